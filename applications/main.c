@@ -11,22 +11,26 @@
 
 /* 驱动头文件 */
 #include "drv_oled.h"
+#include "oled_widget.h"
+#include "oled_trend.h"
 #include "drv_max30102.h"
 #include "drv_adxl345.h"
 #include "drv_ds18b20.h"
 #include "drv_ds1302.h"
 #include "drv_key.h"
+#include "temp_predict.h"
 
 /* 全局变量 */
-static uint8_t page = 0;           /* 页面切换变量 */
+static uint8_t page = 0;           /* 页面切换变量: 0主界面, 1运动, 2趋势 */
 static uint8_t setn = 0;           /* 设置项编号 */
 static uint8_t shanshuo = 0;       /* 闪烁标志 */
 
 /* 计步相关 */
 static uint16_t bushu = 0;         /* 步数 */
 static uint16_t mileage_bushu = 0; /* 里程步数 */
-static uint16_t bu_long = 40;      /* 步长(cm) */
+static uint16_t bu_long = 40;      /* 步长(cm), 100步/分时的基准, 实际随步频估计 */
 static int32_t mileage = 0;        /* 里程(m) */
+static uint32_t mileage_cm = 0;    /* 里程(cm), 按估计步长累计 */
 static int32_t warnMileage = 1000; /* 警告里程(m) */
 
 /* 阈值设置 */
@@ -39,7 +43,8 @@ static uint16_t tempMax = 373;     /* 温度上限 (x10) */
 /* 传感器数据 */
 static int32_t hrAvg = 0;          /* 心率 */
 static int32_t spo2Avg = 0;        /* 血氧 */
-static int16_t temperature = 0;    /* 温度 (x10) */
+static int16_t temperature = 0;    /* 温度 (x10), 预测可信时为预测的平衡温度 */
+static uint8_t temp_settled = 0;   /* 温度可用于报警: 预测可信 */
 
 /* 计时相关 */
 static int32_t timeCountRecord = 0;
@@ -52,43 +57,102 @@ static uint8_t beepFlag = 0x00;
 /* 显示缓冲区 */
 static char display[32];
 
+/* 显示字段: 只重绘变化的字符 */
+static oled_field_t fld_date;      /* 2024-01-01 */
+static oled_field_t fld_week;      /* 周X */
+static oled_field_t fld_time;      /* HH:MM:SS */
+static oled_field_t fld_temp;      /* 36.5 */
+static oled_field_t fld_hr;
+static oled_field_t fld_spo2;
+static oled_field_t fld_steps;
+static oled_field_t fld_timer;     /* 计时 HH:MM:SS */
+static oled_field_t fld_mileage;   /* 里程 */
+static oled_field_t fld_trend_hr;  /* 趋势页当前心率 */
+static oled_field_t fld_trend_temp;
+
+/* 趋势图: 心率与体温, 每 TREND_PERIOD_MS 一个样本, 一屏128个样本约4分钟 */
+#define TREND_PERIOD_MS     2000
+static oled_trend_t trend;
+
+/**
+ * @brief 初始化显示字段
+ */
+static void display_fields_init(void)
+{
+    oled_field_init(&fld_date, 0, 0, 10, 0);
+    oled_field_init(&fld_week, 88, 0, 2, 1);
+    oled_field_init(&fld_time, 0, 2, 8, 0);
+    oled_field_init(&fld_temp, 80, 2, 4, 0);
+    oled_field_init(&fld_hr, 0, 6, 3, 0);
+    oled_field_init(&fld_spo2, 48, 6, 3, 0);
+    oled_field_init(&fld_steps, 88, 6, 5, 0);
+    oled_field_init(&fld_timer, 32, 0, 8, 0);
+    oled_field_init(&fld_mileage, 48, 2, 10, 0);
+    oled_field_init(&fld_trend_hr, 24, 0, 3, 0);
+    oled_field_init(&fld_trend_temp, 80, 0, 4, 0);
+
+    /* 心率 40~160 占2~4页, 体温 30.0~40.0 占5~7页 */
+    oled_trend_init(&trend);
+    oled_trend_add_trace(&trend, 2, 3, 40, 160);
+    oled_trend_add_trace(&trend, 5, 3, 300, 400);
+}
+
+/**
+ * @brief 显示 HH:MM:SS 格式的字段
+ */
+static void display_hms(oled_field_t *pf, int32_t h, int32_t m, int32_t s)
+{
+    char buf[9];
+
+    buf[0] = h/10+'0';
+    buf[1] = h%10+'0';
+    buf[2] = ':';
+    buf[3] = m/10+'0';
+    buf[4] = m%10+'0';
+    buf[5] = ':';
+    buf[6] = s/10+'0';
+    buf[7] = s%10+'0';
+    buf[8] = '\0';
+    oled_field_set_text(pf, buf);
+}
+
 /**
  * @brief 显示时间
  */
 static void display_time(void)
 {
-    uint8_t x = 0;
-
-    if (setn == 0) ds1302_read_date(&sys_date);
+    if (setn == 0) ds1302_get_date(&sys_date);
 
     if (setn < 8 && page == 0)
     {
+        char buf[11];
+
         /* 显示日期 2024-01-01 */
-        oled_show_char((x++)*8, 0, '2', 16, setn+1-1);
-        oled_show_char((x++)*8, 0, '0', 16, setn+1-1);
-        oled_show_char((x++)*8, 0, sys_date.year%100/10+'0', 16, setn+1-1);
-        oled_show_char((x++)*8, 0, sys_date.year%10+'0', 16, setn+1-1);
-        oled_show_char((x++)*8, 0, '-', 16, 0);
-        oled_show_char((x++)*8, 0, sys_date.mon/10+'0', 16, setn+1-2);
-        oled_show_char((x++)*8, 0, sys_date.mon%10+'0', 16, setn+1-2);
-        oled_show_char((x++)*8, 0, '-', 16, 0);
-        oled_show_char((x++)*8, 0, sys_date.day/10+'0', 16, setn+1-3);
-        oled_show_char((x++)*8, 0, sys_date.day%10+'0', 16, setn+1-3);
+        buf[0] = '2';
+        buf[1] = '0';
+        buf[2] = sys_date.year%100/10+'0';
+        buf[3] = sys_date.year%10+'0';
+        buf[4] = '-';
+        buf[5] = sys_date.mon/10+'0';
+        buf[6] = sys_date.mon%10+'0';
+        buf[7] = '-';
+        buf[8] = sys_date.day/10+'0';
+        buf[9] = sys_date.day%10+'0';
+        buf[10] = '\0';
+        oled_field_set_text(&fld_date, buf);
+        oled_field_set_inv(&fld_date, setn == 1 ? 0x000F : setn == 2 ? 0x0060 : setn == 3 ? 0x0300 : 0);
+        oled_field_render(&fld_date);
 
         /* 显示星期 */
-        oled_show_chinese(88, 0, 0, setn+1-4);  /* 周 */
-        oled_show_chinese(104, 0, sys_date.week, setn+1-4);
+        oled_field_set_char(&fld_week, 0, 0);   /* 周 */
+        oled_field_set_char(&fld_week, 1, sys_date.week);
+        oled_field_set_inv(&fld_week, setn == 4 ? 0x03 : 0);
+        oled_field_render(&fld_week);
 
-        x = 0;
         /* 显示时间 HH:MM:SS */
-        oled_show_char((x++)*8, 2, sys_date.hour/10+'0', 16, setn+1-5);
-        oled_show_char((x++)*8, 2, sys_date.hour%10+'0', 16, setn+1-5);
-        oled_show_char((x++)*8, 2, ':', 16, 0);
-        oled_show_char((x++)*8, 2, sys_date.min/10+'0', 16, setn+1-6);
-        oled_show_char((x++)*8, 2, sys_date.min%10+'0', 16, setn+1-6);
-        oled_show_char((x++)*8, 2, ':', 16, 0);
-        oled_show_char((x++)*8, 2, sys_date.sec/10+'0', 16, setn+1-7);
-        oled_show_char((x++)*8, 2, sys_date.sec%10+'0', 16, setn+1-7);
+        display_hms(&fld_time, sys_date.hour, sys_date.min, sys_date.sec);
+        oled_field_set_inv(&fld_time, setn == 5 ? 0x03 : setn == 6 ? 0x18 : setn == 7 ? 0xC0 : 0);
+        oled_field_render(&fld_time);
     }
 }
 
@@ -97,7 +161,6 @@ static void display_time(void)
  */
 static void get_heart_rate_spo2(void)
 {
-    uint8_t x = 0;
     static int32_t hrAvg1 = 0;
     static int32_t spo2Avg1 = 0;
 
@@ -119,34 +182,22 @@ static void get_heart_rate_spo2(void)
     hrAvg1 = hrAvg;
     spo2Avg1 = spo2Avg;
 
-    /* 显示心率 */
-    if (((hrAvg != 0) && (hrAvg >= xinlvMax || hrAvg <= xinlvMin)) && shanshuo == 1)
-    {
-        oled_show_char((x++)*8, 6, ' ', 16, 0);
-        oled_show_char((x++)*8, 6, ' ', 16, 0);
-        oled_show_char((x++)*8, 6, ' ', 16, 0);
-    }
-    else
-    {
-        oled_show_char((x++)*8, 6, hrAvg%1000/100+'0', 16, 0);
-        oled_show_char((x++)*8, 6, hrAvg%100/10+'0', 16, 0);
-        oled_show_char((x++)*8, 6, hrAvg%10+'0', 16, 0);
-    }
+    if (page == 2)
+        return;
+
+    /* 显示心率, 超出阈值时闪烁 */
+    oled_field_set_char(&fld_hr, 0, hrAvg%1000/100+'0');
+    oled_field_set_char(&fld_hr, 1, hrAvg%100/10+'0');
+    oled_field_set_char(&fld_hr, 2, hrAvg%10+'0');
+    oled_field_set_blink(&fld_hr, (hrAvg != 0) && (hrAvg >= xinlvMax || hrAvg <= xinlvMin));
+    oled_field_render(&fld_hr);
 
-    x = 6;
     /* 显示血氧 */
-    if (((spo2Avg != 0) && (spo2Avg <= spo2Min)) && shanshuo == 1)
-    {
-        oled_show_char((x++)*8, 6, ' ', 16, 0);
-        oled_show_char((x++)*8, 6, ' ', 16, 0);
-        oled_show_char((x++)*8, 6, ' ', 16, 0);
-    }
-    else
-    {
-        oled_show_char((x++)*8, 6, spo2Avg%1000/100+'0', 16, 0);
-        oled_show_char((x++)*8, 6, spo2Avg%100/10+'0', 16, 0);
-        oled_show_char((x++)*8, 6, spo2Avg%10+'0', 16, 0);
-    }
+    oled_field_set_char(&fld_spo2, 0, spo2Avg%1000/100+'0');
+    oled_field_set_char(&fld_spo2, 1, spo2Avg%100/10+'0');
+    oled_field_set_char(&fld_spo2, 2, spo2Avg%10+'0');
+    oled_field_set_blink(&fld_spo2, (spo2Avg != 0) && (spo2Avg <= spo2Min));
+    oled_field_render(&fld_spo2);
 }
 
 /**
@@ -154,26 +205,40 @@ static void get_heart_rate_spo2(void)
  */
 static void display_temperature(void)
 {
-    uint8_t x = 10;
-
-    temperature = ds18b20_get_temp();
+    static tp_t tp;
+    static uint32_t last_seq = 0;
+    ds18b20_reading_t rd;
+    tp_result_t pr;
+
+    /* 每个新读数送入预测; 可信时显示预测的平衡温度, 否则显示当前读数 */
+    ds18b20_get_reading(&rd);
+    if (rd.seq != last_seq)
+    {
+        if (last_seq == 0)
+            tp_init(&tp);
+        last_seq = rd.seq;
+        tp_push(&tp, rd.raw, (uint32_t)((uint64_t)rd.tick * 1000 / RT_TICK_PER_SECOND));
+    }
+    if (rd.seq == 0)
+    {
+        temperature = ds18b20_get_temp();
+        temp_settled = 0;
+    }
+    else
+    {
+        tp_get_result(&tp, &pr);
+        temperature = pr.ch_confident ? pr.n_pred_x10 : rd.temp_x10;
+        temp_settled = pr.ch_confident;
+    }
 
     if (page == 0)
     {
-        if ((temperature <= tempMin || temperature >= tempMax) && shanshuo == 1)
-        {
-            oled_show_char((x++)*8, 2, ' ', 16, 0);
-            oled_show_char((x++)*8, 2, ' ', 16, 0);
-            oled_show_char((x++)*8, 2, ' ', 16, 0);
-            oled_show_char((x++)*8, 2, ' ', 16, 0);
-        }
-        else
-        {
-            oled_show_char((x++)*8, 2, temperature/100+'0', 16, 0);
-            oled_show_char((x++)*8, 2, temperature%100/10+'0', 16, 0);
-            oled_show_char((x++)*8, 2, '.', 16, 0);
-            oled_show_char((x++)*8, 2, temperature%10+'0', 16, 0);
-        }
+        oled_field_set_char(&fld_temp, 0, temperature/100+'0');
+        oled_field_set_char(&fld_temp, 1, temperature%100/10+'0');
+        oled_field_set_char(&fld_temp, 2, '.');
+        oled_field_set_char(&fld_temp, 3, temperature%10+'0');
+        oled_field_set_blink(&fld_temp, temp_settled && (temperature <= tempMin || temperature >= tempMax));
+        oled_field_render(&fld_temp);
     }
 }
 
@@ -182,73 +247,45 @@ static void display_temperature(void)
  */
 static void get_steps(void)
 {
-    static uint16_t temp = 0;
+    static uint32_t last_steps = 0;
+    static uint32_t last_distance = 0;
+    pedo_result_t res;
     float tempMileage = 0.0f;
-    uint8_t x = 11;
-    float adx, ady, adz;
-    float acc;
-
-    adxl345_read_average(&adx, &ady, &adz, 10);
-    acc = ady;
-
-    if (acc > 0)
-    {
-        if (acc / 10 >= 10)
-        {
-            if (bushu < 60000) bushu++;
-            if (mileage_bushu < 60000) mileage_bushu++;
-        }
-    }
+    uint32_t n;
+
+    /* 计步在ADXL345采集线程中逐样本进行, 这里只取累计结果的增量 */
+    adxl345_pedo_set_stride(bu_long);
+    adxl345_pedo_get(&res);
+    n = res.un_steps - last_steps;
+    last_steps = res.un_steps;
+    bushu = bushu + n < 60000 ? bushu + n : 60000;
+    mileage_bushu = mileage_bushu + n < 60000 ? mileage_bushu + n : 60000;
+    mileage_cm += res.un_distance_cm - last_distance;
+    last_distance = res.un_distance_cm;
+    mileage = mileage_cm / 100;
 
     if (page == 0)
     {
+        /* 位数不同时的对齐方式与原界面一致 */
         if (bushu > 9999)
-        {
-            oled_show_char((x++)*8, 6, bushu/10000+'0', 16, 0);
-            oled_show_char((x++)*8, 6, bushu%10000/1000+'0', 16, 0);
-            oled_show_char((x++)*8, 6, bushu%1000/100+'0', 16, 0);
-            oled_show_char((x++)*8, 6, bushu%100/10+'0', 16, 0);
-            oled_show_char((x++)*8, 6, bushu%10+'0', 16, 0);
-        }
+            rt_snprintf(display, sizeof(display), "%5d", bushu);
         else if (bushu > 999)
-        {
-            oled_show_char((x++)*8, 6, ' ', 16, 0);
-            oled_show_char((x++)*8, 6, bushu%10000/1000+'0', 16, 0);
-            oled_show_char((x++)*8, 6, bushu%1000/100+'0', 16, 0);
-            oled_show_char((x++)*8, 6, bushu%100/10+'0', 16, 0);
-            oled_show_char((x++)*8, 6, bushu%10+'0', 16, 0);
-        }
+            rt_snprintf(display, sizeof(display), " %4d", bushu);
         else if (bushu > 99)
-        {
-            oled_show_char((x++)*8, 6, ' ', 16, 0);
-            oled_show_char((x++)*8, 6, ' ', 16, 0);
-            oled_show_char((x++)*8, 6, bushu%1000/100+'0', 16, 0);
-            oled_show_char((x++)*8, 6, bushu%100/10+'0', 16, 0);
-            oled_show_char((x++)*8, 6, bushu%10+'0', 16, 0);
-        }
+            rt_snprintf(display, sizeof(display), "  %3d", bushu);
         else if (bushu > 9)
-        {
-            oled_show_char((x++)*8, 6, ' ', 16, 0);
-            oled_show_char((x++)*8, 6, ' ', 16, 0);
-            oled_show_char((x++)*8, 6, bushu%100/10+'0', 16, 0);
-            oled_show_char((x++)*8, 6, bushu%10+'0', 16, 0);
-            oled_show_char((x++)*8, 6, ' ', 16, 0);
-        }
+            rt_snprintf(display, sizeof(display), "  %2d ", bushu);
         else
-        {
-            oled_show_char((x++)*8, 6, ' ', 16, 0);
-            oled_show_char((x++)*8, 6, ' ', 16, 0);
-            oled_show_char((x++)*8, 6, bushu%10+'0', 16, 0);
-            oled_show_char((x++)*8, 6, ' ', 16, 0);
-            oled_show_char((x++)*8, 6, ' ', 16, 0);
-        }
+            rt_snprintf(display, sizeof(display), "  %d  ", bushu);
+        oled_field_set_text(&fld_steps, display);
+        oled_field_render(&fld_steps);
     }
-    else
+    else if (page == 1)
     {
-        mileage = (mileage_bushu * bu_long) / 100;
         tempMileage = (float)mileage / 1000;
         rt_snprintf(display, sizeof(display), "%6.3fkm ", tempMileage);
-        oled_show_string(48, 2, (uint8_t *)display, 16);
+        oled_field_set_text(&fld_mileage, display);
+        oled_field_render(&fld_mileage);
     }
 }
 
@@ -261,29 +298,49 @@ static void display_time_count(void)
     {
         if (setn == 0)
         {
-            oled_show_char(32, 0, timeCountRecord/3600/10+'0', 16, 0);
-            oled_show_char(40, 0, timeCountRecord/3600%10+'0', 16, 0);
-            oled_show_char(48, 0, ':', 16, 0);
-            oled_show_char(56, 0, timeCountRecord%3600/60/10+'0', 16, 0);
-            oled_show_char(64, 0, timeCountRecord%3600/60%10+'0', 16, 0);
-            oled_show_char(72, 0, ':', 16, 0);
-            oled_show_char(80, 0, timeCountRecord%3600%60/10+'0', 16, 0);
-            oled_show_char(88, 0, timeCountRecord%3600%60%10+'0', 16, 0);
+            display_hms(&fld_timer, timeCountRecord/3600, timeCountRecord%3600/60, timeCountRecord%3600%60);
+            oled_field_set_inv(&fld_timer, 0);
+            oled_field_render(&fld_timer);
         }
         else if (setn < 4)
         {
-            oled_show_char(32, 0, shi/10+'0', 16, setn+1-1);
-            oled_show_char(40, 0, shi%10+'0', 16, setn+1-1);
-            oled_show_char(48, 0, ':', 16, 0);
-            oled_show_char(56, 0, fen/10+'0', 16, setn+1-2);
-            oled_show_char(64, 0, fen%10+'0', 16, setn+1-2);
-            oled_show_char(72, 0, ':', 16, 0);
-            oled_show_char(80, 0, miao/10+'0', 16, setn+1-3);
-            oled_show_char(88, 0, miao%10+'0', 16, setn+1-3);
+            display_hms(&fld_timer, shi, fen, miao);
+            oled_field_set_inv(&fld_timer, setn == 1 ? 0x03 : setn == 2 ? 0x18 : 0xC0);
+            oled_field_render(&fld_timer);
         }
     }
 }
 
+/**
+ * @brief 记录趋势样本, 趋势页显示中同时刷新当前值
+ * 无有效心率时心率曲线断开.
+ */
+static void trend_update(void)
+{
+    static rt_tick_t last = 0;
+    int16_t values[2];
+
+    if (page == 2)
+    {
+        rt_snprintf(display, sizeof(display), "%3d", hrAvg);
+        oled_field_set_text(&fld_trend_hr, display);
+        oled_field_render(&fld_trend_hr);
+        oled_field_set_char(&fld_trend_temp, 0, temperature/100+'0');
+        oled_field_set_char(&fld_trend_temp, 1, temperature%100/10+'0');
+        oled_field_set_char(&fld_trend_temp, 2, '.');
+        oled_field_set_char(&fld_trend_temp, 3, temperature%10+'0');
+        oled_field_render(&fld_trend_temp);
+    }
+
+    if (rt_tick_get() - last < rt_tick_from_millisecond(TREND_PERIOD_MS))
+        return;
+    last = rt_tick_get();
+
+    values[0] = hrAvg != 0 ? (int16_t)hrAvg : OLED_TREND_NONE;
+    values[1] = temperature;
+    oled_trend_push(&trend, values);
+}
+
 /**
  * @brief 显示设置值
  */
@@ -344,6 +401,10 @@ static void key_settings(void)
 
     keynum = key_scan(1);
 
+    /* 趋势页只响应切换界面 */
+    if (page == 2 && keynum != KEY4_PRESS)
+        keynum = 0;
+
     if (keynum == KEY0_PRESS)  /* 设置 */
     {
         setn++;
@@ -475,6 +536,7 @@ static void key_settings(void)
                 else
                 {
                     mileage = 0;
+                    mileage_cm = 0;
                     mileage_bushu = 0;
                 }
             }
@@ -509,18 +571,26 @@ static void key_settings(void)
 
     if (keynum == KEY4_PRESS && setn == 0)  /* 切换显示界面 */
     {
-        page = !page;
+        page = (page + 1) % 3;
         oled_clear();
         if (page == 0)
         {
+            oled_trend_hide(&trend);
             oled_show_string(0, 4, (uint8_t *)"HR", 16);
             oled_show_string(48, 4, (uint8_t *)"SpO2", 16);
             oled_show_string(95, 4, (uint8_t *)"Step", 16);
         }
-        else
+        else if (page == 1)
         {
             oled_show_string(0, 2, (uint8_t *)"Mileage:", 16);
         }
+        else
+        {
+            oled_show_string(0, 0, (uint8_t *)"HR", 16);
+            oled_show_string(64, 0, (uint8_t *)"T", 16);
+            oled_show_centigrade(112, 0);
+            oled_trend_show(&trend);
+        }
     }
 }
 
@@ -560,7 +630,7 @@ static void alarm_thread_entry(void *parameter)
         /* 阈值报警 */
         if (((hrAvg != 0) && (hrAvg >= xinlvMax || hrAvg <= xinlvMin)) ||
             ((spo2Avg != 0) && (spo2Avg <= spo2Min)) ||
-            (temperature >= tempMax || temperature <= tempMin))
+            (temp_settled && (temperature >= tempMax || temperature <= tempMin)))
         {
             beep_toggle();
             rt_thread_mdelay(100);
@@ -630,18 +700,25 @@ int main(void)
 
     /* 初始化OLED */
     oled_init();
+    oled_service_start();
     rt_thread_mdelay(100);
 
     /* 初始化DS1302 RTC */
     ds1302_init(RT_NULL);
 
-    /* 初始化MAX30102 */
-    max30102_init();
+    /* 初始化MAX30102, 启动中断驱动的采集与处理线程 */
+    if (max30102_init() == RT_EOK)
+        max30102_acq_start();
+
+    /* ADXL345切换到FIFO流模式, 水位中断驱动采集 */
+    adxl345_acq_start();
+    ds18b20_async_start();
 
     /* 显示欢迎信息 */
     oled_clear();
     oled_show_string(16, 2, (uint8_t *)"Smart Band", 16);
     oled_show_string(24, 4, (uint8_t *)"ART-Pi II", 16);
+    oled_commit();
     rt_thread_mdelay(2000);
 
     /* 显示主界面 */
@@ -670,10 +747,13 @@ int main(void)
     if (tid != RT_NULL)
         rt_thread_startup(tid);
 
+    display_fields_init();
+
     /* 主循环 */
     while (1)
     {
         shanshuo = !shanshuo;
+        oled_widget_set_phase(shanshuo);
         key_settings();
         display_time();
         display_time_count();
@@ -683,8 +763,12 @@ int main(void)
             display_temperature();
             get_steps();
             get_heart_rate_spo2();
+            trend_update();
         }
 
+        /* 提交本轮绘制, 由显示服务线程写出 */
+        oled_commit();
+
         rt_thread_mdelay(100);
     }
 
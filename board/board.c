@@ -145,6 +145,74 @@ void delay_us(uint32_t us)
     }
 }
 
+/**
+ * @brief 微秒时间戳: 系统节拍加SysTick计数, 约71分钟回绕, 用于测量间隔
+ */
+uint32_t get_time_us(void)
+{
+    rt_tick_t tick;
+    uint32_t val;
+
+    /* 读VAL期间节拍可能进位, 重读直到前后一致 */
+    do
+    {
+        tick = rt_tick_get();
+        val = SysTick->VAL;
+    } while (tick != rt_tick_get());
+
+    return tick * (1000000 / RT_TICK_PER_SECOND) + (SysTick->LOAD - val) / (SystemCoreClock / 1000000);
+}
+
+/* ==================== 微秒单次定时器 ==================== */
+
+/* TIM7基本定时器: APB1 120MHz, 定时器时钟倍频为240MHz, 预分频到1MHz, 单脉冲模式 */
+#define US_TIMER                TIM7
+#define US_TIMER_IRQn           TIM7_IRQn
+#define US_TIMER_IRQ_PRIO       1       /* 高于其他外设, 位时隙的误差取决于它的响应延迟 */
+
+static void (*us_timer_callback)(void);
+
+/**
+ * @brief us微秒后在中断中调用一次callback, 重新启动会取消未到期的一次
+ */
+void us_timer_start(uint32_t us, void (*callback)(void))
+{
+    static uint8_t inited;
+
+    if (!inited)
+    {
+        inited = 1;
+        __HAL_RCC_TIM7_CLK_ENABLE();
+        US_TIMER->PSC = 240 - 1;
+        US_TIMER->CR1 = TIM_CR1_OPM | TIM_CR1_URS;
+        US_TIMER->DIER = TIM_DIER_UIE;
+        HAL_NVIC_SetPriority(US_TIMER_IRQn, US_TIMER_IRQ_PRIO, 0);
+        HAL_NVIC_EnableIRQ(US_TIMER_IRQn);
+    }
+
+    US_TIMER->CR1 &= ~TIM_CR1_CEN;
+    us_timer_callback = callback;
+    US_TIMER->ARR = us > 1 ? us - 1 : 1;
+    US_TIMER->EGR = TIM_EGR_UG;             /* 装载PSC/ARR, URS置位时不产生中断 */
+    US_TIMER->SR = 0;
+    US_TIMER->CR1 |= TIM_CR1_CEN;
+}
+
+/**
+ * @brief TIM7中断处理
+ */
+void TIM7_IRQHandler(void)
+{
+    rt_interrupt_enter();
+    if (US_TIMER->SR & TIM_SR_UIF)
+    {
+        US_TIMER->SR = 0;
+        if (us_timer_callback != RT_NULL)
+            us_timer_callback();
+    }
+    rt_interrupt_leave();
+}
+
 /**
  * @brief 延时函数 (毫秒)
  */
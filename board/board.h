@@ -23,10 +23,16 @@ extern "C" {
 #define BSP_I2C1_SCL_PIN                  GET_PIN(B, 6)
 #define BSP_I2C1_SDA_PIN                  GET_PIN(B, 7)
 
+/* MAX30102 中断 (开漏, 低电平有效) */
+#define BSP_MAX30102_INT_PIN              GET_PIN(B, 8)
+
 /* I2C2 - 用于ADXL345 */
 #define BSP_I2C2_SCL_PIN                  GET_PIN(B, 10)
 #define BSP_I2C2_SDA_PIN                  GET_PIN(B, 11)
 
+/* ADXL345 INT1 (推挽, 高电平有效) */
+#define BSP_ADXL345_INT1_PIN              GET_PIN(B, 1)
+
 /* DS18B20 单总线 */
 #define BSP_DS18B20_PIN                   GET_PIN(A, 11)
 
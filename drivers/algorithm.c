@@ -4,10 +4,14 @@
  * Copyright (C) 2016 Maxim Integrated Products, Inc.
  */
 #include "algorithm.h"
+#include <string.h>
+#include <math.h>
 
-/* 数据缓冲区 */
-static int32_t an_x[BUFFER_SIZE];
-static int32_t an_y[BUFFER_SIZE];
+/* 不带上下文接口使用的默认上下文 (前端默认为4点平滑) */
+static maxim_ctx_t ctx_default;
+
+static inline int32_t maxim_peak_det_step(maxim_peak_det_t *pd, int32_t n_x, int32_t n_prev_x,
+        int32_t n_min_height);
 
 /* SPO2查找表 */
 static const uint8_t uch_spo2_table[184] = {
@@ -30,52 +34,185 @@ void maxim_heart_rate_and_oxygen_saturation(uint32_t *pun_ir_buffer, int32_t n_i
         uint32_t *pun_red_buffer, int32_t *pn_spo2, int8_t *pch_spo2_valid,
         int32_t *pn_heart_rate, int8_t *pch_hr_valid)
 {
-    uint32_t un_ir_mean;
-    int32_t k, n_i_ratio_count;
-    int32_t i, n_exact_ir_valley_locs_count, n_middle_idx;
-    int32_t n_th1, n_npks;
-    int32_t an_ir_valley_locs[15];
-    int32_t n_peak_interval_sum;
+    /* 普通数组即掩码全1、起点为0的视图 */
+    maxim_view_t v_ir = { pun_ir_buffer, 0xFFFFFFFF, 0 };
+    maxim_view_t v_red = { pun_red_buffer, 0xFFFFFFFF, 0 };
 
-    int32_t n_y_ac, n_x_ac;
-    int32_t n_spo2_calc;
-    int32_t n_y_dc_max, n_x_dc_max;
-    int32_t n_y_dc_max_idx, n_x_dc_max_idx;
-    int32_t an_ratio[5], n_ratio_average;
-    int32_t n_nume, n_denom;
+    maxim_heart_rate_and_oxygen_saturation_view(&v_ir, &v_red, n_ir_buffer_length,
+            pn_spo2, pch_spo2_valid, pn_heart_rate, pch_hr_valid);
+}
 
-    /* 计算DC均值并减去DC */
-    un_ir_mean = 0;
-    for (k = 0; k < n_ir_buffer_length; k++)
-        un_ir_mean += pun_ir_buffer[k];
-    un_ir_mean = un_ir_mean / n_ir_buffer_length;
+/**
+ * @brief 计算心率和血氧浓度, 样本经环形缓冲区视图读取, 不做拷贝
+ * @note 使用默认上下文, 不可重入
+ */
+void maxim_heart_rate_and_oxygen_saturation_view(const maxim_view_t *pv_ir, const maxim_view_t *pv_red,
+        int32_t n_ir_buffer_length, int32_t *pn_spo2, int8_t *pch_spo2_valid,
+        int32_t *pn_heart_rate, int8_t *pch_hr_valid)
+{
+    maxim_ctx_calc(&ctx_default, pv_ir, pv_red, n_ir_buffer_length,
+            pn_spo2, pch_spo2_valid, pn_heart_rate, pch_hr_valid);
+}
+
+/**
+ * @brief 初始化整窗计算上下文, 前端为4点平滑
+ */
+void maxim_ctx_init(maxim_ctx_t *pc)
+{
+    memset(pc, 0, sizeof(*pc));
+}
+
+/**
+ * @brief 设置上下文的前端滤波器
+ * @param pf 已设计的带通滤波器 (复制系数), RT_NULL恢复4点平滑
+ */
+void maxim_ctx_set_bpf(maxim_ctx_t *pc, const maxim_bpf_t *pf)
+{
+    if (pf != RT_NULL)
+        pc->bpf = *pf;
+    pc->ch_use_bpf = (pf != RT_NULL);
+}
+
+/**
+ * @brief 设置上下文的工作缓冲区, 以计算长于BUFFER_SIZE的窗口
+ * @param pn_buf 至少n_buf_len个点, 由调用者保持有效; RT_NULL恢复内置缓冲区
+ */
+void maxim_ctx_set_buffer(maxim_ctx_t *pc, int32_t *pn_buf, int32_t n_buf_len)
+{
+    pc->pn_buf = pn_buf;
+    pc->n_buf_len = (pn_buf != RT_NULL) ? n_buf_len : 0;
+}
+/* 视图中第k个原始样本 */
+#define IR_AT(k)        ((int32_t)MAXIM_VIEW_AT(pv_ir, k))
+#define RED_AT(k)       ((int32_t)MAXIM_VIEW_AT(pv_red, k))
+
+/**
+ * @brief 带通前端: 滤波去除基线漂移和高频噪声, 补偿群延迟并翻转信号
+ * @param un_ir_mean 窗口均值, 滤波器状态预置为该值以减小起始瞬态
+ * @return 对齐后的有效点数; 末尾MAXIM_BPF_DELAY点没有对应的滤波输出, 不参与谷值和比率计算
+ */
+static int32_t maxim_bpf_frontend(maxim_bpf_t *pf, int32_t *an_x, const maxim_view_t *pv_ir,
+        int32_t n_ir_buffer_length, uint32_t un_ir_mean)
+{
+    int32_t k;
 
-    /* 去除DC并翻转信号 */
     for (k = 0; k < n_ir_buffer_length; k++)
-        an_x[k] = -1 * (pun_ir_buffer[k] - un_ir_mean);
+        an_x[k] = IR_AT(k);
+    maxim_bpf_reset(pf, (int32_t)un_ir_mean);
+    maxim_bpf_process(pf, an_x, n_ir_buffer_length);
 
-    /* 4点移动平均 */
-    for (k = 0; k < BUFFER_SIZE - MA4_SIZE; k++)
+    /* 补偿群延迟, 使谷值位置对齐原始信号 */
+    for (k = 0; k < n_ir_buffer_length - MAXIM_BPF_DELAY; k++)
+        an_x[k] = -an_x[k + MAXIM_BPF_DELAY];
+    return n_ir_buffer_length - MAXIM_BPF_DELAY;
+}
+
+/* 窗口的阈值: 前端输出均值, 限制在30~60之间 */
+static int32_t maxim_calc_threshold(const int32_t *an_x, int32_t n_len)
+{
+    int32_t k, n_th1 = 0;
+
+    for (k = 0; k < n_len; k++)
+        n_th1 += an_x[k];
+    n_th1 = n_th1 / n_len;
+    if (n_th1 < 30) n_th1 = 30;
+    if (n_th1 > 60) n_th1 = 60;
+    return n_th1;
+}
+
+/**
+ * @brief 一对相邻谷值之间的AC/DC比率
+ * @return 1-比率有效, 0-无效
+ */
+static int32_t maxim_pair_ratio(const maxim_view_t *pv_ir, const maxim_view_t *pv_red,
+        int32_t n_v0, int32_t n_v1, int32_t *pn_ratio)
+{
+    int32_t i;
+    int32_t n_y_ac, n_x_ac;
+    int32_t n_y_dc_max = -16777216, n_x_dc_max = -16777216;
+    int32_t n_y_dc_max_idx = n_v0, n_x_dc_max_idx = n_v0;
+    int32_t n_nume, n_denom;
+
+    for (i = n_v0; i < n_v1; i++)
     {
-        an_x[k] = (an_x[k] + an_x[k + 1] + an_x[k + 2] + an_x[k + 3]) / 4;
+        if (IR_AT(i) > n_x_dc_max)
+        {
+            n_x_dc_max = IR_AT(i);
+            n_x_dc_max_idx = i;
+        }
+        if (RED_AT(i) > n_y_dc_max)
+        {
+            n_y_dc_max = RED_AT(i);
+            n_y_dc_max_idx = i;
+        }
     }
+    n_y_ac = (RED_AT(n_v1) - RED_AT(n_v0)) * (n_y_dc_max_idx - n_v0);
+    n_y_ac = RED_AT(n_v0) + n_y_ac / (n_v1 - n_v0);
+    n_y_ac = RED_AT(n_y_dc_max_idx) - n_y_ac;
+    n_x_ac = (IR_AT(n_v1) - IR_AT(n_v0)) * (n_x_dc_max_idx - n_v0);
+    n_x_ac = IR_AT(n_v0) + n_x_ac / (n_v1 - n_v0);
+    n_x_ac = IR_AT(n_y_dc_max_idx) - n_x_ac;
+    n_nume = (n_y_ac * n_x_dc_max) >> 7;
+    n_denom = (n_x_ac * n_y_dc_max) >> 7;
 
-    /* 计算阈值 */
-    n_th1 = 0;
-    for (k = 0; k < BUFFER_SIZE; k++)
+    *pn_ratio = 0;
+    if (n_denom > 0 && n_nume != 0)
     {
-        n_th1 += an_x[k];
+        *pn_ratio = (n_nume * 100) / n_denom;
+        return 1;
     }
-    n_th1 = n_th1 / BUFFER_SIZE;
-    if (n_th1 < 30) n_th1 = 30;
-    if (n_th1 > 60) n_th1 = 60;
+    return 0;
+}
 
-    for (k = 0; k < 15; k++) an_ir_valley_locs[k] = 0;
+/**
+ * @brief 经缓存取一对谷值的比率, 并记入新缓存
+ * @note 谷值按样本序号比较, 上次窗口中已算过的谷值对不再扫描原始数据
+ */
+static int32_t maxim_pair_ratio_cached(const maxim_ratio_cache_t *pc_old, maxim_ratio_cache_t *pc_new,
+        const maxim_view_t *pv_ir, const maxim_view_t *pv_red, int32_t n_v0, int32_t n_v1, int32_t *pn_ratio)
+{
+    uint32_t un_v0 = pv_ir->un_start + (uint32_t)n_v0;
+    uint32_t un_v1 = pv_ir->un_start + (uint32_t)n_v1;
+    int32_t j, n_valid;
 
-    /* 寻找峰值 */
-    maxim_find_peaks(an_ir_valley_locs, &n_npks, an_x, BUFFER_SIZE, n_th1, 4, 15);
-    n_peak_interval_sum = 0;
+    for (j = 0; j < pc_old->n_num; j++)
+    {
+        if (pc_old->aun_v0[j] == un_v0 && pc_old->aun_v1[j] == un_v1)
+            break;
+    }
+    if (j < pc_old->n_num)
+    {
+        *pn_ratio = pc_old->an_ratio[j];
+        n_valid = pc_old->ach_valid[j];
+    }
+    else
+    {
+        n_valid = maxim_pair_ratio(pv_ir, pv_red, n_v0, n_v1, pn_ratio);
+    }
 
+    j = pc_new->n_num++;
+    pc_new->aun_v0[j] = un_v0;
+    pc_new->aun_v1[j] = un_v1;
+    pc_new->an_ratio[j] = *pn_ratio;
+    pc_new->ach_valid[j] = (int8_t)n_valid;
+    return n_valid;
+}
+
+/**
+ * @brief 由谷值位置计算心率, 由谷值间的原始数据计算血氧 (整窗与流式计算共用)
+ * @param pc 比率缓存, 流式计算沿用上次窗口中相同谷值对的比率; RT_NULL不缓存
+ */
+static void maxim_calc_result(const int32_t *an_ir_valley_locs, int32_t n_npks,
+        const maxim_view_t *pv_ir, const maxim_view_t *pv_red, int32_t n_ir_buffer_length,
+        maxim_ratio_cache_t *pc, int32_t *pn_spo2, int8_t *pch_spo2_valid,
+        int32_t *pn_heart_rate, int8_t *pch_hr_valid)
+{
+    maxim_ratio_cache_t cache_new;
+    int32_t k, n_i_ratio_count, n_middle_idx;
+    int32_t n_peak_interval_sum;
+    int32_t an_ratio[5], n_ratio_average, n_ratio, n_valid;
+
+    n_peak_interval_sum = 0;
     if (n_npks >= 2)
     {
         for (k = 1; k < n_npks; k++)
@@ -90,21 +227,14 @@ void maxim_heart_rate_and_oxygen_saturation(uint32_t *pun_ir_buffer, int32_t n_i
         *pch_hr_valid = 0;
     }
 
-    /* 加载原始数据用于SPO2计算 */
-    for (k = 0; k < n_ir_buffer_length; k++)
-    {
-        an_x[k] = pun_ir_buffer[k];
-        an_y[k] = pun_red_buffer[k];
-    }
-
-    n_exact_ir_valley_locs_count = n_npks;
+    /* SPO2计算直接读取原始数据 */
     n_ratio_average = 0;
     n_i_ratio_count = 0;
     for (k = 0; k < 5; k++) an_ratio[k] = 0;
 
-    for (k = 0; k < n_exact_ir_valley_locs_count; k++)
+    for (k = 0; k < n_npks; k++)
     {
-        if (an_ir_valley_locs[k] > BUFFER_SIZE)
+        if (an_ir_valley_locs[k] > n_ir_buffer_length)
         {
             *pn_spo2 = -999;
             *pch_spo2_valid = 0;
@@ -112,41 +242,22 @@ void maxim_heart_rate_and_oxygen_saturation(uint32_t *pun_ir_buffer, int32_t n_i
         }
     }
 
-    /* 计算AC/DC比率 */
-    for (k = 0; k < n_exact_ir_valley_locs_count - 1; k++)
+    /* 计算AC/DC比率, 取前5个有效值 */
+    cache_new.n_num = 0;
+    for (k = 0; k < n_npks - 1 && n_i_ratio_count < 5; k++)
     {
-        n_y_dc_max = -16777216;
-        n_x_dc_max = -16777216;
-        if (an_ir_valley_locs[k + 1] - an_ir_valley_locs[k] > 3)
-        {
-            for (i = an_ir_valley_locs[k]; i < an_ir_valley_locs[k + 1]; i++)
-            {
-                if (an_x[i] > n_x_dc_max)
-                {
-                    n_x_dc_max = an_x[i];
-                    n_x_dc_max_idx = i;
-                }
-                if (an_y[i] > n_y_dc_max)
-                {
-                    n_y_dc_max = an_y[i];
-                    n_y_dc_max_idx = i;
-                }
-            }
-            n_y_ac = (an_y[an_ir_valley_locs[k + 1]] - an_y[an_ir_valley_locs[k]]) * (n_y_dc_max_idx - an_ir_valley_locs[k]);
-            n_y_ac = an_y[an_ir_valley_locs[k]] + n_y_ac / (an_ir_valley_locs[k + 1] - an_ir_valley_locs[k]);
-            n_y_ac = an_y[n_y_dc_max_idx] - n_y_ac;
-            n_x_ac = (an_x[an_ir_valley_locs[k + 1]] - an_x[an_ir_valley_locs[k]]) * (n_x_dc_max_idx - an_ir_valley_locs[k]);
-            n_x_ac = an_x[an_ir_valley_locs[k]] + n_x_ac / (an_ir_valley_locs[k + 1] - an_ir_valley_locs[k]);
-            n_x_ac = an_x[n_y_dc_max_idx] - n_x_ac;
-            n_nume = (n_y_ac * n_x_dc_max) >> 7;
-            n_denom = (n_x_ac * n_y_dc_max) >> 7;
-            if (n_denom > 0 && n_i_ratio_count < 5 && n_nume != 0)
-            {
-                an_ratio[n_i_ratio_count] = (n_nume * 100) / n_denom;
-                n_i_ratio_count++;
-            }
-        }
+        if (an_ir_valley_locs[k + 1] - an_ir_valley_locs[k] <= 3)
+            continue;
+        if (pc != RT_NULL)
+            n_valid = maxim_pair_ratio_cached(pc, &cache_new, pv_ir, pv_red,
+                    an_ir_valley_locs[k], an_ir_valley_locs[k + 1], &n_ratio);
+        else
+            n_valid = maxim_pair_ratio(pv_ir, pv_red, an_ir_valley_locs[k], an_ir_valley_locs[k + 1], &n_ratio);
+        if (n_valid)
+            an_ratio[n_i_ratio_count++] = n_ratio;
     }
+    if (pc != RT_NULL)
+        *pc = cache_new;
 
     /* 取中值 */
     maxim_sort_ascend(an_ratio, n_i_ratio_count);
@@ -159,8 +270,7 @@ void maxim_heart_rate_and_oxygen_saturation(uint32_t *pun_ir_buffer, int32_t n_i
 
     if (n_ratio_average > 2 && n_ratio_average < 184)
     {
-        n_spo2_calc = uch_spo2_table[n_ratio_average];
-        *pn_spo2 = n_spo2_calc;
+        *pn_spo2 = uch_spo2_table[n_ratio_average];
         *pch_spo2_valid = 1;
     }
     else
@@ -171,121 +281,520 @@ void maxim_heart_rate_and_oxygen_saturation(uint32_t *pun_ir_buffer, int32_t n_i
 }
 
 /**
- * @brief 寻找峰值
+ * @brief 在指定上下文中计算心率和血氧浓度, 各上下文之间可并行
+ * @note 窗口长度须在 MA4_SIZE (带通前端为 MAXIM_BPF_MIN_LEN) ~ 工作缓冲区长度之间, 否则结果无效
+ */
+void maxim_ctx_calc(maxim_ctx_t *pc, const maxim_view_t *pv_ir, const maxim_view_t *pv_red,
+        int32_t n_ir_buffer_length, int32_t *pn_spo2, int8_t *pch_spo2_valid,
+        int32_t *pn_heart_rate, int8_t *pch_hr_valid)
+{
+    int32_t *an_x = (pc->pn_buf != RT_NULL) ? pc->pn_buf : pc->an_x;
+    int32_t n_max_len = (pc->pn_buf != RT_NULL) ? pc->n_buf_len : BUFFER_SIZE;
+    int32_t an_ir_valley_locs[MAXIM_MAX_PEAKS];
+    uint32_t un_ir_mean;
+    int32_t k, n_th1, n_npks, n_len;
+
+    /* 窗口不能超过工作缓冲区; 带通前端对齐后还须剩下足够的点 */
+    if (n_ir_buffer_length < (pc->ch_use_bpf ? MAXIM_BPF_MIN_LEN : MA4_SIZE) ||
+        n_ir_buffer_length > n_max_len)
+    {
+        *pn_heart_rate = -999;
+        *pch_hr_valid = 0;
+        *pn_spo2 = -999;
+        *pch_spo2_valid = 0;
+        return;
+    }
+
+    /* 计算DC均值并减去DC */
+    un_ir_mean = 0;
+    for (k = 0; k < n_ir_buffer_length; k++)
+        un_ir_mean += MAXIM_VIEW_AT(pv_ir, k);
+    un_ir_mean = un_ir_mean / n_ir_buffer_length;
+
+    n_len = n_ir_buffer_length;
+    if (pc->ch_use_bpf)
+    {
+        n_len = maxim_bpf_frontend(&pc->bpf, an_x, pv_ir, n_ir_buffer_length, un_ir_mean);
+    }
+    else
+    {
+        /* 去除DC并翻转信号 */
+        for (k = 0; k < n_ir_buffer_length; k++)
+            an_x[k] = -1 * (MAXIM_VIEW_AT(pv_ir, k) - un_ir_mean);
+
+        /* 4点移动平均 */
+        for (k = 0; k < n_ir_buffer_length - MA4_SIZE; k++)
+        {
+            an_x[k] = (an_x[k] + an_x[k + 1] + an_x[k + 2] + an_x[k + 3]) / 4;
+        }
+    }
+
+    /* 计算阈值并寻找峰值 */
+    n_th1 = maxim_calc_threshold(an_x, n_len);
+    maxim_find_peaks(an_ir_valley_locs, &n_npks, an_x, n_len, n_th1,
+                     MAXIM_PEAK_REFRACTORY, MAXIM_MAX_PEAKS);
+
+    maxim_calc_result(an_ir_valley_locs, n_npks, pv_ir, pv_red, n_len, RT_NULL,
+            pn_spo2, pch_spo2_valid, pn_heart_rate, pch_hr_valid);
+}
+
+#undef IR_AT
+#undef RED_AT
+
+/**
+ * @brief 设计带通前端系数 (RBJ二阶巴特沃斯高通 + 低通), 并清零状态
+ * @param f_fs 采样率, f_lo/f_hi 通带下限/上限 (Hz)
+ */
+void maxim_bpf_design(maxim_bpf_t *pf, float f_fs, float f_lo, float f_hi)
+{
+    const float f_scale = (float)(1L << MAXIM_BPF_Q);
+    float f_f[MAXIM_BPF_SECTIONS] = { f_lo, f_hi };
+    int32_t n_s;
+
+    memset(pf, 0, sizeof(*pf));
+    for (n_s = 0; n_s < MAXIM_BPF_SECTIONS; n_s++)
+    {
+        maxim_biquad_t *pq = &pf->sec[n_s];
+        float f_w0 = 2.0f * 3.14159265f * f_f[n_s] / f_fs;
+        float f_cos = cosf(f_w0);
+        float f_alpha = sinf(f_w0) * 0.70710678f;     /* sin(w0) / (2Q), Q = 1/sqrt(2) */
+        float f_a0 = 1.0f + f_alpha;
+        float f_b0 = (n_s == 0) ? (1.0f + f_cos) / 2.0f : (1.0f - f_cos) / 2.0f;
+        float f_b1 = (n_s == 0) ? -(1.0f + f_cos) : (1.0f - f_cos);
+
+        pq->an_b[0] = (int32_t)lrintf(f_b0 / f_a0 * f_scale);
+        pq->an_b[1] = (int32_t)lrintf(f_b1 / f_a0 * f_scale);
+        pq->an_b[2] = pq->an_b[0];
+        pq->an_a[0] = (int32_t)lrintf(-2.0f * f_cos / f_a0 * f_scale);
+        pq->an_a[1] = (int32_t)lrintf((1.0f - f_alpha) / f_a0 * f_scale);
+    }
+}
+
+/**
+ * @brief 将状态预置为输入恒为n_x0时的稳态 (高通输出0)
  */
-void maxim_find_peaks(int32_t *pn_locs, int32_t *n_npks, int32_t *pn_x,
-        int32_t n_size, int32_t n_min_height, int32_t n_min_distance, int32_t n_max_num)
+void maxim_bpf_reset(maxim_bpf_t *pf, int32_t n_x0)
 {
-    maxim_peaks_above_min_height(pn_locs, n_npks, pn_x, n_size, n_min_height);
-    maxim_remove_close_peaks(pn_locs, n_npks, pn_x, n_min_distance);
-    *n_npks = min(*n_npks, n_max_num);
+    int32_t n_s;
+
+    for (n_s = 0; n_s < MAXIM_BPF_SECTIONS; n_s++)
+    {
+        pf->sec[n_s].an_x[0] = pf->sec[n_s].an_x[1] = (n_s == 0) ? n_x0 : 0;
+        pf->sec[n_s].an_y[0] = pf->sec[n_s].an_y[1] = 0;
+    }
+}
+
+/* 一个二阶节的一次运算, 四舍五入回到样本精度 */
+static inline int32_t maxim_biquad_run(const maxim_biquad_t *pq, int32_t n_x,
+        int32_t n_x1, int32_t n_x2, int32_t n_y1, int32_t n_y2)
+{
+    int64_t n_acc = (int64_t)pq->an_b[0] * n_x + (int64_t)pq->an_b[1] * n_x1 + (int64_t)pq->an_b[2] * n_x2
+                  - (int64_t)pq->an_a[0] * n_y1 - (int64_t)pq->an_a[1] * n_y2;
+
+    return (int32_t)((n_acc + (1LL << (MAXIM_BPF_Q - 1))) >> MAXIM_BPF_Q);
 }
 
 /**
- * @brief 寻找高于最小高度的峰值
+ * @brief 对一段样本原地滤波, 逐节处理整块, 状态保存在寄存器中
  */
-void maxim_peaks_above_min_height(int32_t *pn_locs, int32_t *n_npks, int32_t *pn_x,
-        int32_t n_size, int32_t n_min_height)
+void maxim_bpf_process(maxim_bpf_t *pf, int32_t *pn_x, int32_t n_len)
 {
-    int32_t i = 1, riseFound = 0, holdOff1 = 0, holdOff2 = 0, holdOffThresh = 4;
-    *n_npks = 0;
+    int32_t n_s, k;
 
-    while (i < n_size - 1)
+    for (n_s = 0; n_s < MAXIM_BPF_SECTIONS; n_s++)
     {
-        if (holdOff2 == 0)
+        maxim_biquad_t *pq = &pf->sec[n_s];
+        int32_t n_x1 = pq->an_x[0], n_x2 = pq->an_x[1];
+        int32_t n_y1 = pq->an_y[0], n_y2 = pq->an_y[1];
+
+        for (k = 0; k < n_len; k++)
         {
-            if (pn_x[i] > n_min_height && pn_x[i] > pn_x[i - 1])
-            {
-                riseFound = 1;
-            }
-            if (riseFound == 1)
+            int32_t n_x = pn_x[k];
+            int32_t n_y = maxim_biquad_run(pq, n_x, n_x1, n_x2, n_y1, n_y2);
+
+            n_x2 = n_x1;
+            n_x1 = n_x;
+            n_y2 = n_y1;
+            n_y1 = n_y;
+            pn_x[k] = n_y;
+        }
+        pq->an_x[0] = n_x1;
+        pq->an_x[1] = n_x2;
+        pq->an_y[0] = n_y1;
+        pq->an_y[1] = n_y2;
+    }
+}
+
+/**
+ * @brief 滤波一个样本, 供流式计算使用
+ */
+int32_t maxim_bpf_step(maxim_bpf_t *pf, int32_t n_x)
+{
+    int32_t n_s;
+
+    for (n_s = 0; n_s < MAXIM_BPF_SECTIONS; n_s++)
+    {
+        maxim_biquad_t *pq = &pf->sec[n_s];
+        int32_t n_y = maxim_biquad_run(pq, n_x, pq->an_x[0], pq->an_x[1], pq->an_y[0], pq->an_y[1]);
+
+        pq->an_x[1] = pq->an_x[0];
+        pq->an_x[0] = n_x;
+        pq->an_y[1] = pq->an_y[0];
+        pq->an_y[0] = n_y;
+        n_x = n_y;
+    }
+    return n_x;
+}
+
+/**
+ * @brief 设置默认上下文的前端滤波器
+ * @param pf 已设计的带通滤波器 (复制系数), RT_NULL恢复4点平滑
+ */
+void maxim_set_bpf(const maxim_bpf_t *pf)
+{
+    maxim_ctx_set_bpf(&ctx_default, pf);
+}
+
+/**
+ * @brief 设置默认上下文的工作缓冲区, RT_NULL恢复内置缓冲区
+ */
+void maxim_set_buffer(int32_t *pn_buf, int32_t n_buf_len)
+{
+    maxim_ctx_set_buffer(&ctx_default, pn_buf, n_buf_len);
+}
+
+/**
+ * @brief 初始化流式心率血氧计算
+ */
+void maxim_stream_init(maxim_stream_t *ps)
+{
+    memset(ps, 0, sizeof(*ps));
+    maxim_peak_det_init(&ps->det, MAXIM_PEAK_REFRACTORY);
+    ps->n_heart_rate = -999;
+    ps->n_spo2 = -999;
+}
+
+/**
+ * @brief 设置流式计算的前端滤波器, 须在输入第一个样本之前调用
+ * @param pf 已设计的带通滤波器 (复制系数), RT_NULL恢复4点平滑
+ */
+void maxim_stream_set_bpf(maxim_stream_t *ps, const maxim_bpf_t *pf)
+{
+    if (pf != RT_NULL)
+        ps->bpf = *pf;
+    ps->ch_use_bpf = (pf != RT_NULL);
+}
+
+/**
+ * @brief 对最近BUFFER_SIZE个样本计算并发布结果, 与整窗算法逐位相同
+ * @note 4点平滑由增量维护的窗口和与4点和直接得出, 阈值也由增量和得出,
+ *       只剩一遍峰值检测; 相邻谷值对的比率沿用上次窗口的结果
+ */
+static void maxim_stream_calc(maxim_stream_t *ps)
+{
+    const uint32_t un_mask = MAXIM_STREAM_RING - 1;
+    uint32_t un_start = (uint32_t)ps->n_count - BUFFER_SIZE;
+    maxim_view_t v_ir = { ps->aun_ir, un_mask, un_start };
+    maxim_view_t v_red = { ps->aun_red, un_mask, un_start };
+    uint32_t un_ir_mean = ps->un_ir_sum / BUFFER_SIZE;
+    uint32_t un_m4 = un_ir_mean * 4;
+    int32_t an_ir_valley_locs[MAXIM_MAX_PEAKS];
+    int32_t k, n_th1, n_th1_hi, n_npks, n_x, n_prev_x, n_sum, n_len = BUFFER_SIZE;
+    maxim_peak_det_t det;
+
+    if (ps->ch_use_bpf)
+    {
+        maxim_bpf_t bpf = ps->bpf;
+
+        n_len = maxim_bpf_frontend(&bpf, ps->an_x, &v_ir, BUFFER_SIZE, un_ir_mean);
+        n_th1 = maxim_calc_threshold(ps->an_x, n_len);
+        maxim_find_peaks(an_ir_valley_locs, &n_npks, ps->an_x, n_len, n_th1,
+                         MAXIM_PEAK_REFRACTORY, MAXIM_MAX_PEAKS);
+    }
+    else
+    {
+        /*
+         * 阈值: 平滑点 trunc((4m-S)/4) = m - ceil(S/4) + (S>4m且S不被4整除),
+         * 末尾MA4_SIZE点之和为 4m - un_sum4. 括号项的个数只在限幅前后落在不同整数时才需逐点统计.
+         */
+        n_sum = (int32_t)(un_ir_mean * BUFFER_SIZE - ps->un_ceil_sum - ps->un_sum4);
+        n_th1 = n_sum / BUFFER_SIZE;
+        n_th1_hi = (n_sum + BUFFER_SIZE - MA4_SIZE) / BUFFER_SIZE;
+        n_th1 = (n_th1 < 30) ? 30 : (n_th1 > 60) ? 60 : n_th1;
+        n_th1_hi = (n_th1_hi < 30) ? 30 : (n_th1_hi > 60) ? 60 : n_th1_hi;
+        if (n_th1 != n_th1_hi)
+        {
+            for (k = 0; k < BUFFER_SIZE - MA4_SIZE; k++)
             {
-                if ((pn_x[i] < n_min_height) && (holdOff1 < holdOffThresh))
-                {
-                    riseFound = 0;
-                    holdOff1 = 0;
-                }
-                else
-                {
-                    if (holdOff1 == holdOffThresh)
-                    {
-                        if ((pn_x[i] < n_min_height) && (pn_x[i - 1] >= n_min_height))
-                        {
-                            if ((*n_npks) < 15)
-                            {
-                                pn_locs[(*n_npks)++] = i;
-                            }
-                            holdOff1 = 0;
-                            riseFound = 0;
-                            holdOff2 = 8;
-                        }
-                    }
-                    else
-                    {
-                        holdOff1 = holdOff1 + 1;
-                    }
-                }
+                uint32_t un_s = ps->aun_sum4[(un_start + k) & un_mask];
+
+                if (un_s > un_m4 && (un_s & 3))
+                    n_sum++;
             }
+            n_th1 = n_sum / BUFFER_SIZE;
+            n_th1 = (n_th1 < 30) ? 30 : (n_th1 > 60) ? 60 : n_th1;
         }
-        else
+
+        /* 边算平滑信号边检测, 与 maxim_find_peaks 相同 */
+        maxim_peak_det_init(&det, MAXIM_PEAK_REFRACTORY);
+        n_npks = 0;
+        n_prev_x = (int32_t)(un_m4 - ps->aun_sum4[un_start & un_mask]) / 4;
+        for (k = 1; k < BUFFER_SIZE - MA4_SIZE && n_npks < MAXIM_MAX_PEAKS; k++)
+        {
+            n_x = (int32_t)(un_m4 - ps->aun_sum4[(un_start + k) & un_mask]) / 4;
+            if (maxim_peak_det_step(&det, n_x, n_prev_x, n_th1))
+                an_ir_valley_locs[n_npks++] = k;
+            n_prev_x = n_x;
+        }
+        for (; k < BUFFER_SIZE - 1 && n_npks < MAXIM_MAX_PEAKS; k++)
         {
-            holdOff2 = holdOff2 - 1;
+            n_x = (int32_t)(un_ir_mean - MAXIM_VIEW_AT(&v_ir, k));
+            if (maxim_peak_det_step(&det, n_x, n_prev_x, n_th1))
+                an_ir_valley_locs[n_npks++] = k;
+            n_prev_x = n_x;
         }
-        i++;
     }
+
+    maxim_calc_result(an_ir_valley_locs, n_npks, &v_ir, &v_red, n_len, &ps->ratios,
+            &ps->n_spo2, &ps->ch_spo2_valid, &ps->n_heart_rate, &ps->ch_hr_valid);
+    ps->n_since_calc = 0;
+}
+
+/**
+ * @brief 输入一个样本
+ * @return 1-结果已刷新 (确认了新谷值, 或一个窗口内未出现谷值), 0-无变化
+ * @note 平滑需要后续3个样本, 谷值在其后第3个样本输入时确认
+ */
+int32_t maxim_stream_add_sample(maxim_stream_t *ps, uint32_t un_ir, uint32_t un_red)
+{
+    const uint32_t un_mask = MAXIM_STREAM_RING - 1;
+    uint32_t un_t = (uint32_t)ps->n_count;
+    uint32_t un_ir_mean;
+    int32_t n_x, n_valley;
+
+    /* 滑动窗口和与4点和, 4点和按起点位置保存 */
+    if (un_t >= BUFFER_SIZE)
+    {
+        ps->un_ir_sum -= ps->aun_ir[(un_t - BUFFER_SIZE) & un_mask];
+        ps->un_ceil_sum -= (ps->aun_sum4[(un_t - BUFFER_SIZE) & un_mask] + 3) >> 2;
+    }
+    if (un_t >= MA4_SIZE)
+    {
+        ps->un_sum4 -= ps->aun_ir[(un_t - MA4_SIZE) & un_mask];
+        ps->un_ceil_sum += (ps->aun_sum4[(un_t - MA4_SIZE) & un_mask] + 3) >> 2;
+    }
+    ps->aun_ir[un_t & un_mask] = un_ir;
+    ps->aun_red[un_t & un_mask] = un_red;
+    ps->un_ir_sum += un_ir;
+    ps->un_sum4 += un_ir;
+    ps->n_count++;
+    ps->n_since_calc++;
+
+    if (ps->ch_use_bpf && un_t == 0)
+        maxim_bpf_reset(&ps->bpf, (int32_t)un_ir);
+    if (un_t < MA4_SIZE - 1)
+        return 0;
+    ps->aun_sum4[(un_t - (MA4_SIZE - 1)) & un_mask] = ps->un_sum4;
+
+    /* 触发检测: 按当时的窗口均值平滑 (或连续滤波), 逐点单遍检测, 阈值取下限 */
+    if (ps->ch_use_bpf)
+    {
+        n_x = -maxim_bpf_step(&ps->bpf, (int32_t)un_ir);
+    }
+    else
+    {
+        un_ir_mean = (ps->n_count >= BUFFER_SIZE) ? ps->un_ir_sum / BUFFER_SIZE
+                                                  : ps->un_ir_sum / (uint32_t)ps->n_count;
+        n_x = (int32_t)(un_ir_mean * 4 - ps->un_sum4) / 4;
+    }
+    n_valley = (un_t >= MA4_SIZE) ? maxim_peak_det_step(&ps->det, n_x, ps->n_prev_x, 30) : 0;
+    ps->n_prev_x = n_x;
+
+    /* 窗口填满前不发布结果; 长时间无谷值时也重算一次, 使过期的结果失效 */
+    if (ps->n_count < BUFFER_SIZE || (!n_valley && ps->n_since_calc < BUFFER_SIZE))
+        return 0;
+
+    maxim_stream_calc(ps);
+    return 1;
+}
+
+/**
+ * @brief 读取最近一次发布的心率和血氧
+ */
+void maxim_stream_get_result(const maxim_stream_t *ps, int32_t *pn_spo2, int8_t *pch_spo2_valid,
+        int32_t *pn_heart_rate, int8_t *pch_hr_valid)
+{
+    *pn_spo2 = ps->n_spo2;
+    *pch_spo2_valid = ps->ch_spo2_valid;
+    *pn_heart_rate = ps->n_heart_rate;
+    *pch_hr_valid = ps->ch_hr_valid;
+}
+
+/**
+ * @brief 初始化滑动窗口最小/最大值
+ * @param un_window 窗口长度, 不大于 MAXIM_MINMAX_DEPTH
+ */
+void maxim_minmax_init(maxim_minmax_t *pm, uint32_t un_window)
+{
+    pm->un_min_head = pm->un_min_tail = 0;
+    pm->un_max_head = pm->un_max_tail = 0;
+    pm->un_window = min(un_window, MAXIM_MINMAX_DEPTH);
+}
+
+/**
+ * @brief 窗口滑入一个样本
+ * @param pv 起点为0的视图, 序号un_seq的样本为 MAXIM_VIEW_AT(pv, un_seq)
+ * @param un_seq 样本序号, 须连续递增
+ */
+void maxim_minmax_push(maxim_minmax_t *pm, const maxim_view_t *pv, uint32_t un_seq)
+{
+    const uint32_t un_mask = MAXIM_MINMAX_DEPTH - 1;
+    uint32_t un_val = MAXIM_VIEW_AT(pv, un_seq);
+
+    /* 移出窗口的序号 */
+    if (pm->un_min_head != pm->un_min_tail &&
+        un_seq - pm->aun_min_seq[pm->un_min_head & un_mask] >= pm->un_window)
+        pm->un_min_head++;
+    if (pm->un_max_head != pm->un_max_tail &&
+        un_seq - pm->aun_max_seq[pm->un_max_head & un_mask] >= pm->un_window)
+        pm->un_max_head++;
+
+    /* 队尾中不可能再成为极值的样本出队 */
+    while (pm->un_min_head != pm->un_min_tail &&
+           MAXIM_VIEW_AT(pv, pm->aun_min_seq[(pm->un_min_tail - 1) & un_mask]) >= un_val)
+        pm->un_min_tail--;
+    while (pm->un_max_head != pm->un_max_tail &&
+           MAXIM_VIEW_AT(pv, pm->aun_max_seq[(pm->un_max_tail - 1) & un_mask]) <= un_val)
+        pm->un_max_tail--;
+
+    pm->aun_min_seq[pm->un_min_tail++ & un_mask] = un_seq;
+    pm->aun_max_seq[pm->un_max_tail++ & un_mask] = un_seq;
 }
 
 /**
- * @brief 移除距离过近的峰值
+ * @brief 读取窗口内最小/最大值, 窗口为空时返回 0x3FFFF / 0
  */
-void maxim_remove_close_peaks(int32_t *pn_locs, int32_t *pn_npks, int32_t *pn_x,
-        int32_t n_min_distance)
+void maxim_minmax_get(const maxim_minmax_t *pm, const maxim_view_t *pv, uint32_t *pun_min, uint32_t *pun_max)
+{
+    const uint32_t un_mask = MAXIM_MINMAX_DEPTH - 1;
+
+    if (pm->un_min_head == pm->un_min_tail)
+    {
+        *pun_min = 0x3FFFF;
+        *pun_max = 0;
+        return;
+    }
+    *pun_min = MAXIM_VIEW_AT(pv, pm->aun_min_seq[pm->un_min_head & un_mask]);
+    *pun_max = MAXIM_VIEW_AT(pv, pm->aun_max_seq[pm->un_max_head & un_mask]);
+}
+
+/**
+ * @brief 初始化单遍峰值检测
+ * @param n_refractory 确认峰值后跳过的点数
+ */
+void maxim_peak_det_init(maxim_peak_det_t *pd, int32_t n_refractory)
+{
+    memset(pd, 0, sizeof(*pd));
+    pd->n_refractory = n_refractory;
+}
+
+/* 逐点检测, 内联进整窗循环后状态可留在寄存器中 */
+static inline int32_t maxim_peak_det_step(maxim_peak_det_t *pd, int32_t n_x, int32_t n_prev_x,
+        int32_t n_min_height)
 {
-    int32_t i, j, n_old_npks, n_dist;
+    int32_t n_th = pd->n_amp >> MAXIM_PEAK_ADAPT_SHIFT;
+
+    if (n_th < n_min_height)
+        n_th = n_min_height;
+
+    /* 长时间无峰说明幅度已下降, 逐步放低阈值 */
+    if (++pd->n_idle > MAXIM_PEAK_DECAY)
+    {
+        pd->n_amp >>= 1;
+        pd->n_idle = 0;
+    }
+
+    if (pd->n_hold_off2 > 0)
+    {
+        pd->n_hold_off2--;
+        return 0;
+    }
+
+    if (n_x > n_th && n_x > n_prev_x)
+        pd->n_rise_found = 1;
+    if (!pd->n_rise_found)
+        return 0;
 
-    maxim_sort_indices_descend(pn_x, pn_locs, *pn_npks);
+    if (n_x > pd->n_seg_max)
+        pd->n_seg_max = n_x;
 
-    for (i = -1; i < *pn_npks; i++)
+    if ((n_x < n_th) && (pd->n_hold_off1 < MAXIM_PEAK_RISE_HOLD))
     {
-        n_old_npks = *pn_npks;
-        *pn_npks = i + 1;
-        for (j = i + 1; j < n_old_npks; j++)
+        /* 越阈时间太短, 视为噪声 */
+        pd->n_rise_found = 0;
+        pd->n_hold_off1 = 0;
+        pd->n_seg_max = 0;
+    }
+    else if (pd->n_hold_off1 == MAXIM_PEAK_RISE_HOLD)
+    {
+        if ((n_x < n_th) && (n_prev_x >= n_th))
         {
-            n_dist = pn_locs[j] - (i == -1 ? -1 : pn_locs[i]);
-            if (n_dist > n_min_distance || n_dist < -n_min_distance)
-                pn_locs[(*pn_npks)++] = pn_locs[j];
+            pd->n_amp = pd->n_amp ? (pd->n_amp * 3 + pd->n_seg_max) >> 2 : pd->n_seg_max;
+            pd->n_idle = 0;
+            pd->n_rise_found = 0;
+            pd->n_hold_off1 = 0;
+            pd->n_seg_max = 0;
+            pd->n_hold_off2 = pd->n_refractory;
+            return 1;
         }
     }
+    else
+    {
+        pd->n_hold_off1++;
+    }
+    return 0;
+}
 
-    maxim_sort_ascend(pn_locs, *pn_npks);
+/**
+ * @brief 输入一个点, 每点O(1)
+ * @param n_prev_x 前一个点, n_min_height 阈值下限
+ * @return 1-当前点确认为峰 (回落到阈值以下的第一个点)
+ */
+int32_t maxim_peak_det_push(maxim_peak_det_t *pd, int32_t n_x, int32_t n_prev_x, int32_t n_min_height)
+{
+    return maxim_peak_det_step(pd, n_x, n_prev_x, n_min_height);
 }
 
 /**
- * @brief 升序排序
+ * @brief 单遍寻找峰值, O(n), 按位置升序输出
+ * @param n_refractory 峰间最少间隔的不应期, n_max_num pn_locs容量
  */
-void maxim_sort_ascend(int32_t *pn_x, int32_t n_size)
+void maxim_find_peaks(int32_t *pn_locs, int32_t *n_npks, const int32_t *pn_x,
+        int32_t n_size, int32_t n_min_height, int32_t n_refractory, int32_t n_max_num)
 {
-    int32_t i, j, n_temp;
-    for (i = 1; i < n_size; i++)
+    maxim_peak_det_t det;
+    int32_t i;
+
+    maxim_peak_det_init(&det, n_refractory);
+    *n_npks = 0;
+    for (i = 1; i < n_size - 1 && *n_npks < n_max_num; i++)
     {
-        n_temp = pn_x[i];
-        for (j = i; j > 0 && n_temp < pn_x[j - 1]; j--)
-            pn_x[j] = pn_x[j - 1];
-        pn_x[j] = n_temp;
+        if (maxim_peak_det_step(&det, pn_x[i], pn_x[i - 1], n_min_height))
+            pn_locs[(*n_npks)++] = i;
     }
 }
 
 /**
- * @brief 按降序排序索引
+ * @brief 升序排序
  */
-void maxim_sort_indices_descend(int32_t *pn_x, int32_t *pn_indx, int32_t n_size)
+void maxim_sort_ascend(int32_t *pn_x, int32_t n_size)
 {
     int32_t i, j, n_temp;
     for (i = 1; i < n_size; i++)
     {
-        n_temp = pn_indx[i];
-        for (j = i; j > 0 && pn_x[n_temp] > pn_x[pn_indx[j - 1]]; j--)
-            pn_indx[j] = pn_indx[j - 1];
-        pn_indx[j] = n_temp;
+        n_temp = pn_x[i];
+        for (j = i; j > 0 && n_temp < pn_x[j - 1]; j--)
+            pn_x[j] = pn_x[j - 1];
+        pn_x[j] = n_temp;
     }
 }
@@ -14,30 +14,199 @@ extern "C" {
 #endif
 
 #define FS              50          /* 采样频率 */
-#define BUFFER_SIZE     (FS * 3)    /* 缓冲区大小 */
+#define BUFFER_SIZE     (FS * 3)    /* 缓冲区大小, 也是内置工作缓冲区可计算的最长窗口 */
 #define MA4_SIZE        4           /* 移动平均窗口大小 */
 
 #ifndef min
 #define min(x, y)       ((x) < (y) ? (x) : (y))
 #endif
 
+/*
+ * 环形缓冲区视图: 窗口内第k个样本为 pun_buf[(un_start + k) & un_mask].
+ * 缓冲区长度为2的幂; 普通数组可用掩码0xFFFFFFFF、起点0表示.
+ */
+typedef struct {
+    const uint32_t *pun_buf;
+    uint32_t un_mask;
+    uint32_t un_start;
+} maxim_view_t;
+
+#define MAXIM_VIEW_AT(pv, k)    ((pv)->pun_buf[((pv)->un_start + (uint32_t)(k)) & (pv)->un_mask])
+
+#define MAXIM_MINMAX_DEPTH      256 /* 单调队列容量, 2的幂且不小于窗口长度 */
+
+/*
+ * 滑动窗口最小/最大值 (单调双端队列), 每个样本均摊O(1).
+ * 队列中只保存样本序号, 样本值经视图读取, 要求窗口内样本仍在缓冲区中.
+ */
+typedef struct {
+    uint32_t aun_min_seq[MAXIM_MINMAX_DEPTH];
+    uint32_t aun_max_seq[MAXIM_MINMAX_DEPTH];
+    uint32_t un_min_head, un_min_tail;
+    uint32_t un_max_head, un_max_tail;
+    uint32_t un_window;
+} maxim_minmax_t;
+
+#define MAXIM_PEAK_RISE_HOLD    4   /* 越过阈值后至少保持的点数 */
+#define MAXIM_PEAK_REFRACTORY   8   /* 确认峰值后的不应期 (点) */
+#define MAXIM_PEAK_MIN_SPACING  (MAXIM_PEAK_RISE_HOLD + 1 + MAXIM_PEAK_REFRACTORY)
+#define MAXIM_MAX_PEAKS         (BUFFER_SIZE / MAXIM_PEAK_MIN_SPACING + 1)  /* 窗口内可能的最多峰数 */
+#define MAXIM_PEAK_ADAPT_SHIFT  3   /* 自适应阈值 = 峰幅度均值 >> 3 */
+#define MAXIM_PEAK_DECAY        (FS * 2)    /* 超过2秒无峰时峰幅度均值减半 */
+
+/*
+ * 单遍峰值检测状态: 信号上升越过阈值并保持后回落到阈值以下时确认一个峰,
+ * 位置记为回落点, 其后进入不应期. 阈值取最小高度与近期峰幅度比例中的较大者.
+ */
+typedef struct {
+    int32_t n_refractory;
+    int32_t n_rise_found;
+    int32_t n_hold_off1;
+    int32_t n_hold_off2;
+    int32_t n_seg_max;              /* 当前越阈段的最大值 */
+    int32_t n_amp;                  /* 峰幅度的滑动平均, 0表示尚无峰 */
+    int32_t n_idle;                 /* 距上一个峰的点数 */
+} maxim_peak_det_t;
+
+#define MAXIM_BPF_SECTIONS      2   /* 二阶节数: 高通 + 低通 */
+#define MAXIM_BPF_Q             30  /* 系数小数位 (Q2.30) */
+#define MAXIM_BPF_LO_HZ         0.5f
+#define MAXIM_BPF_HI_HZ         4.0f
+#define MAXIM_BPF_DELAY         7   /* 谷值处的群延迟 (样本), 据此对齐原始信号; 窗口末尾这几点不参与计算 */
+#define MAXIM_BPF_MIN_LEN       (MAXIM_BPF_DELAY + MA4_SIZE)    /* 带通前端的最短窗口 */
+
+/*
+ * 定点二阶节 (直接I型), 系数Q2.30, 样本int32, 64位累加.
+ * 0.5Hz@50Hz的高通极点距单位圆很近, Q15系数量化后截止频率偏差过大, 故用Q30.
+ */
+typedef struct {
+    int32_t an_b[3];
+    int32_t an_a[2];                /* a1, a2, a0已归一化为1 */
+    int32_t an_x[2];
+    int32_t an_y[2];
+} maxim_biquad_t;
+
+/* 带通前端: 2阶巴特沃斯高通与低通级联 */
+typedef struct {
+    maxim_biquad_t sec[MAXIM_BPF_SECTIONS];
+} maxim_bpf_t;
+
+/*
+ * 整窗计算上下文: 工作缓冲区与前端滤波器.
+ * 每路信号各用一个上下文即可并行计算; 不带上下文的接口使用内部默认上下文.
+ * 内置缓冲区只容纳BUFFER_SIZE点, 更长的窗口须经 maxim_ctx_set_buffer 提供工作缓冲区.
+ * 无论窗口多长, 只取前MAXIM_MAX_PEAKS个谷值计算.
+ */
+typedef struct {
+    int32_t  an_x[BUFFER_SIZE];
+    int32_t *pn_buf;                /* 调用者提供的工作缓冲区, RT_NULL使用an_x */
+    int32_t  n_buf_len;             /* pn_buf的长度, 即允许的最长窗口 */
+    maxim_bpf_t bpf;
+    int8_t   ch_use_bpf;
+} maxim_ctx_t;
+
+#define MAXIM_STREAM_RING       256 /* 流式计算的原始样本环形缓冲区, 2的幂且不小于BUFFER_SIZE */
+
+/* 流式计算的比率缓存: 相邻谷值对 (样本序号) 及其AC/DC比率 */
+typedef struct {
+    uint32_t aun_v0[MAXIM_MAX_PEAKS];
+    uint32_t aun_v1[MAXIM_MAX_PEAKS];
+    int32_t  an_ratio[MAXIM_MAX_PEAKS];
+    int8_t   ach_valid[MAXIM_MAX_PEAKS];
+    int32_t  n_num;
+} maxim_ratio_cache_t;
+
+/*
+ * 流式心率血氧计算状态
+ * 每输入一个样本以O(1)更新窗口和、4点和及阈值所需的和, 并按当时的均值平滑、单遍检测谷值;
+ * 检测到新谷值时对最近BUFFER_SIZE个样本做一遍峰值检测, 比率只计算新出现的谷值对, 结果与同一窗口上的
+ * maxim_heart_rate_and_oxygen_saturation 逐位相同. 整窗算法每次从窗口起点重新检测,
+ * 且平滑信号以整个窗口的均值去直流, 谷值判定取决于窗口起止, 故不能逐点累积.
+ */
+typedef struct {
+    /* 最近的原始样本, 及以各点起4个样本之和 (与窗口均值无关) */
+    uint32_t aun_ir[MAXIM_STREAM_RING];
+    uint32_t aun_red[MAXIM_STREAM_RING];
+    uint32_t aun_sum4[MAXIM_STREAM_RING];
+    uint32_t un_ir_sum;             /* 最近BUFFER_SIZE个样本之和 */
+    uint32_t un_sum4;               /* 最近MA4_SIZE个样本之和 */
+    uint32_t un_ceil_sum;           /* 窗口内各平滑点 ceil(4点和/4) 之和 */
+    int32_t  n_count;               /* 已输入样本数 */
+    int32_t  n_since_calc;          /* 距上次窗口计算的样本数 */
+
+    /* 触发检测状态 */
+    int32_t  n_prev_x;
+    maxim_peak_det_t det;
+
+    /* 窗口计算的工作缓冲区 (带通前端) 与比率缓存 */
+    int32_t  an_x[BUFFER_SIZE];
+    maxim_ratio_cache_t ratios;
+
+    /* 可选带通前端, 代替4点平滑 */
+    maxim_bpf_t bpf;
+    int8_t   ch_use_bpf;
+
+    /* 最近一次发布的结果 */
+    int32_t  n_heart_rate;
+    int32_t  n_spo2;
+    int8_t   ch_hr_valid;
+    int8_t   ch_spo2_valid;
+} maxim_stream_t;
+
 /* 函数声明 */
 void maxim_heart_rate_and_oxygen_saturation(uint32_t *pun_ir_buffer, int32_t n_ir_buffer_length,
         uint32_t *pun_red_buffer, int32_t *pn_spo2, int8_t *pch_spo2_valid,
         int32_t *pn_heart_rate, int8_t *pch_hr_valid);
 
-void maxim_find_peaks(int32_t *pn_locs, int32_t *n_npks, int32_t *pn_x,
-        int32_t n_size, int32_t n_min_height, int32_t n_min_distance, int32_t n_max_num);
+void maxim_heart_rate_and_oxygen_saturation_view(const maxim_view_t *pv_ir, const maxim_view_t *pv_red,
+        int32_t n_ir_buffer_length, int32_t *pn_spo2, int8_t *pch_spo2_valid,
+        int32_t *pn_heart_rate, int8_t *pch_hr_valid);
 
-void maxim_peaks_above_min_height(int32_t *pn_locs, int32_t *n_npks, int32_t *pn_x,
-        int32_t n_size, int32_t n_min_height);
+void maxim_ctx_init(maxim_ctx_t *pc);
 
-void maxim_remove_close_peaks(int32_t *pn_locs, int32_t *pn_npks, int32_t *pn_x,
-        int32_t n_min_distance);
+void maxim_ctx_set_bpf(maxim_ctx_t *pc, const maxim_bpf_t *pf);
 
-void maxim_sort_ascend(int32_t *pn_x, int32_t n_size);
+void maxim_ctx_set_buffer(maxim_ctx_t *pc, int32_t *pn_buf, int32_t n_buf_len);
+
+void maxim_ctx_calc(maxim_ctx_t *pc, const maxim_view_t *pv_ir, const maxim_view_t *pv_red,
+        int32_t n_ir_buffer_length, int32_t *pn_spo2, int8_t *pch_spo2_valid,
+        int32_t *pn_heart_rate, int8_t *pch_hr_valid);
+
+void maxim_bpf_design(maxim_bpf_t *pf, float f_fs, float f_lo, float f_hi);
+
+void maxim_bpf_reset(maxim_bpf_t *pf, int32_t n_x0);
+
+void maxim_bpf_process(maxim_bpf_t *pf, int32_t *pn_x, int32_t n_len);
+
+int32_t maxim_bpf_step(maxim_bpf_t *pf, int32_t n_x);
+
+void maxim_set_bpf(const maxim_bpf_t *pf);
+
+void maxim_set_buffer(int32_t *pn_buf, int32_t n_buf_len);
 
-void maxim_sort_indices_descend(int32_t *pn_x, int32_t *pn_indx, int32_t n_size);
+void maxim_minmax_init(maxim_minmax_t *pm, uint32_t un_window);
+
+void maxim_minmax_push(maxim_minmax_t *pm, const maxim_view_t *pv, uint32_t un_seq);
+
+void maxim_minmax_get(const maxim_minmax_t *pm, const maxim_view_t *pv, uint32_t *pun_min, uint32_t *pun_max);
+
+void maxim_stream_init(maxim_stream_t *ps);
+
+void maxim_stream_set_bpf(maxim_stream_t *ps, const maxim_bpf_t *pf);
+
+int32_t maxim_stream_add_sample(maxim_stream_t *ps, uint32_t un_ir, uint32_t un_red);
+
+void maxim_stream_get_result(const maxim_stream_t *ps, int32_t *pn_spo2, int8_t *pch_spo2_valid,
+        int32_t *pn_heart_rate, int8_t *pch_hr_valid);
+
+void maxim_peak_det_init(maxim_peak_det_t *pd, int32_t n_refractory);
+
+int32_t maxim_peak_det_push(maxim_peak_det_t *pd, int32_t n_x, int32_t n_prev_x, int32_t n_min_height);
+
+void maxim_find_peaks(int32_t *pn_locs, int32_t *n_npks, const int32_t *pn_x,
+        int32_t n_size, int32_t n_min_height, int32_t n_refractory, int32_t n_max_num);
+
+void maxim_sort_ascend(int32_t *pn_x, int32_t n_size);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,136 @@
+/*
+ * 位操作总线协议引擎
+ * 事务从调用线程开始执行, 步内锁调度器; 遇到第一个长等待时把事务交给微秒定时器,
+ * 此后各步在定时器中断中执行, 调用线程阻塞在信号量上直到事务结束.
+ * 只有一个定时器: 已被占用时, 后来的事务在锁内忙等长等待, 时序不受影响.
+ */
+#include "bitbang.h"
+
+/* 板级接口 */
+extern void delay_us(uint32_t us);
+extern void us_timer_start(uint32_t us, void (*callback)(void));
+
+static struct rt_semaphore bb_done;
+static bb_task_t *bb_owner = RT_NULL;      /* 占用定时器的事务 */
+static uint8_t bb_ready;
+static bb_stat_t bb_stat;
+
+/**
+ * @brief 原地忙等, 计入统计
+ */
+void bb_spin_us(uint32_t us)
+{
+    bb_stat.spin_us += us;
+    delay_us(us);
+}
+
+/**
+ * @brief 定时器到期: 执行到下一个长等待或事务结束
+ */
+static void bb_timer_isr(void)
+{
+    bb_task_t *t = bb_owner;
+    int ret;
+
+    bb_stat.irqs++;
+    while ((ret = t->step(t)) == BB_PENDING && t->wait_us <= BB_SPIN_MAX_US)
+        bb_spin_us(t->wait_us);
+
+    if (ret == BB_PENDING)
+    {
+        bb_stat.yield_us += t->wait_us;
+        us_timer_start(t->wait_us, bb_timer_isr);
+    }
+    else
+    {
+        rt_sem_release(&bb_done);
+    }
+}
+
+/**
+ * @brief 执行一次事务, 返回时事务已结束
+ * @param step: 协议函数, 从头开始执行
+ * @return 协议函数设置的t->result
+ */
+int bb_run(bb_task_t *t, bb_step_fn step)
+{
+    int ret;
+
+    t->step = step;
+    t->lc = 0;
+    t->wait_us = 0;
+    t->result = RT_EOK;
+    bb_stat.tasks++;
+
+    /* 不能阻塞: 整段忙等 */
+    if (!bb_ready || rt_thread_self() == RT_NULL || rt_interrupt_get_nest() > 0)
+    {
+        bb_stat.sync_tasks++;
+        while (step(t) == BB_PENDING)
+            bb_spin_us(t->wait_us);
+        return t->result;
+    }
+
+    for (;;)
+    {
+        rt_enter_critical();
+        ret = step(t);
+        while (ret == BB_PENDING && t->wait_us > BB_SPIN_MAX_US && bb_owner != RT_NULL)
+        {
+            bb_stat.contended++;
+            bb_spin_us(t->wait_us);
+            ret = step(t);
+        }
+        /* 在锁内启动定时器, 等待不会因抢占而拉长 */
+        if (ret == BB_PENDING && t->wait_us > BB_SPIN_MAX_US)
+        {
+            bb_owner = t;
+            bb_stat.yield_us += t->wait_us;
+            us_timer_start(t->wait_us, bb_timer_isr);
+        }
+        rt_exit_critical();
+
+        if (ret == BB_DONE || bb_owner == t)
+            break;
+        /* 短等待只要求"至少", 允许被抢占 */
+        bb_spin_us(t->wait_us);
+    }
+
+    if (bb_owner == t)
+    {
+        rt_sem_take(&bb_done, RT_WAITING_FOREVER);
+        bb_owner = RT_NULL;
+    }
+    return t->result;
+}
+
+/**
+ * @brief 获取引擎统计
+ */
+void bb_get_stat(bb_stat_t *stat)
+{
+    *stat = bb_stat;
+}
+
+/**
+ * @brief 查看引擎统计: bitbang
+ */
+static int bitbang(int argc, char **argv)
+{
+    rt_kprintf("tasks %u (%u busy-waited), timer irqs %u, contended %u\n",
+               bb_stat.tasks, bb_stat.sync_tasks, bb_stat.irqs, bb_stat.contended);
+    rt_kprintf("yielded %u us, busy-waited %u us\n", bb_stat.yield_us, bb_stat.spin_us);
+    return 0;
+}
+MSH_CMD_EXPORT(bitbang, show bit-bang engine statistics);
+
+/**
+ * @brief 初始化引擎, 此前的事务整段忙等
+ */
+static int bb_init(void)
+{
+    rt_sem_init(&bb_done, "bb_done", 0, RT_IPC_FLAG_FIFO);
+    bb_ready = 1;
+    return RT_EOK;
+}
+INIT_PREV_EXPORT(bb_init);
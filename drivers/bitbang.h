@@ -0,0 +1,76 @@
+/*
+ * 位操作总线协议引擎
+ * 单总线 (DS18B20) 与三线 (DS1302) 的事务写成协程式状态机: 协议函数在需要等待处
+ * 返回, 下次从返回处继续. 长等待交给微秒定时器, 调用线程阻塞让出CPU, 之后各步在
+ * 定时器中断中执行; 短等待原地忙等, 不值得一次中断.
+ *
+ * 协议函数中的局部变量不跨等待保存, 状态放在任务结构中:
+ *
+ *   static int xxx_step(bb_task_t *t)
+ *   {
+ *       BB_BEGIN(t);
+ *       拉低;
+ *       BB_WAIT_US(t, 480);     至少480us, 期间可让出CPU
+ *       释放;
+ *       bb_spin_us(2);          原子的时隙, 一定原地忙等
+ *       BB_END(t);
+ *   }
+ */
+#ifndef __BITBANG_H__
+#define __BITBANG_H__
+
+#include <rtthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 不超过该值的BB_WAIT_US原地忙等 (线程中可被抢占拉长), 更长的交给定时器 */
+#define BB_SPIN_MAX_US      15
+
+#define BB_DONE             0
+#define BB_PENDING          1
+
+typedef struct bb_task bb_task_t;
+typedef int (*bb_step_fn)(bb_task_t *t);
+
+/* 一次事务 */
+struct bb_task {
+    bb_step_fn  step;
+    uint16_t    lc;             /* 续点 (__LINE__) */
+    uint32_t    wait_us;        /* 返回BB_PENDING时到下一步的最短等待 */
+    int         result;         /* bb_run的返回值, 由协议函数设置 */
+
+    /* 协议状态 */
+    uint8_t    *buf;
+    uint8_t     len;
+    uint8_t     idx;
+    uint8_t     mode;
+};
+
+/* 续点用switch实现, 同protothread; 协议函数内不能再用switch跨越等待 */
+#define BB_BEGIN(t)         switch ((t)->lc) { case 0:
+#define BB_WAIT_US(t, us)   do { (t)->wait_us = (us); (t)->lc = __LINE__; return BB_PENDING; \
+                                 case __LINE__:; } while (0)
+#define BB_END(t)           } (t)->lc = 0; return BB_DONE
+
+/* 引擎统计, 时间单位微秒 */
+typedef struct {
+    uint32_t tasks;             /* 执行的事务数 */
+    uint32_t sync_tasks;        /* 调度器未运行或在中断中调用, 整段忙等的事务 */
+    uint32_t contended;         /* 定时器被其他事务占用, 长等待改为忙等的次数 */
+    uint32_t irqs;              /* 定时器中断次数 */
+    uint32_t spin_us;           /* 忙等总时间 */
+    uint32_t yield_us;          /* 交给定时器的等待总时间, 即调用线程让出的CPU */
+} bb_stat_t;
+
+/* 函数声明 */
+int  bb_run(bb_task_t *t, bb_step_fn step);
+void bb_spin_us(uint32_t us);
+void bb_get_stat(bb_stat_t *stat);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BITBANG_H__ */
@@ -2,28 +2,31 @@
  * ADXL345三轴加速度传感器驱动 - 用于计步
  */
 #include "drv_adxl345.h"
+#include "i2c_bus.h"
+#include "board.h"
 
-static struct rt_i2c_bus_device *i2c_bus = RT_NULL;
+static i2c_client_t adxl_i2c;
+
+#define ADXL345_ACQ_PRIORITY    9           /* 仅次于PPG采集 */
+#define ADXL345_ACQ_TIMEOUT_MS  500         /* 未等到中断时也读取一次, 防止丢失边沿 */
+#define ADXL345_IDLE_TIMEOUT_MS 10000       /* 静止时同样兜底, 只读一次INT_SOURCE */
+
+static rt_sem_t acq_sem = RT_NULL;
+static adxl345_acq_stat_t acq_stat;
+static pedo_t acc_pedo;                     /* 计步状态, 只在采集线程中更新 */
+static pedo_result_t pedo_res;              /* 每次读完FIFO后发布的计步结果 */
 
 /**
  * @brief 写寄存器
  */
 void adxl345_write_reg(uint8_t addr, uint8_t val)
 {
-    struct rt_i2c_msg msgs;
     uint8_t buf[2];
 
-    if (i2c_bus == RT_NULL) return;
-
     buf[0] = addr;
     buf[1] = val;
 
-    msgs.addr  = ADXL345_I2C_ADDR;
-    msgs.flags = RT_I2C_WR;
-    msgs.buf   = buf;
-    msgs.len   = 2;
-
-    rt_i2c_transfer(i2c_bus, &msgs, 1);
+    i2c_client_write(&adxl_i2c, buf, 2);
 }
 
 /**
@@ -31,47 +34,21 @@ void adxl345_write_reg(uint8_t addr, uint8_t val)
  */
 uint8_t adxl345_read_reg(uint8_t addr)
 {
-    struct rt_i2c_msg msgs[2];
     uint8_t data = 0;
 
-    if (i2c_bus == RT_NULL) return 0;
-
-    msgs[0].addr  = ADXL345_I2C_ADDR;
-    msgs[0].flags = RT_I2C_WR;
-    msgs[0].buf   = &addr;
-    msgs[0].len   = 1;
-
-    msgs[1].addr  = ADXL345_I2C_ADDR;
-    msgs[1].flags = RT_I2C_RD;
-    msgs[1].buf   = &data;
-    msgs[1].len   = 1;
-
-    rt_i2c_transfer(i2c_bus, msgs, 2);
+    i2c_client_read_regs(&adxl_i2c, addr, &data, 1);
     return data;
 }
 
 /**
  * @brief 读取加速度数据
+ * @note 启动采集线程后读数据寄存器会弹出FIFO中的样本, 不要再调用
  */
 void adxl345_read_data(int16_t *x, int16_t *y, int16_t *z)
 {
-    struct rt_i2c_msg msgs[2];
-    uint8_t reg = ADXL345_DATAX0;
     uint8_t buf[6];
 
-    if (i2c_bus == RT_NULL) return;
-
-    msgs[0].addr  = ADXL345_I2C_ADDR;
-    msgs[0].flags = RT_I2C_WR;
-    msgs[0].buf   = &reg;
-    msgs[0].len   = 1;
-
-    msgs[1].addr  = ADXL345_I2C_ADDR;
-    msgs[1].flags = RT_I2C_RD;
-    msgs[1].buf   = buf;
-    msgs[1].len   = 6;
-
-    if (rt_i2c_transfer(i2c_bus, msgs, 2) == 2)
+    if (i2c_client_read_regs(&adxl_i2c, ADXL345_DATAX0, buf, 6) == RT_EOK)
     {
         *x = (int16_t)((buf[1] << 8) | buf[0]);
         *y = (int16_t)((buf[3] << 8) | buf[2]);
@@ -102,6 +79,227 @@ void adxl345_read_average(float *x, float *y, float *z, uint8_t times)
     *z = (float)sum_z / times * 0.004f;
 }
 
+/**
+ * @brief 一次传输读出INT_SOURCE与FIFO_STATUS
+ * 读INT_SOURCE清除锁存的活动/静止标志.
+ */
+static rt_err_t adxl345_read_status(uint8_t *int_src, uint8_t *fifo_status)
+{
+    static uint8_t regs[2] = {ADXL345_INT_SOURCE, ADXL345_FIFO_STATUS};
+    struct rt_i2c_msg msgs[4];
+
+    msgs[0].flags = RT_I2C_WR;
+    msgs[0].buf   = &regs[0];
+    msgs[0].len   = 1;
+    msgs[1].flags = RT_I2C_RD;
+    msgs[1].buf   = int_src;
+    msgs[1].len   = 1;
+    msgs[2].flags = RT_I2C_WR;
+    msgs[2].buf   = &regs[1];
+    msgs[2].len   = 1;
+    msgs[3].flags = RT_I2C_RD;
+    msgs[3].buf   = fifo_status;
+    msgs[3].len   = 1;
+
+    return i2c_client_transfer(&adxl_i2c, msgs, 4) == 4 ? RT_EOK : -RT_ERROR;
+}
+
+/**
+ * @brief 读出FIFO中已知存在的n个样本
+ * FIFO每读完一次 DATAX0~DATAZ1 弹出一项, 因此每个样本是一对 写地址+读6字节 的消息;
+ * n个样本的消息以重复起始相连, 在一次传输中完成 (两次读之间相隔一个地址字节,
+ * 远大于数据手册要求的5us).
+ */
+static int32_t adxl345_fifo_pop(int16_t xyz[][3], uint8_t fifo_status, int32_t max_samples)
+{
+    static struct rt_i2c_msg msgs[ADXL345_FIFO_DEPTH * 2];
+    static uint8_t buf[ADXL345_FIFO_DEPTH][6];
+    static uint8_t reg = ADXL345_DATAX0;
+    int32_t n, i;
+
+    n = fifo_status & 0x3F;
+    if (n >= ADXL345_FIFO_DEPTH)
+        acq_stat.overrun++;
+    if (n > max_samples)
+        n = max_samples;
+    if (n <= 0)
+        return 0;
+
+    for (i = 0; i < n; i++)
+    {
+        msgs[2 * i].flags = RT_I2C_WR;
+        msgs[2 * i].buf   = &reg;
+        msgs[2 * i].len   = 1;
+
+        msgs[2 * i + 1].flags = RT_I2C_RD;
+        msgs[2 * i + 1].buf   = buf[i];
+        msgs[2 * i + 1].len   = 6;
+    }
+    if (i2c_client_transfer(&adxl_i2c, msgs, 2 * n) != (rt_size_t)(2 * n))
+        return -1;
+
+    for (i = 0; i < n; i++)
+    {
+        xyz[i][0] = (int16_t)((buf[i][1] << 8) | buf[i][0]);
+        xyz[i][1] = (int16_t)((buf[i][3] << 8) | buf[i][2]);
+        xyz[i][2] = (int16_t)((buf[i][5] << 8) | buf[i][4]);
+    }
+    return n;
+}
+
+/**
+ * @brief 一次读出FIFO中的样本
+ * @param xyz: 样本输出, 至少max_samples个
+ * @param max_samples: 最多读取的样本数 (1~32), 其余留在FIFO中
+ * @return 读出的样本数, 失败返回-1
+ * @note 只在采集线程中调用
+ */
+int32_t adxl345_read_fifo_burst(int16_t xyz[][3], int32_t max_samples)
+{
+    uint8_t status;
+
+    if (i2c_client_read_regs(&adxl_i2c, ADXL345_FIFO_STATUS, &status, 1) != RT_EOK)
+        return -1;
+    return adxl345_fifo_pop(xyz, status, max_samples);
+}
+
+/**
+ * @brief 全速采集: 100Hz FIFO流模式, 水位与静止中断
+ */
+static void adxl345_enter_active(void)
+{
+    adxl345_write_reg(ADXL345_INT_ENABLE, 0x00);
+    adxl345_write_reg(ADXL345_BW_RATE, ADXL345_BW_ACTIVE);
+    /* 流模式: 满时丢弃最旧样本 */
+    adxl345_write_reg(ADXL345_FIFO_CTL, 0x80 | ADXL345_FIFO_WATERMARK);
+    adxl345_write_reg(ADXL345_INT_ENABLE, ADXL345_INT_WATERMARK | ADXL345_INT_INACTIVITY);
+    acq_stat.active = 1;
+}
+
+/**
+ * @brief 低功耗等待: 12.5Hz旁路模式, 只留活动中断
+ * 使能活动中断时器件以当前加速度为交流耦合的参考.
+ */
+static void adxl345_enter_idle(void)
+{
+    adxl345_write_reg(ADXL345_INT_ENABLE, 0x00);
+    adxl345_write_reg(ADXL345_FIFO_CTL, 0x00);
+    adxl345_write_reg(ADXL345_BW_RATE, ADXL345_BW_IDLE);
+    adxl345_write_reg(ADXL345_INT_ENABLE, ADXL345_INT_ACTIVITY);
+    acq_stat.active = 0;
+}
+
+/**
+ * @brief INT1中断: 唤醒采集线程
+ */
+static void adxl345_int_isr(void *args)
+{
+    acq_stat.irq_count++;
+    rt_sem_release(acq_sem);
+}
+
+/**
+ * @brief 采集线程: 水位中断时一次读空FIFO, 样本逐个送入计步算法
+ * 静止中断后转入低功耗等待, 不再读取样本也不运行计步, 活动中断唤醒后恢复全速采集.
+ */
+static void adxl345_acq_entry(void *parameter)
+{
+    int16_t xyz[ADXL345_FIFO_DEPTH][3];
+    uint8_t int_src, fifo_status;
+    int32_t n, i;
+
+    while (1)
+    {
+        rt_sem_take(acq_sem, rt_tick_from_millisecond(acq_stat.active ? ADXL345_ACQ_TIMEOUT_MS
+                                                                      : ADXL345_IDLE_TIMEOUT_MS));
+
+        if (!acq_stat.active)
+        {
+            if ((adxl345_read_reg(ADXL345_INT_SOURCE) & ADXL345_INT_ACTIVITY) != 0)
+            {
+                acq_stat.wakeups++;
+                adxl345_enter_active();
+            }
+            continue;
+        }
+
+        if (adxl345_read_status(&int_src, &fifo_status) != RT_EOK)
+            continue;
+
+        n = adxl345_fifo_pop(xyz, fifo_status, ADXL345_FIFO_DEPTH);
+        if (n > 0)
+        {
+            for (i = 0; i < n; i++)
+                pedo_push(&acc_pedo, xyz[i][0], xyz[i][1], xyz[i][2]);
+            /* 整块样本处理完后再发布计步结果 */
+            rt_enter_critical();
+            pedo_get_result(&acc_pedo, &pedo_res);
+            rt_exit_critical();
+
+            acq_stat.bursts++;
+            acq_stat.samples += n;
+        }
+
+        if ((int_src & ADXL345_INT_INACTIVITY) != 0)
+        {
+            acq_stat.sleeps++;
+            adxl345_enter_idle();
+        }
+    }
+}
+
+/**
+ * @brief 切换到FIFO流模式, 启动水位中断驱动的采集线程
+ * 静止超过 ADXL345_INACT_TIME_S 后自动转入低功耗等待.
+ * @note 启动后不要再调用 adxl345_read_data / adxl345_read_average
+ */
+int adxl345_acq_start(void)
+{
+    rt_thread_t tid;
+
+    if (acq_sem != RT_NULL)
+        return RT_EOK;
+
+    acq_sem = rt_sem_create("acc_int", 0, RT_IPC_FLAG_FIFO);
+    if (acq_sem == RT_NULL)
+        return -RT_ENOMEM;
+    pedo_init(&acc_pedo);
+    pedo_get_result(&acc_pedo, &pedo_res);
+
+    rt_pin_mode(BSP_ADXL345_INT1_PIN, PIN_MODE_INPUT_PULLDOWN);
+    rt_pin_attach_irq(BSP_ADXL345_INT1_PIN, PIN_IRQ_MODE_RISING, adxl345_int_isr, RT_NULL);
+    rt_pin_irq_enable(BSP_ADXL345_INT1_PIN, PIN_IRQ_ENABLE);
+
+    tid = rt_thread_create("acc_acq", adxl345_acq_entry, RT_NULL, 1024, ADXL345_ACQ_PRIORITY, 10);
+    if (tid == RT_NULL)
+        return -RT_ENOMEM;
+    rt_thread_startup(tid);
+
+    adxl345_enter_active();
+
+    return RT_EOK;
+}
+
+/**
+ * @brief 获取计步结果 (累计步数、距离、当前步频与步长)
+ */
+void adxl345_pedo_get(pedo_result_t *res)
+{
+    rt_enter_critical();
+    *res = pedo_res;
+    rt_exit_critical();
+}
+
+/**
+ * @brief 设置基准步频 (100步/分) 下的步长, 实际步长随步频估计
+ */
+void adxl345_pedo_set_stride(uint16_t base_cm)
+{
+    rt_enter_critical();
+    pedo_set_stride(&acc_pedo, base_cm);
+    rt_exit_critical();
+}
+
 /**
  * @brief 初始化ADXL345
  */
@@ -109,8 +307,7 @@ int adxl345_init(void)
 {
     uint8_t id;
 
-    i2c_bus = (struct rt_i2c_bus_device *)rt_device_find(ADXL345_I2C_BUS_NAME);
-    if (i2c_bus == RT_NULL)
+    if (i2c_client_open(&adxl_i2c, ADXL345_I2C_BUS_NAME, "adxl345", ADXL345_I2C_ADDR, I2C_PRIO_SENSOR) != RT_EOK)
     {
         rt_kprintf("ADXL345: Can't find %s device!\n", ADXL345_I2C_BUS_NAME);
         return -RT_ERROR;
@@ -132,6 +329,14 @@ int adxl345_init(void)
     adxl345_write_reg(ADXL345_OFSY, 0x00);
     adxl345_write_reg(ADXL345_OFSZ, 0x00);
 
+    /* 活动/静止检测: 交流耦合, 三轴均参与; 中断全部接INT1, 由采集线程使能 */
+    adxl345_write_reg(ADXL345_THRESH_ACT, ADXL345_ACT_THRESH);
+    adxl345_write_reg(ADXL345_THRESH_INACT, ADXL345_INACT_THRESH);
+    adxl345_write_reg(ADXL345_TIME_INACT, ADXL345_INACT_TIME_S);
+    adxl345_write_reg(ADXL345_ACT_INACT_CTL, 0xFF);
+    adxl345_write_reg(ADXL345_INT_MAP, 0x00);
+    adxl345_write_reg(ADXL345_INT_ENABLE, 0x00);
+
     rt_kprintf("ADXL345: Initialized successfully\n");
     return RT_EOK;
 }
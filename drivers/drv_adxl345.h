@@ -7,6 +7,7 @@
 
 #include <rtthread.h>
 #include <rtdevice.h>
+#include "pedometer.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -21,8 +22,15 @@ extern "C" {
 #define ADXL345_OFSX           0x1E
 #define ADXL345_OFSY           0x1F
 #define ADXL345_OFSZ           0x20
+#define ADXL345_THRESH_ACT     0x24
+#define ADXL345_THRESH_INACT   0x25
+#define ADXL345_TIME_INACT     0x26
+#define ADXL345_ACT_INACT_CTL  0x27
 #define ADXL345_BW_RATE        0x2C
 #define ADXL345_POWER_CTL      0x2D
+#define ADXL345_INT_ENABLE     0x2E
+#define ADXL345_INT_MAP        0x2F
+#define ADXL345_INT_SOURCE     0x30
 #define ADXL345_DATA_FORMAT    0x31
 #define ADXL345_DATAX0         0x32
 #define ADXL345_DATAX1         0x33
@@ -30,6 +38,27 @@ extern "C" {
 #define ADXL345_DATAY1         0x35
 #define ADXL345_DATAZ0         0x36
 #define ADXL345_DATAZ1         0x37
+#define ADXL345_FIFO_CTL       0x38
+#define ADXL345_FIFO_STATUS    0x39
+
+/* INT_ENABLE / INT_MAP / INT_SOURCE 位 */
+#define ADXL345_INT_DATA_READY 0x80
+#define ADXL345_INT_ACTIVITY   0x10
+#define ADXL345_INT_INACTIVITY 0x08
+#define ADXL345_INT_WATERMARK  0x02
+#define ADXL345_INT_OVERRUN    0x01
+
+/* FIFO */
+#define ADXL345_RATE_HZ        100     /* 输出速率, 与BW_RATE一致 */
+#define ADXL345_FIFO_DEPTH     32      /* FIFO深度 (样本) */
+#define ADXL345_FIFO_WATERMARK 16      /* 水位中断阈值, 100Hz下约160ms一次 */
+
+/* 运动门控: 静止时降为低功耗12.5Hz, 只留活动中断 */
+#define ADXL345_ACT_THRESH     3       /* 活动阈值 62.5mg/LSB, 约0.19g */
+#define ADXL345_INACT_THRESH   2       /* 静止阈值, 约0.13g */
+#define ADXL345_INACT_TIME_S   5       /* 持续静止5秒判为静止 */
+#define ADXL345_BW_ACTIVE      0x0A    /* 100Hz */
+#define ADXL345_BW_IDLE        0x17    /* 低功耗, 12.5Hz */
 
 /* 数据结构 */
 typedef struct {
@@ -38,12 +67,27 @@ typedef struct {
     float z;
 } adxl345_data_t;
 
+/* 采集线程统计 */
+typedef struct {
+    uint32_t irq_count;     /* INT1中断次数 */
+    uint32_t bursts;        /* 突发读取次数 */
+    uint32_t samples;       /* 从FIFO读出的样本数 */
+    uint32_t overrun;       /* 读取时FIFO已满 (可能丢失样本) 的次数 */
+    uint32_t sleeps;        /* 静止中断后进入低功耗的次数 */
+    uint32_t wakeups;       /* 活动中断唤醒的次数 */
+    uint8_t  active;        /* 当前处于全速采集 */
+} adxl345_acq_stat_t;
+
 /* 函数声明 */
 int adxl345_init(void);
 uint8_t adxl345_read_reg(uint8_t addr);
 void adxl345_write_reg(uint8_t addr, uint8_t val);
 void adxl345_read_data(int16_t *x, int16_t *y, int16_t *z);
 void adxl345_read_average(float *x, float *y, float *z, uint8_t times);
+int32_t adxl345_read_fifo_burst(int16_t xyz[][3], int32_t max_samples);
+int adxl345_acq_start(void);
+void adxl345_pedo_get(pedo_result_t *res);
+void adxl345_pedo_set_stride(uint16_t base_cm);
 
 #ifdef __cplusplus
 }
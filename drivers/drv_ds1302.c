@@ -2,15 +2,14 @@
  * DS1302 RTC实时时钟驱动
  */
 #include "drv_ds1302.h"
+#include "bitbang.h"
 #include "board.h"
 
-extern void delay_us(uint32_t us);
-
 /* 全局日期变量 */
 ds1302_date_t sys_date = {0, 0, 12, 1, 1, 1, 24};
 
-#define BCD_TO_DEC(x)    ((x / 16) * 10 + (x % 16))
-#define DEC_TO_BCD(x)    ((x / 10) * 16 + (x % 10))
+#define BCD_TO_DEC(x)    (((x) / 16) * 10 + ((x) % 16))
+#define DEC_TO_BCD(x)    (((x) / 10) * 16 + ((x) % 10))
 
 static void ds1302_clk_high(void) { rt_pin_write(DS1302_CLK_PIN, PIN_HIGH); }
 static void ds1302_clk_low(void)  { rt_pin_write(DS1302_CLK_PIN, PIN_LOW); }
@@ -23,144 +22,452 @@ static uint8_t ds1302_dat_read(void) { return rt_pin_read(DS1302_DAT_PIN); }
 static void ds1302_dat_out(void) { rt_pin_mode(DS1302_DAT_PIN, PIN_MODE_OUTPUT); }
 static void ds1302_dat_in(void)  { rt_pin_mode(DS1302_DAT_PIN, PIN_MODE_INPUT); }
 
+/* 软件时钟: 由系统节拍推算, 每分钟在DS1302的秒跳变处重新对齐 */
+enum { CLK_NONE, CLK_HUNT, CLK_LOCKED };
+
+static struct {
+    int32_t   days;             /* 基准日, 自2000-01-01起 */
+    uint32_t  sod;              /* 基准时刻的当天秒数 */
+    uint8_t   week;
+    rt_tick_t tick;             /* 基准对应的节拍 */
+    uint8_t   state;
+    rt_tick_t next_hunt;        /* 开始寻找下一次秒跳变的节拍 */
+    rt_tick_t hunt_start;
+    rt_tick_t hunt_tick;        /* 上一次读秒寄存器的节拍 */
+    uint8_t   hunt_sec;         /* 上一次读到的秒, 0xFF表示还没有 */
+
+    /* 漂移估计的基线: 某次校准时的DS1302时间与节拍 */
+    uint8_t   anchor_valid;
+    int32_t   anchor_days;
+    uint32_t  anchor_sod;
+    rt_tick_t anchor_tick;
+    uint8_t   drift_valid;
+} clk;
+
+static ds1302_clock_stat_t clk_stat;
+
+/* 软件时钟状态由主循环推进, msh等其他线程也会读取或设置; 三线总线访问同样在锁内进行 */
+static struct rt_mutex clk_mutex;
+
+#define TICKS_FROM_MS(ms)   ((rt_tick_t)((uint64_t)(ms) * RT_TICK_PER_SECOND / 1000))
+#define TICK_REACHED(now, t) ((rt_tick_t)((now) - (t)) < 0x80000000UL)
+
+/* 三线时序 (2V供电下的最小值): CE与SCLK间的建立/保持, SCLK高低电平宽度 */
+#define DS1302_T_CE_US      4
+#define DS1302_T_HALF_US    1
+
 /**
- * @brief 写入一个字节
+ * @brief 三线协议函数: 输出t->mode个字节 (命令及数据), 再读入其余字节, 低位在前
+ * SCLK由主机驱动, 各等待只要求"至少", 都短于一次定时器中断, 原地忙等且允许被抢占.
  */
-void ds1302_write_byte(uint8_t addr, uint8_t data)
+static int ds1302_step(bb_task_t *t)
 {
-    uint8_t i;
+    BB_BEGIN(t);
 
     ds1302_rst_low();
-    delay_us(2);
     ds1302_clk_low();
-    delay_us(2);
-    ds1302_rst_high();
-    delay_us(2);
-
     ds1302_dat_out();
+    BB_WAIT_US(t, DS1302_T_CE_US);
+    ds1302_rst_high();
+    BB_WAIT_US(t, DS1302_T_CE_US);
 
-    /* 写地址 */
-    for (i = 0; i < 8; i++)
-    {
-        ds1302_clk_low();
-        if (addr & 0x01)
-            ds1302_dat_high();
-        else
-            ds1302_dat_low();
-        delay_us(2);
-        ds1302_clk_high();
-        delay_us(2);
-        addr >>= 1;
-    }
-
-    /* 写数据 */
-    for (i = 0; i < 8; i++)
+    for (t->idx = 0; t->idx < t->len * 8; t->idx++)
     {
-        ds1302_clk_low();
-        if (data & 0x01)
-            ds1302_dat_high();
+        if ((t->idx >> 3) < t->mode)
+        {
+            /* SCLK上升沿锁存 */
+            ds1302_clk_low();
+            if (t->buf[t->idx >> 3] & (1 << (t->idx & 7)))
+                ds1302_dat_high();
+            else
+                ds1302_dat_low();
+            BB_WAIT_US(t, DS1302_T_HALF_US);
+        }
         else
-            ds1302_dat_low();
-        delay_us(2);
+        {
+            /* 命令字节之后DS1302在SCLK下降沿输出 */
+            if (t->idx == t->mode * 8)
+                ds1302_dat_in();
+            ds1302_clk_low();
+            BB_WAIT_US(t, DS1302_T_HALF_US);
+            if (ds1302_dat_read())
+                t->buf[t->idx >> 3] |= 1 << (t->idx & 7);
+            else
+                t->buf[t->idx >> 3] &= ~(1 << (t->idx & 7));
+        }
         ds1302_clk_high();
-        delay_us(2);
-        data >>= 1;
+        BB_WAIT_US(t, DS1302_T_HALF_US);
     }
 
     ds1302_rst_low();
-    delay_us(2);
+    BB_WAIT_US(t, DS1302_T_CE_US);
+
+    BB_END(t);
 }
 
 /**
- * @brief 读取一个字节
+ * @brief 一次传输: 共len字节, 前n_out字节输出, 其余读入buf
  */
-uint8_t ds1302_read_byte(uint8_t addr)
+static void ds1302_xfer(uint8_t *buf, uint8_t len, uint8_t n_out)
 {
-    uint8_t i, data = 0;
+    bb_task_t t;
 
-    ds1302_rst_low();
-    delay_us(2);
-    ds1302_clk_low();
-    delay_us(2);
-    ds1302_rst_high();
-    delay_us(2);
+    t.buf = buf;
+    t.len = len;
+    t.mode = n_out;
+    bb_run(&t, ds1302_step);
+}
 
-    ds1302_dat_out();
+/**
+ * @brief 写入一个字节, 调用者须持有clk_mutex
+ */
+static void ds1302_write_byte(uint8_t addr, uint8_t data)
+{
+    uint8_t buf[2] = {addr, data};
+
+    ds1302_xfer(buf, 2, 2);
+}
+
+/**
+ * @brief 读取一个字节, 调用者须持有clk_mutex
+ */
+static uint8_t ds1302_read_byte(uint8_t addr)
+{
+    uint8_t buf[2] = {addr, 0};
+
+    ds1302_xfer(buf, 2, 1);
+    return buf[1];
+}
+
+/**
+ * @brief 时钟突发读: 一次传输读出秒~写保护8个寄存器 (BCD原值)
+ * DS1302在命令字节后锁存全部时间寄存器, 读出过程中不会跨过进位; 调用者须持有clk_mutex
+ */
+static void ds1302_burst_read(uint8_t regs[8])
+{
+    uint8_t buf[9] = {DS1302_CLOCK_BURST_READ};
+
+    ds1302_xfer(buf, 9, 1);
+    rt_memcpy(regs, &buf[1], 8);
+    clk_stat.burst_reads++;
+}
+
+/**
+ * @brief 时钟突发写: 一次传输写入8个寄存器, 须先取消写保护; 调用者须持有clk_mutex
+ */
+static void ds1302_burst_write(const uint8_t regs[8])
+{
+    uint8_t buf[9] = {DS1302_CLOCK_BURST_WRITE};
+
+    rt_memcpy(&buf[1], regs, 8);
+    ds1302_xfer(buf, 9, 9);
+}
+
+/**
+ * @brief 公历日期与自2000-01-01起天数的互相换算
+ */
+static int32_t days_from_civil(int32_t y, uint32_t m, uint32_t d)
+{
+    int32_t era, yoe, doy, doe;
+
+    y -= m <= 2;
+    era = y / 400;
+    yoe = y - era * 400;
+    doy = (153 * (int32_t)(m + (m > 2 ? -3 : 9)) + 2) / 5 + (int32_t)d - 1;
+    doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 730485;
+}
+
+static void civil_from_days(int32_t z, ds1302_date_t *date)
+{
+    int32_t era, doe, yoe, doy, mp;
+
+    z += 730485;
+    era = z / 146097;
+    doe = z - era * 146097;
+    yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    mp = (5 * doy + 2) / 153;
+    date->day = (uint8_t)(doy - (153 * mp + 2) / 5 + 1);
+    date->mon = (uint8_t)(mp < 10 ? mp + 3 : mp - 9);
+    date->year = (uint16_t)(yoe + era * 400 + (date->mon <= 2));
+}
+
+static void ds1302_decode(const uint8_t regs[8], ds1302_date_t *date)
+{
+    date->sec = BCD_TO_DEC(regs[0] & 0x7F);
+    date->min = BCD_TO_DEC(regs[1] & 0x7F);
+    date->hour = BCD_TO_DEC(regs[2] & 0x3F);
+    date->day = BCD_TO_DEC(regs[3] & 0x3F);
+    date->mon = BCD_TO_DEC(regs[4] & 0x1F);
+    date->week = BCD_TO_DEC(regs[5] & 0x07);
+    date->year = 2000 + BCD_TO_DEC(regs[6]);
+}
+
+/**
+ * @brief 软件时钟自基准以来走过的毫秒数 (已按漂移估计修正)
+ */
+static int64_t clk_elapsed_ms(rt_tick_t now)
+{
+    int64_t ms = (int64_t)((uint64_t)(rt_tick_t)(now - clk.tick) * 1000 / RT_TICK_PER_SECOND);
+
+    return ms + (int64_t)(ms * clk_stat.drift_ppm * 1e-6f);
+}
+
+/**
+ * @brief 以节拍now时刻的日期为软件时钟基准
+ */
+static void clk_set_base(const ds1302_date_t *date, rt_tick_t now)
+{
+    clk.days = days_from_civil(date->year, date->mon, date->day);
+    clk.sod = date->hour * 3600UL + date->min * 60UL + date->sec;
+    clk.week = date->week;
+    clk.tick = now;
+}
 
-    /* 写地址 */
-    for (i = 0; i < 8; i++)
+/**
+ * @brief 在秒跳变处对齐: 记录偏差, 更新漂移估计, 安排下一次校准
+ */
+static void clk_lock(const ds1302_date_t *date, rt_tick_t edge)
+{
+    int32_t days = days_from_civil(date->year, date->mon, date->day);
+    uint32_t sod = date->hour * 3600UL + date->min * 60UL + date->sec;
+    int64_t predicted, actual, dt_rtc_s, dt_tick_ms;
+
+    if (clk.state != CLK_NONE && clk_stat.locked)
     {
-        ds1302_clk_low();
-        if (addr & 0x01)
-            ds1302_dat_high();
-        else
-            ds1302_dat_low();
-        delay_us(2);
-        ds1302_clk_high();
-        delay_us(2);
-        addr >>= 1;
+        predicted = ((int64_t)clk.days * 86400 + clk.sod) * 1000 + clk_elapsed_ms(edge);
+        actual = ((int64_t)days * 86400 + sod) * 1000;
+        clk_stat.last_offset_ms = (int32_t)(predicted - actual);
+        if (clk.drift_valid)
+        {
+            if (clk_stat.last_offset_ms > clk_stat.max_offset_ms)
+                clk_stat.max_offset_ms = clk_stat.last_offset_ms;
+            else if (-clk_stat.last_offset_ms > clk_stat.max_offset_ms)
+                clk_stat.max_offset_ms = -clk_stat.last_offset_ms;
+        }
     }
 
-    ds1302_dat_in();
+    /* 漂移: 基线内DS1302走过的秒数与节拍走过的时间之比 */
+    if (clk.anchor_valid)
+    {
+        dt_rtc_s = ((int64_t)days - clk.anchor_days) * 86400 + sod - clk.anchor_sod;
+        dt_tick_ms = (int64_t)((uint64_t)(rt_tick_t)(edge - clk.anchor_tick) * 1000 / RT_TICK_PER_SECOND);
+        if (dt_rtc_s >= DS1302_DRIFT_MIN_S && dt_tick_ms > 0)
+        {
+            clk_stat.drift_ppm = (float)(dt_rtc_s * 1000 - dt_tick_ms) * 1e6f / (float)dt_tick_ms;
+            clk.drift_valid = 1;
+        }
+        if (dt_rtc_s >= DS1302_DRIFT_BASE_S)
+            clk.anchor_valid = 0;
+    }
+    if (!clk.anchor_valid)
+    {
+        clk.anchor_valid = 1;
+        clk.anchor_days = days;
+        clk.anchor_sod = sod;
+        clk.anchor_tick = edge;
+    }
+
+    clk_set_base(date, edge);
+    clk.state = CLK_LOCKED;
+    clk.next_hunt = edge + TICKS_FROM_MS(DS1302_SYNC_PERIOD_S * 1000UL - DS1302_HUNT_LEAD_MS);
+    clk_stat.syncs++;
+    clk_stat.locked = 1;
+}
 
-    /* 读数据 */
-    for (i = 0; i < 8; i++)
+/**
+ * @brief 寻找秒跳变: 每次调用读一次秒寄存器, 跳变时刻取前后两次读之间的中点
+ */
+static void clk_hunt(rt_tick_t now)
+{
+    uint8_t regs[8], sec;
+    ds1302_date_t date;
+
+    sec = ds1302_read_byte(DS1302_READ_SEC) & 0x7F;
+    clk_stat.sec_reads++;
+
+    if (clk.hunt_sec != 0xFF && sec != clk.hunt_sec &&
+        (rt_tick_t)(now - clk.hunt_tick) <= TICKS_FROM_MS(1000))
     {
-        ds1302_clk_low();
-        delay_us(2);
-        data >>= 1;
-        if (ds1302_dat_read())
-            data |= 0x80;
-        ds1302_clk_high();
-        delay_us(2);
+        ds1302_burst_read(regs);
+        ds1302_decode(regs, &date);
+        clk_lock(&date, clk.hunt_tick + (rt_tick_t)(now - clk.hunt_tick) / 2);
+        return;
     }
 
-    ds1302_rst_low();
-    delay_us(2);
+    /* 秒寄存器不走 (时钟停振): 不再等待, 按当前读数重设基准 */
+    if ((rt_tick_t)(now - clk.hunt_start) > TICKS_FROM_MS(2000))
+    {
+        ds1302_burst_read(regs);
+        ds1302_decode(regs, &date);
+        clk_set_base(&date, now);
+        clk.state = CLK_LOCKED;
+        clk.next_hunt = now + TICKS_FROM_MS(DS1302_SYNC_PERIOD_S * 1000UL);
+        clk_stat.locked = 0;
+        return;
+    }
+    clk.hunt_sec = sec;
+    clk.hunt_tick = now;
+}
 
-    return data;
+static void clk_start_hunt(rt_tick_t now)
+{
+    clk.state = CLK_HUNT;
+    clk.hunt_start = now;
+    clk.hunt_sec = 0xFF;
 }
 
 /**
  * @brief 设置日期时间
+ * 取消写保护后一次突发写入全部时间寄存器, 最后一个字节重新写保护
  */
 int ds1302_set_date(const ds1302_date_t *date)
 {
+    uint8_t regs[8];
+
     if (date == RT_NULL) return -RT_ERROR;
 
-    ds1302_write_byte(DS1302_WRITE_CTRL, 0x00);  /* 取消写保护 */
+    regs[0] = DEC_TO_BCD(date->sec);
+    regs[1] = DEC_TO_BCD(date->min);
+    regs[2] = DEC_TO_BCD(date->hour);
+    regs[3] = DEC_TO_BCD(date->day);
+    regs[4] = DEC_TO_BCD(date->mon);
+    regs[5] = DEC_TO_BCD(date->week);
+    regs[6] = DEC_TO_BCD(date->year % 100);
+    regs[7] = 0x80;                              /* 写保护 */
 
-    ds1302_write_byte(DS1302_WRITE_SEC, DEC_TO_BCD(date->sec));
-    ds1302_write_byte(DS1302_WRITE_MIN, DEC_TO_BCD(date->min));
-    ds1302_write_byte(DS1302_WRITE_HOUR, DEC_TO_BCD(date->hour));
-    ds1302_write_byte(DS1302_WRITE_DAY, DEC_TO_BCD(date->day));
-    ds1302_write_byte(DS1302_WRITE_MON, DEC_TO_BCD(date->mon));
-    ds1302_write_byte(DS1302_WRITE_WEEK, DEC_TO_BCD(date->week));
-    ds1302_write_byte(DS1302_WRITE_YEAR, DEC_TO_BCD(date->year % 100));
+    rt_mutex_take(&clk_mutex, RT_WAITING_FOREVER);
+    ds1302_write_byte(DS1302_WRITE_CTRL, 0x00);  /* 取消写保护 */
+    ds1302_burst_write(regs);
 
-    ds1302_write_byte(DS1302_WRITE_CTRL, 0x80);  /* 写保护 */
+    /* 时间跳变, 漂移基线从下一次校准重新开始 */
+    clk_set_base(date, rt_tick_get());
+    clk.anchor_valid = 0;
+    clk.state = CLK_LOCKED;
+    clk.next_hunt = clk.tick + TICKS_FROM_MS(DS1302_SYNC_PERIOD_S * 1000UL - DS1302_HUNT_LEAD_MS);
+    rt_mutex_release(&clk_mutex);
 
     return RT_EOK;
 }
 
 /**
- * @brief 读取日期时间
+ * @brief 从DS1302读取日期时间 (一次突发读)
  */
 int ds1302_read_date(ds1302_date_t *date)
 {
+    uint8_t regs[8];
+
     if (date == RT_NULL) return -RT_ERROR;
 
-    date->sec = BCD_TO_DEC(ds1302_read_byte(DS1302_READ_SEC) & 0x7F);
-    date->min = BCD_TO_DEC(ds1302_read_byte(DS1302_READ_MIN) & 0x7F);
-    date->hour = BCD_TO_DEC(ds1302_read_byte(DS1302_READ_HOUR) & 0x3F);
-    date->day = BCD_TO_DEC(ds1302_read_byte(DS1302_READ_DAY) & 0x3F);
-    date->mon = BCD_TO_DEC(ds1302_read_byte(DS1302_READ_MON) & 0x1F);
-    date->week = BCD_TO_DEC(ds1302_read_byte(DS1302_READ_WEEK) & 0x07);
-    date->year = 2000 + BCD_TO_DEC(ds1302_read_byte(DS1302_READ_YEAR));
+    rt_mutex_take(&clk_mutex, RT_WAITING_FOREVER);
+    ds1302_burst_read(regs);
+    rt_mutex_release(&clk_mutex);
+    ds1302_decode(regs, date);
 
     return RT_EOK;
 }
 
+/**
+ * @brief 由软件时钟基准推算节拍now时刻的日期, 不改变时钟状态
+ */
+static void clk_date(rt_tick_t now, ds1302_date_t *date)
+{
+    int64_t total;
+    int32_t days;
+
+    total = clk.sod + clk_elapsed_ms(now) / 1000;
+    days = clk.days + (int32_t)(total / 86400);
+    total %= 86400;
+    civil_from_days(days, date);
+    date->hour = (uint8_t)(total / 3600);
+    date->min = (uint8_t)(total / 60 % 60);
+    date->sec = (uint8_t)(total % 60);
+    date->week = (uint8_t)((clk.week - 1 + (days - clk.days)) % 7 + 1);
+}
+
+/**
+ * @brief 获取当前日期时间: 由软件时钟推算, 通常不访问DS1302
+ * 首次调用突发读一次作为基准; 之后每分钟在预计的秒跳变前开始,
+ * 每次调用读一次秒寄存器, 读到跳变即重新对齐并估计漂移.
+ * 跳变时刻的分辨率为调用间隔, 应只由一个周期性调用的线程 (主循环) 使用.
+ */
+int ds1302_get_date(ds1302_date_t *date)
+{
+    rt_tick_t now;
+    uint8_t regs[8];
+    ds1302_date_t base;
+
+    if (date == RT_NULL) return -RT_ERROR;
+
+    rt_mutex_take(&clk_mutex, RT_WAITING_FOREVER);
+    now = rt_tick_get();
+    if (clk.state == CLK_NONE)
+    {
+        ds1302_burst_read(regs);
+        ds1302_decode(regs, &base);
+        clk_set_base(&base, now);
+        clk_start_hunt(now);
+    }
+    else if (clk.state == CLK_LOCKED && TICK_REACHED(now, clk.next_hunt))
+    {
+        clk_start_hunt(now);
+    }
+    if (clk.state == CLK_HUNT)
+        clk_hunt(now);
+    clk_stat.reads++;
+
+    clk_date(now, date);
+    rt_mutex_release(&clk_mutex);
+
+    return RT_EOK;
+}
+
+/**
+ * @brief 获取软件时钟统计
+ */
+void ds1302_get_clock_stat(ds1302_clock_stat_t *stat)
+{
+    rt_mutex_take(&clk_mutex, RT_WAITING_FOREVER);
+    *stat = clk_stat;
+    rt_mutex_release(&clk_mutex);
+}
+
+/**
+ * @brief 查看软件时钟与校准统计
+ */
+static int ds1302(int argc, char **argv)
+{
+    ds1302_date_t date;
+    ds1302_clock_stat_t stat;
+    uint8_t started, drift_valid;
+    int32_t ppm_x10;
+
+    /* 只取快照, 不推进对齐状态机 (跳变检测依赖主循环的调用间隔) */
+    rt_mutex_take(&clk_mutex, RT_WAITING_FOREVER);
+    started = clk.state != CLK_NONE;
+    if (started)
+        clk_date(rt_tick_get(), &date);
+    stat = clk_stat;
+    drift_valid = clk.drift_valid;
+    rt_mutex_release(&clk_mutex);
+
+    if (started)
+        rt_kprintf("%04d-%02d-%02d %02d:%02d:%02d week %d, %s\n", date.year, date.mon, date.day,
+                   date.hour, date.min, date.sec, date.week, stat.locked ? "locked" : "unlocked");
+    else
+        rt_kprintf("software clock not started\n");
+    ppm_x10 = (int32_t)(stat.drift_ppm * 10.0f + (stat.drift_ppm >= 0 ? 0.5f : -0.5f));
+    rt_kprintf("syncs %u, reads %u (bus: %u burst, %u sec)\n",
+               stat.syncs, stat.reads, stat.burst_reads, stat.sec_reads);
+    rt_kprintf("offset last %d ms, max %d ms, drift %s%d.%d ppm%s\n",
+               stat.last_offset_ms, stat.max_offset_ms, ppm_x10 < 0 ? "-" : "",
+               (ppm_x10 < 0 ? -ppm_x10 : ppm_x10) / 10, (ppm_x10 < 0 ? -ppm_x10 : ppm_x10) % 10,
+               drift_valid ? "" : " (not yet estimated)");
+    return 0;
+}
+MSH_CMD_EXPORT(ds1302, show ds1302 software clock and drift);
+
 /**
  * @brief 初始化DS1302
  */
@@ -170,11 +477,13 @@ int ds1302_init(const ds1302_date_t *date)
     rt_pin_mode(DS1302_DAT_PIN, PIN_MODE_OUTPUT);
     rt_pin_mode(DS1302_RST_PIN, PIN_MODE_OUTPUT);
 
+    rt_mutex_take(&clk_mutex, RT_WAITING_FOREVER);
     ds1302_rst_low();
     ds1302_clk_low();
 
     ds1302_write_byte(DS1302_WRITE_CTRL, 0x00);  /* 取消写保护 */
     ds1302_write_byte(DS1302_WRITE_SEC, 0x00);   /* 启动时钟 */
+    rt_mutex_release(&clk_mutex);
 
     if (date != RT_NULL)
     {
@@ -184,3 +493,13 @@ int ds1302_init(const ds1302_date_t *date)
     rt_kprintf("DS1302: Initialized successfully\n");
     return RT_EOK;
 }
+
+/**
+ * @brief 创建软件时钟的锁, 须早于任何线程调用本驱动
+ */
+static int ds1302_lock_init(void)
+{
+    rt_mutex_init(&clk_mutex, "ds1302", RT_IPC_FLAG_PRIO);
+    return RT_EOK;
+}
+INIT_PREV_EXPORT(ds1302_lock_init);
@@ -33,6 +33,14 @@ extern "C" {
 #define DS1302_READ_YEAR     0x8D
 #define DS1302_WRITE_CTRL    0x8E
 #define DS1302_READ_CTRL     0x8F
+#define DS1302_CLOCK_BURST_WRITE  0xBE  /* 一次写入秒~写保护8个寄存器 */
+#define DS1302_CLOCK_BURST_READ   0xBF
+
+/* 软件时钟 */
+#define DS1302_SYNC_PERIOD_S      60    /* 每分钟从DS1302重新校准一次 */
+#define DS1302_HUNT_LEAD_MS       300   /* 预计秒跳变前提前开始查询秒寄存器 */
+#define DS1302_DRIFT_MIN_S        600   /* 基线不足10分钟不更新漂移估计 */
+#define DS1302_DRIFT_BASE_S       86400 /* 基线超过一天后以当前校准点重新开始 */
 
 /* 日期时间结构 */
 typedef struct {
@@ -45,6 +53,18 @@ typedef struct {
     volatile uint16_t year;
 } ds1302_date_t;
 
+/* 软件时钟统计 */
+typedef struct {
+    uint32_t syncs;             /* 在秒跳变处完成的校准次数 */
+    uint32_t burst_reads;
+    uint32_t sec_reads;         /* 寻找秒跳变时的单寄存器读 */
+    uint32_t reads;             /* ds1302_get_date 调用次数 (内存读) */
+    int32_t  last_offset_ms;    /* 最近一次校准时软件时钟相对DS1302的偏差 */
+    int32_t  max_offset_ms;     /* 漂移估计生效后的最大偏差绝对值 */
+    float    drift_ppm;         /* DS1302相对系统节拍的快慢 */
+    uint8_t  locked;            /* 已对齐到秒跳变 */
+} ds1302_clock_stat_t;
+
 /* 全局日期变量 */
 extern ds1302_date_t sys_date;
 
@@ -52,8 +72,8 @@ extern ds1302_date_t sys_date;
 int ds1302_init(const ds1302_date_t *date);
 int ds1302_set_date(const ds1302_date_t *date);
 int ds1302_read_date(ds1302_date_t *date);
-void ds1302_write_byte(uint8_t addr, uint8_t data);
-uint8_t ds1302_read_byte(uint8_t addr);
+int ds1302_get_date(ds1302_date_t *date);
+void ds1302_get_clock_stat(ds1302_clock_stat_t *stat);
 
 #ifdef __cplusplus
 }
@@ -1,12 +1,14 @@
 /*
  * DS18B20温度传感器驱动
- * 单总线协议
+ * 单总线协议, 同一引脚可挂多个器件 (Search ROM枚举, Match ROM寻址)
  */
 #include "drv_ds18b20.h"
+#include "bitbang.h"
 #include "board.h"
+#include <stdlib.h>
 
 /* 延时函数声明 */
-extern void delay_us(uint32_t us);
+extern uint32_t get_time_us(void);
 
 /**
  * @brief 设置为输出模式
@@ -48,147 +50,583 @@ static uint8_t ds18b20_read_pin(void)
     return rt_pin_read(DS18B20_PIN);
 }
 
+/* ==================== 单总线时隙 ==================== */
+
+/* 总线事务 (bb_task_t.mode) */
+#define OW_RESET    0
+#define OW_WRITE    1
+#define OW_READ     2
+
+static uint8_t presence;        /* 最近一次复位的应答: 0有器件, 1无应答 */
+
+/**
+ * @brief 单总线协议函数: 复位或收发len位 (低位在前)
+ * 时隙中拉低到释放、拉低到采样的部分原子忙等; 时隙剩余的60us左右
+ * 与复位的毫秒级等待交给定时器, 线程让出CPU.
+ */
+static int ds18b20_step(bb_task_t *t)
+{
+    BB_BEGIN(t);
+
+    if (t->mode == OW_RESET)
+    {
+        /* 复位脉冲至少480us; 应答在释放后15~60us开始, 持续60~240us */
+        ds18b20_set_output();
+        ds18b20_write_low();
+        BB_WAIT_US(t, 500);
+        ds18b20_write_high();
+        ds18b20_set_input();
+        BB_WAIT_US(t, 70);
+        t->result = ds18b20_read_pin();
+        BB_WAIT_US(t, 410);
+    }
+    else
+    {
+        for (t->idx = 0; t->idx < t->len; t->idx++)
+        {
+            ds18b20_set_output();
+            ds18b20_write_low();
+            if (t->mode == OW_READ)
+            {
+                /* 采样点须在拉低后15us内 */
+                bb_spin_us(2);
+                ds18b20_write_high();
+                ds18b20_set_input();
+                bb_spin_us(12);
+                if (ds18b20_read_pin())
+                    t->buf[t->idx >> 3] |= 1 << (t->idx & 7);
+                else
+                    t->buf[t->idx >> 3] &= ~(1 << (t->idx & 7));
+                BB_WAIT_US(t, 50);
+            }
+            else if (t->buf[t->idx >> 3] & (1 << (t->idx & 7)))
+            {
+                /* 写1的低电平超过15us会被读成0 */
+                bb_spin_us(2);
+                ds18b20_write_high();
+                BB_WAIT_US(t, 60);
+            }
+            else
+            {
+                /* 写0低电平60~120us, 超过480us会变成复位脉冲 */
+                BB_WAIT_US(t, 60);
+                ds18b20_write_high();
+                bb_spin_us(2);
+            }
+        }
+    }
+
+    BB_END(t);
+}
+
 /**
- * @brief 复位DS18B20
+ * @brief 收发bits位
+ */
+static void ds18b20_xfer(uint8_t mode, uint8_t *buf, uint8_t bits)
+{
+    bb_task_t t;
+
+    t.mode = mode;
+    t.buf = buf;
+    t.len = bits;
+    bb_run(&t, ds18b20_step);
+}
+
+/**
+ * @brief 复位DS18B20, 应答结果由ds18b20_check取得
  */
 void ds18b20_reset(void)
 {
-    ds18b20_set_output();
-    ds18b20_write_low();
-    delay_us(750);
-    ds18b20_write_high();
-    delay_us(15);
+    bb_task_t t;
+
+    t.mode = OW_RESET;
+    presence = (uint8_t)bb_run(&t, ds18b20_step);
 }
 
 /**
- * @brief 检测DS18B20是否存在
+ * @brief 检测DS18B20是否存在 (最近一次复位的应答)
+ * @return 0有器件, 1无应答
  */
 uint8_t ds18b20_check(void)
 {
-    uint8_t retry = 0;
+    return presence;
+}
+
+/**
+ * @brief 读取一个位
+ */
+uint8_t ds18b20_read_bit(void)
+{
+    uint8_t data = 0;
+
+    ds18b20_xfer(OW_READ, &data, 1);
+    return data;
+}
+
+/**
+ * @brief 读取一个字节
+ */
+uint8_t ds18b20_read_byte(void)
+{
+    uint8_t data = 0;
+
+    ds18b20_xfer(OW_READ, &data, 8);
+    return data;
+}
+
+/**
+ * @brief 写入一个位
+ */
+void ds18b20_write_bit(uint8_t bit)
+{
+    ds18b20_xfer(OW_WRITE, &bit, 1);
+}
+
+/**
+ * @brief 写入一个字节
+ */
+void ds18b20_write_byte(uint8_t dat)
+{
+    ds18b20_xfer(OW_WRITE, &dat, 8);
+}
+
+/**
+ * @brief 启动温度转换
+ */
+void ds18b20_start(void)
+{
+    ds18b20_reset();
+    ds18b20_check();
+    ds18b20_write_byte(DS18B20_CMD_SKIP_ROM);
+    ds18b20_write_byte(DS18B20_CMD_CONVERT_T);
+}
+
+/**
+ * @brief 1-Wire CRC8 (x^8 + x^5 + x^4 + 1, 低位先行)
+ */
+uint8_t ds18b20_crc8(const uint8_t *data, uint8_t len)
+{
+    uint8_t crc = 0, in, i, b;
 
-    ds18b20_set_input();
-    while (ds18b20_read_pin() && retry < 200)
+    for (i = 0; i < len; i++)
     {
-        retry++;
-        delay_us(1);
+        in = data[i];
+        for (b = 0; b < 8; b++)
+        {
+            if ((crc ^ in) & 0x01)
+                crc = (crc >> 1) ^ 0x8C;
+            else
+                crc >>= 1;
+            in >>= 1;
+        }
     }
-    if (retry >= 200) return 1;
+    return crc;
+}
+
+/**
+ * @brief Search ROM枚举总线上的全部器件
+ * 每一位先读ROM位与反码: 不同则所有剩余器件该位一致; 都为0说明有分歧,
+ * 在上次最后的分歧点之前沿用上次的方向, 在分歧点处改走1, 之后先走0.
+ * @param roms: 输出ROM码, 按搜索顺序
+ * @param max: 最多枚举的器件数
+ * @return 找到的器件数, 无器件或CRC错误时返回已找到的部分
+ */
+int ds18b20_search(uint8_t roms[][8], uint8_t max)
+{
+    uint8_t rom[8] = {0};
+    uint8_t last_disc = 0, last_zero, n, id_bit, cmp_bit, dir, pair, count = 0;
 
-    retry = 0;
-    while (!ds18b20_read_pin() && retry < 240)
+    do
     {
-        retry++;
-        delay_us(1);
-    }
-    if (retry >= 240) return 1;
+        ds18b20_reset();
+        if (ds18b20_check())
+            break;
+        ds18b20_write_byte(DS18B20_CMD_SEARCH_ROM);
 
-    return 0;
+        last_zero = 0;
+        for (n = 1; n <= 64; n++)
+        {
+            ds18b20_xfer(OW_READ, &pair, 2);
+            id_bit = pair & 0x01;
+            cmp_bit = (pair >> 1) & 0x01;
+            if (id_bit && cmp_bit)
+                return count;               /* 没有器件应答 */
+
+            if (id_bit != cmp_bit)
+                dir = id_bit;
+            else if (n < last_disc)
+                dir = (rom[(n - 1) / 8] >> ((n - 1) % 8)) & 1;
+            else
+                dir = (n == last_disc);
+            if (id_bit == cmp_bit && dir == 0)
+                last_zero = n;
+
+            if (dir)
+                rom[(n - 1) / 8] |= 1 << ((n - 1) % 8);
+            else
+                rom[(n - 1) / 8] &= ~(1 << ((n - 1) % 8));
+            ds18b20_write_bit(dir);
+        }
+
+        if (ds18b20_crc8(rom, 7) != rom[7])
+            break;
+        rt_memcpy(roms[count++], rom, 8);
+        last_disc = last_zero;
+    } while (last_disc != 0 && count < max);
+
+    return count;
 }
 
+/* ==================== 异步转换 ==================== */
+
+#define DS18B20_THREAD_PRIORITY 11      /* 仅次于主循环 */
+
+#define DS18B20_RESCAN_FAILS    3       /* 某器件连续读失败次数达到后重新枚举 */
+
+static struct rt_timer conv_timer;
+static rt_sem_t conv_sem = RT_NULL;
+static ds18b20_stat_t conv_stat;
+static uint8_t resolution = DS18B20_RES_DEFAULT;
+static uint8_t res_pending = 1;         /* 下次转换前写入配置寄存器 */
+static uint8_t scan_pending = 1;        /* 下次转换前重新枚举 */
+
+/* 枚举到的器件, 按搜索顺序; 第0个为主探头 (显示与报警) */
+static uint8_t dev_count;
+static uint8_t dev_rom[DS18B20_MAX_DEVICES][8];
+static uint8_t dev_th_tl[DS18B20_MAX_DEVICES][2];   /* 报警阈值寄存器, 改分辨率时原样写回 */
+static uint8_t dev_fails[DS18B20_MAX_DEVICES];
+static ds18b20_reading_t readings[DS18B20_MAX_DEVICES];
+
 /**
- * @brief 读取一个位
+ * @brief 复位并选中第idx个器件; 总线上只有一个器件时用Skip ROM省去8字节
+ * @param idx: 器件序号, -1表示广播
  */
-uint8_t ds18b20_read_bit(void)
+static rt_err_t ds18b20_select(int idx)
 {
-    uint8_t data;
+    uint8_t cmd[9];
+
+    ds18b20_reset();
+    if (ds18b20_check())
+        return -RT_EIO;
+    if (idx < 0 || dev_count <= 1)
+    {
+        ds18b20_write_byte(DS18B20_CMD_SKIP_ROM);
+        return RT_EOK;
+    }
+    cmd[0] = DS18B20_CMD_MATCH_ROM;
+    rt_memcpy(&cmd[1], dev_rom[idx], 8);
+    ds18b20_xfer(OW_WRITE, cmd, 72);
+    return RT_EOK;
+}
 
-    ds18b20_set_output();
-    ds18b20_write_low();
-    delay_us(2);
-    ds18b20_write_high();
-    ds18b20_set_input();
-    delay_us(12);
-    data = ds18b20_read_pin();
-    delay_us(50);
+/**
+ * @brief 读第idx个器件的暂存器9字节并校验CRC
+ * @return RT_EOK 成功, -RT_EIO 无应答, -RT_ERROR CRC错误
+ */
+static rt_err_t ds18b20_read_scratchpad(int idx, uint8_t buf[9])
+{
+    if (ds18b20_select(idx) != RT_EOK)
+        return -RT_EIO;
+    ds18b20_write_byte(DS18B20_CMD_READ_SCRATCH);
+    ds18b20_xfer(OW_READ, buf, 72);
 
-    return data;
+    /* 总线悬空时读到全1, CRC为0xFF恰好也不匹配; 全0时CRC为0, 需单独排除 */
+    if (buf[4] == 0 || ds18b20_crc8(buf, 8) != buf[8])
+        return -RT_ERROR;
+    return RT_EOK;
 }
 
 /**
- * @brief 读取一个字节
+ * @brief 写第idx个器件配置寄存器的分辨率位 (R1 R0), TH/TL保持不变
  */
-uint8_t ds18b20_read_byte(void)
+static rt_err_t ds18b20_write_config(int idx, uint8_t bits)
 {
-    uint8_t i, data = 0;
+    uint8_t cmd[4];
+
+    if (ds18b20_select(idx) != RT_EOK)
+        return -RT_EIO;
+    cmd[0] = DS18B20_CMD_WRITE_SCRATCH;
+    cmd[1] = dev_th_tl[idx][0];
+    cmd[2] = dev_th_tl[idx][1];
+    cmd[3] = (uint8_t)(((bits - DS18B20_RES_MIN) << 5) | 0x1F);
+    ds18b20_xfer(OW_WRITE, cmd, 32);
+    return RT_EOK;
+}
 
-    for (i = 0; i < 8; i++)
+/**
+ * @brief 枚举总线上的器件; 搜索失败但有应答时按单个未知ROM的器件处理
+ */
+static void ds18b20_scan(void)
+{
+    uint8_t i, buf[9];
+
+    dev_count = (uint8_t)ds18b20_search(dev_rom, DS18B20_MAX_DEVICES);
+    if (dev_count == 0)
+    {
+        ds18b20_reset();
+        if (ds18b20_check() == 0)
+            dev_count = 1;
+    }
+    for (i = 0; i < dev_count; i++)
     {
-        data >>= 1;
-        if (ds18b20_read_bit())
-            data |= 0x80;
+        dev_fails[i] = 0;
+        dev_th_tl[i][0] = 0x4B;
+        dev_th_tl[i][1] = 0x46;
+        if (ds18b20_read_scratchpad(i, buf) == RT_EOK)
+        {
+            dev_th_tl[i][0] = buf[2];
+            dev_th_tl[i][1] = buf[3];
+        }
     }
+    conv_stat.devices = dev_count;
+    conv_stat.scans++;
+    res_pending = 1;
+}
 
-    return data;
+/**
+ * @brief 转换时间到: 唤醒转换线程读取结果
+ */
+static void ds18b20_conv_timeout(void *parameter)
+{
+    rt_sem_release(conv_sem);
 }
 
 /**
- * @brief 写入一个字节
+ * @brief 读出第idx个器件的结果, CRC正确才更新读数
  */
-void ds18b20_write_byte(uint8_t dat)
+static void ds18b20_update(int idx, uint8_t bits)
 {
-    uint8_t i;
+    ds18b20_reading_t *r = &readings[idx];
+    uint8_t buf[9];
+    int16_t raw;
 
-    ds18b20_set_output();
-    for (i = 0; i < 8; i++)
+    switch (ds18b20_read_scratchpad(idx, buf))
     {
-        if (dat & 0x01)
+    case RT_EOK:
+        dev_fails[idx] = 0;
+        dev_th_tl[idx][0] = buf[2];
+        dev_th_tl[idx][1] = buf[3];
+        /* 配置被改动 (如掉电复位) 时重新写入 */
+        if (((buf[4] >> 5) & 0x03) != bits - DS18B20_RES_MIN)
+            res_pending = 1;
+
+        raw = (int16_t)((buf[1] << 8) | buf[0]);
+        rt_enter_critical();
+        r->raw = raw;
+        /* 四舍五入到0.1°C */
+        r->temp_x10 = raw >= 0 ? (int16_t)((raw * 10 + 8) >> 4) : (int16_t)-((-raw * 10 + 8) >> 4);
+        r->seq++;
+        r->tick = rt_tick_get();
+        rt_exit_critical();
+        conv_stat.reads++;
+        return;
+    case -RT_EIO:
+        conv_stat.no_presence++;
+        break;
+    default:
+        conv_stat.crc_errors++;
+        break;
+    }
+    if (++dev_fails[idx] >= DS18B20_RESCAN_FAILS)
+        scan_pending = 1;
+}
+
+/**
+ * @brief 转换线程: 广播Convert T让所有器件同时转换, 由定时器在转换时间后唤醒,
+ *        再逐个选中读出暂存器, 随即开始下一次转换.
+ *        N个探头只花一次转换时间.
+ */
+static void ds18b20_conv_entry(void *parameter)
+{
+    uint8_t bits, i;
+    uint32_t t0;
+    rt_tick_t wait;
+
+    while (1)
+    {
+        if (scan_pending)
         {
-            ds18b20_write_low();
-            delay_us(2);
-            ds18b20_write_high();
-            delay_us(60);
+            scan_pending = 0;
+            ds18b20_scan();
         }
-        else
+        if (dev_count == 0)
         {
-            ds18b20_write_low();
-            delay_us(60);
-            ds18b20_write_high();
-            delay_us(2);
+            conv_stat.no_presence++;
+            scan_pending = 1;
+            rt_thread_mdelay(DS18B20_CONV_MS(DS18B20_RES_MAX));
+            continue;
+        }
+        if (res_pending)
+        {
+            res_pending = 0;
+            for (i = 0; i < dev_count; i++)
+                ds18b20_write_config(i, resolution);
+        }
+        bits = resolution;
+
+        t0 = get_time_us();
+        if (ds18b20_select(-1) != RT_EOK)
+        {
+            conv_stat.no_presence++;
+            scan_pending = 1;
+            rt_thread_mdelay(DS18B20_CONV_MS(DS18B20_RES_MAX));
+            continue;
         }
-        dat >>= 1;
+        ds18b20_write_byte(DS18B20_CMD_CONVERT_T);
+        conv_stat.conversions++;
+
+        wait = rt_tick_from_millisecond(DS18B20_CONV_MS(bits));
+        rt_timer_control(&conv_timer, RT_TIMER_CTRL_SET_TIME, &wait);
+        rt_timer_start(&conv_timer);
+        rt_sem_take(conv_sem, RT_WAITING_FOREVER);
+
+        for (i = 0; i < dev_count; i++)
+            ds18b20_update(i, bits);
+        conv_stat.cycle_us = get_time_us() - t0;
     }
 }
 
 /**
- * @brief 启动温度转换
+ * @brief 启动异步转换线程
+ * 此后 ds18b20_get_temp 只返回缓存的读数, 不再占用总线.
  */
-void ds18b20_start(void)
+int ds18b20_async_start(void)
 {
-    ds18b20_reset();
-    ds18b20_check();
-    ds18b20_write_byte(0xCC);  /* 跳过ROM */
-    ds18b20_write_byte(0x44);  /* 启动转换 */
+    rt_thread_t tid;
+
+    if (conv_sem != RT_NULL)
+        return RT_EOK;
+
+    conv_sem = rt_sem_create("ds_conv", 0, RT_IPC_FLAG_FIFO);
+    if (conv_sem == RT_NULL)
+        return -RT_ENOMEM;
+    rt_timer_init(&conv_timer, "ds_conv", ds18b20_conv_timeout, RT_NULL,
+                  rt_tick_from_millisecond(DS18B20_CONV_MS(DS18B20_RES_MAX)), RT_TIMER_FLAG_ONE_SHOT);
+
+    tid = rt_thread_create("ds_temp", ds18b20_conv_entry, RT_NULL, 1024, DS18B20_THREAD_PRIORITY, 10);
+    if (tid == RT_NULL)
+        return -RT_ENOMEM;
+    rt_thread_startup(tid);
+
+    return RT_EOK;
+}
+
+/**
+ * @brief 设置分辨率 (9~12位), 在下一次转换前生效
+ * 分辨率每降低一位, 转换时间减半, 读数刷新加快一倍.
+ */
+rt_err_t ds18b20_set_resolution(uint8_t bits)
+{
+    if (bits < DS18B20_RES_MIN || bits > DS18B20_RES_MAX)
+        return -RT_EINVAL;
+    resolution = bits;
+    res_pending = 1;
+    return RT_EOK;
 }
 
 /**
- * @brief 获取温度值
- * @return 温度值 (放大10倍，如365表示36.5度)
+ * @brief 获取当前分辨率
+ */
+uint8_t ds18b20_get_resolution(void)
+{
+    return resolution;
+}
+
+/**
+ * @brief 获取主探头温度值 (最近一次有效读数, 不访问总线)
+ * @return 温度值 (放大10倍，如365表示36.5度), 尚无读数时为0
  */
 int16_t ds18b20_get_temp(void)
 {
-    uint8_t temp_l, temp_h;
-    int16_t temp;
+    return readings[0].temp_x10;
+}
 
-    ds18b20_start();
-    ds18b20_reset();
-    ds18b20_check();
-    ds18b20_write_byte(0xCC);  /* 跳过ROM */
-    ds18b20_write_byte(0xBE);  /* 读暂存器 */
+/**
+ * @brief 获取主探头最近一次有效读数及其序号与时刻
+ */
+void ds18b20_get_reading(ds18b20_reading_t *reading)
+{
+    ds18b20_get_device_reading(0, reading);
+}
 
-    temp_l = ds18b20_read_byte();
-    temp_h = ds18b20_read_byte();
+/**
+ * @brief 获取第idx个器件最近一次有效读数
+ */
+rt_err_t ds18b20_get_device_reading(uint8_t idx, ds18b20_reading_t *reading)
+{
+    if (idx >= DS18B20_MAX_DEVICES)
+        return -RT_EINVAL;
+    rt_enter_critical();
+    *reading = readings[idx];
+    rt_exit_critical();
+    return idx < dev_count ? RT_EOK : -RT_EEMPTY;
+}
 
-    temp = (int16_t)((temp_h << 8) | temp_l);
+/**
+ * @brief 获取枚举到的器件数
+ */
+uint8_t ds18b20_device_count(void)
+{
+    return dev_count;
+}
 
-    /* 转换为温度值 (放大10倍) */
-    if (temp < 0)
-        temp = -((~temp + 1) * 0.625f);
-    else
-        temp = temp * 0.625f;
+/**
+ * @brief 获取第idx个器件的ROM码
+ */
+rt_err_t ds18b20_get_rom(uint8_t idx, uint8_t rom[8])
+{
+    if (idx >= dev_count)
+        return -RT_EINVAL;
+    rt_memcpy(rom, dev_rom[idx], 8);
+    return RT_EOK;
+}
 
-    return temp;
+/**
+ * @brief 获取异步转换统计
+ */
+void ds18b20_get_stat(ds18b20_stat_t *stat)
+{
+    *stat = conv_stat;
+}
+
+/**
+ * @brief 查看读数与统计, 设置分辨率或重新枚举: ds18b20 [res <9-12> | scan]
+ */
+static int ds18b20(int argc, char **argv)
+{
+    const uint8_t *r;
+    uint8_t i;
+
+    if (argc == 3 && rt_strcmp(argv[1], "res") == 0)
+    {
+        if (ds18b20_set_resolution((uint8_t)atoi(argv[2])) != RT_EOK)
+        {
+            rt_kprintf("resolution must be %d~%d bits\n", DS18B20_RES_MIN, DS18B20_RES_MAX);
+            return -RT_EINVAL;
+        }
+        return 0;
+    }
+    if (argc == 2 && rt_strcmp(argv[1], "scan") == 0)
+    {
+        scan_pending = 1;
+        return 0;
+    }
+
+    rt_kprintf("%d device(s), %d bit, %d ms/conversion, last cycle %u us\n",
+               dev_count, resolution, DS18B20_CONV_MS(resolution), conv_stat.cycle_us);
+    for (i = 0; i < dev_count; i++)
+    {
+        r = dev_rom[i];
+        rt_kprintf("  %d %02X%02X%02X%02X%02X%02X%02X%02X %d.%d C (#%u)\n", i,
+                   r[0], r[1], r[2], r[3], r[4], r[5], r[6], r[7],
+                   readings[i].temp_x10 / 10, readings[i].temp_x10 % 10, readings[i].seq);
+    }
+    rt_kprintf("conversions %u, reads %u, crc errors %u, no presence %u, scans %u\n",
+               conv_stat.conversions, conv_stat.reads, conv_stat.crc_errors, conv_stat.no_presence,
+               conv_stat.scans);
+    return 0;
 }
+MSH_CMD_EXPORT(ds18b20, show ds18b20 readings or: ds18b20 [res 9-12 | scan]);
 
 /**
  * @brief 初始化DS18B20
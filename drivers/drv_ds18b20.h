@@ -1,6 +1,6 @@
 /*
  * DS18B20温度传感器驱动
- * 单总线协议
+ * 单总线协议, 同一引脚可挂多个器件 (Search ROM枚举, Match ROM寻址)
  */
 #ifndef __DRV_DS18B20_H__
 #define __DRV_DS18B20_H__
@@ -15,11 +15,58 @@ extern "C" {
 /* GPIO引脚定义 */
 #define DS18B20_PIN     GET_PIN(A, 11)
 
+/* 命令 */
+#define DS18B20_CMD_SEARCH_ROM      0xF0
+#define DS18B20_CMD_MATCH_ROM       0x55
+#define DS18B20_CMD_SKIP_ROM        0xCC
+#define DS18B20_CMD_CONVERT_T       0x44
+#define DS18B20_CMD_READ_SCRATCH    0xBE
+#define DS18B20_CMD_WRITE_SCRATCH   0x4E
+
+/* 同一引脚上最多挂接的器件数 (如皮肤探头与环境探头) */
+#define DS18B20_MAX_DEVICES         4
+
+/* 分辨率与转换时间: 9位93.75ms, 每增加一位翻倍 */
+#define DS18B20_RES_MIN             9
+#define DS18B20_RES_MAX             12
+#define DS18B20_RES_DEFAULT         12
+#define DS18B20_CONV_MS(bits)       ((750 >> (12 - (bits))) + 2)   /* 含余量 */
+
+/* 最近一次有效读数 */
+typedef struct {
+    int16_t   raw;          /* 1/16°C */
+    int16_t   temp_x10;     /* 放大10倍 */
+    uint32_t  seq;          /* 有效读数序号, 0表示尚无读数 */
+    rt_tick_t tick;         /* 读出时刻 */
+} ds18b20_reading_t;
+
+/* 异步转换统计 */
+typedef struct {
+    uint32_t conversions;   /* 启动的转换次数 */
+    uint32_t reads;         /* CRC正确的读数 */
+    uint32_t crc_errors;
+    uint32_t no_presence;   /* 复位后无应答 */
+    uint32_t scans;         /* ROM枚举次数 */
+    uint32_t cycle_us;      /* 最近一轮 广播转换+逐个读出 的耗时 */
+    uint8_t  devices;       /* 枚举到的器件数 */
+} ds18b20_stat_t;
+
 /* 函数声明 */
 int ds18b20_init(void);
 int16_t ds18b20_get_temp(void);
+void ds18b20_get_reading(ds18b20_reading_t *reading);
+rt_err_t ds18b20_get_device_reading(uint8_t idx, ds18b20_reading_t *reading);
+uint8_t ds18b20_device_count(void);
+rt_err_t ds18b20_get_rom(uint8_t idx, uint8_t rom[8]);
+int ds18b20_search(uint8_t roms[][8], uint8_t max);
+void ds18b20_get_stat(ds18b20_stat_t *stat);
+int ds18b20_async_start(void);
+rt_err_t ds18b20_set_resolution(uint8_t bits);
+uint8_t ds18b20_get_resolution(void);
+uint8_t ds18b20_crc8(const uint8_t *data, uint8_t len);
 void ds18b20_start(void);
 void ds18b20_write_byte(uint8_t dat);
+void ds18b20_write_bit(uint8_t bit);
 uint8_t ds18b20_read_byte(void);
 uint8_t ds18b20_read_bit(void);
 uint8_t ds18b20_check(void);
@@ -4,55 +4,31 @@
  */
 #include "drv_max30102.h"
 #include "algorithm.h"
+#include "i2c_bus.h"
+#include "board.h"
 
-/* I2C设备句柄 */
-static struct rt_i2c_bus_device *i2c_bus = RT_NULL;
+/* I2C1上的客户端, 与OLED共用总线; FIFO读取优先于屏幕刷新 */
+static i2c_client_t max_i2c;
 
-/* 数据缓冲区 */
-static uint32_t aun_ir_buffer[150];
-static uint32_t aun_red_buffer[150];
-static int32_t n_ir_buffer_length = 150;
+#define MAX30102_RING_MASK      (MAX30102_RING_SIZE - 1)
 
-/* 心率血氧计算结果 */
-static int32_t n_spo2;
-static int8_t ch_spo2_valid;
-static int32_t n_heart_rate;
-static int8_t ch_hr_valid;
+/* 本机传感器的处理状态 */
+static max30102_ppg_t ppg;
 
-/* 滤波缓冲区 */
-static int32_t hr_buf[16];
-static int32_t spo2_buf[16];
-static int32_t hr_avg = 0;
-static int32_t spo2_avg = 0;
-static int32_t hr_buff_filled = 0;
-static int32_t spo2_buff_filled = 0;
-
-/* 信号范围 */
-static uint32_t un_min, un_max, un_prev_data;
+/* FIFO溢出丢失的样本总数 */
+static uint32_t un_ovf_total = 0;
 
 /**
  * @brief 写寄存器
  */
 bool max30102_write_reg(uint8_t reg, uint8_t data)
 {
-    struct rt_i2c_msg msgs;
     uint8_t buf[2];
 
-    if (i2c_bus == RT_NULL)
-        return false;
-
     buf[0] = reg;
     buf[1] = data;
 
-    msgs.addr  = MAX30102_I2C_ADDR;
-    msgs.flags = RT_I2C_WR;
-    msgs.buf   = buf;
-    msgs.len   = 2;
-
-    if (rt_i2c_transfer(i2c_bus, &msgs, 1) == 1)
-        return true;
-    else
-        return false;
+    return i2c_client_write(&max_i2c, buf, 2) == RT_EOK;
 }
 
 /**
@@ -60,25 +36,10 @@ bool max30102_write_reg(uint8_t reg, uint8_t data)
  */
 bool max30102_read_reg(uint8_t reg, uint8_t *data)
 {
-    struct rt_i2c_msg msgs[2];
-
-    if (i2c_bus == RT_NULL || data == RT_NULL)
+    if (data == RT_NULL)
         return false;
 
-    msgs[0].addr  = MAX30102_I2C_ADDR;
-    msgs[0].flags = RT_I2C_WR;
-    msgs[0].buf   = &reg;
-    msgs[0].len   = 1;
-
-    msgs[1].addr  = MAX30102_I2C_ADDR;
-    msgs[1].flags = RT_I2C_RD;
-    msgs[1].buf   = data;
-    msgs[1].len   = 1;
-
-    if (rt_i2c_transfer(i2c_bus, msgs, 2) == 2)
-        return true;
-    else
-        return false;
+    return i2c_client_read_regs(&max_i2c, reg, data, 1) == RT_EOK;
 }
 
 /**
@@ -86,33 +47,26 @@ bool max30102_read_reg(uint8_t reg, uint8_t *data)
  */
 bool max30102_read_fifo(uint32_t *red_led, uint32_t *ir_led)
 {
-    struct rt_i2c_msg msgs[2];
-    uint8_t reg = REG_FIFO_DATA;
     uint8_t buf[6];
     uint8_t temp;
+    rt_err_t ret;
 
-    if (i2c_bus == RT_NULL || red_led == RT_NULL || ir_led == RT_NULL)
+    if (red_led == RT_NULL || ir_led == RT_NULL)
         return false;
 
     *red_led = 0;
     *ir_led = 0;
 
+    i2c_client_lock(&max_i2c);
+
     /* 清除中断状态 */
     max30102_read_reg(REG_INTR_STATUS_1, &temp);
     max30102_read_reg(REG_INTR_STATUS_2, &temp);
 
     /* 读取FIFO数据 (6字节) */
-    msgs[0].addr  = MAX30102_I2C_ADDR;
-    msgs[0].flags = RT_I2C_WR;
-    msgs[0].buf   = &reg;
-    msgs[0].len   = 1;
-
-    msgs[1].addr  = MAX30102_I2C_ADDR;
-    msgs[1].flags = RT_I2C_RD;
-    msgs[1].buf   = buf;
-    msgs[1].len   = 6;
-
-    if (rt_i2c_transfer(i2c_bus, msgs, 2) != 2)
+    ret = i2c_client_read_regs(&max_i2c, REG_FIFO_DATA, buf, 6);
+    i2c_client_unlock(&max_i2c);
+    if (ret != RT_EOK)
         return false;
 
     /* 解析RED数据 (前3字节) */
@@ -126,6 +80,148 @@ bool max30102_read_fifo(uint32_t *red_led, uint32_t *ir_led)
     return true;
 }
 
+/**
+ * @brief 一次读出FIFO中全部待读样本
+ * @param red_led: 红光样本输出, 至少max_samples个
+ * @param ir_led: 红外样本输出, 至少max_samples个
+ * @param max_samples: 最多读取的样本数 (1~32), 其余留在FIFO中
+ * @param ovf: 输出本次读取前丢失的样本数 (OVF_COUNTER, 饱和于31), 可为RT_NULL
+ * @return 读出的样本数, 失败返回-1
+ * @note FIFO满且尚未溢出时读写指针相等, 按空处理, 下一个样本到来后即可读出
+ */
+int32_t max30102_read_fifo_burst(uint32_t *red_led, uint32_t *ir_led, int32_t max_samples, uint8_t *ovf)
+{
+    uint8_t ptr[3];
+    uint8_t buf[MAX30102_FIFO_DEPTH * MAX30102_SAMPLE_BYTES];
+    int32_t n, i;
+    const uint8_t *p;
+
+    if (red_led == RT_NULL || ir_led == RT_NULL)
+        return -1;
+
+    /*
+     * 指针与数据在一次总线持有内读出, 两次传输之间屏幕刷新不能插入.
+     * WR_PTR, OVF_COUNTER, RD_PTR 地址连续, 一次读出
+     */
+    i2c_client_lock(&max_i2c);
+    if (i2c_client_read_regs(&max_i2c, REG_FIFO_WR_PTR, ptr, 3) != RT_EOK)
+    {
+        i2c_client_unlock(&max_i2c);
+        return -1;
+    }
+
+    n = (ptr[0] - ptr[2]) & (MAX30102_FIFO_DEPTH - 1);
+    if (n == 0 && ptr[1] != 0)
+        n = MAX30102_FIFO_DEPTH;
+    if (ovf != RT_NULL)
+        *ovf = ptr[1];
+    un_ovf_total += ptr[1];
+
+    if (n > max_samples)
+        n = max_samples;
+    if (n <= 0)
+    {
+        i2c_client_unlock(&max_i2c);
+        return 0;
+    }
+
+    /* 读FIFO_DATA时寄存器地址不递增, 连续读出n个样本 */
+    if (i2c_client_read_regs(&max_i2c, REG_FIFO_DATA, buf, (uint16_t)(n * MAX30102_SAMPLE_BYTES)) != RT_EOK)
+    {
+        i2c_client_unlock(&max_i2c);
+        return -1;
+    }
+    i2c_client_unlock(&max_i2c);
+
+    for (i = 0, p = buf; i < n; i++, p += MAX30102_SAMPLE_BYTES)
+    {
+        red_led[i] = (((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2]) & 0x03FFFF;
+        ir_led[i] = (((uint32_t)p[3] << 16) | ((uint32_t)p[4] << 8) | p[5]) & 0x03FFFF;
+    }
+
+    return n;
+}
+
+/**
+ * @brief 初始化一路处理状态, 前端使用0.5~4Hz带通
+ */
+void max30102_ppg_init(max30102_ppg_t *pp)
+{
+    maxim_bpf_t bpf;
+
+    rt_memset(pp, 0, sizeof(*pp));
+    maxim_ctx_init(&pp->ctx);
+
+    /* 带通代替4点平滑, 抑制基线漂移和运动噪声 */
+    maxim_bpf_design(&bpf, FS, MAXIM_BPF_LO_HZ, MAXIM_BPF_HI_HZ);
+    maxim_ctx_set_bpf(&pp->ctx, &bpf);
+}
+
+/**
+ * @brief 样本存入环形缓冲区
+ */
+void max30102_ppg_append(max30102_ppg_t *pp, const uint32_t *red, const uint32_t *ir, int32_t n)
+{
+    int32_t i;
+
+    for (i = 0; i < n; i++)
+    {
+        uint32_t un_pos = pp->un_ring_count & MAX30102_RING_MASK;
+
+        pp->aun_red_ring[un_pos] = red[i];
+        pp->aun_ir_ring[un_pos] = ir[i];
+        pp->un_ring_count++;
+    }
+}
+
+/**
+ * @brief 样本不连续时清空窗口: 重新填满BUFFER_SIZE个样本前不计算,
+ *        结果按无效处理, 滑动平均由超时逻辑自然清除
+ */
+void max30102_ppg_restart(max30102_ppg_t *pp)
+{
+    pp->un_ring_count = 0;
+    pp->ch_hr_valid = 0;
+    pp->ch_spo2_valid = 0;
+}
+
+/**
+ * @brief 从FIFO读取un_num个新样本存入环形缓冲区, FIFO中不足时等待
+ */
+static void max30102_store_samples(uint32_t un_num)
+{
+    uint32_t aun_red[MAX30102_FIFO_DEPTH], aun_ir[MAX30102_FIFO_DEPTH];
+    int32_t n;
+
+    while (un_num > 0)
+    {
+        n = max30102_read_fifo_burst(aun_red, aun_ir, min(un_num, MAX30102_FIFO_DEPTH), RT_NULL);
+        if (n < 0)
+            return;
+        if (n == 0)
+        {
+            /* 等待剩余样本产生, 最多等半个FIFO */
+            rt_thread_mdelay(1000 / FS * min(un_num, MAX30102_FIFO_DEPTH / 2));
+            continue;
+        }
+
+        max30102_ppg_append(&ppg, aun_red, aun_ir, n);
+        un_num -= n;
+    }
+}
+
+/**
+ * @brief 对最近BUFFER_SIZE个样本计算心率和血氧
+ */
+static void max30102_ppg_calc(max30102_ppg_t *pp)
+{
+    maxim_view_t v_ir = { pp->aun_ir_ring, MAX30102_RING_MASK, pp->un_ring_count - BUFFER_SIZE };
+    maxim_view_t v_red = { pp->aun_red_ring, MAX30102_RING_MASK, pp->un_ring_count - BUFFER_SIZE };
+
+    maxim_ctx_calc(&pp->ctx, &v_ir, &v_red, BUFFER_SIZE,
+                   &pp->n_spo2, &pp->ch_spo2_valid, &pp->n_heart_rate, &pp->ch_hr_valid);
+}
+
 /**
  * @brief 复位传感器
  */
@@ -139,19 +235,17 @@ bool max30102_reset(void)
  */
 int max30102_init(void)
 {
-    int32_t i;
     uint8_t temp;
 
-    /* 查找I2C总线 */
-    i2c_bus = (struct rt_i2c_bus_device *)rt_device_find(MAX30102_I2C_BUS_NAME);
-    if (i2c_bus == RT_NULL)
+    /* 登记到I2C总线 */
+    if (i2c_client_open(&max_i2c, MAX30102_I2C_BUS_NAME, "max30102", MAX30102_I2C_ADDR, I2C_PRIO_SENSOR) != RT_EOK)
     {
         rt_kprintf("MAX30102: Can't find %s device!\n", MAX30102_I2C_BUS_NAME);
         return -RT_ERROR;
     }
 
-    un_min = 0x3FFFF;
-    un_max = 0;
+    un_ovf_total = 0;
+    max30102_ppg_init(&ppg);
 
     /* 复位传感器 */
     max30102_reset();
@@ -161,7 +255,7 @@ int max30102_init(void)
     max30102_read_reg(REG_INTR_STATUS_1, &temp);
 
     /* 配置寄存器 */
-    if (!max30102_write_reg(REG_INTR_ENABLE_1, 0xC0)) return -RT_ERROR;
+    if (!max30102_write_reg(REG_INTR_ENABLE_1, 0x80)) return -RT_ERROR;  /* A_FULL */
     if (!max30102_write_reg(REG_INTR_ENABLE_2, 0x00)) return -RT_ERROR;
     if (!max30102_write_reg(REG_FIFO_WR_PTR, 0x00)) return -RT_ERROR;
     if (!max30102_write_reg(REG_OVF_COUNTER, 0x00)) return -RT_ERROR;
@@ -173,176 +267,146 @@ int max30102_init(void)
     if (!max30102_write_reg(REG_LED2_PA, 0x17)) return -RT_ERROR;      /* ~4.5mA for LED2 */
     if (!max30102_write_reg(REG_PILOT_PA, 0x7F)) return -RT_ERROR;     /* ~25mA for Pilot LED */
 
-    /* 读取初始样本 */
-    for (i = 0; i < n_ir_buffer_length; i++)
-    {
-        max30102_read_fifo(&aun_red_buffer[i], &aun_ir_buffer[i]);
-        if (un_min > aun_red_buffer[i])
-            un_min = aun_red_buffer[i];
-        if (un_max < aun_red_buffer[i])
-            un_max = aun_red_buffer[i];
-    }
-    un_prev_data = aun_red_buffer[i - 1];
-
-    /* 初始计算 */
-    maxim_heart_rate_and_oxygen_saturation(aun_ir_buffer, n_ir_buffer_length, aun_red_buffer,
-                                           &n_spo2, &ch_spo2_valid, &n_heart_rate, &ch_hr_valid);
-
     rt_kprintf("MAX30102: Initialized successfully\n");
     return RT_EOK;
 }
 
 /**
- * @brief 读取心率血氧数据
+ * @brief 读取心率血氧数据 (轮询方式, 不可与采集线程同时使用)
  */
 void max30102_read_data(max30102_data_t *data)
+{
+    /* 读取新的50个样本, 窗口随写入位置前移 */
+    max30102_store_samples(FS);
+    max30102_ppg_process(&ppg, data);
+}
+
+/**
+ * @brief 对窗口计算心率血氧并做滑动平均
+ */
+void max30102_ppg_process(max30102_ppg_t *pp, max30102_data_t *data)
 {
     int32_t i;
-    static uint8_t count = 0;
     int32_t hr_sum, spo2_sum;
-    int32_t hr_valid_cnt = 0;
-    int32_t spo2_valid_cnt = 0;
-    static int32_t hr_timeout = 0;
-    static int32_t spo2_timeout = 0;
-
-    /* 移动缓冲区数据 */
-    un_min = 0x3FFFF;
-    un_max = 0;
-    for (i = 50; i < 150; i++)
-    {
-        aun_red_buffer[i - 50] = aun_red_buffer[i];
-        aun_ir_buffer[i - 50] = aun_ir_buffer[i];
-        if (un_min > aun_red_buffer[i])
-            un_min = aun_red_buffer[i];
-        if (un_max < aun_red_buffer[i])
-            un_max = aun_red_buffer[i];
-    }
-
-    /* 读取新的50个样本 */
-    for (i = 100; i < 150; i++)
-    {
-        un_prev_data = aun_red_buffer[i - 1];
-        max30102_read_fifo(&aun_red_buffer[i], &aun_ir_buffer[i]);
-    }
 
-    /* 计算心率和血氧 */
-    maxim_heart_rate_and_oxygen_saturation(aun_ir_buffer, n_ir_buffer_length, aun_red_buffer,
-                                           &n_spo2, &ch_spo2_valid, &n_heart_rate, &ch_hr_valid);
+    /* 窗口填满后计算心率和血氧 */
+    if (pp->un_ring_count >= BUFFER_SIZE)
+        max30102_ppg_calc(pp);
 
     /* 滤波处理 (每8次更新一次) */
-    if (++count > 8)
+    if (++pp->count > 8)
     {
-        count = 0;
+        pp->count = 0;
 
         /* 心率滤波 */
-        if ((ch_hr_valid == 1) && (n_heart_rate < 150) && (n_heart_rate > 60))
+        if ((pp->ch_hr_valid == 1) && (pp->n_heart_rate < 150) && (pp->n_heart_rate > 60))
         {
-            hr_timeout = 0;
+            pp->hr_timeout = 0;
 
             /* 移位新样本到缓冲区 */
             for (i = 0; i < 15; i++)
-                hr_buf[i] = hr_buf[i + 1];
-            hr_buf[15] = n_heart_rate;
+                pp->hr_buf[i] = pp->hr_buf[i + 1];
+            pp->hr_buf[15] = pp->n_heart_rate;
 
-            if (hr_buff_filled < 16)
-                hr_buff_filled++;
+            if (pp->hr_buff_filled < 16)
+                pp->hr_buff_filled++;
 
             /* 滑动平均 */
             hr_sum = 0;
-            if (hr_buff_filled < 2)
+            if (pp->hr_buff_filled < 2)
             {
-                hr_avg = 0;
+                pp->hr_avg = 0;
             }
-            else if (hr_buff_filled < 4)
+            else if (pp->hr_buff_filled < 4)
             {
                 for (i = 14; i < 16; i++)
-                    hr_sum += hr_buf[i];
-                hr_avg = hr_sum >> 1;
+                    hr_sum += pp->hr_buf[i];
+                pp->hr_avg = hr_sum >> 1;
             }
-            else if (hr_buff_filled < 8)
+            else if (pp->hr_buff_filled < 8)
             {
                 for (i = 12; i < 16; i++)
-                    hr_sum += hr_buf[i];
-                hr_avg = hr_sum >> 2;
+                    hr_sum += pp->hr_buf[i];
+                pp->hr_avg = hr_sum >> 2;
             }
-            else if (hr_buff_filled < 16)
+            else if (pp->hr_buff_filled < 16)
             {
                 for (i = 8; i < 16; i++)
-                    hr_sum += hr_buf[i];
-                hr_avg = hr_sum >> 3;
+                    hr_sum += pp->hr_buf[i];
+                pp->hr_avg = hr_sum >> 3;
             }
             else
             {
                 for (i = 0; i < 16; i++)
-                    hr_sum += hr_buf[i];
-                hr_avg = hr_sum >> 4;
+                    hr_sum += pp->hr_buf[i];
+                pp->hr_avg = hr_sum >> 4;
             }
         }
         else
         {
-            if (hr_timeout >= 2)
+            if (pp->hr_timeout >= 2)
             {
-                hr_avg = 0;
-                hr_buff_filled = 0;
+                pp->hr_avg = 0;
+                pp->hr_buff_filled = 0;
             }
             else
             {
-                hr_timeout++;
+                pp->hr_timeout++;
             }
         }
 
         /* 血氧滤波 */
-        if ((ch_spo2_valid == 1) && (n_spo2 > 80))
+        if ((pp->ch_spo2_valid == 1) && (pp->n_spo2 > 80))
         {
-            spo2_timeout = 0;
+            pp->spo2_timeout = 0;
 
             for (i = 0; i < 15; i++)
-                spo2_buf[i] = spo2_buf[i + 1];
-            spo2_buf[15] = n_spo2;
+                pp->spo2_buf[i] = pp->spo2_buf[i + 1];
+            pp->spo2_buf[15] = pp->n_spo2;
 
-            if (spo2_buff_filled < 16)
-                spo2_buff_filled++;
+            if (pp->spo2_buff_filled < 16)
+                pp->spo2_buff_filled++;
 
             spo2_sum = 0;
-            if (spo2_buff_filled < 2)
+            if (pp->spo2_buff_filled < 2)
             {
-                spo2_avg = 0;
+                pp->spo2_avg = 0;
             }
-            else if (spo2_buff_filled < 4)
+            else if (pp->spo2_buff_filled < 4)
             {
                 for (i = 14; i < 16; i++)
-                    spo2_sum += spo2_buf[i];
-                spo2_avg = spo2_sum >> 1;
+                    spo2_sum += pp->spo2_buf[i];
+                pp->spo2_avg = spo2_sum >> 1;
             }
-            else if (spo2_buff_filled < 8)
+            else if (pp->spo2_buff_filled < 8)
             {
                 for (i = 12; i < 16; i++)
-                    spo2_sum += spo2_buf[i];
-                spo2_avg = spo2_sum >> 2;
+                    spo2_sum += pp->spo2_buf[i];
+                pp->spo2_avg = spo2_sum >> 2;
             }
-            else if (spo2_buff_filled < 16)
+            else if (pp->spo2_buff_filled < 16)
             {
                 for (i = 8; i < 16; i++)
-                    spo2_sum += spo2_buf[i];
-                spo2_avg = spo2_sum >> 3;
+                    spo2_sum += pp->spo2_buf[i];
+                pp->spo2_avg = spo2_sum >> 3;
             }
             else
             {
                 for (i = 0; i < 16; i++)
-                    spo2_sum += spo2_buf[i];
-                spo2_avg = spo2_sum >> 4;
+                    spo2_sum += pp->spo2_buf[i];
+                pp->spo2_avg = spo2_sum >> 4;
             }
         }
         else
         {
-            if (spo2_timeout >= 2)
+            if (pp->spo2_timeout >= 2)
             {
-                spo2_avg = 0;
-                spo2_buff_filled = 0;
+                pp->spo2_avg = 0;
+                pp->spo2_buff_filled = 0;
             }
             else
             {
-                spo2_timeout++;
+                pp->spo2_timeout++;
             }
         }
     }
@@ -350,19 +414,158 @@ void max30102_read_data(max30102_data_t *data)
     /* 返回结果 */
     if (data != RT_NULL)
     {
-        data->heart_rate = hr_avg;
-        data->spo2 = spo2_avg;
-        data->hr_valid = (hr_avg > 0) ? 1 : 0;
-        data->spo2_valid = (spo2_avg > 0) ? 1 : 0;
+        data->heart_rate = pp->hr_avg;
+        data->spo2 = pp->spo2_avg;
+        data->hr_valid = (pp->hr_avg > 0) ? 1 : 0;
+        data->spo2_valid = (pp->spo2_avg > 0) ? 1 : 0;
     }
 }
 
+/* 采集线程 -> 处理线程 的样本块 */
+struct max30102_block
+{
+    uint32_t seq;                           /* 块内首个样本序号, 含溢出丢失的样本 */
+    uint8_t  num;
+    uint8_t  ovf;                           /* 本块之前FIFO溢出丢失的样本数 */
+    uint32_t red[MAX30102_FIFO_DEPTH];
+    uint32_t ir[MAX30102_FIFO_DEPTH];
+};
+
+#define MAX30102_ACQ_PRIORITY   8           /* 高于主循环, 不受界面刷新影响 */
+#define MAX30102_DSP_PRIORITY   15
+#define MAX30102_QUEUE_BLOCKS   4
+#define MAX30102_ACQ_TIMEOUT_MS 500         /* 未等到中断时也读取一次, 防止丢失边沿 */
+
+static rt_sem_t acq_sem = RT_NULL;
+static rt_mq_t acq_mq = RT_NULL;
+static max30102_acq_stat_t acq_stat;
+
+/**
+ * @brief INT引脚中断: 唤醒采集线程
+ */
+static void max30102_int_isr(void *args)
+{
+    acq_stat.irq_count++;
+    rt_sem_release(acq_sem);
+}
+
+/**
+ * @brief 采集线程: 每次中断一次性读空FIFO, 整块送给处理线程
+ */
+static void max30102_acq_entry(void *parameter)
+{
+    struct max30102_block blk;
+    uint32_t seq = 0;
+    int32_t n;
+
+    while (1)
+    {
+        rt_sem_take(acq_sem, rt_tick_from_millisecond(MAX30102_ACQ_TIMEOUT_MS));
+
+        n = max30102_read_fifo_burst(blk.red, blk.ir, MAX30102_FIFO_DEPTH, &blk.ovf);
+        if (n <= 0)
+            continue;
+
+        seq += blk.ovf;
+        blk.seq = seq;
+        blk.num = (uint8_t)n;
+        seq += n;
+
+        acq_stat.samples += n;
+        acq_stat.overflow += blk.ovf;
+        if (rt_mq_send(acq_mq, &blk, sizeof(blk)) == RT_EOK)
+            acq_stat.blocks++;
+        else
+            acq_stat.dropped += n;
+    }
+}
+
+/**
+ * @brief 处理线程: 样本入窗口, 每FS个新样本计算一次心率血氧
+ */
+static void max30102_dsp_entry(void *parameter)
+{
+    struct max30102_block blk;
+    uint32_t expect = 0;
+    int32_t pending = 0;
+
+    while (1)
+    {
+        if (rt_mq_recv(acq_mq, &blk, sizeof(blk), RT_WAITING_FOREVER) != RT_EOK)
+            continue;
+
+        /* FIFO溢出或队列满丢了样本: 拼接的窗口峰间距变短, 心率偏高, 重新开始 */
+        if (blk.seq != expect)
+        {
+            acq_stat.gaps++;
+            max30102_ppg_restart(&ppg);
+            pending = 0;
+        }
+        expect = blk.seq + blk.num;
+
+        max30102_ppg_append(&ppg, blk.red, blk.ir, blk.num);
+        pending += blk.num;
+        while (pending >= FS)
+        {
+            pending -= FS;
+            max30102_ppg_process(&ppg, RT_NULL);
+        }
+    }
+}
+
+/**
+ * @brief 启动中断驱动的采集线程和处理线程
+ * @note 启动后不要再调用 max30102_read_data
+ */
+int max30102_acq_start(void)
+{
+    rt_thread_t tid;
+
+    if (acq_mq != RT_NULL)
+        return RT_EOK;
+
+    acq_sem = rt_sem_create("ppg_int", 0, RT_IPC_FLAG_FIFO);
+    acq_mq = rt_mq_create("ppg_blk", sizeof(struct max30102_block), MAX30102_QUEUE_BLOCKS, RT_IPC_FLAG_FIFO);
+    if (acq_sem == RT_NULL || acq_mq == RT_NULL)
+        return -RT_ENOMEM;
+
+    rt_pin_mode(BSP_MAX30102_INT_PIN, PIN_MODE_INPUT_PULLUP);
+    rt_pin_attach_irq(BSP_MAX30102_INT_PIN, PIN_IRQ_MODE_FALLING, max30102_int_isr, RT_NULL);
+    rt_pin_irq_enable(BSP_MAX30102_INT_PIN, PIN_IRQ_ENABLE);
+
+    tid = rt_thread_create("ppg_dsp", max30102_dsp_entry, RT_NULL, 2048, MAX30102_DSP_PRIORITY, 10);
+    if (tid != RT_NULL)
+        rt_thread_startup(tid);
+
+    tid = rt_thread_create("ppg_acq", max30102_acq_entry, RT_NULL, 1024, MAX30102_ACQ_PRIORITY, 10);
+    if (tid != RT_NULL)
+        rt_thread_startup(tid);
+
+    return RT_EOK;
+}
+
+/**
+ * @brief 获取采集线程统计
+ */
+void max30102_get_acq_stat(max30102_acq_stat_t *stat)
+{
+    *stat = acq_stat;
+}
+
+/**
+ * @brief 获取FIFO溢出丢失的样本总数
+ */
+uint32_t max30102_get_overflow_count(void)
+{
+    return un_ovf_total;
+}
+
 /**
  * @brief 获取心率值
  */
 int32_t max30102_get_heart_rate(void)
 {
-    return hr_avg;
+    return ppg.hr_avg;
 }
 
 /**
@@ -370,7 +573,7 @@ int32_t max30102_get_heart_rate(void)
  */
 int32_t max30102_get_spo2(void)
 {
-    return spo2_avg;
+    return ppg.spo2_avg;
 }
 
 /* 注册初始化函数 */
@@ -8,6 +8,7 @@
 #include <rtthread.h>
 #include <rtdevice.h>
 #include <stdbool.h>
+#include "algorithm.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -41,6 +42,10 @@ extern "C" {
 #define REG_REV_ID              0xFE
 #define REG_PART_ID             0xFF
 
+/* FIFO */
+#define MAX30102_FIFO_DEPTH     32      /* FIFO深度 (样本) */
+#define MAX30102_SAMPLE_BYTES   6       /* SpO2模式每样本字节数 (红光+红外) */
+
 /* 心率血氧数据结构 */
 typedef struct {
     int32_t heart_rate;     /* 心率值 */
@@ -49,15 +54,64 @@ typedef struct {
     uint8_t spo2_valid;     /* 血氧有效标志 */
 } max30102_data_t;
 
+/* 样本环形缓冲区长度, 2的幂 */
+#define MAX30102_RING_SIZE      256
+
+/*
+ * 一路PPG信号的处理状态: 样本环形缓冲区、算法上下文和结果滤波.
+ * 各实例互不影响, 可用于第二个传感器或主机上的多路回放.
+ */
+typedef struct {
+    uint32_t aun_ir_ring[MAX30102_RING_SIZE];
+    uint32_t aun_red_ring[MAX30102_RING_SIZE];
+    uint32_t un_ring_count;         /* 已写入样本数, 即下一个样本序号 */
+    maxim_ctx_t ctx;
+
+    /* 心率血氧计算结果 */
+    int32_t n_spo2;
+    int8_t  ch_spo2_valid;
+    int32_t n_heart_rate;
+    int8_t  ch_hr_valid;
+
+    /* 滤波缓冲区 */
+    int32_t hr_buf[16];
+    int32_t spo2_buf[16];
+    int32_t hr_avg;
+    int32_t spo2_avg;
+    int32_t hr_buff_filled;
+    int32_t spo2_buff_filled;
+    int32_t hr_timeout;
+    int32_t spo2_timeout;
+    uint8_t count;
+} max30102_ppg_t;
+
+/* 采集线程统计 */
+typedef struct {
+    uint32_t irq_count;     /* A_FULL中断次数 */
+    uint32_t blocks;        /* 送入队列的样本块数 */
+    uint32_t samples;       /* 从FIFO读出的样本数 */
+    uint32_t overflow;      /* FIFO溢出丢失的样本数 */
+    uint32_t dropped;       /* 队列满丢弃的样本数 */
+    uint32_t gaps;          /* 样本序号不连续, 窗口重新开始的次数 */
+} max30102_acq_stat_t;
+
 /* 函数声明 */
 int max30102_init(void);
 bool max30102_write_reg(uint8_t reg, uint8_t data);
 bool max30102_read_reg(uint8_t reg, uint8_t *data);
 bool max30102_read_fifo(uint32_t *red_led, uint32_t *ir_led);
+int32_t max30102_read_fifo_burst(uint32_t *red_led, uint32_t *ir_led, int32_t max_samples, uint8_t *ovf);
 bool max30102_reset(void);
 void max30102_read_data(max30102_data_t *data);
 int32_t max30102_get_heart_rate(void);
 int32_t max30102_get_spo2(void);
+uint32_t max30102_get_overflow_count(void);
+int max30102_acq_start(void);
+void max30102_ppg_init(max30102_ppg_t *pp);
+void max30102_ppg_append(max30102_ppg_t *pp, const uint32_t *red, const uint32_t *ir, int32_t n);
+void max30102_ppg_restart(max30102_ppg_t *pp);
+void max30102_ppg_process(max30102_ppg_t *pp, max30102_data_t *data);
+void max30102_get_acq_stat(max30102_acq_stat_t *stat);
 
 #ifdef __cplusplus
 }
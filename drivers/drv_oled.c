@@ -4,46 +4,315 @@
  */
 #include "drv_oled.h"
 #include "oled_font.h"
+#include "i2c_bus.h"
 
-/* I2C设备句柄 */
-static struct rt_i2c_bus_device *i2c_bus = RT_NULL;
+/*
+ * I2C1上的客户端, 与MAX30102共用总线. 每个列段或命令串单独一次传输,
+ * 传输之间让出总线, 等待中的传感器读取可以插入, 不必等整帧写完.
+ */
+static i2c_client_t oled_i2c;
+
+/*
+ * 后台缓冲: 绘图函数只写RAM, 提交或刷新时把变化的列段批量写入GDDRAM.
+ * 每页每列1位脏标记; 写入与原值相同的字节不置脏.
+ */
+static uint8_t  oled_fb[OLED_PAGES][OLED_WIDTH];
+static uint32_t oled_dirty[OLED_PAGES][OLED_WIDTH / 32];
+static uint8_t  fb_x, fb_y;
+static uint32_t fb_fill_gen;        /* 整屏填充次数 */
+
+/*
+ * 字形缓存: 字库以压缩格式存放, 解码后的字形按 (字库, 编码, 反显) 缓存,
+ * 反显字形缓存取反后的字节, 绘制时整块复制. 满时替换最久未用的一项.
+ * 只在绘图线程中使用.
+ */
+typedef struct {
+    const oled_font_t *font;
+    uint8_t  code;
+    uint8_t  inv;
+    uint32_t stamp;                 /* 最近使用的序号, 0为空 */
+    uint8_t  data[64];
+} oled_glyph_t;
+
+static oled_glyph_t glyph_cache[OLED_GLYPH_CACHE];
+static uint32_t glyph_clock;
+
+/*
+ * 显示服务: oled_commit() 把后台缓冲复制为待显示帧后立即返回,
+ * 服务线程按帧率上限取走最新的待显示帧写出. 写出期间到来的多次提交
+ * 只保留最后一次, 脏标记累积, 中间帧被丢弃.
+ * 锁只保护两次内存复制, 从不在持锁时访问总线.
+ */
+static uint8_t  oled_pending[OLED_PAGES][OLED_WIDTH];
+static uint32_t oled_pending_dirty[OLED_PAGES][OLED_WIDTH / 32];
+static uint8_t  oled_work[OLED_PAGES][OLED_WIDTH];
+static uint32_t oled_work_dirty[OLED_PAGES][OLED_WIDTH / 32];
+static uint8_t  oled_has_pending;
+static rt_mutex_t oled_lock = RT_NULL;
+static rt_sem_t oled_sem = RT_NULL;
+static oled_stat_t oled_stat;
 
 /**
- * @brief I2C写入一个字节
+ * @brief 一次传输写入 控制字节 + 多个字节
+ * @param ctrl 0x00连续命令, 0x40连续数据
  */
-static rt_err_t oled_write_byte(uint8_t reg, uint8_t data)
+static rt_err_t oled_write_stream(uint8_t ctrl, const uint8_t *data, uint16_t len)
 {
-    struct rt_i2c_msg msgs;
-    uint8_t buf[2];
+    uint8_t buf[OLED_WIDTH + 1];
+
+    buf[0] = ctrl;
+    rt_memcpy(&buf[1], data, len);
 
-    buf[0] = reg;
-    buf[1] = data;
+    return i2c_client_write(&oled_i2c, buf, len + 1);
+}
 
-    msgs.addr  = OLED_I2C_ADDR;
-    msgs.flags = RT_I2C_WR;
-    msgs.buf   = buf;
-    msgs.len   = 2;
+/**
+ * @brief 写数据到后台缓冲当前位置, 列地址按页地址模式自增回绕
+ */
+static void oled_write_data(uint8_t data)
+{
+    if (fb_y < OLED_PAGES && oled_fb[fb_y][fb_x] != data)
+    {
+        oled_fb[fb_y][fb_x] = data;
+        oled_dirty[fb_y][fb_x >> 5] |= 1UL << (fb_x & 31);
+    }
+    fb_x = (fb_x + 1) & (OLED_WIDTH - 1);
+}
 
-    if (rt_i2c_transfer(i2c_bus, &msgs, 1) == 1)
-        return RT_EOK;
-    else
+/**
+ * @brief 写出一页中 [x0, x1) 列
+ * 页与列地址命令和数据在同一传输中: 每个命令字节前为Co=1的控制字节0x80,
+ * 最后的控制字节0x40之后全部为数据.
+ */
+static rt_err_t oled_write_span(const uint8_t *row, uint8_t page, uint8_t x0, uint8_t x1)
+{
+    uint8_t buf[7 + OLED_WIDTH];
+
+    buf[0] = 0x80;
+    buf[1] = 0xB0 + page;
+    buf[2] = 0x80;
+    buf[3] = 0x10 | (x0 >> 4);
+    buf[4] = 0x80;
+    buf[5] = x0 & 0x0F;
+    buf[6] = 0x40;
+    rt_memcpy(&buf[7], &row[x0], x1 - x0);
+
+    return i2c_client_write(&oled_i2c, buf, 7 + x1 - x0);
+}
+
+static void oled_dirty_pages(uint32_t dirty[OLED_PAGES][OLED_WIDTH / 32], uint8_t page0, uint8_t page1)
+{
+    uint8_t page;
+
+    for (page = page0; page <= page1 && page < OLED_PAGES; page++)
+        rt_memset(dirty[page], 0xFF, sizeof(dirty[page]));
+}
+
+static int oled_col_dirty(const uint32_t *dirty, uint8_t x)
+{
+    return (dirty[x >> 5] >> (x & 31)) & 1;
+}
+
+/**
+ * @brief 把缓冲区中标记为脏的部分写入屏幕
+ * 每页内相距不超过 OLED_FLUSH_GAP 列的脏段合并为一次传输,
+ * 间隔中未变化的字节随之重发, 比多一次寻址便宜.
+ * @return 写出的数据字节数, 传输失败返回-RT_ERROR (未写出页的脏标记保留)
+ */
+static int oled_write_dirty(uint8_t fb[OLED_PAGES][OLED_WIDTH],
+                            uint32_t dirty[OLED_PAGES][OLED_WIDTH / 32])
+{
+    uint8_t page, x, x0, x1, gap;
+    int bytes = 0;
+
+    if (oled_i2c.bus == RT_NULL)
         return -RT_ERROR;
+
+    for (page = 0; page < OLED_PAGES; page++)
+    {
+        if ((dirty[page][0] | dirty[page][1] | dirty[page][2] | dirty[page][3]) == 0)
+            continue;
+
+        x = 0;
+        while (x < OLED_WIDTH)
+        {
+            if (!oled_col_dirty(dirty[page], x))
+            {
+                x++;
+                continue;
+            }
+            x0 = x;
+            x1 = x + 1;
+            gap = 0;
+            for (x++; x < OLED_WIDTH && gap <= OLED_FLUSH_GAP; x++)
+            {
+                if (oled_col_dirty(dirty[page], x))
+                {
+                    x1 = x + 1;
+                    gap = 0;
+                }
+                else
+                {
+                    gap++;
+                }
+            }
+            if (oled_write_span(fb[page], page, x0, x1) != RT_EOK)
+                return -RT_ERROR;
+            bytes += x1 - x0;
+            x = x1;
+        }
+        rt_memset(dirty[page], 0, sizeof(dirty[page]));
+    }
+    return bytes;
 }
 
 /**
- * @brief 写命令
+ * @brief 同步写出后台缓冲的变化, 调用者等待总线传输完成
+ * 显示服务启动后应使用 oled_commit().
+ * @return 写出的数据字节数, 传输失败返回-RT_ERROR
  */
-static void oled_write_cmd(uint8_t cmd)
+int oled_flush(void)
 {
-    oled_write_byte(0x00, cmd);
+    return oled_write_dirty(oled_fb, oled_dirty);
 }
 
 /**
- * @brief 写数据
+ * @brief 提交后台缓冲为待显示帧, 不等待总线
+ * 未启动显示服务时退化为 oled_flush().
  */
-static void oled_write_data(uint8_t data)
+void oled_commit(void)
 {
-    oled_write_byte(0x40, data);
+    uint8_t page, k, signal = 0;
+    uint32_t changed = 0;
+
+    if (oled_sem == RT_NULL)
+    {
+        oled_flush();
+        return;
+    }
+
+    rt_mutex_take(oled_lock, RT_WAITING_FOREVER);
+    oled_stat.commits++;
+
+    for (page = 0; page < OLED_PAGES; page++)
+    {
+        uint32_t any = 0;
+
+        for (k = 0; k < OLED_WIDTH / 32; k++)
+        {
+            oled_pending_dirty[page][k] |= oled_dirty[page][k];
+            any |= oled_dirty[page][k];
+            oled_dirty[page][k] = 0;
+        }
+        if (any)
+            rt_memcpy(oled_pending[page], oled_fb[page], OLED_WIDTH);
+        changed |= any;
+    }
+    /* 内容未变化不唤醒服务线程 */
+    if (changed == 0)
+    {
+        rt_mutex_release(oled_lock);
+        return;
+    }
+    if (oled_has_pending)
+    {
+        oled_stat.dropped++;
+    }
+    else
+    {
+        oled_has_pending = 1;
+        signal = 1;
+    }
+    rt_mutex_release(oled_lock);
+
+    if (signal)
+        rt_sem_release(oled_sem);
+}
+
+/**
+ * @brief 显示服务线程: 按帧率上限写出最新的待显示帧
+ */
+static void oled_service_entry(void *parameter)
+{
+    const rt_tick_t period = rt_tick_from_millisecond(1000 / OLED_FPS_MAX);
+    rt_tick_t last = rt_tick_get() - period;
+    uint8_t page;
+    int bytes;
+
+    while (1)
+    {
+        rt_sem_take(oled_sem, RT_WAITING_FOREVER);
+
+        /* 帧率上限: 等待期间的提交并入本帧 */
+        if (rt_tick_get() - last < period)
+            rt_thread_delay(period - (rt_tick_get() - last));
+        last = rt_tick_get();
+
+        rt_mutex_take(oled_lock, RT_WAITING_FOREVER);
+        for (page = 0; page < OLED_PAGES; page++)
+        {
+            rt_memcpy(oled_work_dirty[page], oled_pending_dirty[page], sizeof(oled_work_dirty[page]));
+            rt_memset(oled_pending_dirty[page], 0, sizeof(oled_pending_dirty[page]));
+        }
+        rt_memcpy(oled_work, oled_pending, sizeof(oled_work));
+        oled_has_pending = 0;
+        rt_mutex_release(oled_lock);
+
+        bytes = oled_write_dirty(oled_work, oled_work_dirty);
+        if (bytes < 0)
+        {
+            /* 未写出的部分并回待显示帧, 待显示帧内容不旧于本帧 */
+            oled_stat.errors++;
+            rt_mutex_take(oled_lock, RT_WAITING_FOREVER);
+            for (page = 0; page < OLED_PAGES; page++)
+            {
+                oled_pending_dirty[page][0] |= oled_work_dirty[page][0];
+                oled_pending_dirty[page][1] |= oled_work_dirty[page][1];
+                oled_pending_dirty[page][2] |= oled_work_dirty[page][2];
+                oled_pending_dirty[page][3] |= oled_work_dirty[page][3];
+            }
+            if (!oled_has_pending)
+            {
+                oled_has_pending = 1;
+                rt_sem_release(oled_sem);
+            }
+            rt_mutex_release(oled_lock);
+            continue;
+        }
+        oled_stat.frames++;
+        oled_stat.bytes += (uint32_t)bytes;
+    }
+}
+
+/**
+ * @brief 启动显示服务线程, 此后由服务线程独占屏幕总线
+ */
+int oled_service_start(void)
+{
+    rt_thread_t tid;
+
+    if (oled_sem != RT_NULL)
+        return RT_EOK;
+
+    oled_lock = rt_mutex_create("oled", RT_IPC_FLAG_PRIO);
+    oled_sem = rt_sem_create("oled", 0, RT_IPC_FLAG_FIFO);
+    if (oled_lock == RT_NULL || oled_sem == RT_NULL)
+        return -RT_ENOMEM;
+
+    tid = rt_thread_create("oled", oled_service_entry, RT_NULL, 1024, OLED_SERVICE_PRIORITY, 10);
+    if (tid == RT_NULL)
+        return -RT_ENOMEM;
+    rt_thread_startup(tid);
+
+    return RT_EOK;
+}
+
+/**
+ * @brief 获取显示服务统计
+ */
+void oled_get_stat(oled_stat_t *stat)
+{
+    *stat = oled_stat;
 }
 
 /**
@@ -51,9 +320,30 @@ static void oled_write_data(uint8_t data)
  */
 int oled_init(void)
 {
-    /* 查找I2C总线 */
-    i2c_bus = (struct rt_i2c_bus_device *)rt_device_find(OLED_I2C_BUS_NAME);
-    if (i2c_bus == RT_NULL)
+    static const uint8_t init_cmds[] = {
+        0xAE,           /* 关闭显示 */
+        0x20, 0x10,     /* 设置内存地址模式: 页地址模式 */
+        0xB0,           /* 设置页起始地址 */
+        0xC8,           /* COM输出扫描方向 */
+        0x00,           /* 设置低列地址 */
+        0x10,           /* 设置高列地址 */
+        0x40,           /* 设置起始行地址 */
+        0x81, 0xFF,     /* 设置对比度控制: 亮度 0x00~0xFF */
+        0xA1,           /* 段重映射 */
+        0xA6,           /* 正常显示 */
+        0xA8, 0x3F,     /* 设置复用比: 1/64 */
+        0xA4,           /* 输出跟随RAM内容 */
+        0xD3, 0x00,     /* 设置显示偏移: 无偏移 */
+        0xD5, 0xF0,     /* 设置显示时钟分频/振荡频率 */
+        0xD9, 0x22,     /* 设置预充电周期 */
+        0xDA, 0x12,     /* 设置COM引脚硬件配置 */
+        0xDB, 0x20,     /* 设置VCOMH: 0.77xVcc */
+        0x8D, 0x14,     /* 设置DC-DC使能 */
+        0xAF,           /* 开启显示 */
+    };
+
+    /* 登记到I2C总线 */
+    if (i2c_client_open(&oled_i2c, OLED_I2C_BUS_NAME, "oled", OLED_I2C_ADDR, I2C_PRIO_DISPLAY) != RT_EOK)
     {
         rt_kprintf("OLED: Can't find %s device!\n", OLED_I2C_BUS_NAME);
         return -RT_ERROR;
@@ -61,50 +351,25 @@ int oled_init(void)
 
     rt_thread_mdelay(100);
 
-    /* 初始化命令序列 */
-    oled_write_cmd(0xAE);  /* 关闭显示 */
-    oled_write_cmd(0x20);  /* 设置内存地址模式 */
-    oled_write_cmd(0x10);  /* 页地址模式 */
-    oled_write_cmd(0xB0);  /* 设置页起始地址 */
-    oled_write_cmd(0xC8);  /* COM输出扫描方向 */
-    oled_write_cmd(0x00);  /* 设置低列地址 */
-    oled_write_cmd(0x10);  /* 设置高列地址 */
-    oled_write_cmd(0x40);  /* 设置起始行地址 */
-    oled_write_cmd(0x81);  /* 设置对比度控制 */
-    oled_write_cmd(0xFF);  /* 亮度 0x00~0xFF */
-    oled_write_cmd(0xA1);  /* 段重映射 */
-    oled_write_cmd(0xA6);  /* 正常显示 */
-    oled_write_cmd(0xA8);  /* 设置复用比 */
-    oled_write_cmd(0x3F);  /* 1/64 */
-    oled_write_cmd(0xA4);  /* 输出跟随RAM内容 */
-    oled_write_cmd(0xD3);  /* 设置显示偏移 */
-    oled_write_cmd(0x00);  /* 无偏移 */
-    oled_write_cmd(0xD5);  /* 设置显示时钟分频/振荡频率 */
-    oled_write_cmd(0xF0);  /* 分频比 */
-    oled_write_cmd(0xD9);  /* 设置预充电周期 */
-    oled_write_cmd(0x22);
-    oled_write_cmd(0xDA);  /* 设置COM引脚硬件配置 */
-    oled_write_cmd(0x12);
-    oled_write_cmd(0xDB);  /* 设置VCOMH */
-    oled_write_cmd(0x20);  /* 0.77xVcc */
-    oled_write_cmd(0x8D);  /* 设置DC-DC使能 */
-    oled_write_cmd(0x14);
-    oled_write_cmd(0xAF);  /* 开启显示 */
-
-    oled_clear();
+    /* 初始化命令序列, 一次传输写出 */
+    oled_write_stream(0x00, init_cmds, sizeof(init_cmds));
+
+    /* 上电后GDDRAM内容不定, 整屏写一次 */
+    rt_memset(oled_fb, 0, sizeof(oled_fb));
+    rt_memset(oled_dirty, 0xFF, sizeof(oled_dirty));
+    oled_flush();
 
     rt_kprintf("OLED: Initialized successfully\n");
     return RT_EOK;
 }
 
 /**
- * @brief 设置坐标
+ * @brief 设置后台缓冲的写入坐标
  */
 void oled_set_pos(uint8_t x, uint8_t y)
 {
-    oled_write_cmd(0xB0 + y);
-    oled_write_cmd(((x & 0xF0) >> 4) | 0x10);
-    oled_write_cmd((x & 0x0F) | 0x01);
+    fb_x = x & (OLED_WIDTH - 1);
+    fb_y = y;
 }
 
 /**
@@ -113,18 +378,27 @@ void oled_set_pos(uint8_t x, uint8_t y)
 void oled_fill(uint8_t data)
 {
     uint8_t m, n;
-    for (m = 0; m < 8; m++)
+
+    fb_fill_gen++;
+    for (m = 0; m < OLED_PAGES; m++)
     {
-        oled_write_cmd(0xB0 + m);
-        oled_write_cmd(0x00);
-        oled_write_cmd(0x10);
-        for (n = 0; n < 128; n++)
+        oled_set_pos(0, m);
+        for (n = 0; n < OLED_WIDTH; n++)
         {
             oled_write_data(data);
         }
     }
 }
 
+/**
+ * @brief 把若干页标记为需要重写, 不论内容是否变化
+ * 用于屏幕内容可能与后台缓冲不一致时 (如传输出错后) 重新同步.
+ */
+void oled_invalidate(uint8_t page0, uint8_t page1)
+{
+    oled_dirty_pages(oled_dirty, page0, page1);
+}
+
 /**
  * @brief 清屏
  */
@@ -133,14 +407,23 @@ void oled_clear(void)
     oled_fill(0x00);
 }
 
+/**
+ * @brief 获取整屏填充次数
+ * 每次 oled_fill()/oled_clear() 加1, 保留模式控件据此判断屏幕内容已被清除.
+ */
+uint32_t oled_fill_generation(void)
+{
+    return fb_fill_gen;
+}
+
 /**
  * @brief 开启显示
  */
 void oled_on(void)
 {
-    oled_write_cmd(0x8D);
-    oled_write_cmd(0x14);
-    oled_write_cmd(0xAF);
+    static const uint8_t cmds[] = {0x8D, 0x14, 0xAF};
+
+    oled_write_stream(0x00, cmds, sizeof(cmds));
 }
 
 /**
@@ -148,80 +431,176 @@ void oled_on(void)
  */
 void oled_off(void)
 {
-    oled_write_cmd(0x8D);
-    oled_write_cmd(0x10);
-    oled_write_cmd(0xAE);
+    static const uint8_t cmds[] = {0x8D, 0x10, 0xAE};
+
+    oled_write_stream(0x00, cmds, sizeof(cmds));
 }
 
 /**
- * @brief 显示一个字符
- * @param x: 0~127
- * @param y: 0~7
- * @param chr: 字符
- * @param size: 字体大小 (1:6x8, 2:8x16)
- * @param mode: 0正常, 1反显
+ * @brief 解码字形, 编码不在字库内时为空白
+ * 格式见 sim/tools/font_pack.c: 每字节2位操作码, 之后为字面字节; 每8个字形一个偏移.
  */
-void oled_show_char(uint8_t x, uint8_t y, char chr, uint8_t size, uint8_t mode)
+static void oled_glyph_decode(const oled_font_t *font, uint8_t code, uint8_t inv, uint8_t *out)
 {
-    uint8_t c = 0, i = 0;
+    uint16_t n = font->width * font->pages, ops = (n + 3) / 4, i;
+    uint8_t k = code - font->first, skip;
+    const uint8_t *p, *lit;
 
-    c = chr - ' ';
+    if (code < font->first || k >= font->count)
+    {
+        rt_memset(out, inv ? 0xFF : 0x00, n);
+        return;
+    }
 
-    if (size == 2)
+    /* 组内前面的字形长度 = 操作码字节 + 字面字节数 */
+    p = font->data + font->index[k / 8];
+    for (skip = k % 8; skip > 0; skip--)
     {
-        if (x > 120) { x = 0; y++; }
-        oled_set_pos(x, y);
-        for (i = 0; i < 8; i++)
+        uint16_t len = ops;
+
+        for (i = 0; i < n; i++)
+            len += ((p[i / 4] >> ((i % 4) * 2)) & 3) == 2;
+        p += len;
+    }
+
+    lit = p + ops;
+    for (i = 0; i < n; i++)
+    {
+        switch ((p[i / 4] >> ((i % 4) * 2)) & 3)
         {
-            if (mode == 1)
-                oled_write_data(~F8X16[c * 16 + i]);
-            else
-                oled_write_data(F8X16[c * 16 + i]);
+        case 0: out[i] = 0x00; break;
+        case 1: out[i] = out[i - 1]; break;
+        case 2: out[i] = *lit++; break;
+        default: out[i] = 0xFF; break;
         }
-        oled_set_pos(x, y + 1);
-        for (i = 0; i < 8; i++)
+    }
+    if (inv)
+    {
+        for (i = 0; i < n; i++)
+            out[i] = ~out[i];
+    }
+}
+
+/**
+ * @brief 取解码后的字形, 优先从缓存
+ */
+static const uint8_t *oled_glyph(const oled_font_t *font, uint8_t code, uint8_t inv)
+{
+    oled_glyph_t *pg, *victim = &glyph_cache[0];
+    uint8_t i;
+
+    for (i = 0; i < OLED_GLYPH_CACHE; i++)
+    {
+        pg = &glyph_cache[i];
+        if (pg->stamp != 0 && pg->font == font && pg->code == code && pg->inv == inv)
         {
-            if (mode == 1)
-                oled_write_data(~F8X16[c * 16 + i + 8]);
-            else
-                oled_write_data(F8X16[c * 16 + i + 8]);
+            pg->stamp = ++glyph_clock;
+            oled_stat.glyph_hits++;
+            return pg->data;
         }
+        if (pg->stamp < victim->stamp)
+            victim = pg;
+    }
+
+    oled_glyph_decode(font, code, inv, victim->data);
+    victim->font = font;
+    victim->code = code;
+    victim->inv = inv;
+    victim->stamp = ++glyph_clock;
+    oled_stat.glyph_misses++;
+    return victim->data;
+}
+
+/**
+ * @brief 在 (x, 页y) 绘制一个字形, 占 字宽 x 页数
+ */
+static void oled_draw_glyph(uint8_t x, uint8_t y, const oled_font_t *font, uint8_t code, uint8_t mode)
+{
+    const uint8_t *g = oled_glyph(font, code, mode == 1);
+    uint8_t page, i;
+
+    for (page = 0; page < font->pages; page++)
+    {
+        oled_set_pos(x, y + page);
+        for (i = 0; i < font->width; i++)
+            oled_write_data(*g++);
     }
 }
 
+/**
+ * @brief 字体高度对应的字库
+ * @param size: 8-6x8, 16-8x16, 32-16x32数字 ('-' '.' '/' '0'~'9' ':')
+ */
+static const oled_font_t *oled_font_for_size(uint8_t size)
+{
+    switch (size)
+    {
+    case 8:  return &font6x8;
+    case 16: return &font8x16;
+    case 32: return &font16x32;
+    default: return RT_NULL;
+    }
+}
+
+/**
+ * @brief 显示一个字符
+ * @param x: 0~127
+ * @param y: 0~7
+ * @param chr: 字符
+ * @param size: 字体高度 (8:6x8, 16:8x16, 32:16x32数字)
+ * @param mode: 0正常, 1反显
+ */
+void oled_show_char(uint8_t x, uint8_t y, char chr, uint8_t size, uint8_t mode)
+{
+    const oled_font_t *font = oled_font_for_size(size);
+
+    if (font == RT_NULL)
+        return;
+    if (x > OLED_WIDTH - font->width) { x = 0; y += font->pages; }
+    oled_draw_glyph(x, y, font, (uint8_t)chr, mode);
+}
+
 /**
  * @brief 显示字符串
  */
 void oled_show_string(uint8_t x, uint8_t y, const char *str, uint8_t size)
 {
+    const oled_font_t *font = oled_font_for_size(size);
     uint8_t j = 0;
 
+    if (font == RT_NULL)
+        return;
     while (str[j] != '\0')
     {
-        if (size == 2)
-        {
-            uint8_t c = str[j] - 32;
-            if (x > 120) { x = 0; y++; }
-            oled_set_pos(x, y);
-            for (uint8_t i = 0; i < 8; i++)
-                oled_write_data(F8X16[c * 16 + i]);
-            oled_set_pos(x, y + 1);
-            for (uint8_t i = 0; i < 8; i++)
-                oled_write_data(F8X16[c * 16 + i + 8]);
-            x += 8;
-        }
+        if (x > OLED_WIDTH - font->width) { x = 0; y += font->pages; }
+        oled_draw_glyph(x, y, font, (uint8_t)str[j], 0);
+        x += font->width;
         j++;
     }
 }
 
+/**
+ * @brief 求幂
+ */
+static uint32_t oled_pow(uint8_t m, uint8_t n)
+{
+    uint32_t result = 1;
+    while (n--) result *= m;
+    return result;
+}
+
 /**
  * @brief 显示数字
  */
 void oled_show_num(uint8_t x, uint8_t y, uint32_t num, uint8_t len, uint8_t size)
 {
+    const oled_font_t *font = oled_font_for_size(size);
     uint8_t t, temp;
     uint8_t enshow = 0;
 
+    if (font == RT_NULL)
+        return;
+
     for (t = 0; t < len; t++)
     {
         temp = (num / oled_pow(10, len - t - 1)) % 10;
@@ -229,7 +608,7 @@ void oled_show_num(uint8_t x, uint8_t y, uint32_t num, uint8_t len, uint8_t size
         {
             if (temp == 0)
             {
-                oled_show_char(x + (size / 2) * t, y, ' ', size, 0);
+                oled_show_char(x + font->width * t, y, ' ', size, 0);
                 continue;
             }
             else
@@ -237,20 +616,10 @@ void oled_show_num(uint8_t x, uint8_t y, uint32_t num, uint8_t len, uint8_t size
                 enshow = 1;
             }
         }
-        oled_show_char(x + (size / 2) * t, y, temp + '0', size, 0);
+        oled_show_char(x + font->width * t, y, temp + '0', size, 0);
     }
 }
 
-/**
- * @brief 求幂
- */
-static uint32_t oled_pow(uint8_t m, uint8_t n)
-{
-    uint32_t result = 1;
-    while (n--) result *= m;
-    return result;
-}
-
 /**
  * @brief 显示汉字
  * @param index: 字库索引
@@ -258,27 +627,7 @@ static uint32_t oled_pow(uint8_t m, uint8_t n)
  */
 void oled_show_chinese(uint8_t x, uint8_t y, uint8_t index, uint8_t mode)
 {
-    uint8_t wm = 0;
-    uint32_t addr = 32 * index;
-
-    oled_set_pos(x, y);
-    for (wm = 0; wm < 16; wm++)
-    {
-        if (mode == 1)
-            oled_write_data(~F16x16[addr]);
-        else
-            oled_write_data(F16x16[addr]);
-        addr++;
-    }
-    oled_set_pos(x, y + 1);
-    for (wm = 0; wm < 16; wm++)
-    {
-        if (mode == 1)
-            oled_write_data(~F16x16[addr]);
-        else
-            oled_write_data(F16x16[addr]);
-        addr++;
-    }
+    oled_draw_glyph(x, y, &font16x16, index, mode);
 }
 
 /**
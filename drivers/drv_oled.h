@@ -21,12 +21,40 @@ extern "C" {
 #define OLED_HEIGHT         64
 #define OLED_PAGES          8
 
-/* 函数声明 */
+/* 刷新时同页内相距不超过该列数的脏段合并为一次传输 (单独寻址需多7字节) */
+#define OLED_FLUSH_GAP      7
+
+/* 字形缓存项数, 每项存一个解码 (及反显) 后的字形, 最大16x32 */
+#define OLED_GLYPH_CACHE        16
+
+/* 显示服务 */
+#define OLED_FPS_MAX            20      /* 帧率上限 */
+#define OLED_SERVICE_PRIORITY   21      /* 低于主循环与报警线程 */
+
+/* 显示服务统计 */
+typedef struct {
+    uint32_t commits;       /* oled_commit() 调用次数 */
+    uint32_t frames;        /* 写出的帧数 */
+    uint32_t dropped;       /* 被后续提交覆盖而未写出的帧数 */
+    uint32_t bytes;         /* 写出的数据字节数 */
+    uint32_t errors;        /* 写出失败次数 */
+    uint32_t glyph_hits;    /* 字形缓存命中 */
+    uint32_t glyph_misses;  /* 字形解码次数 */
+} oled_stat_t;
+
+/* 函数声明
+ * 绘图函数只写入后台缓冲, 调用 oled_commit() (或服务启动前的 oled_flush()) 后才送到屏幕 */
 int oled_init(void);
+int oled_service_start(void);
+void oled_commit(void);
+void oled_get_stat(oled_stat_t *stat);
 void oled_clear(void);
+uint32_t oled_fill_generation(void);
 void oled_fill(uint8_t data);
+void oled_invalidate(uint8_t page0, uint8_t page1);
 void oled_on(void);
 void oled_off(void);
+int oled_flush(void);
 void oled_set_pos(uint8_t x, uint8_t y);
 void oled_show_char(uint8_t x, uint8_t y, char chr, uint8_t size, uint8_t mode);
 void oled_show_string(uint8_t x, uint8_t y, const char *str, uint8_t size);
@@ -0,0 +1,329 @@
+/*
+ * I2C总线管理
+ * 同一总线上的设备各自登记为客户端, 事务在总线上串行执行;
+ * 总线忙时等待者按客户端优先级排队, 释放时直接交给最高优先级的等待者;
+ * 持有线程临时继承等待线程中的最高线程优先级.
+ */
+#include "i2c_bus.h"
+
+extern uint32_t get_time_us(void);
+
+/* 等待总线的线程, 节点在等待者的栈上, 按客户端优先级排队 (同优先级先到先得) */
+struct i2c_waiter
+{
+    rt_thread_t thread;
+    i2c_client_t *cl;
+    struct rt_semaphore sem;
+    struct i2c_waiter *next;
+};
+
+/*
+ * 每条总线一个状态. 持有者可嵌套加锁 (如事务内再调用单次传输);
+ * 释放时若有等待者, 直接把总线 (owner/holder) 交给队首的一个再唤醒它,
+ * 其他线程看到busy只能排队, 不会插队.
+ * 持有线程的优先级低于某个等待线程时提升到该优先级, 释放时恢复,
+ * 避免低优先级的持有者被中间优先级的线程抢占而使高优先级的等待者无限期等待.
+ * 持有期间同时占住设备自身的互斥量, rt_i2c_transfer() 内只是嵌套加锁,
+ * 其释放不会把提升过的优先级改回去.
+ */
+struct i2c_bus_mgr
+{
+    const char  *name;
+    struct rt_i2c_bus_device *dev;
+    uint8_t     busy;
+    uint8_t     depth;                      /* 持有者的嵌套层数 */
+    rt_uint8_t  owner_prio;                 /* 持有线程取得总线时的优先级, 释放时恢复 */
+    rt_thread_t owner;                      /* 持有线程 */
+    i2c_client_t *holder;
+    struct i2c_waiter *waiters;
+    i2c_client_t *clients;
+};
+
+static struct i2c_bus_mgr buses[I2C_BUS_MAX];
+
+/**
+ * @brief 按名称取总线, 首次使用时查找设备并建立状态
+ */
+static struct i2c_bus_mgr *i2c_bus_get(const char *bus_name)
+{
+    struct i2c_bus_mgr *bus;
+    struct rt_i2c_bus_device *dev;
+    uint8_t i;
+
+    for (i = 0; i < I2C_BUS_MAX; i++)
+    {
+        if (buses[i].name != RT_NULL && rt_strcmp(buses[i].name, bus_name) == 0)
+            return &buses[i];
+    }
+
+    dev = (struct rt_i2c_bus_device *)rt_device_find(bus_name);
+    if (dev == RT_NULL)
+        return RT_NULL;
+
+    for (i = 0; i < I2C_BUS_MAX; i++)
+    {
+        bus = &buses[i];
+        if (bus->name != RT_NULL)
+            continue;
+
+        bus->name = bus_name;
+        bus->dev = dev;
+        return bus;
+    }
+    return RT_NULL;
+}
+
+/**
+ * @brief 登记总线上的一个设备
+ * @param prio: 优先级, 0最高
+ * @note 在初始化阶段调用, 客户端结构体须长期有效
+ */
+int i2c_client_open(i2c_client_t *cl, const char *bus_name, const char *name,
+                    rt_uint16_t addr, uint8_t prio)
+{
+    struct i2c_bus_mgr *bus;
+
+    if (cl->bus != RT_NULL)
+        return RT_EOK;
+
+    bus = i2c_bus_get(bus_name);
+    if (bus == RT_NULL)
+        return -RT_ERROR;
+
+    rt_memset(&cl->stat, 0, sizeof(cl->stat));
+    cl->name = name;
+    cl->addr = addr;
+    cl->prio = prio < I2C_PRIO_LEVELS ? prio : I2C_PRIO_LEVELS - 1;
+    cl->next = bus->clients;
+    bus->clients = cl;
+    cl->bus = bus;
+    return RT_EOK;
+}
+
+/**
+ * @brief 把持有线程提升到等待线程中的最高优先级 (优先级继承)
+ * @note 调用者须处于临界区, 且总线已有持有者
+ */
+static void i2c_bus_inherit(struct i2c_bus_mgr *bus)
+{
+    struct i2c_waiter *w;
+    rt_uint8_t prio = bus->owner->current_priority;
+
+    for (w = bus->waiters; w != RT_NULL; w = w->next)
+    {
+        if (w->thread->current_priority < prio)
+            prio = w->thread->current_priority;
+    }
+    if (prio < bus->owner->current_priority)
+        rt_thread_control(bus->owner, RT_THREAD_CTRL_CHANGE_PRIORITY, &prio);
+}
+
+/**
+ * @brief 取得总线, 总线忙时按优先级排队等待
+ * 同一线程可嵌套调用, 与 i2c_client_unlock() 成对使用.
+ * 持有期间应只做总线传输, 不要延时等待.
+ */
+void i2c_client_lock(i2c_client_t *cl)
+{
+    struct i2c_bus_mgr *bus = cl->bus;
+    struct i2c_waiter w, **pp;
+    rt_thread_t self = rt_thread_self();
+    uint32_t t0 = get_time_us(), dt;
+    uint8_t waited = 0;
+
+    if (bus == RT_NULL)
+        return;
+
+    rt_enter_critical();
+    if (bus->busy && bus->owner == self)
+    {
+        bus->depth++;
+        rt_exit_critical();
+        return;
+    }
+    if (bus->busy)
+    {
+        w.thread = self;
+        w.cl = cl;
+        rt_sem_init(&w.sem, bus->name, 0, RT_IPC_FLAG_FIFO);
+        for (pp = &bus->waiters; *pp != RT_NULL && (*pp)->cl->prio <= cl->prio; pp = &(*pp)->next)
+            ;
+        w.next = *pp;
+        *pp = &w;
+        i2c_bus_inherit(bus);
+        rt_exit_critical();
+
+        /* 释放者已把总线交给本线程 */
+        rt_sem_take(&w.sem, RT_WAITING_FOREVER);
+        rt_sem_detach(&w.sem);
+        waited = 1;
+    }
+    else
+    {
+        bus->busy = 1;
+        bus->depth = 1;
+        bus->owner = self;
+        bus->owner_prio = self->current_priority;
+        bus->holder = cl;
+        rt_exit_critical();
+    }
+    rt_mutex_take(&bus->dev->lock, RT_WAITING_FOREVER);
+
+    cl->t_lock = get_time_us();
+    cl->stat.locks++;
+    if (waited)
+    {
+        dt = cl->t_lock - t0;
+        cl->stat.waits++;
+        cl->stat.wait_us += dt;
+        if (dt > cl->stat.wait_max_us)
+            cl->stat.wait_max_us = dt;
+    }
+}
+
+/**
+ * @brief 释放总线, 有等待者时交给优先级最高的一个
+ */
+void i2c_client_unlock(i2c_client_t *cl)
+{
+    struct i2c_bus_mgr *bus = cl->bus;
+    struct i2c_waiter *w;
+    rt_thread_t self = rt_thread_self();
+    rt_uint8_t prio;
+    uint32_t dt;
+
+    if (bus == RT_NULL)
+        return;
+
+    rt_enter_critical();
+    if (--bus->depth > 0)
+    {
+        rt_exit_critical();
+        return;
+    }
+
+    dt = get_time_us() - cl->t_lock;
+    cl->stat.busy_us += dt;
+    if (dt > cl->stat.busy_max_us)
+        cl->stat.busy_max_us = dt;
+
+    prio = bus->owner_prio;
+    w = bus->waiters;
+    if (w == RT_NULL)
+    {
+        bus->busy = 0;
+        bus->owner = RT_NULL;
+        bus->holder = RT_NULL;
+    }
+    else
+    {
+        /* 交接期间新到的等待者也能提升被唤醒的线程 */
+        bus->waiters = w->next;
+        bus->depth = 1;
+        bus->owner = w->thread;
+        bus->owner_prio = w->thread->current_priority;
+        bus->holder = w->cl;
+        i2c_bus_inherit(bus);
+    }
+    rt_mutex_release(&bus->dev->lock);
+    if (self->current_priority != prio)
+        rt_thread_control(self, RT_THREAD_CTRL_CHANGE_PRIORITY, &prio);
+    /* 在临界区内唤醒, 恢复优先级后不会在唤醒前被抢占 */
+    if (w != RT_NULL)
+        rt_sem_release(&w->sem);
+    rt_exit_critical();
+}
+
+/**
+ * @brief 一次传输, 未持有总线时自动加锁
+ * @return 成功传输的消息数
+ */
+rt_size_t i2c_client_transfer(i2c_client_t *cl, struct rt_i2c_msg msgs[], rt_uint32_t num)
+{
+    rt_size_t ret;
+    rt_uint32_t i;
+
+    if (cl->bus == RT_NULL)
+        return 0;
+
+    i2c_client_lock(cl);
+    for (i = 0; i < num; i++)
+    {
+        msgs[i].addr = cl->addr;
+        cl->stat.bytes += msgs[i].len;
+    }
+    ret = rt_i2c_transfer(cl->bus->dev, msgs, num);
+    cl->stat.xfers++;
+    if (ret != num)
+        cl->stat.errors++;
+    i2c_client_unlock(cl);
+
+    return ret;
+}
+
+/**
+ * @brief 写若干字节 (首字节通常为寄存器地址或控制字节)
+ */
+rt_err_t i2c_client_write(i2c_client_t *cl, const uint8_t *buf, uint16_t len)
+{
+    struct rt_i2c_msg msgs;
+
+    msgs.flags = RT_I2C_WR;
+    msgs.buf   = (uint8_t *)buf;
+    msgs.len   = len;
+
+    return i2c_client_transfer(cl, &msgs, 1) == 1 ? RT_EOK : -RT_ERROR;
+}
+
+/**
+ * @brief 从寄存器reg起连续读len字节
+ */
+rt_err_t i2c_client_read_regs(i2c_client_t *cl, uint8_t reg, uint8_t *buf, uint16_t len)
+{
+    struct rt_i2c_msg msgs[2];
+
+    msgs[0].flags = RT_I2C_WR;
+    msgs[0].buf   = &reg;
+    msgs[0].len   = 1;
+
+    msgs[1].flags = RT_I2C_RD;
+    msgs[1].buf   = buf;
+    msgs[1].len   = len;
+
+    return i2c_client_transfer(cl, msgs, 2) == 2 ? RT_EOK : -RT_ERROR;
+}
+
+/**
+ * @brief 获取客户端统计
+ */
+void i2c_client_get_stat(const i2c_client_t *cl, i2c_stat_t *stat)
+{
+    *stat = cl->stat;
+}
+
+/**
+ * @brief 打印各总线上客户端的占用与等待统计
+ */
+static int i2c_stat(int argc, char **argv)
+{
+    const i2c_client_t *cl;
+    uint8_t i;
+
+    for (i = 0; i < I2C_BUS_MAX; i++)
+    {
+        if (buses[i].name == RT_NULL)
+            continue;
+
+        rt_kprintf("%s:\n", buses[i].name);
+        rt_kprintf("  %-8s prio  xfers err    bytes  busy_ms busy_max  waits wait_avg wait_max (us)\n", "client");
+        for (cl = buses[i].clients; cl != RT_NULL; cl = cl->next)
+        {
+            rt_kprintf("  %-8s %4d %6u %3u %8u %8u %8u %6u %8u %8u\n",
+                       cl->name, cl->prio, cl->stat.xfers, cl->stat.errors, cl->stat.bytes,
+                       cl->stat.busy_us / 1000, cl->stat.busy_max_us, cl->stat.waits,
+                       cl->stat.waits ? cl->stat.wait_us / cl->stat.waits : 0, cl->stat.wait_max_us);
+        }
+    }
+    return 0;
+}
+MSH_CMD_EXPORT(i2c_stat, show i2c bus occupancy and wait time);
@@ -0,0 +1,63 @@
+/*
+ * I2C总线管理
+ * 同一总线上的设备各自登记为客户端, 事务在总线上串行执行;
+ * 总线忙时等待者按客户端优先级排队, 释放时直接交给最高优先级的等待者;
+ * 持有线程临时继承等待线程中的最高线程优先级.
+ */
+#ifndef __I2C_BUS_H__
+#define __I2C_BUS_H__
+
+#include <rtthread.h>
+#include <rtdevice.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define I2C_BUS_MAX         2       /* 最多管理的总线数 */
+#define I2C_PRIO_LEVELS     4       /* 优先级数, 0最高 */
+
+/* 客户端优先级 */
+#define I2C_PRIO_SENSOR     0       /* 传感器FIFO读取, 采样延迟敏感 */
+#define I2C_PRIO_DISPLAY    2       /* 屏幕刷新, 可让出 */
+
+/* 每个客户端的总线统计, 时间单位微秒 */
+typedef struct {
+    uint32_t xfers;         /* 传输次数 */
+    uint32_t errors;        /* 传输失败次数 */
+    uint32_t bytes;         /* 消息字节数 (不含地址) */
+    uint32_t locks;         /* 取得总线次数 */
+    uint32_t waits;         /* 其中需要等待的次数 */
+    uint32_t busy_us;       /* 占用总线的总时间 */
+    uint32_t busy_max_us;   /* 单次占用最长时间 */
+    uint32_t wait_us;       /* 等待总线的总时间 */
+    uint32_t wait_max_us;   /* 单次等待最长时间 */
+} i2c_stat_t;
+
+struct i2c_bus_mgr;
+
+typedef struct i2c_client {
+    const char  *name;
+    rt_uint16_t addr;               /* 7位地址 */
+    uint8_t     prio;
+    struct i2c_bus_mgr *bus;
+    uint32_t    t_lock;             /* 取得总线的时刻 */
+    i2c_stat_t  stat;
+    struct i2c_client *next;
+} i2c_client_t;
+
+/* 函数声明 */
+int  i2c_client_open(i2c_client_t *cl, const char *bus_name, const char *name,
+                     rt_uint16_t addr, uint8_t prio);
+void i2c_client_lock(i2c_client_t *cl);
+void i2c_client_unlock(i2c_client_t *cl);
+rt_size_t i2c_client_transfer(i2c_client_t *cl, struct rt_i2c_msg msgs[], rt_uint32_t num);
+rt_err_t i2c_client_write(i2c_client_t *cl, const uint8_t *buf, uint16_t len);
+rt_err_t i2c_client_read_regs(i2c_client_t *cl, uint8_t reg, uint8_t *buf, uint16_t len);
+void i2c_client_get_stat(const i2c_client_t *cl, i2c_stat_t *stat);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __I2C_BUS_H__ */
@@ -1,206 +1,219 @@
 /*
- * OLED字库文件
- * 包含8x16 ASCII字符和16x16汉字
+ * OLED字库 - 由 sim/tools/font_pack 从 sim/tools/font_src.h 生成, 请勿手工修改
+ * 压缩格式见 sim/tools/font_pack.c, 解码见 drv_oled.c
  */
 #ifndef __OLED_FONT_H__
 #define __OLED_FONT_H__
 
 #include <rtthread.h>
 
-/* 16x16汉字字库 */
-const unsigned char F16x16[] = {
-    /* 日 0 */
-    0x00,0x00,0xFE,0x82,0x92,0x92,0x92,0xFE,0x92,0x92,0x92,0x82,0xFE,0x00,0x00,0x00,
-    0x80,0x60,0x1F,0x00,0x00,0x1E,0x12,0x12,0x12,0x1E,0x40,0x80,0x7F,0x00,0x00,0x00,
-    /* 一 1 */
-    0x80,0x80,0x80,0x80,0x80,0x80,0x80,0x80,0x80,0x80,0x80,0x80,0x80,0x80,0x80,0x00,
-    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-    /* 二 2 */
-    0x00,0x00,0x08,0x08,0x08,0x08,0x08,0x08,0x08,0x08,0x08,0x08,0x08,0x00,0x00,0x00,
-    0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x00,
-    /* 三 3 */
-    0x00,0x04,0x84,0x84,0x84,0x84,0x84,0x84,0x84,0x84,0x84,0x84,0x84,0x04,0x00,0x00,
-    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x00,
-    /* 四 4 */
-    0x00,0xFC,0x04,0x04,0x04,0xFC,0x04,0x04,0x04,0xFC,0x04,0x04,0x04,0xFC,0x00,0x00,
-    0x00,0x7F,0x28,0x24,0x23,0x20,0x20,0x20,0x20,0x21,0x22,0x22,0x22,0x7F,0x00,0x00,
-    /* 五 5 */
-    0x00,0x02,0x42,0x42,0x42,0xC2,0x7E,0x42,0x42,0x42,0x42,0xC2,0x02,0x02,0x00,0x00,
-    0x40,0x40,0x40,0x40,0x78,0x47,0x40,0x40,0x40,0x40,0x40,0x7F,0x40,0x40,0x40,0x00,
-    /* 六 6 */
-    0x20,0x20,0x20,0x20,0x20,0x20,0x21,0x22,0x2C,0x20,0x20,0x20,0x20,0x20,0x20,0x00,
-    0x00,0x40,0x20,0x10,0x0C,0x03,0x00,0x00,0x00,0x01,0x02,0x04,0x18,0x60,0x00,0x00,
-    /* 七 7 */
-    0x00,0x00,0x00,0xFE,0x82,0x82,0x82,0x82,0x82,0x82,0x82,0xFE,0x00,0x00,0x00,0x00,
-    0x00,0x00,0x00,0xFF,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0xFF,0x00,0x00,0x00,0x00,
-    /* 欢 8 */
-    0x04,0x24,0x44,0x84,0x64,0x9C,0x40,0x30,0x0F,0xC8,0x08,0x08,0x28,0x18,0x00,0x00,
-    0x10,0x08,0x06,0x01,0x82,0x4C,0x20,0x18,0x06,0x01,0x06,0x18,0x20,0x40,0x80,0x00,
-    /* 迎 9 */
-    0x40,0x40,0x42,0xCC,0x00,0x00,0xFC,0x04,0x02,0x00,0xFC,0x04,0x04,0xFC,0x00,0x00,
-    0x00,0x40,0x20,0x1F,0x20,0x40,0x4F,0x44,0x42,0x40,0x7F,0x42,0x44,0x43,0x40,0x00,
-    /* 使 10 */
-    0x80,0x60,0xF8,0x07,0x04,0xE4,0x24,0x24,0x24,0xFF,0x24,0x24,0x24,0xE4,0x04,0x00,
-    0x00,0x00,0xFF,0x00,0x80,0x81,0x45,0x29,0x11,0x2F,0x41,0x41,0x81,0x81,0x80,0x00,
-    /* 用 11 */
-    0x00,0x00,0xFE,0x22,0x22,0x22,0x22,0xFE,0x22,0x22,0x22,0x22,0xFE,0x00,0x00,0x00,
-    0x80,0x60,0x1F,0x02,0x02,0x02,0x02,0x7F,0x02,0x02,0x42,0x82,0x7F,0x00,0x00,0x00,
-    /* 智 12 */
-    0x10,0x94,0x53,0x32,0x1E,0x32,0x52,0x10,0x00,0x7E,0x42,0x42,0x42,0x7E,0x00,0x00,
-    0x00,0x00,0x00,0xFF,0x49,0x49,0x49,0x49,0x49,0x49,0x49,0xFF,0x00,0x00,0x00,0x00,
-    /* 能 13 */
-    0x08,0xCC,0x4A,0x49,0x48,0x4A,0xCC,0x18,0x00,0x7F,0x88,0x88,0x84,0x82,0xE0,0x00,
-    0x00,0xFF,0x12,0x12,0x52,0x92,0x7F,0x00,0x00,0x7E,0x88,0x88,0x84,0x82,0xE0,0x00,
-    /* 手 14 */
-    0x00,0x00,0x24,0x24,0x24,0x24,0x24,0xFC,0x22,0x22,0x22,0x23,0x22,0x00,0x00,0x00,
-    0x02,0x02,0x02,0x02,0x02,0x42,0x82,0x7F,0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x00,
-    /* 环 15 */
-    0x04,0x84,0x84,0xFC,0x84,0x84,0x00,0x04,0x04,0x84,0xE4,0x1C,0x84,0x04,0x04,0x00,
-    0x20,0x60,0x20,0x1F,0x10,0x10,0x04,0x02,0x01,0x00,0xFF,0x00,0x00,0x01,0x06,0x00,
-    /* 心 16 */
-    0x00,0x00,0x80,0x00,0x00,0xE0,0x02,0x04,0x18,0x00,0x00,0x00,0x40,0x80,0x00,0x00,
-    0x10,0x0C,0x03,0x00,0x00,0x3F,0x40,0x40,0x40,0x40,0x40,0x78,0x00,0x01,0x0E,0x00,
-    /* 率 17 */
-    0x00,0x14,0xA4,0x44,0x24,0x34,0xAD,0x66,0x24,0x94,0x04,0x44,0xA4,0x14,0x00,0x00,
-    0x08,0x09,0x08,0x08,0x09,0x09,0x09,0xFD,0x09,0x09,0x0B,0x08,0x08,0x09,0x08,0x00,
-    /* 血 18 */
-    0x00,0x00,0xF8,0x08,0x08,0xF8,0x0C,0x0B,0x08,0xF8,0x08,0x08,0xF8,0x00,0x00,0x00,
-    0x40,0x40,0x7F,0x40,0x40,0x7F,0x40,0x40,0x40,0x7F,0x40,0x40,0x7F,0x40,0x40,0x00,
-    /* 氧 19 */
-    0x08,0x24,0x23,0x6A,0xAA,0x2A,0xAA,0x6A,0x2A,0x2A,0x2A,0xEA,0x02,0x02,0x00,0x00,
-    0x10,0x11,0x15,0x15,0x15,0xFF,0x15,0x15,0x15,0x11,0x10,0x0F,0x30,0x40,0xF8,0x00,
-    /* 步 20 */
-    0x40,0x40,0x40,0x7C,0x40,0x40,0x40,0xFF,0x44,0x44,0x44,0x44,0x44,0x40,0x40,0x00,
-    0x80,0x90,0x88,0x46,0x40,0x40,0x20,0x2F,0x10,0x10,0x08,0x04,0x02,0x00,0x00,0x00,
-    /* 数 21 */
-    0x90,0x52,0x34,0x10,0xFF,0x10,0x34,0x52,0x80,0x70,0x8F,0x08,0x08,0xF8,0x08,0x00,
-    0x82,0x9A,0x56,0x63,0x22,0x52,0x8E,0x00,0x80,0x40,0x33,0x0C,0x33,0x40,0x80,0x00,
-    /* 设 22 */
-    0x40,0x40,0x42,0xCC,0x00,0x40,0xA0,0x9E,0x82,0x82,0x82,0x9E,0xA0,0x20,0x20,0x00,
-    0x00,0x00,0x00,0x3F,0x90,0x88,0x40,0x43,0x2C,0x10,0x28,0x46,0x41,0x80,0x80,0x00,
-    /* 置 23 */
-    0x00,0x17,0x15,0xD5,0x55,0x57,0x55,0x7D,0x55,0x57,0x55,0xD5,0x15,0x17,0x00,0x00,
-    0x40,0x40,0x40,0x7F,0x55,0x55,0x55,0x55,0x55,0x55,0x55,0x7F,0x40,0x40,0x40,0x00,
-    /* 时 44 */
-    0x00,0xFC,0x84,0x84,0x84,0xFC,0x00,0x10,0x10,0x10,0x10,0x10,0xFF,0x10,0x10,0x00,
-    0x00,0x3F,0x10,0x10,0x10,0x3F,0x00,0x00,0x01,0x06,0x40,0x80,0x7F,0x00,0x00,0x00,
-    /* 里 45 */
-    0x00,0x00,0xFE,0x92,0x92,0x92,0x92,0xFE,0x92,0x92,0x92,0x92,0xFE,0x00,0x00,0x00,
-    0x40,0x40,0x44,0x44,0x44,0x44,0x44,0x7F,0x44,0x44,0x44,0x44,0x44,0x40,0x40,0x00,
-    /* 程 46 */
-    0x24,0x24,0xA4,0xFE,0x23,0x22,0x00,0x3E,0x22,0x22,0x22,0x22,0x22,0x3E,0x00,0x00,
-    0x08,0x06,0x01,0xFF,0x01,0x06,0x40,0x49,0x49,0x49,0x7F,0x49,0x49,0x49,0x41,0x00,
-    /* 最 26 */
-    0x02,0x02,0x02,0x02,0x02,0x02,0xFE,0x02,0x02,0x42,0x82,0x02,0x02,0x02,0x02,0x00,
-    0x00,0x00,0x00,0x00,0x00,0x00,0xFF,0x00,0x00,0x00,0x00,0x01,0x06,0x00,0x00,0x00,
-    /* 低 27 */
-    0x00,0xFE,0x22,0x5A,0x86,0x00,0xFE,0x92,0x92,0x92,0x92,0x92,0xFE,0x00,0x00,0x00,
-    0x00,0xFF,0x04,0x08,0x07,0x00,0xFF,0x40,0x20,0x03,0x0C,0x14,0x22,0x41,0x40,0x00,
-    /* 最 28 */
-    0x00,0x00,0x00,0x00,0x00,0x00,0xFF,0x40,0x40,0x40,0x40,0x40,0x40,0x00,0x00,0x00,
-    0x40,0x40,0x40,0x40,0x40,0x40,0x7F,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x00,
-    /* 高 29 */
-    0x00,0xFE,0x22,0x5A,0x86,0x00,0xFE,0x92,0x92,0x92,0x92,0x92,0xFE,0x00,0x00,0x00,
-    0x00,0xFF,0x04,0x08,0x07,0x00,0xFF,0x40,0x20,0x03,0x0C,0x14,0x22,0x41,0x40,0x00,
+typedef struct {
+    uint8_t  width;                 /* 字宽 (列) */
+    uint8_t  pages;                 /* 字高 (页) */
+    uint8_t  first;                 /* 首个字形的编码 */
+    uint8_t  count;                 /* 字形数 */
+    const uint16_t *index;          /* 每8个字形的起始偏移 */
+    const uint8_t  *data;
+} oled_font_t;
+
+/* 6x8 ASCII: 95个字形, 原始570字节, 压缩后560字节 (含索引) */
+static const uint16_t font6x8_index[] = {
+    0, 41, 80, 131, 171, 217, 264, 312, 358, 402, 448, 497,
+};
+static const uint8_t font6x8_data[] = {
+    0x00,0x00,0x80,0x00,0x2F,0x20,0x02,0x07,0x07,0xA8,0x0A,0x14,0x7F,0x14,0x7F,0x14,
+    0xA8,0x0A,0x24,0x2A,0x7F,0x2A,0x12,0xA8,0x0A,0x62,0x64,0x08,0x13,0x23,0xA8,0x0A,
+    0x36,0x49,0x55,0x22,0x50,0xA0,0x00,0x05,0x03,0xA0,0x02,0x1C,0x22,0x41,0xA0,0x02,
+    0x41,0x22,0x1C,0xA8,0x0A,0x14,0x08,0x3E,0x08,0x14,0x98,0x06,0x08,0x3E,0x08,0x80,
+    0x02,0xA0,0x60,0x58,0x05,0x08,0x60,0x00,0x60,0xA8,0x0A,0x20,0x10,0x08,0x04,0x02,
+    0xA8,0x0A,0x3E,0x51,0x49,0x45,0x3E,0xA0,0x02,0x42,0x7F,0x40,0xA8,0x0A,0x42,0x61,
+    0x51,0x49,0x46,0xA8,0x0A,0x21,0x41,0x45,0x4B,0x31,0xA8,0x0A,0x18,0x14,0x12,0x7F,
+    0x10,0x68,0x09,0x27,0x45,0x39,0xA8,0x09,0x3C,0x4A,0x49,0x30,0xA8,0x0A,0x01,0x71,
+    0x09,0x05,0x03,0x68,0x09,0x36,0x49,0x36,0x68,0x0A,0x06,0x49,0x29,0x1E,0x60,0x00,
+    0x36,0xA0,0x00,0x56,0x36,0xA8,0x02,0x08,0x14,0x22,0x41,0x58,0x05,0x14,0xA0,0x0A,
+    0x41,0x22,0x14,0x08,0xA8,0x0A,0x02,0x01,0x51,0x09,0x06,0xA8,0x0A,0x32,0x49,0x59,
+    0x51,0x3E,0xA8,0x0A,0x7C,0x12,0x11,0x12,0x7C,0x68,0x09,0x7F,0x49,0x36,0x68,0x09,
+    0x3E,0x41,0x22,0x68,0x0A,0x7F,0x41,0x22,0x1C,0x68,0x09,0x7F,0x49,0x41,0x68,0x09,
+    0x7F,0x09,0x01,0xA8,0x09,0x3E,0x41,0x49,0x7A,0x68,0x09,0x7F,0x08,0x7F,0xA0,0x02,
+    0x41,0x7F,0x41,0xA8,0x0A,0x20,0x40,0x41,0x3F,0x01,0xA8,0x0A,0x7F,0x08,0x14,0x22,
+    0x41,0x68,0x05,0x7F,0x40,0xA8,0x0A,0x7F,0x02,0x0C,0x02,0x7F,0xA8,0x0A,0x7F,0x04,
+    0x08,0x10,0x7F,0x68,0x09,0x3E,0x41,0x3E,0x68,0x09,0x7F,0x09,0x06,0xA8,0x0A,0x3E,
+    0x41,0x51,0x21,0x5E,0xA8,0x0A,0x7F,0x09,0x19,0x29,0x46,0x68,0x09,0x46,0x49,0x31,
+    0x98,0x06,0x01,0x7F,0x01,0x68,0x09,0x3F,0x40,0x3F,0xA8,0x0A,0x1F,0x20,0x40,0x20,
+    0x1F,0xA8,0x0A,0x3F,0x40,0x38,0x40,0x3F,0xA8,0x0A,0x63,0x14,0x08,0x14,0x63,0xA8,
+    0x0A,0x07,0x08,0x70,0x08,0x07,0xA8,0x0A,0x61,0x51,0x49,0x45,0x43,0xA0,0x01,0x7F,
+    0x41,0xA8,0x0A,0x02,0x04,0x08,0x10,0x20,0x60,0x02,0x41,0x7F,0xA8,0x0A,0x04,0x02,
+    0x01,0x02,0x04,0x58,0x05,0x40,0xA0,0x02,0x01,0x02,0x04,0x68,0x09,0x20,0x54,0x78,
+    0xA8,0x09,0x7F,0x48,0x44,0x38,0x68,0x09,0x38,0x44,0x20,0x68,0x0A,0x38,0x44,0x48,
+    0x7F,0x68,0x09,0x38,0x54,0x18,0xA8,0x0A,0x08,0x7E,0x09,0x01,0x02,0x68,0x09,0x18,
+    0xA4,0x7C,0xA8,0x09,0x7F,0x08,0x04,0x78,0xA0,0x02,0x44,0x7D,0x40,0xA8,0x02,0x40,
+    0x80,0x84,0x7D,0xA8,0x02,0x7F,0x10,0x28,0x44,0xA0,0x02,0x41,0x7F,0x40,0xA8,0x0A,
+    0x7C,0x04,0x18,0x04,0x78,0xA8,0x09,0x7C,0x08,0x04,0x78,0x68,0x09,0x38,0x44,0x38,
+    0x68,0x09,0xFC,0x24,0x18,0x68,0x0A,0x18,0x24,0x18,0xFC,0xA8,0x09,0x7C,0x08,0x04,
+    0x08,0x68,0x09,0x48,0x54,0x20,0xA8,0x0A,0x04,0x3F,0x44,0x40,0x20,0x68,0x0A,0x3C,
+    0x40,0x20,0x7C,0xA8,0x0A,0x1C,0x20,0x40,0x20,0x1C,0xA8,0x0A,0x3C,0x40,0x30,0x40,
+    0x3C,0xA8,0x0A,0x44,0x28,0x10,0x28,0x44,0x68,0x09,0x1C,0xA0,0x7C,0xA8,0x0A,0x44,
+    0x64,0x54,0x4C,0x44,0xA0,0x02,0x08,0x36,0x41,0x80,0x00,0x7F,0xA0,0x02,0x41,0x36,
+    0x08,0xA8,0x0A,0x08,0x04,0x08,0x10,0x08,
+};
+static const oled_font_t font6x8 = {6, 1, 32, 95, font6x8_index, font6x8_data};
+
+/* 8x16 ASCII: 95个字形, 原始1520字节, 压缩后1108字节 (含索引) */
+static const uint16_t font8x16_index[] = {
+    0, 88, 163, 262, 349, 465, 575, 684, 769, 847, 932, 1018,
+};
+static const uint8_t font8x16_data[] = {
+    0x00,0x00,0x00,0x00,0x80,0x00,0x80,0x02,0xF8,0x33,0x30,0xA8,0x2A,0x00,0x00,0x10,
+    0x0C,0x06,0x10,0x0C,0x06,0xAA,0x2A,0x6A,0x1A,0x40,0xC0,0x78,0x40,0xC0,0x78,0x40,
+    0x04,0x3F,0x04,0x3F,0x04,0xA8,0x0A,0xE8,0x0A,0x70,0x88,0xFC,0x08,0x30,0x18,0x20,
+    0x21,0x1E,0x2A,0x0A,0xA8,0x2A,0xF0,0x08,0xF0,0xE0,0x18,0x21,0x1C,0x03,0x1E,0x21,
+    0x1E,0xA8,0x02,0xAA,0xAA,0xF0,0x08,0x88,0x70,0x1E,0x21,0x23,0x24,0x19,0x27,0x21,
+    0x10,0x2A,0x00,0x00,0x00,0x10,0x16,0x0E,0x80,0x2A,0x80,0x2A,0xE0,0x18,0x04,0x02,
+    0x07,0x18,0x20,0x40,0xA8,0x02,0xA8,0x02,0x02,0x04,0x18,0xE0,0x40,0x20,0x18,0x07,
+    0xA6,0x1A,0xA6,0x1A,0x40,0x80,0xF0,0x80,0x40,0x02,0x01,0x0F,0x01,0x02,0x80,0x00,
+    0x96,0x16,0xF0,0x01,0x1F,0x01,0x00,0x00,0x2A,0x00,0x80,0xB0,0x70,0x00,0x00,0x58,
+    0x55,0x01,0x00,0x00,0x18,0x00,0x30,0x00,0xAA,0xA8,0x02,0x80,0x60,0x18,0x04,0x60,
+    0x18,0x06,0x01,0xA8,0x29,0xA8,0x29,0xE0,0x10,0x08,0x10,0xE0,0x0F,0x10,0x20,0x10,
+    0x0F,0x98,0x00,0x98,0x06,0x10,0xF8,0x20,0x3F,0x20,0x68,0x29,0xA8,0x2A,0x70,0x08,
+    0x88,0x70,0x30,0x28,0x24,0x22,0x21,0x30,0xA8,0x29,0x68,0x29,0x30,0x08,0x88,0x48,
+    0x30,0x18,0x20,0x11,0x0E,0xA0,0x0A,0xA8,0x29,0xC0,0x20,0x10,0xF8,0x07,0x04,0x24,
+    0x3F,0x24,0xA8,0x19,0xA8,0x29,0xF8,0x08,0x88,0x08,0x19,0x21,0x20,0x11,0x0E,0xA8,
+    0x09,0xA8,0x29,0xE0,0x10,0x88,0x18,0x0F,0x11,0x20,0x11,0x0E,0x68,0x2A,0x80,0x00,
+    0x38,0x08,0xC8,0x38,0x08,0x3F,0xA8,0x29,0xA8,0x29,0x70,0x88,0x08,0x88,0x70,0x1C,
+    0x22,0x21,0x22,0x1C,0xA8,0x29,0xA0,0x29,0xE0,0x10,0x08,0x10,0xE0,0x31,0x22,0x11,
+    0x0F,0x80,0x01,0x80,0x01,0xC0,0x30,0x80,0x00,0xA0,0x00,0x80,0x80,0x60,0xA0,0x2A,
+    0xA8,0x2A,0x80,0x40,0x20,0x10,0x08,0x01,0x02,0x04,0x08,0x10,0x20,0x56,0x15,0x56,
+    0x15,0x40,0x04,0xA8,0x0A,0xA8,0x2A,0x08,0x10,0x20,0x40,0x80,0x20,0x10,0x08,0x04,
+    0x02,0x01,0xA8,0x25,0x80,0x0A,0x70,0x48,0x08,0xF0,0x30,0x36,0x01,0xAA,0x2A,0xAA,
+    0x2A,0xC0,0x30,0xC8,0x28,0xE8,0x10,0xE0,0x07,0x18,0x27,0x24,0x23,0x14,0x0B,0xA0,
+    0x02,0xAA,0xA9,0xC0,0x38,0xE0,0x20,0x3C,0x23,0x02,0x27,0x38,0x20,0x6A,0x09,0x6A,
+    0x29,0x08,0xF8,0x88,0x70,0x20,0x3F,0x20,0x11,0x0E,0x6A,0x25,0x6A,0x29,0xC0,0x30,
+    0x08,0x38,0x07,0x18,0x20,0x10,0x08,0x6A,0x29,0x6A,0x29,0x08,0xF8,0x08,0x10,0xE0,
+    0x20,0x3F,0x20,0x10,0x0F,0x6A,0x2A,0x6A,0x2A,0x08,0xF8,0x88,0xE8,0x08,0x10,0x20,
+    0x3F,0x20,0x23,0x20,0x18,0x6A,0x2A,0x2A,0x02,0x08,0xF8,0x88,0xE8,0x08,0x10,0x20,
+    0x3F,0x20,0x03,0x6A,0x09,0x6A,0x2A,0xC0,0x30,0x08,0x38,0x07,0x18,0x20,0x22,0x1E,
+    0x02,0x2A,0xA8,0xAA,0xA9,0x08,0xF8,0x08,0x08,0xF8,0x08,0x20,0x3F,0x21,0x01,0x21,
+    0x3F,0x20,0x98,0x06,0x98,0x06,0x08,0xF8,0x08,0x20,0x3F,0x20,0x60,0x1A,0x5A,0x02,
+    0x08,0xF8,0x08,0xC0,0x80,0x7F,0xAA,0x2A,0xAA,0x2A,0x08,0xF8,0x88,0xC0,0x28,0x18,
+    0x08,0x20,0x3F,0x20,0x01,0x26,0x38,0x20,0x2A,0x00,0x6A,0x25,0x08,0xF8,0x08,0x20,
+    0x3F,0x20,0x30,0x1A,0x26,0x8A,0x28,0x08,0xF8,0xF8,0x08,0x20,0x3F,0x3F,0x3F,0x20,
+    0xAA,0xA8,0x2A,0x2A,0x08,0xF8,0x30,0xC0,0x08,0xF8,0x08,0x20,0x3F,0x20,0x07,0x18,
+    0x3F,0x6A,0x29,0x6A,0x29,0xE0,0x10,0x08,0x10,0xE0,0x0F,0x10,0x20,0x10,0x0F,0x6A,
+    0x25,0xAA,0x05,0x08,0xF8,0x08,0xF0,0x20,0x3F,0x21,0x01,0x6A,0x29,0x6A,0x2A,0xE0,
+    0x10,0x08,0x10,0xE0,0x0F,0x18,0x24,0x38,0x50,0x4F,0x6A,0x25,0x2A,0xAA,0x08,0xF8,
+    0x88,0x70,0x20,0x3F,0x20,0x03,0x0C,0x30,0x20,0xA8,0x25,0xA8,0x29,0x70,0x88,0x08,
+    0x38,0x38,0x20,0x21,0x22,0x1C,0x9A,0x26,0xA0,0x02,0x18,0x08,0xF8,0x08,0x18,0x20,
+    0x3F,0x20,0x2A,0xA8,0x68,0x25,0x08,0xF8,0x08,0x08,0xF8,0x08,0x1F,0x20,0x1F,0x2A,
+    0xA8,0xA0,0x0A,0x08,0x78,0x88,0xC8,0x38,0x08,0x07,0x38,0x0E,0x01,0x8A,0x28,0x2A,
+    0x2A,0xF8,0x08,0xF8,0x08,0xF8,0x03,0x3C,0x07,0x07,0x3C,0x03,0xAA,0xA9,0xAA,0xA9,
+    0x08,0x18,0x68,0x80,0x68,0x18,0x08,0x20,0x30,0x2C,0x03,0x2C,0x30,0x20,0x2A,0x2A,
+    0xA0,0x02,0x08,0x38,0xC8,0xC8,0x38,0x08,0x20,0x3F,0x20,0x5A,0x2A,0xAA,0x26,0x10,
+    0x08,0xC8,0x38,0x08,0x20,0x38,0x26,0x21,0x20,0x18,0x80,0x16,0x80,0x16,0xFE,0x02,
+    0x7F,0x40,0xA8,0x00,0x80,0x2A,0x0C,0x30,0xC0,0x01,0x06,0x38,0xC0,0x58,0x02,0x58,
+    0x02,0x02,0xFE,0x40,0x7F,0xA0,0x25,0x00,0x00,0x04,0x02,0x04,0x00,0x00,0x56,0x55,
+    0x80,0x98,0x00,0x00,0x00,0x02,0x04,0x60,0x05,0xA8,0xA5,0x80,0x19,0x24,0x22,0x3F,
+    0x20,0x8A,0x01,0xA8,0x29,0x08,0xF8,0x80,0x3F,0x11,0x20,0x11,0x0E,0x80,0x05,0xA8,
+    0x25,0x80,0x0E,0x11,0x20,0x11,0x80,0x29,0xA8,0xA9,0x80,0x88,0xF8,0x0E,0x11,0x20,
+    0x10,0x3F,0x20,0x60,0x05,0x68,0x25,0x80,0x1F,0x22,0x13,0x98,0x96,0x98,0x06,0x80,
+    0xF0,0x88,0x18,0x20,0x3F,0x20,0x60,0x15,0x68,0x29,0x80,0x6B,0x94,0x93,0x60,0x8A,
+    0x05,0x2A,0xA8,0x08,0xF8,0x80,0x20,0x3F,0x21,0x20,0x3F,0x20,0x68,0x00,0x98,0x06,
+    0x80,0x98,0x20,0x3F,0x20,0x80,0x06,0x68,0x09,0x80,0x98,0xC0,0x80,0x7F,0x0A,0x16,
+    0xAA,0x2A,0x08,0xF8,0x80,0x20,0x3F,0x24,0x02,0x2D,0x30,0x20,0x98,0x00,0x98,0x06,
+    0x08,0xF8,0x20,0x3F,0x20,0x56,0x15,0x2A,0x8A,0x80,0x20,0x3F,0x20,0x3F,0x20,0x3F,
+    0x86,0x05,0x2A,0xA8,0x80,0x80,0x20,0x3F,0x21,0x20,0x3F,0x20,0x60,0x05,0x68,0x25,
+    0x80,0x1F,0x20,0x1F,0x86,0x01,0xAE,0x29,0x80,0x80,0x80,0xA1,0x20,0x11,0x0E,0x80,
+    0x15,0xA8,0xB9,0x80,0x0E,0x11,0x20,0xA0,0x80,0x16,0x16,0xA6,0x22,0x80,0x80,0x20,
+    0x3F,0x21,0x20,0x01,0x60,0x15,0x68,0x25,0x80,0x33,0x24,0x19,0x98,0x06,0x80,0x06,
+    0x80,0xE0,0x80,0x1F,0x20,0x06,0x18,0x68,0xA9,0x80,0x80,0x1F,0x20,0x10,0x3F,0x20,
+    0x16,0x58,0xA8,0x2A,0x80,0x80,0x01,0x0E,0x30,0x08,0x06,0x01,0x86,0x58,0xAA,0x2A,
+    0x80,0x80,0x80,0x0F,0x30,0x0C,0x03,0x0C,0x30,0x0F,0x18,0x16,0xA8,0x2A,0x80,0x80,
+    0x20,0x31,0x2E,0x0E,0x31,0x20,0x16,0x58,0xAA,0x2A,0x80,0x80,0x80,0x81,0x8E,0x70,
+    0x18,0x06,0x01,0x58,0x15,0xA8,0x2A,0x80,0x21,0x30,0x2C,0x22,0x21,0x30,0x00,0x6A,
+    0x00,0x68,0x80,0x7C,0x02,0x3F,0x40,0x00,0x03,0x00,0x03,0x98,0x02,0x98,0x00,0x02,
+    0x7C,0x80,0x40,0x3F,0x68,0x66,0x00,0x00,0x06,0x01,0x02,0x04,
 };
+static const oled_font_t font8x16 = {8, 2, 32, 95, font8x16_index, font8x16_data};
 
-/* 8x16 ASCII字符字库 */
-const unsigned char F8X16[] = {
-    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,// sp 0
-    0x00,0x00,0x00,0xF8,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x33,0x30,0x00,0x00,0x00,//! 1
-    0x00,0x10,0x0C,0x06,0x10,0x0C,0x06,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,//" 2
-    0x40,0xC0,0x78,0x40,0xC0,0x78,0x40,0x00,0x04,0x3F,0x04,0x04,0x3F,0x04,0x04,0x00,//# 3
-    0x00,0x70,0x88,0xFC,0x08,0x30,0x00,0x00,0x00,0x18,0x20,0xFF,0x21,0x1E,0x00,0x00,//$ 4
-    0xF0,0x08,0xF0,0x00,0xE0,0x18,0x00,0x00,0x00,0x21,0x1C,0x03,0x1E,0x21,0x1E,0x00,//% 5
-    0x00,0xF0,0x08,0x88,0x70,0x00,0x00,0x00,0x1E,0x21,0x23,0x24,0x19,0x27,0x21,0x10,//& 6
-    0x10,0x16,0x0E,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,//' 7
-    0x00,0x00,0x00,0xE0,0x18,0x04,0x02,0x00,0x00,0x00,0x00,0x07,0x18,0x20,0x40,0x00,//( 8
-    0x00,0x02,0x04,0x18,0xE0,0x00,0x00,0x00,0x00,0x40,0x20,0x18,0x07,0x00,0x00,0x00,//) 9
-    0x40,0x40,0x80,0xF0,0x80,0x40,0x40,0x00,0x02,0x02,0x01,0x0F,0x01,0x02,0x02,0x00,//* 10
-    0x00,0x00,0x00,0xF0,0x00,0x00,0x00,0x00,0x01,0x01,0x01,0x1F,0x01,0x01,0x01,0x00,//+ 11
-    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x80,0xB0,0x70,0x00,0x00,0x00,0x00,0x00,//, 12
-    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x01,0x01,0x01,0x01,0x01,0x01,0x01,//- 13
-    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x30,0x30,0x00,0x00,0x00,0x00,0x00,//. 14
-    0x00,0x00,0x00,0x00,0x80,0x60,0x18,0x04,0x00,0x60,0x18,0x06,0x01,0x00,0x00,0x00,/// 15
-    0x00,0xE0,0x10,0x08,0x08,0x10,0xE0,0x00,0x00,0x0F,0x10,0x20,0x20,0x10,0x0F,0x00,//0 16
-    0x00,0x10,0x10,0xF8,0x00,0x00,0x00,0x00,0x00,0x20,0x20,0x3F,0x20,0x20,0x00,0x00,//1 17
-    0x00,0x70,0x08,0x08,0x08,0x88,0x70,0x00,0x00,0x30,0x28,0x24,0x22,0x21,0x30,0x00,//2 18
-    0x00,0x30,0x08,0x88,0x88,0x48,0x30,0x00,0x00,0x18,0x20,0x20,0x20,0x11,0x0E,0x00,//3 19
-    0x00,0x00,0xC0,0x20,0x10,0xF8,0x00,0x00,0x00,0x07,0x04,0x24,0x24,0x3F,0x24,0x00,//4 20
-    0x00,0xF8,0x08,0x88,0x88,0x08,0x08,0x00,0x00,0x19,0x21,0x20,0x20,0x11,0x0E,0x00,//5 21
-    0x00,0xE0,0x10,0x88,0x88,0x18,0x00,0x00,0x00,0x0F,0x11,0x20,0x20,0x11,0x0E,0x00,//6 22
-    0x00,0x38,0x08,0x08,0xC8,0x38,0x08,0x00,0x00,0x00,0x00,0x3F,0x00,0x00,0x00,0x00,//7 23
-    0x00,0x70,0x88,0x08,0x08,0x88,0x70,0x00,0x00,0x1C,0x22,0x21,0x21,0x22,0x1C,0x00,//8 24
-    0x00,0xE0,0x10,0x08,0x08,0x10,0xE0,0x00,0x00,0x00,0x31,0x22,0x22,0x11,0x0F,0x00,//9 25
-    0x00,0x00,0x00,0xC0,0xC0,0x00,0x00,0x00,0x00,0x00,0x00,0x30,0x30,0x00,0x00,0x00,//: 26
-    0x00,0x00,0x00,0x80,0x00,0x00,0x00,0x00,0x00,0x00,0x80,0x60,0x00,0x00,0x00,0x00,//; 27
-    0x00,0x00,0x80,0x40,0x20,0x10,0x08,0x00,0x00,0x01,0x02,0x04,0x08,0x10,0x20,0x00,//< 28
-    0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x00,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x00,//= 29
-    0x00,0x08,0x10,0x20,0x40,0x80,0x00,0x00,0x00,0x20,0x10,0x08,0x04,0x02,0x01,0x00,//> 30
-    0x00,0x70,0x48,0x08,0x08,0x08,0xF0,0x00,0x00,0x00,0x00,0x30,0x36,0x01,0x00,0x00,//? 31
-    0xC0,0x30,0xC8,0x28,0xE8,0x10,0xE0,0x00,0x07,0x18,0x27,0x24,0x23,0x14,0x0B,0x00,//@ 32
-    0x00,0x00,0xC0,0x38,0xE0,0x00,0x00,0x00,0x20,0x3C,0x23,0x02,0x02,0x27,0x38,0x20,//A 33
-    0x08,0xF8,0x88,0x88,0x88,0x70,0x00,0x00,0x20,0x3F,0x20,0x20,0x20,0x11,0x0E,0x00,//B 34
-    0xC0,0x30,0x08,0x08,0x08,0x08,0x38,0x00,0x07,0x18,0x20,0x20,0x20,0x10,0x08,0x00,//C 35
-    0x08,0xF8,0x08,0x08,0x08,0x10,0xE0,0x00,0x20,0x3F,0x20,0x20,0x20,0x10,0x0F,0x00,//D 36
-    0x08,0xF8,0x88,0x88,0xE8,0x08,0x10,0x00,0x20,0x3F,0x20,0x20,0x23,0x20,0x18,0x00,//E 37
-    0x08,0xF8,0x88,0x88,0xE8,0x08,0x10,0x00,0x20,0x3F,0x20,0x00,0x03,0x00,0x00,0x00,//F 38
-    0xC0,0x30,0x08,0x08,0x08,0x38,0x00,0x00,0x07,0x18,0x20,0x20,0x22,0x1E,0x02,0x00,//G 39
-    0x08,0xF8,0x08,0x00,0x00,0x08,0xF8,0x08,0x20,0x3F,0x21,0x01,0x01,0x21,0x3F,0x20,//H 40
-    0x00,0x08,0x08,0xF8,0x08,0x08,0x00,0x00,0x00,0x20,0x20,0x3F,0x20,0x20,0x00,0x00,//I 41
-    0x00,0x00,0x08,0x08,0xF8,0x08,0x08,0x00,0xC0,0x80,0x80,0x80,0x7F,0x00,0x00,0x00,//J 42
-    0x08,0xF8,0x88,0xC0,0x28,0x18,0x08,0x00,0x20,0x3F,0x20,0x01,0x26,0x38,0x20,0x00,//K 43
-    0x08,0xF8,0x08,0x00,0x00,0x00,0x00,0x00,0x20,0x3F,0x20,0x20,0x20,0x20,0x30,0x00,//L 44
-    0x08,0xF8,0xF8,0x00,0xF8,0xF8,0x08,0x00,0x20,0x3F,0x00,0x3F,0x00,0x3F,0x20,0x00,//M 45
-    0x08,0xF8,0x30,0xC0,0x00,0x08,0xF8,0x08,0x20,0x3F,0x20,0x00,0x07,0x18,0x3F,0x00,//N 46
-    0xE0,0x10,0x08,0x08,0x08,0x10,0xE0,0x00,0x0F,0x10,0x20,0x20,0x20,0x10,0x0F,0x00,//O 47
-    0x08,0xF8,0x08,0x08,0x08,0x08,0xF0,0x00,0x20,0x3F,0x21,0x01,0x01,0x01,0x00,0x00,//P 48
-    0xE0,0x10,0x08,0x08,0x08,0x10,0xE0,0x00,0x0F,0x18,0x24,0x24,0x38,0x50,0x4F,0x00,//Q 49
-    0x08,0xF8,0x88,0x88,0x88,0x88,0x70,0x00,0x20,0x3F,0x20,0x00,0x03,0x0C,0x30,0x20,//R 50
-    0x00,0x70,0x88,0x08,0x08,0x08,0x38,0x00,0x00,0x38,0x20,0x21,0x21,0x22,0x1C,0x00,//S 51
-    0x18,0x08,0x08,0xF8,0x08,0x08,0x18,0x00,0x00,0x00,0x20,0x3F,0x20,0x00,0x00,0x00,//T 52
-    0x08,0xF8,0x08,0x00,0x00,0x08,0xF8,0x08,0x00,0x1F,0x20,0x20,0x20,0x20,0x1F,0x00,//U 53
-    0x08,0x78,0x88,0x00,0x00,0xC8,0x38,0x08,0x00,0x00,0x07,0x38,0x0E,0x01,0x00,0x00,//V 54
-    0xF8,0x08,0x00,0xF8,0x00,0x08,0xF8,0x00,0x03,0x3C,0x07,0x00,0x07,0x3C,0x03,0x00,//W 55
-    0x08,0x18,0x68,0x80,0x80,0x68,0x18,0x08,0x20,0x30,0x2C,0x03,0x03,0x2C,0x30,0x20,//X 56
-    0x08,0x38,0xC8,0x00,0xC8,0x38,0x08,0x00,0x00,0x00,0x20,0x3F,0x20,0x00,0x00,0x00,//Y 57
-    0x10,0x08,0x08,0x08,0xC8,0x38,0x08,0x00,0x20,0x38,0x26,0x21,0x20,0x20,0x18,0x00,//Z 58
-    0x00,0x00,0x00,0xFE,0x02,0x02,0x02,0x00,0x00,0x00,0x00,0x7F,0x40,0x40,0x40,0x00,//[ 59
-    0x00,0x0C,0x30,0xC0,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x01,0x06,0x38,0xC0,0x00,//\ 60
-    0x00,0x02,0x02,0x02,0xFE,0x00,0x00,0x00,0x00,0x40,0x40,0x40,0x7F,0x00,0x00,0x00,//] 61
-    0x00,0x00,0x04,0x02,0x02,0x02,0x04,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,//^ 62
-    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x80,0x80,0x80,0x80,0x80,0x80,0x80,0x80,//_ 63
-    0x00,0x02,0x02,0x04,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,//` 64
-    0x00,0x00,0x80,0x80,0x80,0x80,0x00,0x00,0x00,0x19,0x24,0x22,0x22,0x22,0x3F,0x20,//a 65
-    0x08,0xF8,0x00,0x80,0x80,0x00,0x00,0x00,0x00,0x3F,0x11,0x20,0x20,0x11,0x0E,0x00,//b 66
-    0x00,0x00,0x00,0x80,0x80,0x80,0x00,0x00,0x00,0x0E,0x11,0x20,0x20,0x20,0x11,0x00,//c 67
-    0x00,0x00,0x00,0x80,0x80,0x88,0xF8,0x00,0x00,0x0E,0x11,0x20,0x20,0x10,0x3F,0x20,//d 68
-    0x00,0x00,0x80,0x80,0x80,0x80,0x00,0x00,0x00,0x1F,0x22,0x22,0x22,0x22,0x13,0x00,//e 69
-    0x00,0x80,0x80,0xF0,0x88,0x88,0x88,0x18,0x00,0x20,0x20,0x3F,0x20,0x20,0x00,0x00,//f 70
-    0x00,0x00,0x80,0x80,0x80,0x80,0x80,0x00,0x00,0x6B,0x94,0x94,0x94,0x93,0x60,0x00,//g 71
-    0x08,0xF8,0x00,0x80,0x80,0x80,0x00,0x00,0x20,0x3F,0x21,0x00,0x00,0x20,0x3F,0x20,//h 72
-    0x00,0x80,0x98,0x98,0x00,0x00,0x00,0x00,0x00,0x20,0x20,0x3F,0x20,0x20,0x00,0x00,//i 73
-    0x00,0x00,0x00,0x80,0x98,0x98,0x00,0x00,0x00,0xC0,0x80,0x80,0x80,0x7F,0x00,0x00,//j 74
-    0x08,0xF8,0x00,0x00,0x80,0x80,0x80,0x00,0x20,0x3F,0x24,0x02,0x2D,0x30,0x20,0x00,//k 75
-    0x00,0x08,0x08,0xF8,0x00,0x00,0x00,0x00,0x00,0x20,0x20,0x3F,0x20,0x20,0x00,0x00,//l 76
-    0x80,0x80,0x80,0x80,0x80,0x80,0x80,0x00,0x20,0x3F,0x20,0x00,0x3F,0x20,0x00,0x3F,//m 77
-    0x80,0x80,0x00,0x80,0x80,0x80,0x00,0x00,0x20,0x3F,0x21,0x00,0x00,0x20,0x3F,0x20,//n 78
-    0x00,0x00,0x80,0x80,0x80,0x80,0x00,0x00,0x00,0x1F,0x20,0x20,0x20,0x20,0x1F,0x00,//o 79
-    0x80,0x80,0x00,0x80,0x80,0x00,0x00,0x00,0x80,0xFF,0xA1,0x20,0x20,0x11,0x0E,0x00,//p 80
-    0x00,0x00,0x00,0x80,0x80,0x80,0x80,0x00,0x00,0x0E,0x11,0x20,0x20,0xA0,0xFF,0x80,//q 81
-    0x80,0x80,0x80,0x00,0x80,0x80,0x80,0x00,0x20,0x20,0x3F,0x21,0x20,0x00,0x01,0x00,//r 82
-    0x00,0x00,0x80,0x80,0x80,0x80,0x80,0x00,0x00,0x33,0x24,0x24,0x24,0x24,0x19,0x00,//s 83
-    0x00,0x80,0x80,0xE0,0x80,0x80,0x00,0x00,0x00,0x00,0x00,0x1F,0x20,0x20,0x00,0x00,//t 84
-    0x80,0x80,0x00,0x00,0x00,0x80,0x80,0x00,0x00,0x1F,0x20,0x20,0x20,0x10,0x3F,0x20,//u 85
-    0x80,0x80,0x80,0x00,0x00,0x80,0x80,0x80,0x00,0x01,0x0E,0x30,0x08,0x06,0x01,0x00,//v 86
-    0x80,0x80,0x00,0x80,0x00,0x80,0x80,0x80,0x0F,0x30,0x0C,0x03,0x0C,0x30,0x0F,0x00,//w 87
-    0x00,0x80,0x80,0x00,0x80,0x80,0x80,0x00,0x00,0x20,0x31,0x2E,0x0E,0x31,0x20,0x00,//x 88
-    0x80,0x80,0x80,0x00,0x00,0x80,0x80,0x80,0x80,0x81,0x8E,0x70,0x18,0x06,0x01,0x00,//y 89
-    0x00,0x80,0x80,0x80,0x80,0x80,0x80,0x00,0x00,0x21,0x30,0x2C,0x22,0x21,0x30,0x00,//z 90
-    0x00,0x00,0x00,0x00,0x80,0x7C,0x02,0x02,0x00,0x00,0x00,0x00,0x00,0x3F,0x40,0x40,//{ 91
-    0x00,0x00,0x00,0x00,0xFF,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xFF,0x00,0x00,0x00,//| 92
-    0x00,0x02,0x02,0x7C,0x80,0x00,0x00,0x00,0x00,0x40,0x40,0x3F,0x00,0x00,0x00,0x00,//} 93
-    0x00,0x06,0x01,0x01,0x02,0x02,0x04,0x04,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,//~ 94
+/* 16x32 数字: 14个字形, 原始896字节, 压缩后336字节 (含索引) */
+static const uint16_t font16x32_index[] = {
+    0, 185,
+};
+static const uint8_t font16x32_data[] = {
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x60,0x55,0x55,0x55,0x00,0x00,0x00,0x00,
+    0x03,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x60,0x05,0x00,
+    0x00,0x0F,0x00,0x00,0x00,0x66,0x00,0x00,0x66,0x06,0x00,0x66,0x06,0x00,0x60,0x06,
+    0x00,0x00,0xC0,0x30,0xC0,0x3C,0x03,0xC0,0x3C,0x03,0x3C,0x03,0x00,0x60,0x05,0x00,
+    0x60,0x06,0x60,0x06,0xF0,0x00,0x00,0x0F,0x00,0x66,0x65,0x00,0xC0,0xFC,0x03,0x03,
+    0xFC,0x03,0x0C,0x03,0x00,0x60,0x00,0x00,0x60,0xF5,0x00,0x00,0x00,0xF0,0x00,0x00,
+    0x60,0x65,0x56,0x00,0xC0,0x03,0x0C,0x0F,0x0C,0x00,0x56,0x55,0x00,0x60,0x00,0x60,
+    0x06,0x00,0x66,0x66,0x00,0x60,0x56,0x55,0x06,0xC0,0x3F,0xC0,0x3F,0xC0,0x30,0x0C,
+    0x03,0x0F,0x0C,0x0F,0x00,0x56,0x55,0x00,0x60,0x60,0x65,0x06,0x60,0x00,0x60,0x06,
+    0x60,0x56,0x65,0x00,0xC0,0x0F,0xC0,0x30,0x0F,0xC0,0x03,0xFC,0x03,0x0C,0x03,0x00,
+    0x00,0x60,0x00,0x00,0x66,0xF6,0x00,0x60,0x56,0xF5,0x06,0x00,0x60,0x65,0x06,0xC0,
+    0xF0,0x0C,0x03,0x3F,0x30,0x30,0x0C,0x0F,0x0C,0x60,0x55,0x55,0x05,0xF0,0x60,0x05,
+    0x00,0x60,0x06,0x60,0x06,0x60,0x56,0x65,0x00,0xC0,0xC0,0xC3,0x03,0x03,0xFC,0x03,
+    0x0C,0x03,0x00,0x60,0x55,0x00,0x60,0x66,0x65,0x00,0xF0,0x06,0x60,0x06,0x00,0x66,
+    0x65,0x00,0xC0,0xFC,0x03,0xC0,0x03,0x03,0x03,0xFC,0x03,0x0C,0x03,0x60,0x55,0x55,
+    0x05,0x60,0x00,0x66,0x00,0x00,0xF0,0x00,0x00,0x00,0x60,0x00,0x00,0xC0,0x0F,0xF0,
+    0x0F,0x0F,0x00,0x56,0x55,0x00,0x60,0x06,0x60,0x06,0x60,0x66,0x65,0x06,0x60,0x56,
+    0x55,0x06,0xC0,0x3F,0xC0,0xC0,0x3F,0xF0,0x0C,0x03,0x0C,0xF0,0x03,0x0C,0x03,0x00,
+    0x60,0x05,0x00,0x60,0x06,0x60,0x06,0x00,0x66,0x65,0x0F,0x00,0x66,0x65,0x00,0xC0,
+    0xFC,0x03,0x03,0xFC,0x03,0x0C,0x03,0x0F,0x0C,0x03,0x00,0x00,0x00,0x00,0x00,0x60,
+    0x05,0x00,0x00,0x00,0x00,0x00,0x00,0x60,0x05,0x00,0xF0,0x0F,
+};
+static const oled_font_t font16x32 = {16, 4, 45, 14, font16x32_index, font16x32_data};
+
+/* 16x16 汉字: 31个字形, 原始992字节, 压缩后722字节 (含索引) */
+static const uint16_t font16x16_index[] = {
+    0, 134, 346, 569,
+};
+static const uint8_t font16x16_data[] = {
+    0xA0,0x96,0x96,0x02,0x2A,0x68,0xA9,0x02,0xFE,0x82,0x92,0xFE,0x92,0x82,0xFE,0x80,
+    0x60,0x1F,0x1E,0x12,0x1E,0x40,0x80,0x7F,0x56,0x55,0x55,0x15,0x00,0x00,0x00,0x00,
+    0x80,0x60,0x55,0x55,0x01,0x56,0x55,0x55,0x15,0x08,0x10,0x68,0x55,0x55,0x09,0x56,
+    0x55,0x55,0x15,0x04,0x84,0x04,0x20,0x68,0x69,0x69,0x09,0xA8,0x5A,0x69,0x09,0xFC,
+    0x04,0xFC,0x04,0xFC,0x04,0xFC,0x7F,0x28,0x24,0x23,0x20,0x21,0x22,0x7F,0x68,0xA9,
+    0x95,0x06,0x56,0x6A,0x95,0x16,0x02,0x42,0xC2,0x7E,0x42,0xC2,0x02,0x40,0x78,0x47,
+    0x40,0x7F,0x40,0x56,0xA5,0x5A,0x15,0xA8,0x0A,0xA8,0x0A,0x20,0x21,0x22,0x2C,0x20,
+    0x40,0x20,0x10,0x0C,0x03,0x01,0x02,0x04,0x18,0x60,0x80,0x56,0x95,0x00,0xC0,0x56,
+    0xD5,0x00,0xFE,0x82,0xFE,0x40,0xAA,0xAA,0x6A,0x0A,0xAA,0xAA,0xAA,0x2A,0x04,0x24,
+    0x44,0x84,0x64,0x9C,0x40,0x30,0x0F,0xC8,0x08,0x28,0x18,0x10,0x08,0x06,0x01,0x82,
+    0x4C,0x20,0x18,0x06,0x01,0x06,0x18,0x20,0x40,0x80,0xA6,0xA0,0xA2,0x09,0xA8,0xAA,
+    0xAA,0x2A,0x40,0x42,0xCC,0xFC,0x04,0x02,0xFC,0x04,0xFC,0x40,0x20,0x1F,0x20,0x40,
+    0x4F,0x44,0x42,0x40,0x7F,0x42,0x44,0x43,0x40,0xAA,0x6A,0x6D,0x29,0x30,0xAA,0x6A,
+    0x26,0x80,0x60,0xF8,0x07,0x04,0xE4,0x24,0x24,0xE4,0x04,0x80,0x81,0x45,0x29,0x11,
+    0x2F,0x41,0x81,0x80,0xA0,0x95,0x56,0x02,0xAA,0x95,0xA6,0x02,0xFE,0x22,0xFE,0x22,
+    0xFE,0x80,0x60,0x1F,0x02,0x7F,0x02,0x42,0x82,0x7F,0xAA,0xAA,0x68,0x09,0xC0,0x56,
+    0xD5,0x00,0x10,0x94,0x53,0x32,0x1E,0x32,0x52,0x10,0x7E,0x42,0x7E,0x49,0xAA,0xAA,
+    0x68,0x2A,0x6C,0x2A,0x68,0x2A,0x08,0xCC,0x4A,0x49,0x48,0x4A,0xCC,0x18,0x7F,0x88,
+    0x84,0x82,0xE0,0x12,0x52,0x92,0x7F,0x7E,0x88,0x84,0x82,0xE0,0x60,0x95,0x96,0x02,
+    0x56,0xA9,0x56,0x15,0x24,0xFC,0x22,0x23,0x22,0x02,0x42,0x82,0x7F,0x02,0x9A,0x86,
+    0xA9,0x1A,0xAA,0xA6,0x32,0x28,0x04,0x84,0xFC,0x84,0x04,0x84,0xE4,0x1C,0x84,0x04,
+    0x20,0x60,0x20,0x1F,0x10,0x04,0x02,0x01,0x01,0x06,0x20,0xA8,0x02,0x0A,0x2A,0x68,
+    0x95,0x28,0x80,0xE0,0x02,0x04,0x18,0x40,0x80,0x10,0x0C,0x03,0x3F,0x40,0x78,0x01,
+    0x0E,0xA8,0xAA,0xAA,0x0A,0x6A,0x96,0xA6,0x29,0x14,0xA4,0x44,0x24,0x34,0xAD,0x66,
+    0x24,0x94,0x04,0x44,0xA4,0x14,0x08,0x09,0x08,0x09,0xFD,0x09,0x0B,0x08,0x09,0x08,
+    0xA0,0xA9,0x6A,0x02,0xA6,0x69,0x69,0x1A,0xF8,0x08,0xF8,0x0C,0x0B,0x08,0xF8,0x08,
+    0xF8,0x40,0x7F,0x40,0x7F,0x40,0x7F,0x40,0x7F,0x40,0xAA,0xAA,0x96,0x06,0x6A,0x6D,
+    0xA9,0x2A,0x08,0x24,0x23,0x6A,0xAA,0x2A,0xAA,0x6A,0x2A,0xEA,0x02,0x10,0x11,0x15,
+    0x15,0x11,0x10,0x0F,0x30,0x40,0xF8,0x96,0xD6,0x56,0x19,0xAA,0xA6,0xA6,0x02,0x40,
+    0x7C,0x40,0x44,0x40,0x80,0x90,0x88,0x46,0x40,0x20,0x2F,0x10,0x08,0x04,0x02,0xAA,
+    0xAB,0xAA,0x29,0xAA,0x2A,0xAA,0x2A,0x90,0x52,0x34,0x10,0x10,0x34,0x52,0x80,0x70,
+    0x8F,0x08,0xF8,0x08,0x82,0x9A,0x56,0x63,0x22,0x52,0x8E,0x80,0x40,0x33,0x0C,0x33,
+    0x40,0x80,0xA6,0xA8,0x96,0x1A,0x80,0xAA,0xAA,0x1A,0x40,0x42,0xCC,0x40,0xA0,0x9E,
+    0x82,0x9E,0xA0,0x20,0x3F,0x90,0x88,0x40,0x43,0x2C,0x10,0x28,0x46,0x41,0x80,0xA8,
+    0xAA,0xAA,0x0A,0x96,0x56,0x95,0x16,0x17,0x15,0xD5,0x55,0x57,0x55,0x7D,0x55,0x57,
+    0x55,0xD5,0x15,0x17,0x40,0x7F,0x55,0x7F,0x40,0x68,0x89,0x55,0x1B,0x68,0x09,0xAA,
+    0x02,0xFC,0x84,0xFC,0x10,0x10,0x3F,0x10,0x3F,0x01,0x06,0x40,0x80,0x7F,0xA0,0x95,
+    0x56,0x02,0x66,0x95,0x56,0x19,0xFE,0x92,0xFE,0x92,0xFE,0x40,0x44,0x7F,0x44,0x40,
+    0xA6,0x8A,0x56,0x09,0xEA,0xAA,0xA5,0x25,0x24,0xA4,0xFE,0x23,0x22,0x3E,0x22,0x3E,
+    0x08,0x06,0x01,0x01,0x06,0x40,0x49,0x7F,0x49,0x41,0x56,0xA5,0xA9,0x15,0x00,0x30,
+    0x80,0x02,0x02,0xFE,0x02,0x42,0x82,0x02,0x01,0x06,0xA8,0xA2,0x55,0x02,0xAC,0xB2,
+    0xAA,0x2A,0xFE,0x22,0x5A,0x86,0xFE,0x92,0xFE,0x04,0x08,0x07,0x40,0x20,0x03,0x0C,
+    0x14,0x22,0x41,0x40,0x00,0xB0,0x55,0x01,0x56,0xA5,0x55,0x15,0x40,0x40,0x7F,0x40,
+    0xA8,0xA2,0x55,0x02,0xAC,0xB2,0xAA,0x2A,0xFE,0x22,0x5A,0x86,0xFE,0x92,0xFE,0x04,
+    0x08,0x07,0x40,0x20,0x03,0x0C,0x14,0x22,0x41,0x40,
 };
+static const oled_font_t font16x16 = {16, 2, 0, 31, font16x16_index, font16x16_data};
 
 #endif /* __OLED_FONT_H__ */
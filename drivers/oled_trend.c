@@ -0,0 +1,145 @@
+/*
+ * OLED趋势图
+ * 固定长度的历史环形缓冲, 每个样本占屏幕一列. 扫描式显示: 缓冲位置i固定画在第i列,
+ * 新样本到来只重画它所在的列和其后的一列空白 (扫描间隙), 不移动已画的曲线.
+ * 不用芯片的硬件滚动: 其步进跟随相位未知的帧时钟, 启停之间移动的列数不确定.
+ */
+#include "oled_trend.h"
+
+/**
+ * @brief 初始化趋势图, 无曲线, 历史为空
+ */
+void oled_trend_init(oled_trend_t *pt)
+{
+    rt_memset(pt, 0, sizeof(*pt));
+}
+
+/**
+ * @brief 添加一条曲线
+ * @param page0: 起始页
+ * @param pages: 页数
+ * @param vmin: 底行对应值
+ * @param vmax: 顶行对应值
+ */
+int oled_trend_add_trace(oled_trend_t *pt, uint8_t page0, uint8_t pages, int16_t vmin, int16_t vmax)
+{
+    oled_trace_t *tr;
+
+    if (pt->ntrace >= OLED_TREND_TRACES || pages == 0 || page0 + pages > OLED_PAGES || vmax <= vmin)
+        return -RT_ERROR;
+
+    tr = &pt->trace[pt->ntrace];
+    tr->page0 = page0;
+    tr->pages = pages;
+    tr->vmin = vmin;
+    tr->vmax = vmax;
+
+    if (pt->ntrace == 0 || page0 < pt->page0)
+        pt->page0 = page0;
+    if (pt->ntrace == 0 || page0 + pages - 1 > pt->page1)
+        pt->page1 = page0 + pages - 1;
+    pt->ntrace++;
+    return RT_EOK;
+}
+
+/**
+ * @brief 取第k新的样本, k=0为最新
+ * @return 样本各曲线的值, 不存在返回RT_NULL
+ */
+static const int16_t *oled_trend_sample(const oled_trend_t *pt, uint8_t k)
+{
+    if (k >= pt->count)
+        return RT_NULL;
+    return pt->hist[(uint8_t)(pt->head + OLED_TREND_LEN - 1 - k) % OLED_TREND_LEN];
+}
+
+/**
+ * @brief 值映射为曲线区内的行号, 0为顶行
+ */
+static int oled_trace_row(const oled_trace_t *tr, int16_t v)
+{
+    int h = tr->pages * 8;
+    int row;
+
+    if (v <= tr->vmin)
+        return h - 1;
+    if (v >= tr->vmax)
+        return 0;
+    row = (h - 1) - (int)(v - tr->vmin) * (h - 1) / (tr->vmax - tr->vmin);
+    return row;
+}
+
+/**
+ * @brief 绘制第x列, 显示第k新的样本, 与前一样本之间连竖线
+ * 最旧的位置是扫描间隙, 画成空白, 间隙后的一列也不与它相连.
+ */
+static void oled_trend_draw_col(const oled_trend_t *pt, uint8_t x, uint8_t k)
+{
+    const int16_t *cur = k < OLED_TREND_LEN - 1 ? oled_trend_sample(pt, k) : RT_NULL;
+    const int16_t *prev = k + 1 < OLED_TREND_LEN - 1 ? oled_trend_sample(pt, k + 1) : RT_NULL;
+    uint8_t col[OLED_PAGES] = {0};
+    uint8_t i;
+
+    for (i = 0; cur != RT_NULL && i < pt->ntrace; i++)
+    {
+        const oled_trace_t *tr = &pt->trace[i];
+        int r0, r1, r;
+
+        if (cur[i] == OLED_TREND_NONE)
+            continue;
+        r0 = r1 = oled_trace_row(tr, cur[i]);
+        if (prev != RT_NULL && prev[i] != OLED_TREND_NONE)
+        {
+            r = oled_trace_row(tr, prev[i]);
+            if (r < r0) r0 = r;
+            if (r > r1) r1 = r;
+        }
+        for (r = r0; r <= r1; r++)
+            col[tr->page0 + r / 8] |= 1 << (r % 8);
+    }
+
+    /* 一列宽的位图, 每页一个字节 */
+    oled_draw_bmp(x, pt->page0, x + 1, pt->page1 + 1, &col[pt->page0]);
+}
+
+/**
+ * @brief 记录一个样本, 显示中则绘制新列并把下一列擦成扫描间隙
+ * @param values: 各曲线的值, 无效值为 OLED_TREND_NONE
+ */
+void oled_trend_push(oled_trend_t *pt, const int16_t *values)
+{
+    uint8_t i;
+
+    for (i = 0; i < pt->ntrace; i++)
+        pt->hist[pt->head][i] = values[i];
+    pt->head = (pt->head + 1) % OLED_TREND_LEN;
+    if (pt->count < OLED_TREND_LEN)
+        pt->count++;
+
+    if (!pt->visible)
+        return;
+
+    /* 缓冲位置即列号: 最新样本在head前一列, head列为间隙 */
+    oled_trend_draw_col(pt, (pt->head + OLED_TREND_LEN - 1) % OLED_TREND_LEN, 0);
+    oled_trend_draw_col(pt, pt->head, OLED_TREND_LEN - 1);
+}
+
+/**
+ * @brief 显示趋势图: 按历史绘制整个曲线区, 第x列为缓冲位置x的样本
+ */
+void oled_trend_show(oled_trend_t *pt)
+{
+    uint8_t x;
+
+    for (x = 0; x < OLED_WIDTH; x++)
+        oled_trend_draw_col(pt, x, (pt->head + 2 * OLED_TREND_LEN - 1 - x) % OLED_TREND_LEN);
+    pt->visible = 1;
+}
+
+/**
+ * @brief 停止显示趋势图, 之后只记录历史
+ */
+void oled_trend_hide(oled_trend_t *pt)
+{
+    pt->visible = 0;
+}
@@ -0,0 +1,56 @@
+/*
+ * OLED趋势图
+ * 固定长度的历史环形缓冲, 每个样本占屏幕一列. 扫描式显示: 缓冲位置i固定画在第i列,
+ * 新样本到来只重画它所在的列和其后的一列空白 (扫描间隙), 不移动已画的曲线
+ */
+#ifndef __OLED_TREND_H__
+#define __OLED_TREND_H__
+
+#include <rtthread.h>
+#include "drv_oled.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OLED_TREND_LEN      OLED_WIDTH  /* 历史长度, 一屏宽; 位置与列一一对应 */
+#define OLED_TREND_TRACES   2           /* 最多曲线数 */
+#define OLED_TREND_NONE     (-32768)    /* 无效样本, 不画点 */
+
+/* 一条曲线: 占用连续若干页, 纵轴线性映射 [vmin, vmax] */
+typedef struct {
+    uint8_t  page0;                 /* 起始页 */
+    uint8_t  pages;                 /* 页数 */
+    int16_t  vmin;                  /* 底行对应值 */
+    int16_t  vmax;                  /* 顶行对应值 */
+} oled_trace_t;
+
+/*
+ * 趋势图: 所有曲线共用一个曲线区 (各曲线页的并集) 与一个历史缓冲.
+ * 不显示时 oled_trend_push() 只记录历史.
+ */
+typedef struct {
+    oled_trace_t trace[OLED_TREND_TRACES];
+    uint8_t  ntrace;
+    uint8_t  page0;                 /* 曲线区 */
+    uint8_t  page1;
+
+    int16_t  hist[OLED_TREND_LEN][OLED_TREND_TRACES];
+    uint8_t  head;                  /* 下一个样本的位置, 即扫描间隙所在列 */
+    uint8_t  count;                 /* 有效样本数 */
+
+    uint8_t  visible;
+} oled_trend_t;
+
+/* 函数声明 */
+void oled_trend_init(oled_trend_t *pt);
+int  oled_trend_add_trace(oled_trend_t *pt, uint8_t page0, uint8_t pages, int16_t vmin, int16_t vmax);
+void oled_trend_push(oled_trend_t *pt, const int16_t *values);
+void oled_trend_show(oled_trend_t *pt);
+void oled_trend_hide(oled_trend_t *pt);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __OLED_TREND_H__ */
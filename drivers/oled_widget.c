@@ -0,0 +1,123 @@
+/*
+ * OLED保留模式控件
+ * 基于drv_oled, 字段记住已绘制的内容, 只重绘变化的字符
+ */
+#include "oled_widget.h"
+
+/* 闪烁相位, 所有闪烁字段共用 */
+static uint8_t blink_phase = 0;
+
+/**
+ * @brief 初始化字段, 内容为空白
+ * @param hz: 0-8x16 ASCII字符, 1-16x16汉字字库索引
+ */
+void oled_field_init(oled_field_t *pf, uint8_t x, uint8_t y, uint8_t len, uint8_t hz)
+{
+    rt_memset(pf, 0, sizeof(*pf));
+    pf->x = x;
+    pf->y = y;
+    pf->len = len > OLED_FIELD_MAX ? OLED_FIELD_MAX : len;
+    pf->hz = hz;
+    rt_memset(pf->text, ' ', sizeof(pf->text));
+}
+
+/**
+ * @brief 设置字段内容, 不足部分补空格, 超出部分截断
+ */
+void oled_field_set_text(oled_field_t *pf, const char *text)
+{
+    uint8_t i;
+
+    for (i = 0; i < pf->len && text[i] != '\0'; i++)
+        pf->text[i] = text[i];
+    for (; i < pf->len; i++)
+        pf->text[i] = ' ';
+}
+
+/**
+ * @brief 设置字段中的一个字符
+ */
+void oled_field_set_char(oled_field_t *pf, uint8_t i, char ch)
+{
+    if (i < pf->len)
+        pf->text[i] = ch;
+}
+
+/**
+ * @brief 设置反显位图, 第i位对应第i个字符
+ */
+void oled_field_set_inv(oled_field_t *pf, uint16_t mask)
+{
+    pf->inv = mask;
+}
+
+/**
+ * @brief 设置闪烁状态
+ */
+void oled_field_set_blink(oled_field_t *pf, uint8_t on)
+{
+    pf->blink = on;
+}
+
+/**
+ * @brief 下次绘制时整体重绘 (字段区域被其他绘图覆盖后调用)
+ */
+void oled_field_invalidate(oled_field_t *pf)
+{
+    pf->drawn = 0;
+}
+
+/**
+ * @brief 设置闪烁相位, 相位为1时闪烁字段显示空白
+ */
+void oled_widget_set_phase(uint8_t phase)
+{
+    blink_phase = phase;
+}
+
+/**
+ * @brief 绘制字段中变化的字符
+ * @return 重绘的字符数, 无变化返回0
+ */
+int oled_field_render(oled_field_t *pf)
+{
+    uint8_t i, w = pf->hz ? 16 : 8, hidden = pf->blink && blink_phase;
+    uint16_t inv = hidden ? 0 : pf->inv;
+    int count = 0;
+
+    if (pf->gen != oled_fill_generation())
+    {
+        pf->gen = oled_fill_generation();
+        pf->drawn = 0;
+    }
+
+    for (i = 0; i < pf->len; i++)
+    {
+        char ch = hidden ? ' ' : pf->text[i];
+        uint8_t mode = (inv >> i) & 1;
+        uint8_t x = pf->x + i * w;
+
+        if (pf->drawn && ch == pf->shown[i] && mode == ((pf->shown_inv >> i) & 1))
+            continue;
+
+        if (!pf->hz)
+        {
+            oled_show_char(x, pf->y, ch, 16, mode);
+        }
+        else if (hidden)
+        {
+            /* 汉字字段的空白用两个ASCII空格 */
+            oled_show_char(x, pf->y, ' ', 16, 0);
+            oled_show_char(x + 8, pf->y, ' ', 16, 0);
+        }
+        else
+        {
+            oled_show_chinese(x, pf->y, (uint8_t)ch, mode);
+        }
+        pf->shown[i] = ch;
+        count++;
+    }
+    pf->shown_inv = inv;
+    pf->drawn = 1;
+    return count;
+}
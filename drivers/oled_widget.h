@@ -0,0 +1,54 @@
+/*
+ * OLED保留模式控件
+ * 基于drv_oled, 字段记住已绘制的内容, 只重绘变化的字符
+ */
+#ifndef __OLED_WIDGET_H__
+#define __OLED_WIDGET_H__
+
+#include <rtthread.h>
+#include "drv_oled.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OLED_FIELD_MAX      12      /* 字段最多字符数 */
+
+/*
+ * 文本字段: 一行8x16字符 (或16x16汉字), 位置固定.
+ * 设置内容与属性只改内存, oled_field_render() 对比上次绘制的结果,
+ * 只对变化的字符调用绘图函数; 屏幕被整屏清除后自动整体重绘.
+ */
+typedef struct {
+    uint8_t  x;                     /* 起始列 0~127 */
+    uint8_t  y;                     /* 起始页 0~7 (占两页) */
+    uint8_t  len;                   /* 字符数 */
+    uint8_t  hz;                    /* 1: 字符为16x16汉字字库索引 */
+
+    /* 期望内容 */
+    char     text[OLED_FIELD_MAX];
+    uint16_t inv;                   /* 反显位图, 第i位对应第i个字符 */
+    uint8_t  blink;                 /* 1: 闪烁相位为1时显示空白 */
+
+    /* 屏幕上的内容 */
+    char     shown[OLED_FIELD_MAX];
+    uint16_t shown_inv;
+    uint32_t gen;                   /* 绘制时的整屏填充次数 */
+    uint8_t  drawn;
+} oled_field_t;
+
+/* 函数声明 */
+void oled_field_init(oled_field_t *pf, uint8_t x, uint8_t y, uint8_t len, uint8_t hz);
+void oled_field_set_text(oled_field_t *pf, const char *text);
+void oled_field_set_char(oled_field_t *pf, uint8_t i, char ch);
+void oled_field_set_inv(oled_field_t *pf, uint16_t mask);
+void oled_field_set_blink(oled_field_t *pf, uint8_t on);
+void oled_field_invalidate(oled_field_t *pf);
+int  oled_field_render(oled_field_t *pf);
+void oled_widget_set_phase(uint8_t phase);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __OLED_WIDGET_H__ */
@@ -0,0 +1,210 @@
+/*
+ * 计步算法
+ * 逐样本输入三轴加速度, 合加速度经带通后做自适应阈值峰值检测,
+ * 连续若干步节奏一致才开始计数. 状态大小固定, 不依赖RT-Thread, 可在主机上回放.
+ */
+#include "pedometer.h"
+#include <string.h>
+
+/**
+ * @brief 整数平方根 (逐位确定, 16次迭代), 结果向下取整
+ */
+uint32_t pedo_isqrt(uint32_t un_x)
+{
+    uint32_t un_res = 0;
+    uint32_t un_bit = 1UL << 30;
+
+    while (un_bit > un_x)
+        un_bit >>= 2;
+    while (un_bit != 0)
+    {
+        if (un_x >= un_res + un_bit)
+        {
+            un_x -= un_res + un_bit;
+            un_res = (un_res >> 1) + un_bit;
+        }
+        else
+        {
+            un_res >>= 1;
+        }
+        un_bit >>= 2;
+    }
+    return un_res;
+}
+
+/**
+ * @brief 初始化计步状态, 基准步长为 PEDO_STRIDE_DEFAULT
+ */
+void pedo_init(pedo_t *pp)
+{
+    memset(pp, 0, sizeof(*pp));
+    maxim_bpf_design(&pp->bpf, (float)PEDO_FS, PEDO_BPF_LO_HZ, PEDO_BPF_HI_HZ);
+    pp->un_stride_base = PEDO_STRIDE_DEFAULT;
+    pp->un_stride_cm = PEDO_STRIDE_DEFAULT;
+}
+
+/**
+ * @brief 设置基准步频 PEDO_CADENCE_REF 下的步长
+ */
+void pedo_set_stride(pedo_t *pp, uint16_t un_base_cm)
+{
+    pp->un_stride_base = un_base_cm;
+}
+
+/**
+ * @brief 合加速度的模, 放大 1 << PEDO_MAG_SHIFT 倍, 与姿态无关
+ */
+static int32_t pedo_magnitude(int16_t n_x, int16_t n_y, int16_t n_z)
+{
+    uint32_t un_sum = (uint32_t)((int32_t)n_x * n_x) + (uint32_t)((int32_t)n_y * n_y) +
+                      (uint32_t)((int32_t)n_z * n_z);
+
+    /* 约8g以内先放大再开方保留小数位, 更大时先开方再放大 */
+    if (un_sum < (1UL << (32 - 2 * PEDO_MAG_SHIFT)))
+        return (int32_t)pedo_isqrt(un_sum << (2 * PEDO_MAG_SHIFT));
+    return (int32_t)(pedo_isqrt(un_sum) << PEDO_MAG_SHIFT);
+}
+
+/**
+ * @brief 步长估计: 步长随步频近似线性增长, 基准步频下等于基准步长,
+ *        系数限制在0.6~1.6倍
+ */
+static uint16_t pedo_stride(const pedo_t *pp)
+{
+    int32_t n_k = PEDO_CADENCE_REF + pp->un_cadence;      /* 相对 2*PEDO_CADENCE_REF */
+
+    if (n_k < PEDO_CADENCE_REF * 2 * 6 / 10)
+        n_k = PEDO_CADENCE_REF * 2 * 6 / 10;
+    if (n_k > PEDO_CADENCE_REF * 2 * 16 / 10)
+        n_k = PEDO_CADENCE_REF * 2 * 16 / 10;
+    return (uint16_t)((uint32_t)pp->un_stride_base * n_k / (PEDO_CADENCE_REF * 2));
+}
+
+/**
+ * @brief 记入n步, 按当前步长累计距离
+ */
+static void pedo_count(pedo_t *pp, int32_t n_steps)
+{
+    pp->un_cadence = (uint16_t)(60 * PEDO_FS * 16 / pp->n_interval_x16);
+    pp->un_stride_cm = pedo_stride(pp);
+    pp->un_steps += n_steps;
+    pp->un_distance_cm += (uint32_t)n_steps * pp->un_stride_cm;
+}
+
+/**
+ * @brief 新的峰: 按间隔做节奏验证
+ * @return 本次记入的步数
+ */
+static int32_t pedo_on_peak(pedo_t *pp, uint32_t un_idx)
+{
+    int32_t n_dt = (int32_t)(un_idx - pp->un_last_peak);
+    int8_t ch_first = !pp->ch_have_peak;
+
+    pp->ch_have_peak = 1;
+    pp->un_last_peak = un_idx;
+
+    if (ch_first || n_dt > PEDO_MAX_INTERVAL)
+    {
+        /* 从这个峰重新开始搜索 */
+        pp->ch_counting = 0;
+        pp->n_pending = 1;
+        pp->n_last_interval = 0;
+        pp->un_cadence = 0;
+        return 0;
+    }
+
+    if (pp->ch_counting)
+    {
+        pp->n_interval_x16 += (n_dt * 16 - pp->n_interval_x16) >> 2;
+        pedo_count(pp, 1);
+        return 1;
+    }
+
+    /* 搜索态: 与上一间隔相差超过一半视为节奏不一致 */
+    if (pp->n_last_interval != 0 &&
+        (n_dt * 2 < pp->n_last_interval || n_dt > pp->n_last_interval * 2 - pp->n_last_interval / 2))
+    {
+        pp->n_pending = 1;
+        pp->n_last_interval = n_dt;
+        return 0;
+    }
+    if (pp->n_last_interval == 0)
+        pp->n_interval_x16 = n_dt * 16;
+    else
+        pp->n_interval_x16 += (n_dt * 16 - pp->n_interval_x16) >> 2;
+    pp->n_last_interval = n_dt;
+
+    if (++pp->n_pending < PEDO_CONFIRM_STEPS)
+        return 0;
+
+    pp->ch_counting = 1;
+    pedo_count(pp, pp->n_pending);
+    return pp->n_pending;
+}
+
+/**
+ * @brief 输入一个样本 (全分辨率, 4mg/LSB)
+ * 越过阈值开始一段, 回落到0以下时确认段内最大值为峰;
+ * 距上一峰不足 PEDO_MIN_INTERVAL 的段忽略.
+ * @return 本样本记入的步数 (确认节奏时可能一次补记多步)
+ */
+int32_t pedo_push(pedo_t *pp, int16_t n_x, int16_t n_y, int16_t n_z)
+{
+    int32_t n_m = pedo_magnitude(n_x, n_y, n_z);
+    int32_t n_f, n_th, n_ret = 0;
+    uint32_t un_idx = pp->un_count++;
+
+    if (!pp->ch_primed)
+    {
+        maxim_bpf_reset(&pp->bpf, n_m);
+        pp->ch_primed = 1;
+    }
+    n_f = maxim_bpf_step(&pp->bpf, n_m);
+
+    n_th = pp->n_amp >> PEDO_AMP_SHIFT;
+    if (n_th < PEDO_MIN_AMP)
+        n_th = PEDO_MIN_AMP;
+
+    if (pp->ch_in_seg)
+    {
+        if (n_f > pp->n_seg_max)
+        {
+            pp->n_seg_max = n_f;
+            pp->un_seg_max_idx = un_idx;
+        }
+        if (n_f < 0)
+        {
+            pp->ch_in_seg = 0;
+            pp->n_amp += (pp->n_seg_max - pp->n_amp) >> 2;
+            n_ret = pedo_on_peak(pp, pp->un_seg_max_idx);
+        }
+    }
+    else if (n_f > n_th && (!pp->ch_have_peak || un_idx - pp->un_last_peak >= PEDO_MIN_INTERVAL))
+    {
+        pp->ch_in_seg = 1;
+        pp->n_seg_max = n_f;
+        pp->un_seg_max_idx = un_idx;
+    }
+
+    /* 停止行走: 步频清零, 峰高均值逐渐衰减以便识别较轻的步伐 */
+    if (pp->ch_have_peak && un_idx - pp->un_last_peak > PEDO_MAX_INTERVAL)
+    {
+        pp->ch_counting = 0;
+        pp->un_cadence = 0;
+    }
+    if (!pp->ch_in_seg && (!pp->ch_have_peak || un_idx - pp->un_last_peak > PEDO_IDLE_DECAY))
+        pp->n_amp -= pp->n_amp >> 6;
+
+    return n_ret;
+}
+
+/**
+ * @brief 获取计步结果
+ */
+void pedo_get_result(const pedo_t *pp, pedo_result_t *pr)
+{
+    pr->un_steps = pp->un_steps;
+    pr->un_distance_cm = pp->un_distance_cm;
+    pr->un_cadence = pp->un_cadence;
+    pr->un_stride_cm = pp->ch_counting ? pp->un_stride_cm : pp->un_stride_base;
+}
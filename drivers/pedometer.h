@@ -0,0 +1,87 @@
+/*
+ * 计步算法
+ * 逐样本输入三轴加速度, 合加速度经带通后做自适应阈值峰值检测,
+ * 连续若干步节奏一致才开始计数. 状态大小固定, 不依赖RT-Thread, 可在主机上回放.
+ */
+#ifndef __PEDOMETER_H__
+#define __PEDOMETER_H__
+
+#include <rtthread.h>
+#include <stdint.h>
+#include "algorithm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PEDO_FS                 100         /* 采样频率, 与ADXL345输出速率一致 */
+#define PEDO_LSB_PER_G          256         /* 全分辨率模式 */
+#define PEDO_MAG_SHIFT          4           /* 合加速度放大16倍保留小数 */
+
+#define PEDO_BPF_LO_HZ          0.6f        /* 去掉重力与姿态变化 */
+#define PEDO_BPF_HI_HZ          4.0f        /* 步频上限约240步/分 */
+
+#define PEDO_MIN_AMP            ((PEDO_LSB_PER_G * 8 / 100) << PEDO_MAG_SHIFT) /* 最小峰高0.08g */
+#define PEDO_AMP_SHIFT          1           /* 阈值 = 近期峰高均值 >> 1 */
+#define PEDO_IDLE_DECAY         (PEDO_FS * 2)   /* 超过2秒无峰后峰高均值逐渐衰减 */
+
+#define PEDO_MIN_INTERVAL       (PEDO_FS / 4)   /* 步间隔0.25s~2s, 即30~240步/分 */
+#define PEDO_MAX_INTERVAL       (PEDO_FS * 2)
+#define PEDO_CONFIRM_STEPS      4           /* 连续4步节奏一致后开始计数, 之前的步补记 */
+
+#define PEDO_CADENCE_REF        100         /* 步长基准对应的步频 (步/分) */
+#define PEDO_STRIDE_DEFAULT     70          /* 默认基准步长 (cm) */
+
+/*
+ * 计步状态
+ * 搜索态: 峰间隔在范围内且与上一间隔相差不超过一半时累积待确认步,
+ * 否则从当前峰重新开始; 累积到 PEDO_CONFIRM_STEPS 步后一次补记并进入计数态.
+ * 计数态: 每个间隔合规的峰记一步; 超过 PEDO_MAX_INTERVAL 无峰回到搜索态.
+ */
+typedef struct {
+    maxim_bpf_t bpf;
+    uint32_t un_count;              /* 已输入样本数 */
+    int8_t   ch_primed;             /* 带通已按首个样本预置 */
+
+    /* 峰值检测 */
+    int32_t  n_amp;                 /* 峰高滑动平均 */
+    int8_t   ch_in_seg;             /* 处于越阈段中 */
+    int32_t  n_seg_max;
+    uint32_t un_seg_max_idx;
+    uint32_t un_last_peak;          /* 上一个峰的样本序号 */
+    int8_t   ch_have_peak;
+
+    /* 节奏验证 */
+    int8_t   ch_counting;
+    int32_t  n_pending;             /* 搜索态中的待确认步数 */
+    int32_t  n_last_interval;       /* 上一间隔 (样本) */
+    int32_t  n_interval_x16;        /* 步间隔滑动平均, x16 */
+
+    /* 输出 */
+    uint32_t un_steps;
+    uint32_t un_distance_cm;
+    uint16_t un_cadence;            /* 步/分, 未在行走时为0 */
+    uint16_t un_stride_cm;          /* 当前步长估计 */
+    uint16_t un_stride_base;        /* 基准步频下的步长 (cm) */
+} pedo_t;
+
+/* 计步结果 */
+typedef struct {
+    uint32_t un_steps;
+    uint32_t un_distance_cm;
+    uint16_t un_cadence;
+    uint16_t un_stride_cm;
+} pedo_result_t;
+
+/* 函数声明 */
+void pedo_init(pedo_t *pp);
+void pedo_set_stride(pedo_t *pp, uint16_t un_base_cm);
+int32_t pedo_push(pedo_t *pp, int16_t n_x, int16_t n_y, int16_t n_z);
+void pedo_get_result(const pedo_t *pp, pedo_result_t *pr);
+uint32_t pedo_isqrt(uint32_t un_x);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PEDOMETER_H__ */
@@ -0,0 +1,233 @@
+/*
+ * 体温预测
+ * 一阶指数过程按等间隔分块平均后满足 B[j] = a·B[j-L] + (1-a)·Teq, a = e^(-L·Tb/τ).
+ * 对窗口内 x = B[j-L], y = B[j] - B[j-L] 做最小二乘, 斜率 k = a-1,
+ * y = 0 处即平衡温度. 升温与降温 (摘下探头) 都适用.
+ * 分块平均消除DS18B20的量化台阶, 拟合只在每块结束时做一次.
+ */
+#include "temp_predict.h"
+#include <string.h>
+#include <math.h>
+
+#define BLK(pt, j)  ((pt)->af_blk[(j) % TP_NBLK])
+
+/**
+ * @brief 初始化预测状态
+ */
+void tp_init(tp_t *pt)
+{
+    memset(pt, 0, sizeof(*pt));
+}
+
+/**
+ * @brief 从第un_start块开始新的曲线
+ */
+static void tp_restart(tp_t *pt, uint32_t un_start)
+{
+    pt->un_start = un_start;
+    pt->ch_bad = 0;
+    pt->ch_flat = 0;
+    pt->ch_hist_n = 0;
+    pt->ch_confident = 0;
+    pt->f_tau = 0.0f;
+    pt->f_k_lock = 0.0f;
+}
+
+/**
+ * @brief 对当前曲线窗口内的样本对求直线 y = k·x + c
+ * @param f_k_fix: 非0时斜率取该值, 只求截距; 接近平衡时x分布很窄, 斜率已无法重新估计
+ * @param pf_se: 非NULL时返回平衡温度 -c/k 的标准误差 (°C)
+ * @return 样本对个数, x分布不足时为0
+ */
+static int tp_fit(const tp_t *pt, float f_k_fix, float *pf_k, float *pf_c, float *pf_se)
+{
+    uint32_t j, un_first = pt->un_start + TP_LAG;
+    float f_mx = 0.0f, f_my = 0.0f, f_sxx = 0.0f, f_sxy = 0.0f, f_syy = 0.0f, f_x, f_y, f_s2;
+    int n = 0;
+
+    if (pt->un_blk > TP_NBLK && un_first < pt->un_blk - TP_NBLK + TP_LAG)
+        un_first = pt->un_blk - TP_NBLK + TP_LAG;
+    if (un_first + TP_MIN_PAIRS > pt->un_blk)
+        return 0;
+
+    for (j = un_first; j < pt->un_blk; j++)
+    {
+        f_mx += BLK(pt, j - TP_LAG);
+        f_my += BLK(pt, j) - BLK(pt, j - TP_LAG);
+        n++;
+    }
+    f_mx /= n;
+    f_my /= n;
+    for (j = un_first; j < pt->un_blk; j++)
+    {
+        f_x = BLK(pt, j - TP_LAG) - f_mx;
+        f_y = BLK(pt, j) - BLK(pt, j - TP_LAG) - f_my;
+        f_sxx += f_x * f_x;
+        f_sxy += f_x * f_y;
+        f_syy += f_y * f_y;
+    }
+    if (f_k_fix != 0.0f)
+    {
+        *pf_k = f_k_fix;
+        *pf_c = f_my - f_k_fix * f_mx;
+        if (pf_se != NULL)
+        {
+            /* Teq = mx - my/k: 斜率已知, 只剩截距的误差 */
+            f_s2 = (f_syy - 2.0f * f_k_fix * f_sxy + f_k_fix * f_k_fix * f_sxx) / (n > 1 ? n - 1 : 1);
+            *pf_se = sqrtf((f_s2 > 0.0f ? f_s2 : 0.0f) / (n * f_k_fix * f_k_fix));
+        }
+        return n;
+    }
+    /* x的方差不足 (0.05°C)^2 时无法区分斜率 */
+    if (f_sxx <= n * 0.0025f)
+        return 0;
+    *pf_k = f_sxy / f_sxx;
+    *pf_c = f_my - *pf_k * f_mx;
+    if (pf_se != NULL)
+    {
+        /* Teq = mx - my/k: 截距与斜率两项误差 */
+        f_s2 = (f_syy - *pf_k * f_sxy) / (n > 2 ? n - 2 : 1);
+        if (f_s2 < 0.0f)
+            f_s2 = 0.0f;
+        *pf_se = sqrtf(f_s2 / (n * *pf_k * *pf_k) +
+                       f_my * f_my * f_s2 / (*pf_k * *pf_k * *pf_k * *pf_k * f_sxx));
+    }
+    return n;
+}
+
+/**
+ * @brief 一个块结束: 检查曲线是否被打断, 重新拟合并更新可信标志
+ */
+static void tp_block_done(tp_t *pt, float f_blk)
+{
+    uint32_t j = pt->un_blk;
+    float f_k, f_c, f_min, f_max, f_sum, f_d, f_tau, f_pred, f_se;
+    uint8_t i;
+
+    BLK(pt, j) = f_blk;
+    pt->un_blk++;
+    if (j == 0)
+    {
+        tp_restart(pt, 0);
+        return;
+    }
+
+    /* 平衡且没有在走的曲线时开始变化 (佩戴/摘下): 从这一块重新开始 */
+    f_d = f_blk - BLK(pt, j - 1);
+    if (pt->ch_flat && pt->f_tau == 0.0f &&
+        (fabsf(f_d) > TP_STEP_C || (j >= TP_LAG && fabsf(f_blk - BLK(pt, j - TP_LAG)) > TP_STEP_C)))
+        tp_restart(pt, j);
+    /* 连续两块明显偏离当前曲线: 从偏离处重新开始 */
+    else if (j >= pt->un_start + TP_LAG && tp_fit(pt, 0.0f, &f_k, &f_c, NULL) && f_k < 0.0f &&
+             fabsf(f_blk - BLK(pt, j - TP_LAG) - (f_k * BLK(pt, j - TP_LAG) + f_c)) > TP_RESID_C)
+    {
+        if (++pt->ch_bad >= 2)
+            tp_restart(pt, j - 1);
+    }
+    else
+    {
+        pt->ch_bad = 0;
+    }
+
+    if (j >= pt->un_start + TP_LAG)
+    {
+        f_d = f_blk - BLK(pt, j - TP_LAG);
+        pt->ch_flat = f_d <= TP_FLAT_C && f_d >= -TP_FLAT_C;
+    }
+
+    pt->f_tau = 0.0f;
+    f_pred = f_blk;
+    f_se = 0.0f;
+    if (tp_fit(pt, pt->f_k_lock, &f_k, &f_c, &f_se) > 0 && f_k < 0.0f && f_k > -1.0f)
+    {
+        f_tau = -(float)(TP_LAG * TP_BLOCK_MS) / 1000.0f / logf(1.0f + f_k);
+        if (f_tau >= TP_TAU_MIN_S && f_tau <= TP_TAU_MAX_S)
+        {
+            pt->f_tau = f_tau;
+            f_pred = -f_c / f_k;
+        }
+    }
+    /* 接近平衡时x的分布变窄, 拟合变差; 已平衡就直接用块均值 */
+    if (pt->ch_flat && (pt->f_tau == 0.0f || f_se > TP_SE_C))
+    {
+        pt->f_tau = 0.0f;
+        f_pred = f_blk;
+        f_se = 0.0f;
+    }
+    /* 既没有有效拟合也未平衡: 没有可用的预测 */
+    if (pt->f_tau == 0.0f && !pt->ch_flat)
+    {
+        pt->ch_hist_n = 0;
+        pt->ch_confident = 0;
+        return;
+    }
+
+    /* 最近几块的预测足够一致才可信 */
+    if (pt->ch_hist_n < TP_HIST)
+        pt->ch_hist_n++;
+    for (i = TP_HIST - 1; i > 0; i--)
+        pt->af_hist[i] = pt->af_hist[i - 1];
+    pt->af_hist[0] = f_pred;
+
+    /* 输出取最近几块预测的均值 */
+    f_min = f_max = f_sum = pt->af_hist[0];
+    for (i = 1; i < pt->ch_hist_n; i++)
+    {
+        if (pt->af_hist[i] < f_min) f_min = pt->af_hist[i];
+        if (pt->af_hist[i] > f_max) f_max = pt->af_hist[i];
+        f_sum += pt->af_hist[i];
+    }
+    pt->f_pred = f_sum / pt->ch_hist_n;
+    /* 已可信时放宽一倍, 避免显示在预测值与原始读数之间来回跳 */
+    f_d = pt->ch_confident ? 2.0f : 1.0f;
+    /* 慢曲线早期的拟合可能整体偏移而历史一致, 须等剩余升温足够小 */
+    pt->ch_confident = pt->ch_hist_n == TP_HIST && f_max - f_min <= TP_STABLE_C * f_d && f_se <= TP_SE_C * f_d &&
+                       (float)(j - pt->un_start) * (TP_BLOCK_MS / 1000.0f) >= TP_MIN_TAUS * pt->f_tau;
+    /* 首次可信时锁定斜率 (时间常数), 此后只随读数修正平衡温度 */
+    if (pt->ch_confident && pt->f_k_lock == 0.0f && pt->f_tau != 0.0f)
+        pt->f_k_lock = f_k;
+}
+
+/**
+ * @brief 输入一个读数
+ * 读数中断超过两个块 (长时间漏读) 时丢弃已有的块重新开始.
+ * @param n_raw: 温度 (1/16°C)
+ * @param un_time_ms: 读出时刻 (毫秒)
+ */
+void tp_push(tp_t *pt, int16_t n_raw, uint32_t un_time_ms)
+{
+    if (pt->ch_valid && un_time_ms - pt->un_last_ms > 2 * TP_BLOCK_MS)
+        tp_init(pt);
+    if (!pt->ch_valid)
+    {
+        pt->ch_valid = 1;
+        pt->un_blk_ms = un_time_ms;
+    }
+    pt->un_last_ms = un_time_ms;
+    pt->n_last = n_raw;
+
+    if (un_time_ms - pt->un_blk_ms >= TP_BLOCK_MS && pt->un_n > 0)
+    {
+        tp_block_done(pt, pt->l_sum / 16.0f / pt->un_n);
+        pt->l_sum = 0;
+        pt->un_n = 0;
+        pt->un_blk_ms += TP_BLOCK_MS;
+        if (un_time_ms - pt->un_blk_ms >= TP_BLOCK_MS)
+            pt->un_blk_ms = un_time_ms;
+    }
+    pt->l_sum += n_raw;
+    pt->un_n++;
+}
+
+/**
+ * @brief 获取预测结果; 不可信时预测值为最新读数
+ */
+void tp_get_result(const tp_t *pt, tp_result_t *pr)
+{
+    float f_p = pt->ch_confident ? pt->f_pred : pt->n_last / 16.0f;
+
+    pr->f_pred_c = f_p;
+    pr->f_tau_s = pt->f_tau;
+    pr->ch_confident = pt->ch_confident;
+    pr->n_pred_x10 = (int16_t)(f_p >= 0.0f ? f_p * 10.0f + 0.5f : f_p * 10.0f - 0.5f);
+}
@@ -0,0 +1,70 @@
+/*
+ * 体温预测
+ * 接触式探头升温到平衡需要数分钟. 按块平均读数后拟合指数升温曲线
+ * T(t) = Teq - (Teq - T0)·e^(-t/τ), 提前给出平衡温度的预测与可信标志.
+ * 状态大小固定, 不依赖RT-Thread, 可在主机上回放.
+ */
+#ifndef __TEMP_PREDICT_H__
+#define __TEMP_PREDICT_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TP_BLOCK_MS         6000        /* 读数按6秒分块平均, 与分辨率(读数间隔)无关 */
+#define TP_NBLK             32          /* 保留的块数, 拟合窗口192秒 */
+#define TP_LAG              8           /* 拟合 B[j] 与 B[j-TP_LAG] 的线性关系 (块) */
+#define TP_MIN_PAIRS        4           /* 给出预测所需的最少样本对 */
+#define TP_HIST             4           /* 预测值稳定性检查的长度 (块) */
+#define TP_STABLE_C         0.1f        /* 最近TP_HIST次预测的极差上限 (°C) */
+#define TP_SE_C             0.05f       /* 预测的标准误差上限 (°C) */
+#define TP_RESID_C          0.15f       /* 残差超过该值视为曲线被打断 (摘下/重新佩戴) */
+#define TP_STEP_C           0.08f       /* 平衡后相邻块变化超过该值视为开始升/降温 */
+#define TP_FLAT_C           0.06f       /* 一个滞后内变化不超过该值视为已平衡 */
+#define TP_TAU_MIN_S        3.0f        /* 合理的时间常数范围 (秒) */
+#define TP_TAU_MAX_S        900.0f
+#define TP_MIN_TAUS         1.5f        /* 曲线持续不足该倍数的时间常数时不可信: 剩余升温大, τ的小误差也会放大 */
+
+/* 预测状态 */
+typedef struct {
+    float    af_blk[TP_NBLK];       /* 块均值 (°C), 环形 */
+    uint32_t un_blk;                /* 已完成的块数 */
+    uint32_t un_start;              /* 当前曲线的起始块 */
+    int32_t  l_sum;                 /* 当前块的读数和 (1/16°C) */
+    uint16_t un_n;                  /* 当前块的读数个数 */
+    uint32_t un_blk_ms;             /* 当前块的起始时刻 */
+    uint32_t un_last_ms;
+    int16_t  n_last;                /* 最新读数 */
+    uint8_t  ch_valid;              /* 已有读数 */
+    uint8_t  ch_bad;                /* 连续大残差次数 */
+    uint8_t  ch_flat;               /* 已平衡 */
+
+    float    af_hist[TP_HIST];      /* 最近的预测值 */
+    uint8_t  ch_hist_n;
+
+    float    f_pred;                /* 预测的平衡温度 (°C) */
+    float    f_tau;                 /* 拟合的时间常数 (秒), 无效时为0 */
+    float    f_k_lock;              /* 首次可信时锁定的斜率, 此后只拟合平衡温度; 0为未锁定 */
+    uint8_t  ch_confident;
+} tp_t;
+
+/* 预测结果 */
+typedef struct {
+    float    f_pred_c;
+    float    f_tau_s;
+    int16_t  n_pred_x10;            /* 放大10倍, 与ds18b20_get_temp一致 */
+    uint8_t  ch_confident;
+} tp_result_t;
+
+/* 函数声明 */
+void tp_init(tp_t *pt);
+void tp_push(tp_t *pt, int16_t n_raw, uint32_t un_time_ms);
+void tp_get_result(const tp_t *pt, tp_result_t *pr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TEMP_PREDICT_H__ */
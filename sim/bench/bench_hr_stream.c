@@ -0,0 +1,239 @@
+/*
+ * 心率血氧: 整窗重算 与 流式计算 的开销和一致性对比
+ *
+ *   bench_hr_stream [-t 信号时长s] [-r 重复次数] [-a 最低一致率%]
+ *
+ * 输入由PPG合成器生成 (50Hz, 心率/血氧分段变化). 整窗算法按驱动的用法
+ * 每50个样本移动150点窗口并重算一次; 流式算法逐样本输入. 流式结果每次刷新时,
+ * 对同一150点窗口运行整窗算法, 心率、血氧及有效标志须完全相同.
+ * 4点平滑与带通两种前端各测一遍; 一致率低于 -a (默认100%) 时返回1.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "algorithm.h"
+#include "ppg_synth.h"
+#include "bench.h"
+
+#define BLOCK       50
+
+struct result
+{
+    int32_t hr, spo2;
+    int8_t  hr_valid, spo2_valid;
+};
+
+static uint32_t *ir_in, *red_in;
+static double   *hr_true, *spo2_true;
+
+static void make_signal(int n)
+{
+    static const double hr_steps[] = {72, 64, 88, 110, 135, 96, 78, 120, 58, 100};
+    static const double spo2_steps[] = {98, 97, 99, 96, 95, 98, 97, 94, 99, 96};
+    struct ppg_synth s;
+    int i;
+
+    ppg_synth_init(&s, FS);
+    for (i = 0; i < n; i++)
+    {
+        int seg = (i / (FS * 30)) % 10;
+        s.hr_bpm = hr_steps[seg];
+        s.spo2 = spo2_steps[seg];
+        ppg_synth_next(&s, &red_in[i], &ir_in[i]);
+        hr_true[i] = s.hr_bpm;
+        spo2_true[i] = s.spo2;
+    }
+}
+
+static uint64_t run_batch(int n, struct result *out)
+{
+    static uint32_t ir[BUFFER_SIZE], red[BUFFER_SIZE];
+    uint64_t t0, cycles = 0;
+    int i, k;
+
+    for (i = 0; i + BLOCK <= n; i += BLOCK)
+    {
+        t0 = bench_cycles();
+        memmove(ir, ir + BLOCK, sizeof(uint32_t) * (BUFFER_SIZE - BLOCK));
+        memmove(red, red + BLOCK, sizeof(uint32_t) * (BUFFER_SIZE - BLOCK));
+        for (k = 0; k < BLOCK; k++)
+        {
+            ir[BUFFER_SIZE - BLOCK + k] = ir_in[i + k];
+            red[BUFFER_SIZE - BLOCK + k] = red_in[i + k];
+        }
+        if (i + BLOCK >= BUFFER_SIZE)
+        {
+            struct result *r = &out[i / BLOCK];
+            maxim_heart_rate_and_oxygen_saturation(ir, BUFFER_SIZE, red,
+                    &r->spo2, &r->spo2_valid, &r->hr, &r->hr_valid);
+        }
+        cycles += bench_cycles() - t0;
+    }
+    return cycles;
+}
+
+static uint64_t run_stream(int n, int use_bpf, int *upd_at, struct result *upd, int *updates)
+{
+    static maxim_stream_t st;
+    maxim_bpf_t bpf;
+    uint64_t t0;
+    int i;
+
+    /* 逐样本调用太短, 整段计时 (含记录结果, 可忽略) */
+    *updates = 0;
+    t0 = bench_cycles();
+    maxim_stream_init(&st);
+    if (use_bpf)
+    {
+        maxim_bpf_design(&bpf, FS, MAXIM_BPF_LO_HZ, MAXIM_BPF_HI_HZ);
+        maxim_stream_set_bpf(&st, &bpf);
+    }
+    for (i = 0; i < n; i++)
+    {
+        if (maxim_stream_add_sample(&st, ir_in[i], red_in[i]))
+        {
+            struct result *r = &upd[*updates];
+            maxim_stream_get_result(&st, &r->spo2, &r->spo2_valid, &r->hr, &r->hr_valid);
+            upd_at[(*updates)++] = i;
+        }
+    }
+    return bench_cycles() - t0;
+}
+
+/* 在流式结果刷新的时刻对同一窗口做整窗计算, 逐项比较; 返回整窗计算的周期数 */
+static uint64_t check_stream(int updates, const int *upd_at, const struct result *upd,
+                             int *same, double *err)
+{
+    uint64_t t0, cycles = 0;
+    int u, valid = 0;
+
+    *same = 0;
+    *err = 0;
+    for (u = 0; u < updates; u++)
+    {
+        int t0_idx = upd_at[u] + 1 - BUFFER_SIZE;
+        struct result b;
+
+        t0 = bench_cycles();
+        maxim_heart_rate_and_oxygen_saturation(ir_in + t0_idx, BUFFER_SIZE, red_in + t0_idx,
+                &b.spo2, &b.spo2_valid, &b.hr, &b.hr_valid);
+        cycles += bench_cycles() - t0;
+
+        if (b.hr == upd[u].hr && b.hr_valid == upd[u].hr_valid &&
+            b.spo2 == upd[u].spo2 && b.spo2_valid == upd[u].spo2_valid)
+            (*same)++;
+        else if (*same + 10 > u)
+            fprintf(stderr, "mismatch at sample %d: batch hr %d/%d spo2 %d/%d, stream hr %d/%d spo2 %d/%d\n",
+                    upd_at[u], b.hr, b.hr_valid, b.spo2, b.spo2_valid,
+                    upd[u].hr, upd[u].hr_valid, upd[u].spo2, upd[u].spo2_valid);
+        if (upd[u].hr_valid)
+        {
+            valid++;
+            *err += abs(upd[u].hr - (int32_t)hr_true[upd_at[u]]);
+        }
+    }
+    if (valid)
+        *err /= valid;
+    return cycles;
+}
+
+int main(int argc, char **argv)
+{
+    static const char *fe_name[] = {"ma4", "bpf"};
+    int seconds = 600, repeat = 5, opt, fe;
+    int n, blocks, i, rep, updates = 0, same = 0;
+    double min_agree = 100.0, agree, s_err = 0;
+    struct result *rb, *upd;
+    int *upd_at;
+    uint64_t cyc_b, cyc_s, cyc_c, c;
+    int b_valid;
+    double b_err;
+    maxim_bpf_t bpf;
+    int ret = 0;
+
+    while ((opt = getopt(argc, argv, "t:r:a:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 't': seconds = atoi(optarg); break;
+        case 'r': repeat = atoi(optarg); break;
+        case 'a': min_agree = atof(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-t seconds] [-r repeat] [-a min agreement %%]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    n = seconds * FS;
+    blocks = n / BLOCK;
+    ir_in = malloc(sizeof(uint32_t) * n);
+    red_in = malloc(sizeof(uint32_t) * n);
+    hr_true = malloc(sizeof(double) * n);
+    spo2_true = malloc(sizeof(double) * n);
+    rb = calloc(blocks, sizeof(*rb));
+    upd = calloc(n, sizeof(*upd));
+    upd_at = calloc(n, sizeof(*upd_at));
+    make_signal(n);
+
+    printf("signal: %d s, %d samples @ %d Hz, best of %d runs\n", seconds, n, FS, repeat);
+    printf("%-10s %14s %14s %12s %14s\n", "engine", "cycles/sample", "cycles/update", "updates/s", "HR |err| bpm");
+
+    for (fe = 0; fe < 2; fe++)
+    {
+        if (fe)
+            maxim_bpf_design(&bpf, FS, MAXIM_BPF_LO_HZ, MAXIM_BPF_HI_HZ);
+        maxim_set_bpf(fe ? &bpf : RT_NULL);
+
+        /* 取多次运行中的最小值 */
+        cyc_b = cyc_s = cyc_c = UINT64_MAX;
+        for (rep = 0; rep < repeat; rep++)
+        {
+            c = run_batch(n, rb);
+            if (c < cyc_b) cyc_b = c;
+            c = run_stream(n, fe, upd_at, upd, &updates);
+            if (c < cyc_s) cyc_s = c;
+            c = check_stream(updates, upd_at, upd, &same, &s_err);
+            if (c < cyc_c) cyc_c = c;
+        }
+
+        b_valid = 0;
+        b_err = 0;
+        for (i = BUFFER_SIZE / BLOCK - 1; i < blocks; i++)
+        {
+            if (rb[i].hr_valid)
+            {
+                b_valid++;
+                b_err += abs(rb[i].hr - (int32_t)hr_true[i * BLOCK + BLOCK - 1]);
+            }
+        }
+
+        /* 整窗@刷新: 整窗算法在流式结果刷新的时刻重算同一窗口的开销 */
+        printf("%s:\n", fe_name[fe]);
+        printf("  %-8s %14.1f %14.0f %12.2f %14.2f\n", "batch", (double)cyc_b / n,
+               (double)cyc_b / (blocks - 2), (double)FS / BLOCK, b_valid ? b_err / b_valid : 0);
+        printf("  %-8s %14.1f %14.0f %12.2f %14s\n", "batch@upd", (double)cyc_c / n,
+               updates ? (double)cyc_c / updates : 0, (double)updates / seconds, "-");
+        printf("  %-8s %14.1f %14.0f %12.2f %14.2f\n", "stream", (double)cyc_s / n,
+               updates ? (double)cyc_s / updates : 0, (double)updates / seconds, s_err);
+
+        agree = updates ? 100.0 * same / updates : 0;
+        printf("  agreement: %d/%d updates identical to batch on the same window (%.1f%%)\n",
+               same, updates, agree);
+        if (agree < min_agree)
+        {
+            printf("  FAIL: agreement below %.1f%%\n", min_agree);
+            ret = 1;
+        }
+    }
+    maxim_set_bpf(RT_NULL);
+
+    free(ir_in);
+    free(red_in);
+    free(hr_true);
+    free(spo2_true);
+    free(rb);
+    free(upd);
+    free(upd_at);
+    return ret;
+}
@@ -0,0 +1,183 @@
+/*
+ * 峰值检测: 原 "越阈检测 + 按幅度排序剔除近峰 + 再排序" 与 单遍检测 的开销对比
+ *
+ *   bench_peaks [-r 重复次数]
+ *
+ * 原实现检测阶段最多保留15个峰; 为比较长窗口下的真实开销, 另测一个去掉
+ * 上限的版本 (两次插入排序和剔除均为O(峰数^2)). 输入为合成PPG经带通
+ * 前端后的信号, 窗口长度从3秒到16分钟.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "algorithm.h"
+#include "ppg_synth.h"
+#include "bench.h"
+
+#define HOLD_OFF_RISE   4
+#define HOLD_OFF_AFTER  8
+
+/* 原实现的检测阶段, n_cap为保留的最多峰数 */
+static void ref_peaks_above_min_height(int32_t *pn_locs, int32_t *n_npks, const int32_t *pn_x,
+        int32_t n_size, int32_t n_min_height, int32_t n_cap)
+{
+    int32_t i = 1, riseFound = 0, holdOff1 = 0, holdOff2 = 0;
+    *n_npks = 0;
+
+    while (i < n_size - 1)
+    {
+        if (holdOff2 == 0)
+        {
+            if (pn_x[i] > n_min_height && pn_x[i] > pn_x[i - 1])
+                riseFound = 1;
+            if (riseFound == 1)
+            {
+                if ((pn_x[i] < n_min_height) && (holdOff1 < HOLD_OFF_RISE))
+                {
+                    riseFound = 0;
+                    holdOff1 = 0;
+                }
+                else if (holdOff1 == HOLD_OFF_RISE)
+                {
+                    if ((pn_x[i] < n_min_height) && (pn_x[i - 1] >= n_min_height))
+                    {
+                        if ((*n_npks) < n_cap)
+                            pn_locs[(*n_npks)++] = i;
+                        holdOff1 = 0;
+                        riseFound = 0;
+                        holdOff2 = HOLD_OFF_AFTER;
+                    }
+                }
+                else
+                {
+                    holdOff1++;
+                }
+            }
+        }
+        else
+        {
+            holdOff2--;
+        }
+        i++;
+    }
+}
+
+static void ref_sort_indices_descend(const int32_t *pn_x, int32_t *pn_indx, int32_t n_size)
+{
+    int32_t i, j, n_temp;
+
+    for (i = 1; i < n_size; i++)
+    {
+        n_temp = pn_indx[i];
+        for (j = i; j > 0 && pn_x[n_temp] > pn_x[pn_indx[j - 1]]; j--)
+            pn_indx[j] = pn_indx[j - 1];
+        pn_indx[j] = n_temp;
+    }
+}
+
+static void ref_remove_close_peaks(int32_t *pn_locs, int32_t *pn_npks, const int32_t *pn_x,
+        int32_t n_min_distance)
+{
+    int32_t i, j, n_old_npks, n_dist;
+
+    ref_sort_indices_descend(pn_x, pn_locs, *pn_npks);
+    for (i = -1; i < *pn_npks; i++)
+    {
+        n_old_npks = *pn_npks;
+        *pn_npks = i + 1;
+        for (j = i + 1; j < n_old_npks; j++)
+        {
+            n_dist = pn_locs[j] - (i == -1 ? -1 : pn_locs[i]);
+            if (n_dist > n_min_distance || n_dist < -n_min_distance)
+                pn_locs[(*pn_npks)++] = pn_locs[j];
+        }
+    }
+    maxim_sort_ascend(pn_locs, *pn_npks);
+}
+
+static void ref_find_peaks(int32_t *pn_locs, int32_t *n_npks, const int32_t *pn_x,
+        int32_t n_size, int32_t n_min_height, int32_t n_cap)
+{
+    ref_peaks_above_min_height(pn_locs, n_npks, pn_x, n_size, n_min_height, n_cap);
+    ref_remove_close_peaks(pn_locs, n_npks, pn_x, 4);
+}
+
+static volatile int32_t sink;
+
+int main(int argc, char **argv)
+{
+    static const int seconds[] = {3, 12, 60, 240, 960};
+    int repeat = 20, opt, n_max, n, i, rep;
+    unsigned s;
+    int32_t *x, *locs;
+    uint32_t red, ir;
+    struct ppg_synth syn;
+    maxim_bpf_t bpf;
+
+    while ((opt = getopt(argc, argv, "r:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 'r': repeat = atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-r repeat]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    n_max = seconds[sizeof(seconds) / sizeof(seconds[0]) - 1] * FS;
+    x = malloc(sizeof(int32_t) * n_max);
+    locs = malloc(sizeof(int32_t) * n_max);
+
+    ppg_synth_init(&syn, FS);
+    syn.hrv = 0.05;
+    syn.noise = 60;
+    maxim_bpf_design(&bpf, FS, MAXIM_BPF_LO_HZ, MAXIM_BPF_HI_HZ);
+    for (i = 0; i < n_max; i++)
+    {
+        syn.hr_bpm = 60 + (i / (FS * 20)) % 6 * 15;
+        ppg_synth_next(&syn, &red, &ir);
+        x[i] = (int32_t)ir;
+    }
+    maxim_bpf_reset(&bpf, x[0]);
+    maxim_bpf_process(&bpf, x, n_max);
+    for (i = 0; i < n_max; i++)
+        x[i] = -x[i];
+
+    printf("%8s %8s | %-22s | %-22s | %-22s\n", "window", "samples",
+           "capped (15) cyc/smp pk", "uncapped cyc/smp pk", "single-pass cyc/smp pk");
+    for (s = 0; s < sizeof(seconds) / sizeof(seconds[0]); s++)
+    {
+        uint64_t best[3] = {UINT64_MAX, UINT64_MAX, UINT64_MAX}, t0, c;
+        int32_t npks[3];
+
+        n = seconds[s] * FS;
+        for (rep = 0; rep < repeat; rep++)
+        {
+            t0 = bench_cycles();
+            ref_find_peaks(locs, &npks[0], x, n, 30, 15);
+            c = bench_cycles() - t0;
+            if (c < best[0]) best[0] = c;
+            sink += locs[0];
+
+            t0 = bench_cycles();
+            ref_find_peaks(locs, &npks[1], x, n, 30, n);
+            c = bench_cycles() - t0;
+            if (c < best[1]) best[1] = c;
+            sink += locs[0];
+
+            t0 = bench_cycles();
+            maxim_find_peaks(locs, &npks[2], x, n, 30, MAXIM_PEAK_REFRACTORY, n);
+            c = bench_cycles() - t0;
+            if (c < best[2]) best[2] = c;
+            sink += locs[0];
+        }
+        printf("%7ds %8d | %13.1f %8d | %13.1f %8d | %13.1f %8d\n", seconds[s], n,
+               (double)best[0] / n, npks[0], (double)best[1] / n, npks[1], (double)best[2] / n, npks[2]);
+    }
+
+    free(x);
+    free(locs);
+    return 0;
+}
@@ -0,0 +1,352 @@
+/*
+ * PPG前端: 4点移动平均 与 定点带通滤波 的开销和检测准确度对比
+ *
+ *   bench_ppg_filter [-t 每段信号时长s] [-r 重复次数] [-f 记录文件.csv]
+ *
+ * 开销: 对150点窗口做前端处理的每样本周期数 (整块 / 逐样本).
+ * 准确度: 同一信号分别用两种前端跑整窗算法 (每50个样本一次) 和流式算法,
+ * 统计心率有效率、与真值的误差. 合成信号按场景叠加基线漂移、宽带噪声
+ * 和肢体运动伪迹; 记录文件每行 "red,ir[,心率真值]", 无真值列时只比较有效率.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include "algorithm.h"
+#include "ppg_synth.h"
+#include "bench.h"
+
+#define BLOCK       50
+
+struct scenario
+{
+    const char *name;
+    int32_t     noise;          /* 白噪声 (LSB) */
+    int32_t     wander;         /* 0.2Hz基线漂移 (LSB) */
+    double      motion;         /* 运动伪迹: 基线阶跃与8Hz抖动幅度 (LSB) */
+};
+
+static const struct scenario scenarios[] = {
+    {"clean",    20,    0,    0},
+    {"wander",   20, 1500,    0},
+    {"noise",   120,    0,    0},
+    {"motion",   40,  800,  400},
+};
+
+struct score
+{
+    int     windows;
+    int     valid;
+    int     within5;
+    double  err;
+    int     spo2_valid;
+    double  spo2_err;
+};
+
+static uint32_t *ir_in, *red_in;
+static double   *hr_true, *spo2_true;
+static int      n_in, has_truth;
+
+static uint32_t clamp18(double v)
+{
+    if (v < 0) return 0;
+    if (v > 0x3FFFF) return 0x3FFFF;
+    return (uint32_t)v;
+}
+
+static void make_signal(const struct scenario *sc, int n)
+{
+    static const double hr_steps[] = {72, 64, 88, 110, 135, 96, 78, 120, 58, 100};
+    static const double spo2_steps[] = {98, 97, 99, 96, 95, 98, 97, 94, 99, 96};
+    struct ppg_synth s;
+    double step = 0, tremor_phase = 0;
+    int i;
+
+    ppg_synth_init(&s, FS);
+    s.noise = sc->noise;
+    s.wander = sc->wander;
+    s.hrv = 0.03;
+    srand(1);
+    for (i = 0; i < n; i++)
+    {
+        int seg = (i / (FS * 30)) % 10;
+        uint32_t red, ir;
+        double m = 0;
+
+        s.hr_bpm = hr_steps[seg];
+        s.spo2 = spo2_steps[seg];
+        ppg_synth_next(&s, &red, &ir);
+
+        if (sc->motion > 0)
+        {
+            /* 平均每4秒一次基线阶跃, 以0.5s时间常数恢复; 叠加8Hz抖动 */
+            if (rand() % (FS * 4) == 0)
+                step += sc->motion * 4 * ((rand() % 2001) / 1000.0 - 1.0);
+            step *= 1.0 - 1.0 / (FS * 0.5);
+            tremor_phase += 8.0 / FS;
+            m = step + sc->motion * 0.5 * sin(2 * M_PI * tremor_phase);
+        }
+        ir_in[i] = clamp18(ir + m);
+        red_in[i] = clamp18(red + m * 95000 / 110000);
+        hr_true[i] = s.hr_bpm;
+        spo2_true[i] = s.spo2;
+    }
+    n_in = n;
+    has_truth = 1;
+}
+
+static int load_csv(const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    char line[128];
+    int cap = 0, n = 0;
+
+    if (fp == NULL)
+        return -1;
+    has_truth = 1;
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        unsigned long red, ir;
+        double hr;
+        int cols = sscanf(line, "%lu,%lu,%lf", &red, &ir, &hr);
+
+        if (cols < 2)
+            continue;
+        if (n == cap)
+        {
+            cap = cap ? cap * 2 : 4096;
+            ir_in = realloc(ir_in, sizeof(uint32_t) * cap);
+            red_in = realloc(red_in, sizeof(uint32_t) * cap);
+            hr_true = realloc(hr_true, sizeof(double) * cap);
+            spo2_true = realloc(spo2_true, sizeof(double) * cap);
+        }
+        red_in[n] = (uint32_t)red & 0x3FFFF;
+        ir_in[n] = (uint32_t)ir & 0x3FFFF;
+        hr_true[n] = cols >= 3 ? hr : 0;
+        spo2_true[n] = 0;
+        if (cols < 3)
+            has_truth = 0;
+        n++;
+    }
+    fclose(fp);
+    n_in = n;
+    return n;
+}
+
+static void score_add(struct score *sc, int t, int32_t hr, int8_t hr_valid, int32_t spo2, int8_t spo2_valid)
+{
+    sc->windows++;
+    if (hr_valid)
+    {
+        double e = fabs(hr - hr_true[t]);
+
+        sc->valid++;
+        sc->err += e;
+        sc->within5 += e <= 5;
+    }
+    if (spo2_valid)
+    {
+        sc->spo2_valid++;
+        sc->spo2_err += fabs(spo2 - spo2_true[t]);
+    }
+}
+
+/* 与驱动相同: 每50个样本移动150点窗口重算 */
+static void run_window(const maxim_bpf_t *pf, struct score *sc)
+{
+    static uint32_t ir[BUFFER_SIZE], red[BUFFER_SIZE];
+    int32_t hr, spo2;
+    int8_t hr_valid, spo2_valid;
+    int i;
+
+    maxim_set_bpf(pf);
+    for (i = BUFFER_SIZE; i <= n_in; i += BLOCK)
+    {
+        memcpy(ir, ir_in + i - BUFFER_SIZE, sizeof(ir));
+        memcpy(red, red_in + i - BUFFER_SIZE, sizeof(red));
+        maxim_heart_rate_and_oxygen_saturation(ir, BUFFER_SIZE, red, &spo2, &spo2_valid, &hr, &hr_valid);
+        score_add(sc, i - 1, hr, hr_valid, spo2, spo2_valid);
+    }
+    maxim_set_bpf(RT_NULL);
+}
+
+static void run_stream(const maxim_bpf_t *pf, struct score *sc)
+{
+    static maxim_stream_t st;
+    int32_t hr, spo2;
+    int8_t hr_valid, spo2_valid;
+    int i;
+
+    maxim_stream_init(&st);
+    maxim_stream_set_bpf(&st, pf);
+    for (i = 0; i < n_in; i++)
+    {
+        maxim_stream_add_sample(&st, ir_in[i], red_in[i]);
+        if (i + 1 >= BUFFER_SIZE && (i + 1) % BLOCK == 0)
+        {
+            maxim_stream_get_result(&st, &spo2, &spo2_valid, &hr, &hr_valid);
+            score_add(sc, i, hr, hr_valid, spo2, spo2_valid);
+        }
+    }
+}
+
+/* 4点平滑前端, 与整窗算法中的写法相同 */
+static void frontend_ma4(int32_t *x, const uint32_t *ir, int n)
+{
+    uint32_t mean = 0;
+    int k;
+
+    for (k = 0; k < n; k++)
+        mean += ir[k];
+    mean /= n;
+    for (k = 0; k < n; k++)
+        x[k] = -1 * (int32_t)(ir[k] - mean);
+    for (k = 0; k < n - MA4_SIZE; k++)
+        x[k] = (x[k] + x[k + 1] + x[k + 2] + x[k + 3]) / 4;
+}
+
+static void frontend_bpf(maxim_bpf_t *pf, int32_t *x, const uint32_t *ir, int n)
+{
+    uint32_t mean = 0;
+    int k;
+
+    for (k = 0; k < n; k++)
+    {
+        mean += ir[k];
+        x[k] = (int32_t)ir[k];
+    }
+    maxim_bpf_reset(pf, (int32_t)(mean / n));
+    maxim_bpf_process(pf, x, n);
+    for (k = 0; k < n; k++)
+        x[k] = -x[k];
+}
+
+static volatile int32_t sink;
+
+static void bench_cost(maxim_bpf_t *pf, int repeat)
+{
+    static int32_t x[BUFFER_SIZE];
+    uint64_t t0, c, best_ma = UINT64_MAX, best_bpf = UINT64_MAX, best_step = UINT64_MAX;
+    int windows = (n_in - BUFFER_SIZE) / BLOCK + 1;
+    int rep, w, k;
+
+    for (rep = 0; rep < repeat; rep++)
+    {
+        t0 = bench_cycles();
+        for (w = 0; w < windows; w++)
+        {
+            frontend_ma4(x, ir_in + w * BLOCK, BUFFER_SIZE);
+            sink += x[w % BUFFER_SIZE];
+        }
+        c = bench_cycles() - t0;
+        if (c < best_ma) best_ma = c;
+
+        t0 = bench_cycles();
+        for (w = 0; w < windows; w++)
+        {
+            frontend_bpf(pf, x, ir_in + w * BLOCK, BUFFER_SIZE);
+            sink += x[w % BUFFER_SIZE];
+        }
+        c = bench_cycles() - t0;
+        if (c < best_bpf) best_bpf = c;
+
+        maxim_bpf_reset(pf, (int32_t)ir_in[0]);
+        t0 = bench_cycles();
+        for (k = 0; k < n_in; k++)
+            sink += maxim_bpf_step(pf, (int32_t)ir_in[k]);
+        c = bench_cycles() - t0;
+        if (c < best_step) best_step = c;
+    }
+
+    printf("front-end cost (best of %d, %d windows of %d):\n", repeat, windows, BUFFER_SIZE);
+    printf("  %-22s %8.1f cycles/sample\n", "ma4 window", (double)best_ma / ((double)windows * BUFFER_SIZE));
+    printf("  %-22s %8.1f cycles/sample\n", "bpf window (block)", (double)best_bpf / ((double)windows * BUFFER_SIZE));
+    printf("  %-22s %8.1f cycles/sample\n", "bpf stream (step)", (double)best_step / n_in);
+}
+
+static void print_score(const char *name, const struct score *sc)
+{
+    printf("  %-14s %8.1f%%", name, sc->windows ? 100.0 * sc->valid / sc->windows : 0);
+    if (has_truth)
+        printf(" %10.2f %11.1f%% %10.2f",
+               sc->valid ? sc->err / sc->valid : 0,
+               sc->valid ? 100.0 * sc->within5 / sc->valid : 0,
+               sc->spo2_valid ? sc->spo2_err / sc->spo2_valid : 0);
+    printf("\n");
+}
+
+static void evaluate(const char *title, const maxim_bpf_t *pf)
+{
+    struct score s_ma_w = {0}, s_bpf_w = {0}, s_ma_s = {0}, s_bpf_s = {0};
+
+    run_window(RT_NULL, &s_ma_w);
+    run_window(pf, &s_bpf_w);
+    run_stream(RT_NULL, &s_ma_s);
+    run_stream(pf, &s_bpf_s);
+
+    printf("%s (%d samples):\n", title, n_in);
+    printf("  %-14s %9s %10s %12s %10s\n", "front-end", "HR valid", "|err| bpm", "within 5", "SpO2 |err|");
+    print_score("ma4 window", &s_ma_w);
+    print_score("bpf window", &s_bpf_w);
+    print_score("ma4 stream", &s_ma_s);
+    print_score("bpf stream", &s_bpf_s);
+}
+
+int main(int argc, char **argv)
+{
+    const char *file = NULL;
+    int seconds = 300, repeat = 5, opt;
+    unsigned i;
+    maxim_bpf_t bpf;
+
+    while ((opt = getopt(argc, argv, "t:r:f:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 't': seconds = atoi(optarg); break;
+        case 'r': repeat = atoi(optarg); break;
+        case 'f': file = optarg; break;
+        default:
+            fprintf(stderr, "usage: %s [-t seconds] [-r repeat] [-f trace.csv]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    maxim_bpf_design(&bpf, FS, MAXIM_BPF_LO_HZ, MAXIM_BPF_HI_HZ);
+    printf("band-pass %.1f-%.1f Hz @ %d Hz, %d biquads, Q%d coefficients\n",
+           MAXIM_BPF_LO_HZ, MAXIM_BPF_HI_HZ, FS, MAXIM_BPF_SECTIONS, MAXIM_BPF_Q);
+
+    if (file != NULL)
+    {
+        if (load_csv(file) < BUFFER_SIZE)
+        {
+            fprintf(stderr, "%s: need at least %d samples\n", file, BUFFER_SIZE);
+            return 1;
+        }
+        bench_cost(&bpf, repeat);
+        evaluate(file, &bpf);
+    }
+    else
+    {
+        int n = seconds * FS;
+
+        ir_in = malloc(sizeof(uint32_t) * n);
+        red_in = malloc(sizeof(uint32_t) * n);
+        hr_true = malloc(sizeof(double) * n);
+        spo2_true = malloc(sizeof(double) * n);
+        for (i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++)
+        {
+            make_signal(&scenarios[i], n);
+            if (i == 0)
+                bench_cost(&bpf, repeat);
+            evaluate(scenarios[i].name, &bpf);
+        }
+    }
+
+    free(ir_in);
+    free(red_in);
+    free(hr_true);
+    free(spo2_true);
+    return 0;
+}
@@ -0,0 +1,541 @@
+/*
+ * 心率血氧算法回放: 记录数据逐窗口送入 maxim_heart_rate_and_oxygen_saturation,
+ * 统计每窗口耗时、堆分配次数、与参考标注的误差, 并可保存/校验基准输出.
+ *
+ *   bench_ppg_replay [-i 记录文件] [-b] [-a 标注.csv] [-w 窗口] [-s 步长] [-r 重复次数]
+ *                    [-m bpf|ma4] [-g 保存基准] [-c 校验基准] [-T 允许变慢百分比] [-v]
+ *
+ * 记录文件 (50Hz):
+ *   .csv   每行 "red,ir[,参考心率[,参考血氧]]", 参考值为0表示未知
+ *   其他   MAX30102 FIFO原始字节, 每样本6字节: 红光3字节 + 红外3字节, 高位在前 (-b强制)
+ * 标注文件每行 "样本序号,心率[,血氧]", 从该样本起生效, 覆盖记录文件中的参考列.
+ * 不给记录文件时使用PPG合成器生成10分钟信号, 参考值为合成真值.
+ * 前端默认与驱动一致使用带通滤波 (-m ma4 改用4点平滑).
+ *
+ * 基准文件记录参数、每个窗口的输出和平均周期数. 校验时输出须逐窗口一致;
+ * 给出 -T 时平均周期数超过基准的 (1 + T%) 也判为回归. 有回归时返回1.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include "algorithm.h"
+#include "ppg_synth.h"
+#include "bench.h"
+
+struct window_out
+{
+    int32_t end;                /* 窗口最后一个样本的序号 */
+    int32_t hr, spo2;
+    int8_t  hr_valid, spo2_valid;
+};
+
+static uint32_t *ir_in, *red_in;
+static float    *hr_ref, *spo2_ref;
+static int      n_in;
+static char     src_name[256] = "synth";
+static const char *frontend = "bpf";
+
+/* ==================== 堆分配计数 ==================== */
+
+static volatile int count_allocs;
+static unsigned long allocs, alloc_bytes;
+
+#ifdef __GLIBC__
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *p, size_t size);
+
+void *malloc(size_t size)
+{
+    if (count_allocs)
+    {
+        allocs++;
+        alloc_bytes += size;
+    }
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size)
+{
+    if (count_allocs)
+    {
+        allocs++;
+        alloc_bytes += n * size;
+    }
+    return __libc_calloc(n, size);
+}
+
+void *realloc(void *p, size_t size)
+{
+    if (count_allocs)
+    {
+        allocs++;
+        alloc_bytes += size;
+    }
+    return __libc_realloc(p, size);
+}
+#define ALLOC_COUNTING  1
+#else
+#define ALLOC_COUNTING  0
+#endif
+
+/* ==================== 输入 ==================== */
+
+static void reserve(int n)
+{
+    ir_in = realloc(ir_in, sizeof(uint32_t) * n);
+    red_in = realloc(red_in, sizeof(uint32_t) * n);
+    hr_ref = realloc(hr_ref, sizeof(float) * n);
+    spo2_ref = realloc(spo2_ref, sizeof(float) * n);
+}
+
+static int load_csv(FILE *fp)
+{
+    char line[128];
+    int cap = 0;
+
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        unsigned long red, ir;
+        float hr = 0, spo2 = 0;
+
+        if (sscanf(line, "%lu,%lu,%f,%f", &red, &ir, &hr, &spo2) < 2)
+            continue;
+        if (n_in == cap)
+        {
+            cap = cap ? cap * 2 : 65536;
+            reserve(cap);
+        }
+        red_in[n_in] = (uint32_t)red & 0x3FFFF;
+        ir_in[n_in] = (uint32_t)ir & 0x3FFFF;
+        hr_ref[n_in] = hr;
+        spo2_ref[n_in] = spo2;
+        n_in++;
+    }
+    return n_in;
+}
+
+static int load_fifo_bin(FILE *fp)
+{
+    uint8_t b[6];
+    int cap = 0;
+
+    while (fread(b, 1, sizeof(b), fp) == sizeof(b))
+    {
+        if (n_in == cap)
+        {
+            cap = cap ? cap * 2 : 65536;
+            reserve(cap);
+        }
+        red_in[n_in] = (((uint32_t)b[0] << 16) | ((uint32_t)b[1] << 8) | b[2]) & 0x3FFFF;
+        ir_in[n_in] = (((uint32_t)b[3] << 16) | ((uint32_t)b[4] << 8) | b[5]) & 0x3FFFF;
+        hr_ref[n_in] = 0;
+        spo2_ref[n_in] = 0;
+        n_in++;
+    }
+    return n_in;
+}
+
+static int load_annotations(const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    char line[128];
+    int last = 0, rows = 0, k;
+    float hr = 0, spo2 = 0;
+
+    if (fp == NULL)
+        return -1;
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        int at;
+        float h = 0, s = 0;
+
+        if (sscanf(line, "%d,%f,%f", &at, &h, &s) < 2 || at < 0)
+            continue;
+        if (at > n_in)
+            at = n_in;
+        for (k = last; k < at; k++)
+        {
+            hr_ref[k] = hr;
+            spo2_ref[k] = spo2;
+        }
+        last = at;
+        hr = h;
+        spo2 = s;
+        rows++;
+    }
+    for (k = last; k < n_in; k++)
+    {
+        hr_ref[k] = hr;
+        spo2_ref[k] = spo2;
+    }
+    fclose(fp);
+    return rows;
+}
+
+static void make_synth(int seconds)
+{
+    static const double hr_steps[] = {72, 64, 88, 110, 135, 96, 78, 120, 58, 100};
+    static const double spo2_steps[] = {98, 97, 99, 96, 95, 98, 97, 94, 99, 96};
+    struct ppg_synth s;
+    int i;
+
+    n_in = seconds * FS;
+    reserve(n_in);
+    ppg_synth_init(&s, FS);
+    s.noise = 60;
+    s.wander = 600;
+    s.hrv = 0.03;
+    for (i = 0; i < n_in; i++)
+    {
+        int seg = (i / (FS * 30)) % 10;
+
+        s.hr_bpm = hr_steps[seg];
+        s.spo2 = spo2_steps[seg];
+        ppg_synth_next(&s, &red_in[i], &ir_in[i]);
+        hr_ref[i] = (float)s.hr_bpm;
+        spo2_ref[i] = (float)s.spo2;
+    }
+}
+
+/* ==================== 回放 ==================== */
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * @brief 回放一遍, 每窗口耗时取多次重复中的最小值
+ */
+static int replay(int window, int step, int repeat, struct window_out *out,
+                  uint64_t *cycles, uint64_t *ns)
+{
+    int w, rep, i;
+
+    for (w = 0, i = window; i <= n_in; i += step, w++)
+    {
+        struct window_out *o = &out[w];
+
+        cycles[w] = UINT64_MAX;
+        ns[w] = UINT64_MAX;
+        o->end = i - 1;
+        for (rep = 0; rep < repeat; rep++)
+        {
+            uint64_t t0 = bench_ns(), c0 = bench_cycles(), c1, t1;
+
+            count_allocs = 1;
+            maxim_heart_rate_and_oxygen_saturation(ir_in + i - window, window, red_in + i - window,
+                    &o->spo2, &o->spo2_valid, &o->hr, &o->hr_valid);
+            count_allocs = 0;
+            c1 = bench_cycles();
+            t1 = bench_ns();
+            if (c1 - c0 < cycles[w]) cycles[w] = c1 - c0;
+            if (t1 - t0 < ns[w]) ns[w] = t1 - t0;
+        }
+    }
+    return w;
+}
+
+struct accuracy
+{
+    int     hr_ref, hr_valid, hr_within;
+    double  hr_err;
+    int     spo2_ref, spo2_valid, spo2_within;
+    double  spo2_err;
+};
+
+static void score(const struct window_out *out, int windows, struct accuracy *a)
+{
+    int w;
+
+    memset(a, 0, sizeof(*a));
+    for (w = 0; w < windows; w++)
+    {
+        const struct window_out *o = &out[w];
+        double e;
+
+        if (hr_ref[o->end] > 0)
+        {
+            a->hr_ref++;
+            if (o->hr_valid)
+            {
+                e = fabs(o->hr - hr_ref[o->end]);
+                a->hr_valid++;
+                a->hr_err += e;
+                a->hr_within += e <= 5;
+            }
+        }
+        if (spo2_ref[o->end] > 0)
+        {
+            a->spo2_ref++;
+            if (o->spo2_valid)
+            {
+                e = fabs(o->spo2 - spo2_ref[o->end]);
+                a->spo2_valid++;
+                a->spo2_err += e;
+                a->spo2_within += e <= 2;
+            }
+        }
+    }
+}
+
+/* ==================== 基准文件 ==================== */
+
+static int save_golden(const char *path, int window, int step, const struct window_out *out,
+                       int windows, double cyc_mean)
+{
+    FILE *fp = fopen(path, "w");
+    int w;
+
+    if (fp == NULL)
+        return -1;
+    fprintf(fp, "# ppg replay golden\n");
+    fprintf(fp, "source %s\nfrontend %s\nsamples %d\nwindow %d\nstep %d\nwindows %d\ncycles %.1f\n",
+            src_name, frontend, n_in, window, step, windows, cyc_mean);
+    fprintf(fp, "# end hr hr_valid spo2 spo2_valid\n");
+    for (w = 0; w < windows; w++)
+        fprintf(fp, "%d %d %d %d %d\n", out[w].end, out[w].hr, out[w].hr_valid,
+                out[w].spo2, out[w].spo2_valid);
+    fclose(fp);
+    return 0;
+}
+
+/**
+ * @return 0-一致, 1-有回归, -1-文件无法读取或参数不符
+ */
+static int check_golden(const char *path, int window, int step, const struct window_out *out,
+                        int windows, double cyc_mean, double slower_pct)
+{
+    FILE *fp = fopen(path, "r");
+    char line[256], key[32], val[224];
+    int g_samples = -1, g_window = -1, g_step = -1, g_windows = -1, w = 0, diffs = 0;
+    char g_frontend[sizeof(val)] = "";
+    double g_cycles = 0;
+    int ret = 0;
+
+    if (fp == NULL)
+        return -1;
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        struct window_out g;
+        int hv, sv;
+
+        if (line[0] == '#')
+            continue;
+        if (sscanf(line, "%d %d %d %d %d", &g.end, &g.hr, &hv, &g.spo2, &sv) == 5)
+        {
+            if (w < windows && (out[w].end != g.end || out[w].hr != g.hr || out[w].hr_valid != hv ||
+                                out[w].spo2 != g.spo2 || out[w].spo2_valid != sv))
+            {
+                if (diffs < 5)
+                    printf("  window @%d: hr %d/%d spo2 %d/%d, golden hr %d/%d spo2 %d/%d\n",
+                           g.end, out[w].hr, out[w].hr_valid, out[w].spo2, out[w].spo2_valid,
+                           g.hr, hv, g.spo2, sv);
+                diffs++;
+            }
+            w++;
+            continue;
+        }
+        if (sscanf(line, "%31s %223s", key, val) != 2)
+            continue;
+        if (strcmp(key, "samples") == 0) g_samples = atoi(val);
+        else if (strcmp(key, "window") == 0) g_window = atoi(val);
+        else if (strcmp(key, "step") == 0) g_step = atoi(val);
+        else if (strcmp(key, "windows") == 0) g_windows = atoi(val);
+        else if (strcmp(key, "cycles") == 0) g_cycles = atof(val);
+        else if (strcmp(key, "frontend") == 0) snprintf(g_frontend, sizeof(g_frontend), "%s", val);
+    }
+    fclose(fp);
+
+    if (g_samples != n_in || g_window != window || g_step != step || g_windows != windows || w != windows ||
+        strcmp(g_frontend, frontend) != 0)
+    {
+        printf("golden %s: parameters differ (frontend %s samples %d window %d step %d windows %d)\n",
+               path, g_frontend, g_samples, g_window, g_step, g_windows);
+        return -1;
+    }
+
+    if (diffs)
+    {
+        printf("golden: %d of %d windows differ\n", diffs, windows);
+        ret = 1;
+    }
+    else
+    {
+        printf("golden: all %d windows match\n", windows);
+    }
+    if (slower_pct >= 0 && g_cycles > 0)
+    {
+        double pct = (cyc_mean / g_cycles - 1.0) * 100.0;
+
+        printf("golden: %.1f cycles/window vs %.1f (%+.1f%%, limit +%.0f%%)\n",
+               cyc_mean, g_cycles, pct, slower_pct);
+        if (pct > slower_pct)
+            ret = 1;
+    }
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    const char *input = NULL, *annot = NULL, *golden_out = NULL, *golden_in = NULL;
+    int window = BUFFER_SIZE, step = FS, repeat = 3, force_bin = 0, verbose = 0, opt;
+    int windows, w, ret = 0;
+    double slower_pct = -1, cyc_mean = 0, ns_mean = 0;
+    struct window_out *out;
+    uint64_t *cycles, *ns, *sorted;
+    int32_t *work = NULL;
+    struct accuracy acc;
+
+    while ((opt = getopt(argc, argv, "i:ba:w:s:r:m:g:c:T:vh")) != -1)
+    {
+        switch (opt)
+        {
+        case 'i': input = optarg; break;
+        case 'b': force_bin = 1; break;
+        case 'a': annot = optarg; break;
+        case 'w': window = atoi(optarg); break;
+        case 's': step = atoi(optarg); break;
+        case 'r': repeat = atoi(optarg); break;
+        case 'm': frontend = optarg; break;
+        case 'g': golden_out = optarg; break;
+        case 'c': golden_in = optarg; break;
+        case 'T': slower_pct = atof(optarg); break;
+        case 'v': verbose = 1; break;
+        default:
+            fprintf(stderr, "usage: %s [-i trace.csv|trace.bin] [-b] [-a annot.csv] [-w window] [-s step]\n"
+                    "       [-r repeat] [-m bpf|ma4] [-g save_golden] [-c check_golden] [-T slower_pct] [-v]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (window < MA4_SIZE || step < 1 || repeat < 1)
+    {
+        fprintf(stderr, "window must be >= %d, step and repeat >= 1\n", MA4_SIZE);
+        return 2;
+    }
+    /* 超过内置缓冲区的窗口由这里提供工作缓冲区 */
+    if (window > BUFFER_SIZE)
+    {
+        work = malloc(sizeof(int32_t) * window);
+        maxim_set_buffer(work, window);
+    }
+    if (strcmp(frontend, "bpf") == 0)
+    {
+        maxim_bpf_t bpf;
+
+        maxim_bpf_design(&bpf, FS, MAXIM_BPF_LO_HZ, MAXIM_BPF_HI_HZ);
+        maxim_set_bpf(&bpf);
+    }
+    else if (strcmp(frontend, "ma4") != 0)
+    {
+        fprintf(stderr, "front-end must be bpf or ma4\n");
+        return 2;
+    }
+
+    if (input != NULL)
+    {
+        const char *ext = strrchr(input, '.');
+        FILE *fp = fopen(input, "rb");
+
+        if (fp == NULL)
+        {
+            perror(input);
+            return 2;
+        }
+        if (!force_bin && ext != NULL && strcmp(ext, ".csv") == 0)
+            load_csv(fp);
+        else
+            load_fifo_bin(fp);
+        fclose(fp);
+        snprintf(src_name, sizeof(src_name), "%s", strrchr(input, '/') ? strrchr(input, '/') + 1 : input);
+    }
+    else
+    {
+        make_synth(600);
+    }
+    if (annot != NULL && load_annotations(annot) < 0)
+    {
+        perror(annot);
+        return 2;
+    }
+    if (n_in < window)
+    {
+        fprintf(stderr, "%s: %d samples, shorter than one window\n", src_name, n_in);
+        return 2;
+    }
+
+    windows = (n_in - window) / step + 1;
+    out = calloc(windows, sizeof(*out));
+    cycles = calloc(windows, sizeof(*cycles));
+    ns = calloc(windows, sizeof(*ns));
+    sorted = calloc(windows, sizeof(*sorted));
+
+    replay(window, step, repeat, out, cycles, ns);
+    for (w = 0; w < windows; w++)
+    {
+        cyc_mean += (double)cycles[w];
+        ns_mean += (double)ns[w];
+        if (verbose)
+            printf("%8d %5d %d %4d %d %8llu\n", out[w].end, out[w].hr, out[w].hr_valid,
+                   out[w].spo2, out[w].spo2_valid, (unsigned long long)cycles[w]);
+    }
+    cyc_mean /= windows;
+    ns_mean /= windows;
+    memcpy(sorted, cycles, sizeof(*sorted) * windows);
+    qsort(sorted, windows, sizeof(*sorted), cmp_u64);
+    score(out, windows, &acc);
+
+    printf("%s: %d samples (%.1f min @ %d Hz), %s front-end, window %d, step %d, %d windows, best of %d\n",
+           src_name, n_in, (double)n_in / FS / 60, FS, frontend, window, step, windows, repeat);
+    printf("time/window: %.1f cycles (p50 %llu, p99 %llu, max %llu), %.2f us, %.1f cycles/sample\n",
+           cyc_mean, (unsigned long long)sorted[windows / 2],
+           (unsigned long long)sorted[windows * 99 / 100], (unsigned long long)sorted[windows - 1],
+           ns_mean / 1000.0, cyc_mean / step);
+    if (ALLOC_COUNTING)
+        printf("heap: %lu allocations, %lu bytes over %d calls\n", allocs, alloc_bytes, windows * repeat);
+    else
+        printf("heap: allocation counting not available on this libc\n");
+    if (acc.hr_ref)
+        printf("HR:   %d/%d valid (%.1f%%), mean |err| %.2f bpm, within 5 bpm %.1f%%\n",
+               acc.hr_valid, acc.hr_ref, 100.0 * acc.hr_valid / acc.hr_ref,
+               acc.hr_valid ? acc.hr_err / acc.hr_valid : 0,
+               acc.hr_valid ? 100.0 * acc.hr_within / acc.hr_valid : 0);
+    if (acc.spo2_ref)
+        printf("SpO2: %d/%d valid (%.1f%%), mean |err| %.2f %%, within 2 %% %.1f%%\n",
+               acc.spo2_valid, acc.spo2_ref, 100.0 * acc.spo2_valid / acc.spo2_ref,
+               acc.spo2_valid ? acc.spo2_err / acc.spo2_valid : 0,
+               acc.spo2_valid ? 100.0 * acc.spo2_within / acc.spo2_valid : 0);
+    if (!acc.hr_ref && !acc.spo2_ref)
+        printf("no reference annotations, accuracy not scored\n");
+
+    if (golden_out != NULL && save_golden(golden_out, window, step, out, windows, cyc_mean) < 0)
+    {
+        perror(golden_out);
+        ret = 2;
+    }
+    if (golden_in != NULL)
+    {
+        int r = check_golden(golden_in, window, step, out, windows, cyc_mean, slower_pct);
+
+        if (r < 0)
+            ret = 2;
+        else if (r > 0)
+            ret = 1;
+    }
+
+    free(out);
+    free(cycles);
+    free(ns);
+    free(sorted);
+    free(ir_in);
+    free(red_in);
+    free(hr_ref);
+    free(spo2_ref);
+    maxim_set_buffer(RT_NULL, 0);
+    free(work);
+    return ret;
+}
@@ -0,0 +1,297 @@
+/*
+ * 体温预测: 每个读数的开销与到达平衡温度±0.1°C的时间
+ *
+ *   bench_temp_predict [-r 重复次数] [-i 升温记录.csv] [-e 平衡温度] [-b 分辨率位数]
+ *
+ * 合成升温曲线: 佩戴前为环境温度, 佩戴后按一个或两个时间常数的指数过程趋近
+ * 平衡温度 (探头与皮肤接触的快过程 + 局部皮肤回温的慢过程), 加噪声后按DS18B20
+ * 分辨率量化, 读数间隔与固件一次转换周期一致. 另有摘下探头的降温与已平衡两种情形.
+ * 显示值: 预测可信时为预测值, 否则为原始读数. 统计原始读数与显示值各自从佩戴起
+ * 到此后一直在平衡温度±0.1°C内的时间, 首次可信的时间, 以及可信输出中误差超过0.2°C的比例.
+ * 记录文件每行 "t_s,temp_c", 平衡温度默认取最后30秒的均值.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include "temp_predict.h"
+#include "bench.h"
+
+struct curve
+{
+    const char  *name;
+    double      t_amb;          /* 佩戴前 */
+    double      t_eq;
+    double      w_fast;         /* 快过程占比 */
+    double      tau_fast;
+    double      tau_slow;
+    double      noise;          /* °C */
+    double      seconds;
+};
+
+static const struct curve curves[] = {
+    {"tau 40s",       24.0, 33.5, 0.0,  0,  40, 0.02, 400},
+    {"tau 90s",       24.0, 33.5, 0.0,  0,  90, 0.02, 700},
+    {"tau 180s",      22.0, 34.2, 0.0,  0, 180, 0.02, 1200},
+    {"2-exp 8s/120s", 24.0, 33.8, 0.6,  8, 120, 0.02, 900},
+    {"2-exp 5s/60s",  18.0, 32.9, 0.5,  5,  60, 0.03, 500},
+    {"warm start",    33.1, 33.4, 0.0,  0,  30, 0.02, 300},
+    {"removal",       33.5, 26.0, 0.0,  0,  60, 0.02, 500},
+};
+#define CURVES      ((int)(sizeof(curves) / sizeof(curves[0])))
+
+#define ONSET_S     60.0        /* 佩戴时刻 */
+
+static double   *t_in, *v_in;
+static int      n_in;
+
+static uint32_t rand_state = 0x13579BDF;
+
+static double rand_uniform(void)
+{
+    rand_state ^= rand_state << 13;
+    rand_state ^= rand_state >> 17;
+    rand_state ^= rand_state << 5;
+    return (rand_state & 0xFFFFFF) / (double)0x1000000;
+}
+
+static double rand_noise(double sd)
+{
+    return (rand_uniform() + rand_uniform() + rand_uniform() + rand_uniform() - 2.0) * sd * 1.732;
+}
+
+static int16_t quantize(double c, int bits)
+{
+    int step = 1 << (12 - bits);
+
+    return (int16_t)(lrint(c * 16.0 / step) * step);
+}
+
+static double curve_value(const struct curve *cv, double t)
+{
+    double dt = t - ONSET_S, d;
+
+    if (dt < 0)
+        return cv->t_amb;
+    d = cv->t_eq - cv->t_amb;
+    if (cv->w_fast > 0)
+        return cv->t_eq - d * (cv->w_fast * exp(-dt / cv->tau_fast) + (1 - cv->w_fast) * exp(-dt / cv->tau_slow));
+    return cv->t_eq - d * exp(-dt / cv->tau_slow);
+}
+
+static int load_csv(const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    char line[128];
+    int cap = 0, n = 0;
+
+    if (fp == NULL)
+        return -1;
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        double t, v;
+
+        if (sscanf(line, "%lf,%lf", &t, &v) != 2)
+            continue;
+        if (n == cap)
+        {
+            cap = cap ? cap * 2 : 1024;
+            t_in = realloc(t_in, sizeof(double) * cap);
+            v_in = realloc(v_in, sizeof(double) * cap);
+        }
+        t_in[n] = t;
+        v_in[n] = v;
+        n++;
+    }
+    fclose(fp);
+    n_in = n;
+    return n;
+}
+
+struct result
+{
+    double  t_raw, t_disp, t_conf;
+    int     conf, conf_bad;
+    int     conf_far;           /* 首次可信后预测值超出 ±0.1°C 的次数 */
+};
+
+/* 从 onset 起到此后一直在 ±0.1°C 内的时间, 从未达到时为负 */
+static void evaluate(const int16_t *raw, const uint32_t *ms, int n, double t_eq, double onset,
+                     struct result *res)
+{
+    static tp_t tp;
+    tp_result_t pr;
+    double last_raw_out = -1, last_disp_out = -1, t;
+    int i, lost = 0;
+
+    memset(res, 0, sizeof(*res));
+    res->t_conf = -1;
+    tp_init(&tp);
+    for (i = 0; i < n; i++)
+    {
+        double r = raw[i] / 16.0, disp;
+
+        tp_push(&tp, raw[i], ms[i]);
+        tp_get_result(&tp, &pr);
+        t = ms[i] / 1000.0;
+        disp = pr.ch_confident ? pr.f_pred_c : r;
+
+        if (fabs(r - t_eq) > 0.1)
+            last_raw_out = t;
+        if (fabs(disp - t_eq) > 0.1)
+            last_disp_out = t;
+        /* 佩戴前的可信状态不算, 取佩戴后重新变为可信的时刻 */
+        if (!pr.ch_confident && t >= onset)
+            lost = 1;
+        if (pr.ch_confident && t >= onset)
+        {
+            if (res->t_conf < 0 && lost)
+                res->t_conf = t - onset;
+            res->conf++;
+            if (fabs(pr.f_pred_c - t_eq) > 0.2)
+                res->conf_bad++;
+            if (res->t_conf >= 0 && fabs(pr.f_pred_c - t_eq) > 0.1)
+                res->conf_far++;
+        }
+    }
+    t = ms[n - 1] / 1000.0;
+    res->t_raw = last_raw_out >= t - 30 ? -1 : (last_raw_out < onset ? 0 : last_raw_out - onset);
+    res->t_disp = last_disp_out >= t - 30 ? -1 : (last_disp_out < onset ? 0 : last_disp_out - onset);
+}
+
+static void print_time(double t)
+{
+    if (t < 0)
+        printf(" %8s", "never");
+    else
+        printf(" %7.1fs", t);
+}
+
+int main(int argc, char **argv)
+{
+    static int16_t raw[65536];
+    static uint32_t ms[65536];
+    int repeat = 20, bits = 12, opt, i, c, rep, n, failed = 0;
+    const char *in = NULL;
+    double t_eq_arg = NAN, interval;
+    uint64_t best = UINT64_MAX, pushes = 0, t0, cyc;
+    struct result res;
+    static tp_t tp;
+
+    while ((opt = getopt(argc, argv, "r:i:e:b:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 'r': repeat = atoi(optarg); break;
+        case 'i': in = optarg; break;
+        case 'e': t_eq_arg = atof(optarg); break;
+        case 'b': bits = atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-r repeat] [-i warmup.csv] [-e equilibrium C] [-b bits 9-12]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (bits < 9 || bits > 12)
+        bits = 12;
+    /* 一轮 = 转换时间 + 读出约35ms */
+    interval = (750 >> (12 - bits)) + 2 + 35;
+
+    printf("%-14s %7s %9s %9s %9s %9s %8s %6s\n", "curve", "T_eq", "raw 0.1", "pred 0.1", "confident", "speedup",
+           "bad conf", "check");
+
+    if (in != NULL)
+    {
+        double t_eq = t_eq_arg, sum = 0;
+        int cnt = 0;
+
+        if (load_csv(in) <= 1)
+        {
+            fprintf(stderr, "bench_temp_predict: cannot read %s\n", in);
+            return 1;
+        }
+        n = n_in < 65536 ? n_in : 65536;
+        for (i = 0; i < n; i++)
+        {
+            raw[i] = quantize(v_in[i], bits);
+            ms[i] = (uint32_t)lrint((t_in[i] - t_in[0]) * 1000.0);
+            if (t_in[i] >= t_in[n - 1] - 30)
+            {
+                sum += v_in[i];
+                cnt++;
+            }
+        }
+        if (isnan(t_eq))
+            t_eq = sum / cnt;
+        evaluate(raw, ms, n, t_eq, 0, &res);
+        printf("%-14s %7.2f", "trace", t_eq);
+        print_time(res.t_raw);
+        print_time(res.t_disp);
+        print_time(res.t_conf);
+        if (res.t_raw > 0 && res.t_disp >= 0)
+            printf(" %8.1fx", res.t_raw / (res.t_disp > 0 ? res.t_disp : interval / 1000.0));
+        else
+            printf(" %9s", "-");
+        printf(" %7.1f%%\n", res.conf ? 100.0 * res.conf_bad / res.conf : 0.0);
+        pushes = n;
+    }
+    else
+    {
+        for (c = 0; c < CURVES; c++)
+        {
+            const struct curve *cv = &curves[c];
+
+            n = (int)(cv->seconds * 1000.0 / interval);
+            if (n > 65536)
+                n = 65536;
+            for (i = 0; i < n; i++)
+            {
+                double t = i * interval / 1000.0;
+
+                raw[i] = quantize(curve_value(cv, t) + rand_noise(cv->noise), bits);
+                ms[i] = (uint32_t)lrint(i * interval);
+            }
+            evaluate(raw, ms, n, cv->t_eq, ONSET_S, &res);
+            printf("%-14s %7.2f", cv->name, cv->t_eq);
+            print_time(res.t_raw);
+            print_time(res.t_disp);
+            print_time(res.t_conf);
+            if (res.t_raw > 0 && res.t_disp >= 0)
+                printf(" %8.1fx", res.t_raw / (res.t_disp > 0 ? res.t_disp : interval / 1000.0));
+            else
+                printf(" %9s", "-");
+            printf(" %7.1f%%", res.conf ? 100.0 * res.conf_bad / res.conf : 0.0);
+            /* 变为可信后显示的预测值须一直在 ±0.1°C 内; 9/10位的量化步长本身超过该范围, 只报告 */
+            if (bits < 11)
+                printf(" %6s\n", "-");
+            else if (res.t_conf < 0 || res.conf_far > 0)
+            {
+                printf(" %6s\n", "FAIL");
+                failed++;
+            }
+            else
+                printf(" %6s\n", "ok");
+            pushes += n;
+        }
+    }
+
+    /* 开销: 最后一条曲线反复输入, 取多次运行中的最小值 */
+    for (rep = 0; rep < repeat; rep++)
+    {
+        tp_init(&tp);
+        t0 = bench_cycles();
+        for (i = 0; i < n; i++)
+            tp_push(&tp, raw[i], ms[i]);
+        cyc = bench_cycles() - t0;
+        if (cyc < best)
+            best = cyc;
+    }
+    printf("%d-bit readings every %.0f ms, %llu readings, tp_t %zu bytes, %.1f cycles/reading (best of %d)\n",
+           bits, interval, (unsigned long long)pushes, sizeof(tp_t), (double)best / n, repeat);
+    if (failed)
+    {
+        printf("check: %d curve(s) left ±0.1°C after becoming confident\n", failed);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,107 @@
+/*
+ * 智能手环主机仿真 - PPG波形合成器
+ *
+ * 每个心动周期的吸收曲线由收缩峰和重搏波两个高斯脉冲组成,
+ * 检测光强 = DC * (1 - 灌注指数 * 吸收). 红光灌注指数按
+ * Maxim查找表的标定曲线 SpO2 = -45.060R^2 + 30.354R + 94.845 反解.
+ */
+#include <math.h>
+#include "ppg_synth.h"
+
+#define PPG_ADC_MAX     0x3FFFF
+
+static uint32_t synth_rand(struct ppg_synth *s)
+{
+    s->rng ^= s->rng << 13;
+    s->rng ^= s->rng >> 17;
+    s->rng ^= s->rng << 5;
+    return s->rng;
+}
+
+static double synth_noise(struct ppg_synth *s)
+{
+    double sum = 0;
+    int i;
+
+    for (i = 0; i < 4; i++)
+        sum += (synth_rand(s) % 20001) / 10000.0 - 1.0;
+    return sum / 1.1547;
+}
+
+static double pulse_shape(double phase)
+{
+    double a = (phase - 0.18) / 0.07;
+    double b = (phase - 0.48) / 0.10;
+
+    return exp(-a * a) + 0.35 * exp(-b * b);
+}
+
+/**
+ * @brief 求使查找表输出spo2的红光/红外比值R
+ */
+double ppg_synth_ratio_for_spo2(double spo2)
+{
+    double a = -45.060, b = 30.354, c = 94.845 - spo2;
+    double disc = b * b - 4 * a * c;
+
+    if (disc < 0)
+        disc = 0;
+    return (-b - sqrt(disc)) / (2 * a);
+}
+
+void ppg_synth_init(struct ppg_synth *s, double fs)
+{
+    s->fs = fs;
+    s->hr_bpm = 72;
+    s->spo2 = 97;
+    s->perfusion = 0.012;
+    s->hrv = 0.0;
+    s->dc_ir = 110000;
+    s->dc_red = 95000;
+    s->noise = 20;
+    s->wander = 0;
+    s->finger = 1;
+    s->phase = 0;
+    s->beat_scale = 1.0;
+    s->wander_phase = 0;
+    s->rng = 0x2545F491;
+    s->beats = 0;
+}
+
+void ppg_synth_next(struct ppg_synth *s, uint32_t *red, uint32_t *ir)
+{
+    double absorb, ratio, v_ir, v_red, base;
+
+    s->phase += s->hr_bpm * s->beat_scale / 60.0 / s->fs;
+    if (s->phase >= 1.0)
+    {
+        s->phase -= 1.0;
+        s->beats++;
+        s->beat_scale = 1.0 + s->hrv * synth_noise(s);
+    }
+    s->wander_phase += 0.2 / s->fs;
+    if (s->wander_phase >= 1.0)
+        s->wander_phase -= 1.0;
+
+    if (!s->finger)
+    {
+        v_ir = 1500 + 30 * synth_noise(s);
+        v_red = 1200 + 30 * synth_noise(s);
+    }
+    else
+    {
+        absorb = pulse_shape(s->phase);
+        ratio = ppg_synth_ratio_for_spo2(s->spo2);
+        base = s->wander * sin(2 * M_PI * s->wander_phase);
+        v_ir = s->dc_ir * (1.0 - s->perfusion * absorb) + base + s->noise * synth_noise(s);
+        v_red = s->dc_red * (1.0 - s->perfusion * ratio * absorb) + base * s->dc_red / s->dc_ir
+                + s->noise * synth_noise(s);
+    }
+
+    if (v_ir < 0) v_ir = 0;
+    if (v_red < 0) v_red = 0;
+    if (v_ir > PPG_ADC_MAX) v_ir = PPG_ADC_MAX;
+    if (v_red > PPG_ADC_MAX) v_red = PPG_ADC_MAX;
+    *ir = (uint32_t)v_ir;
+    *red = (uint32_t)v_red;
+}
@@ -0,0 +1,43 @@
+/*
+ * 智能手环主机仿真 - PPG波形合成器
+ * 按给定心率/血氧生成MAX30102红光/红外原始样本 (18位)
+ */
+#ifndef __PPG_SYNTH_H__
+#define __PPG_SYNTH_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct ppg_synth
+{
+    double      fs;             /* 采样率 (Hz) */
+    double      hr_bpm;         /* 心率 */
+    double      spo2;           /* 血氧 (%) */
+    double      perfusion;      /* 红外灌注指数 (AC/DC) */
+    double      hrv;            /* 逐拍心率变异 (比例) */
+    int32_t     dc_ir;
+    int32_t     dc_red;
+    int32_t     noise;          /* 白噪声标准差 (LSB) */
+    int32_t     wander;         /* 基线漂移幅度 (LSB) */
+    int         finger;         /* 是否有手指 */
+
+    /* 内部状态 */
+    double      phase;
+    double      beat_scale;
+    double      wander_phase;
+    uint32_t    rng;
+    uint64_t    beats;
+};
+
+void   ppg_synth_init(struct ppg_synth *s, double fs);
+void   ppg_synth_next(struct ppg_synth *s, uint32_t *red, uint32_t *ir);
+double ppg_synth_ratio_for_spo2(double spo2);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PPG_SYNTH_H__ */
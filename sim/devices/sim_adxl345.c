@@ -0,0 +1,539 @@
+/*
+ * 智能手环主机仿真 - 虚拟ADXL345
+ *
+ * 旁路模式下数据寄存器总是给出按BW_RATE输出速率量化后的"当前"样本,
+ * 同一输出周期内重复读取得到同一样本.
+ * FIFO模式 (FIFO_CTL) 下每个输出周期存入一个样本, 数据寄存器给出最旧的一项,
+ * 一次读到DATAZ1之后的读消息结束时弹出. 流模式满时丢弃最旧项并置OVERRUN;
+ * 项数达到FIFO_CTL中的水位时置WATERMARK. INT_SOURCE按INT_ENABLE/INT_MAP
+ * 驱动INT1/INT2 (DATA_FORMAT.INT_INVERT为低有效), 仿真只接出INT1.
+ * 活动/静止检测按ACT_INACT_CTL逐输出周期进行 (交流耦合时在使能中断的时刻取参考值,
+ * 静止检测在超出阈值时更新参考), 标志锁存到读INT_SOURCE为止.
+ * 报告给出FIFO流模式 (全速采集) 的时间占比, 以及与全天流模式相比节省的I2C传输数.
+ *
+ * 脚本命令:
+ *   adxl345 still                   静止 (只有重力)
+ *   adxl345 orient <x> <y> <z>      重力方向 (mg)
+ *   adxl345 walk <步/分>            步行, 竖直方向周期加速度
+ *   adxl345 noise <mg>
+ *   adxl345 trace <csv: x,y,z mg @100Hz> | trace off
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "drv_adxl345.h"
+#include "sim_devices.h"
+
+static const uint32_t odr_centi_hz[16] = {
+    10, 20, 39, 78, 156, 313, 625, 1250, 2500, 5000, 10000, 20000, 40000, 80000, 160000, 320000
+};
+
+#define FIFO_DEPTH      32
+
+#define INT_DATA_READY  0x80
+#define INT_ACTIVITY    0x10
+#define INT_INACTIVITY  0x08
+#define INT_WATERMARK   0x02
+#define INT_OVERRUN     0x01
+
+static struct
+{
+    struct sim_i2c_dev i2c;
+    uint8_t     regs[64];
+    uint8_t     reg_ptr;
+
+    /* FIFO */
+    int16_t     fifo[FIFO_DEPTH][3];
+    uint8_t     head;               /* 最旧项 */
+    uint8_t     count;
+    uint8_t     popping;            /* 本条读消息读过数据寄存器 */
+    uint8_t     src_read;           /* 本条读消息读过INT_SOURCE */
+    struct sim_event sample_ev;
+
+    /* 活动/静止检测 (mg) */
+    uint8_t     latched;            /* 读INT_SOURCE清除的标志 */
+    int32_t     act_ref[3];
+    int32_t     inact_ref[3];
+    uint32_t    inact_count;        /* 连续静止的输出周期数 */
+    uint32_t    act_events;
+    uint32_t    inact_events;
+
+    /* 流模式时间与传输统计 */
+    uint64_t    mode_since_ns;
+    uint64_t    stream_ns;
+    uint64_t    idle_ns;
+    uint32_t    stream_xfers;
+    uint32_t    idle_xfers;
+
+    /* INT1引脚 */
+    struct sim_pin_dev int_dev;
+    rt_base_t   int_pin;
+    int         int_level;
+
+    /* 运动模型 (mg) */
+    int32_t     grav[3];
+    double      cadence;
+    int32_t     noise;
+    int32_t     *trace;
+    int         trace_len;
+    double      step_phase;
+    uint64_t    phase_ns;           /* 步态相位对应的时刻, 输出速率变化时保持连续 */
+
+    /* 当前输出周期的样本缓存 */
+    uint64_t    cur_index;
+    int16_t     cur[3];
+    uint8_t     cur_valid;
+
+    uint64_t    steps_generated;
+    uint64_t    fifo_pushed;
+    uint64_t    fifo_popped;
+    uint64_t    fifo_lost;
+    uint32_t    irqs;
+} dev;
+
+static uint64_t odr_period_ns(void)
+{
+    return SIM_NS_PER_SEC * 100 / odr_centi_hz[dev.regs[ADXL345_BW_RATE] & 0x0F];
+}
+
+static int32_t lsb_per_g(void)
+{
+    uint8_t fmt = dev.regs[ADXL345_DATA_FORMAT];
+
+    if (fmt & 0x08)
+        return 256;
+    return 256 >> (fmt & 0x03);
+}
+
+/**
+ * @brief 生成第n个输出周期的样本 (mg)
+ */
+static void model_sample(uint64_t n, int32_t mg[3])
+{
+    uint64_t t = n * odr_period_ns();
+    int i;
+
+    if (dev.trace != RT_NULL && dev.trace_len > 0)
+    {
+        /* 记录为100Hz, 按时刻取样, 与输出速率无关 */
+        int idx = (int)(t / (SIM_NS_PER_SEC / 100) % (uint64_t)dev.trace_len);
+        for (i = 0; i < 3; i++)
+            mg[i] = dev.trace[idx * 3 + i];
+        return;
+    }
+
+    for (i = 0; i < 3; i++)
+        mg[i] = dev.grav[i];
+
+    if (dev.cadence > 0)
+    {
+        double f = dev.cadence / 60.0;
+        double prev = dev.step_phase;
+        double norm = sqrt((double)dev.grav[0] * dev.grav[0] + (double)dev.grav[1] * dev.grav[1] +
+                           (double)dev.grav[2] * dev.grav[2]);
+        double vert, lat;
+
+        /* 步态相位只随输出周期推进一次 */
+        if (t > dev.phase_ns)
+        {
+            dev.step_phase += f * (double)(t - dev.phase_ns) / SIM_NS_PER_SEC;
+            dev.phase_ns = t;
+            dev.steps_generated += (uint64_t)dev.step_phase - (uint64_t)prev;
+        }
+        vert = 350 * sin(2 * M_PI * dev.step_phase) + 120 * sin(4 * M_PI * dev.step_phase);
+        lat = 90 * sin(M_PI * dev.step_phase);
+        if (norm < 1)
+            norm = 1;
+        for (i = 0; i < 3; i++)
+            mg[i] += (int32_t)(vert * dev.grav[i] / norm);
+        mg[0] += (int32_t)lat;
+    }
+    else
+    {
+        dev.phase_ns = t;
+    }
+
+    for (i = 0; i < 3; i++)
+        mg[i] += sim_rand_noise(dev.noise);
+}
+
+static int16_t mg_to_lsb(int32_t mg)
+{
+    int32_t v = mg * lsb_per_g() / 1000;
+
+    if (v > 32767) v = 32767;
+    if (v < -32768) v = -32768;
+    return (int16_t)v;
+}
+
+static void current_sample(void)
+{
+    uint64_t n = sim_now_ns() / odr_period_ns();
+    int32_t mg[3];
+    int i;
+
+    if (dev.cur_valid && dev.cur_index == n)
+        return;
+
+    model_sample(n, mg);
+    for (i = 0; i < 3; i++)
+        dev.cur[i] = mg_to_lsb(mg[i]);
+    dev.cur_index = n;
+    dev.cur_valid = 1;
+}
+
+static int measuring(void)
+{
+    return (dev.regs[ADXL345_POWER_CTL] & 0x08) != 0;
+}
+
+static int fifo_mode(void)
+{
+    return dev.regs[ADXL345_FIFO_CTL] >> 6;
+}
+
+static int int_level(struct sim_pin_dev *pd, rt_base_t pin)
+{
+    return dev.int_level;
+}
+
+/* FIFO项数或锁存标志变化后重新计算中断标志与INT1电平 */
+static void int_update(void)
+{
+    uint8_t src = (dev.regs[ADXL345_INT_SOURCE] & INT_OVERRUN) | dev.latched;
+    int active, level;
+
+    if (fifo_mode() == 0)
+        src |= measuring() ? INT_DATA_READY : 0;
+    else if (dev.count > 0)
+        src |= INT_DATA_READY;
+    if (fifo_mode() != 0 && dev.count >= (dev.regs[ADXL345_FIFO_CTL] & 0x1F))
+        src |= INT_WATERMARK;
+    dev.regs[ADXL345_INT_SOURCE] = src;
+    dev.regs[ADXL345_FIFO_STATUS] = dev.count;
+
+    active = (src & dev.regs[ADXL345_INT_ENABLE] & ~dev.regs[ADXL345_INT_MAP]) != 0;
+    level = (dev.regs[ADXL345_DATA_FORMAT] & 0x20) ? !active : active;
+    if (level == dev.int_level)
+        return;
+    dev.int_level = level;
+    if (active)
+        dev.irqs++;
+    if (dev.int_pin >= 0)
+        sim_pin_update(dev.int_pin);
+}
+
+static int32_t abs32(int32_t v)
+{
+    return v < 0 ? -v : v;
+}
+
+/**
+ * @brief 对一个输出周期的样本做活动/静止检测
+ * ACT_INACT_CTL: bit7/bit3 交流耦合, bit6~4/bit2~0 参与检测的X/Y/Z轴
+ */
+static void act_inact_detect(const int32_t mg[3])
+{
+    uint8_t ctl = dev.regs[ADXL345_ACT_INACT_CTL];
+    uint8_t en = dev.regs[ADXL345_INT_ENABLE];
+    int32_t act_th = dev.regs[ADXL345_THRESH_ACT] * 625 / 10;
+    int32_t inact_th = dev.regs[ADXL345_THRESH_INACT] * 625 / 10;
+    uint32_t inact_n = (uint32_t)(dev.regs[ADXL345_TIME_INACT] * (SIM_NS_PER_SEC / odr_period_ns()));
+    int i, over;
+
+    if (en & INT_ACTIVITY)
+    {
+        for (i = 0, over = 0; i < 3; i++)
+            if ((ctl & (0x40 >> i)) && abs32((ctl & 0x80) ? mg[i] - dev.act_ref[i] : mg[i]) > act_th)
+                over = 1;
+        if (over)
+        {
+            if (!(dev.latched & INT_ACTIVITY))
+                dev.act_events++;
+            dev.latched |= INT_ACTIVITY;
+        }
+    }
+
+    if (en & INT_INACTIVITY)
+    {
+        for (i = 0, over = 0; i < 3; i++)
+            if ((ctl & (0x04 >> i)) && abs32((ctl & 0x08) ? mg[i] - dev.inact_ref[i] : mg[i]) > inact_th)
+                over = 1;
+        if (over)
+        {
+            for (i = 0; i < 3; i++)
+                dev.inact_ref[i] = mg[i];
+            dev.inact_count = 0;
+        }
+        else if (++dev.inact_count == inact_n)
+        {
+            dev.inact_events++;
+            dev.latched |= INT_INACTIVITY;
+        }
+    }
+}
+
+static void sample_tick(void *arg)
+{
+    int32_t mg[3];
+    uint8_t slot;
+    int i;
+
+    model_sample(sim_now_ns() / odr_period_ns(), mg);
+    act_inact_detect(mg);
+
+    if (fifo_mode() == 0)
+        goto next;
+
+    if (dev.count == FIFO_DEPTH)
+    {
+        dev.regs[ADXL345_INT_SOURCE] |= INT_OVERRUN;
+        dev.fifo_lost++;
+        /* FIFO模式满后停止收集; 流模式 (触发模式同样处理) 丢弃最旧项 */
+        if (fifo_mode() == 1)
+            goto next;
+        dev.head = (dev.head + 1) % FIFO_DEPTH;
+        dev.count--;
+    }
+
+    slot = (dev.head + dev.count) % FIFO_DEPTH;
+    for (i = 0; i < 3; i++)
+        dev.fifo[slot][i] = mg_to_lsb(mg[i]);
+    dev.count++;
+    dev.fifo_pushed++;
+
+next:
+    int_update();
+    sim_event_schedule(&dev.sample_ev, dev.sample_ev.when_ns + odr_period_ns());
+}
+
+/* 累计流模式/其他模式的时间 */
+static void mode_account(void)
+{
+    uint64_t now = sim_now_ns();
+
+    if (measuring() && fifo_mode() != 0)
+        dev.stream_ns += now - dev.mode_since_ns;
+    else
+        dev.idle_ns += now - dev.mode_since_ns;
+    dev.mode_since_ns = now;
+}
+
+/* 测量/速率/FIFO设置变化: 重新对齐采样节拍 */
+static void restart_sampling(void)
+{
+    uint64_t period = odr_period_ns();
+
+    sim_event_cancel(&dev.sample_ev);
+    if (fifo_mode() == 0)
+    {
+        dev.count = 0;
+        dev.head = 0;
+    }
+    if (measuring() && (fifo_mode() != 0 || (dev.regs[ADXL345_INT_ENABLE] & (INT_ACTIVITY | INT_INACTIVITY))))
+        sim_event_schedule(&dev.sample_ev, (sim_now_ns() / period + 1) * period);
+    int_update();
+}
+
+static uint8_t read_reg(uint8_t reg)
+{
+    if (!measuring())
+        return reg >= ADXL345_DATAX0 && reg <= ADXL345_DATAZ1 ? 0 : dev.regs[reg & 0x3F];
+
+    if (reg >= ADXL345_DATAX0 && reg <= ADXL345_DATAZ1)
+    {
+        int axis = (reg - ADXL345_DATAX0) / 2;
+        int16_t v;
+
+        if (fifo_mode() != 0)
+        {
+            /* FIFO为空时数据寄存器保持最后弹出的值 */
+            v = dev.fifo[dev.count > 0 ? dev.head : (dev.head + FIFO_DEPTH - 1) % FIFO_DEPTH][axis];
+            dev.popping = 1;
+        }
+        else
+        {
+            current_sample();
+            v = dev.cur[axis];
+        }
+        return (reg & 1) ? (uint8_t)((uint16_t)v >> 8) : (uint8_t)v;
+    }
+    if (reg == ADXL345_INT_SOURCE)
+        dev.src_read = 1;
+    return dev.regs[reg & 0x3F];
+}
+
+/* 读消息结束: 读过INT_SOURCE则清除锁存标志, 读过数据寄存器则弹出一项 */
+static void read_done(void)
+{
+    if (dev.src_read)
+    {
+        dev.src_read = 0;
+        dev.latched = 0;
+        int_update();
+    }
+    if (!dev.popping)
+        return;
+    dev.popping = 0;
+    if (dev.count > 0)
+    {
+        dev.head = (dev.head + 1) % FIFO_DEPTH;
+        dev.count--;
+        dev.fifo_popped++;
+    }
+    dev.regs[ADXL345_INT_SOURCE] &= ~INT_OVERRUN;
+    int_update();
+}
+
+static void write_reg(uint8_t reg, uint8_t v)
+{
+    uint8_t en_old = dev.regs[ADXL345_INT_ENABLE];
+    int i;
+
+    if (reg == ADXL345_DEVID || (reg >= ADXL345_DATAX0 && reg <= ADXL345_DATAZ1) ||
+        reg == ADXL345_INT_SOURCE || reg == ADXL345_FIFO_STATUS)
+        return;
+    if (reg == ADXL345_POWER_CTL || reg == ADXL345_FIFO_CTL)
+        mode_account();
+    dev.regs[reg & 0x3F] = v;
+    if (reg == ADXL345_BW_RATE || reg == ADXL345_DATA_FORMAT)
+        dev.cur_valid = 0;
+
+    /* 使能活动/静止检测时以当前加速度为参考 */
+    if (reg == ADXL345_INT_ENABLE && (v & ~en_old & (INT_ACTIVITY | INT_INACTIVITY)))
+    {
+        int32_t mg[3];
+
+        model_sample(sim_now_ns() / odr_period_ns(), mg);
+        for (i = 0; i < 3; i++)
+        {
+            if (v & ~en_old & INT_ACTIVITY)
+                dev.act_ref[i] = mg[i];
+            if (v & ~en_old & INT_INACTIVITY)
+                dev.inact_ref[i] = mg[i];
+        }
+        if (v & ~en_old & INT_INACTIVITY)
+            dev.inact_count = 0;
+    }
+
+    if (reg == ADXL345_BW_RATE || reg == ADXL345_POWER_CTL || reg == ADXL345_FIFO_CTL ||
+        (reg == ADXL345_INT_ENABLE && ((v ^ en_old) & (INT_ACTIVITY | INT_INACTIVITY))))
+        restart_sampling();
+    else if (reg == ADXL345_INT_ENABLE || reg == ADXL345_INT_MAP || reg == ADXL345_DATA_FORMAT)
+        int_update();
+}
+
+static int adxl345_xfer(struct sim_i2c_dev *i2c, struct rt_i2c_msg *msgs, int num)
+{
+    int i, k;
+
+    if (measuring() && fifo_mode() != 0)
+        dev.stream_xfers++;
+    else
+        dev.idle_xfers++;
+
+    for (i = 0; i < num; i++)
+    {
+        struct rt_i2c_msg *m = &msgs[i];
+
+        if (m->flags & RT_I2C_RD)
+        {
+            for (k = 0; k < m->len; k++)
+                m->buf[k] = read_reg(dev.reg_ptr++);
+            read_done();
+        }
+        else if (m->len > 0)
+        {
+            dev.reg_ptr = m->buf[0] & 0x3F;
+            for (k = 1; k < m->len; k++)
+                write_reg(dev.reg_ptr++, m->buf[k]);
+        }
+    }
+    return num;
+}
+
+static int adxl345_cmd(int argc, char **argv)
+{
+    if (argc < 2)
+        return -RT_EINVAL;
+
+    if (strcmp(argv[1], "still") == 0)
+        dev.cadence = 0;
+    else if (strcmp(argv[1], "walk") == 0 && argc == 3)
+        dev.cadence = atof(argv[2]);
+    else if (strcmp(argv[1], "orient") == 0 && argc == 5)
+    {
+        dev.grav[0] = atoi(argv[2]);
+        dev.grav[1] = atoi(argv[3]);
+        dev.grav[2] = atoi(argv[4]);
+    }
+    else if (strcmp(argv[1], "noise") == 0 && argc == 3)
+        dev.noise = atoi(argv[2]);
+    else if (strcmp(argv[1], "trace") == 0 && argc == 3)
+    {
+        free(dev.trace);
+        dev.trace = RT_NULL;
+        dev.trace_len = 0;
+        if (strcmp(argv[2], "off") != 0)
+        {
+            dev.trace_len = sim_csv_load(argv[2], 3, &dev.trace);
+            if (dev.trace_len <= 0)
+                return -RT_EIO;
+        }
+    }
+    else
+        return -RT_EINVAL;
+
+    dev.cur_valid = 0;
+    return 0;
+}
+
+static void adxl345_report(FILE *out)
+{
+    fprintf(out, "adxl345: %llu steps generated by motion model\n",
+            (unsigned long long)dev.steps_generated);
+    if (dev.fifo_pushed > 0)
+        fprintf(out, "adxl345: fifo %llu samples, %llu read, %llu lost to overrun, int1 %u\n",
+                (unsigned long long)dev.fifo_pushed, (unsigned long long)dev.fifo_popped,
+                (unsigned long long)dev.fifo_lost, dev.irqs);
+
+    mode_account();
+    if (dev.act_events + dev.inact_events > 0)
+    {
+        double stream_s = (double)dev.stream_ns / SIM_NS_PER_SEC;
+        double idle_s = (double)dev.idle_ns / SIM_NS_PER_SEC;
+        double saved = stream_s > 0 ? dev.stream_xfers / stream_s * idle_s - dev.idle_xfers : 0;
+
+        fprintf(out, "adxl345: fifo streaming %.1f%% of %.3f s, %u activity / %u inactivity events\n",
+                100.0 * stream_s / (stream_s + idle_s), stream_s + idle_s, dev.act_events, dev.inact_events);
+        fprintf(out, "adxl345: %u xfers streaming, %u otherwise, ~%.0f saved vs streaming throughout\n",
+                dev.stream_xfers, dev.idle_xfers, saved);
+    }
+}
+
+void sim_adxl345_init(const char *bus, rt_base_t int1_pin)
+{
+    dev.i2c.name = "adxl345";
+    dev.i2c.addr = ADXL345_I2C_ADDR;
+    dev.i2c.xfer = adxl345_xfer;
+
+    dev.regs[ADXL345_DEVID] = 0xE5;
+    dev.regs[ADXL345_BW_RATE] = 0x0A;
+    dev.grav[0] = 0;
+    dev.grav[1] = 0;
+    dev.grav[2] = 1000;
+    dev.noise = 8;
+    sim_event_init(&dev.sample_ev, sample_tick, RT_NULL);
+
+    dev.int_pin = int1_pin;
+    dev.int_level = 0;
+    dev.int_dev.name = "adxl345.int1";
+    dev.int_dev.level = int_level;
+    sim_pin_attach(int1_pin, &dev.int_dev);
+
+    sim_i2c_attach(bus, &dev.i2c);
+    sim_cmd_register("adxl345", adxl345_cmd,
+                     "adxl345 still | walk <spm> | orient <x> <y> <z> | noise <mg> | trace <csv>|off");
+    sim_report_register("adxl345", adxl345_report);
+}
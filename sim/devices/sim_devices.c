@@ -0,0 +1,66 @@
+/*
+ * 智能手环主机仿真 - 虚拟器件装配 (引脚与总线取自 board/board.h)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "board.h"
+#include "sim_devices.h"
+
+void sim_devices_init(void)
+{
+    /* 软件I2C, 默认100kHz */
+    sim_i2c_bus_create("i2c1", 100000);
+    sim_i2c_bus_create("i2c2", 100000);
+
+    sim_ssd1306_init("i2c1");
+    sim_max30102_init("i2c1", BSP_MAX30102_INT_PIN);
+    sim_adxl345_init("i2c2", BSP_ADXL345_INT1_PIN);
+    sim_ds18b20_init(BSP_DS18B20_PIN);
+    sim_ds1302_init(BSP_DS1302_CLK_PIN, BSP_DS1302_DAT_PIN, BSP_DS1302_RST_PIN);
+    sim_key_init();
+}
+
+/**
+ * @brief 读取整数CSV, 跳过无法解析的行 (如表头)
+ */
+int sim_csv_load(const char *path, int cols, int32_t **data)
+{
+    FILE *fp = fopen(path, "r");
+    char line[256];
+    int32_t *buf = RT_NULL;
+    int rows = 0, cap = 0;
+
+    if (fp == RT_NULL)
+    {
+        fprintf(stderr, "sim: cannot open %s\n", path);
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), fp) != RT_NULL)
+    {
+        char *p = line, *end;
+        int c;
+
+        if (rows == cap)
+        {
+            cap = cap ? cap * 2 : 1024;
+            buf = realloc(buf, sizeof(int32_t) * cols * cap);
+        }
+        for (c = 0; c < cols; c++)
+        {
+            buf[rows * cols + c] = (int32_t)strtol(p, &end, 10);
+            if (end == p)
+                break;
+            p = end;
+            while (*p == ',' || *p == ' ' || *p == '\t' || *p == ';')
+                p++;
+        }
+        if (c == cols)
+            rows++;
+    }
+    fclose(fp);
+
+    *data = buf;
+    return rows;
+}
@@ -0,0 +1,27 @@
+/*
+ * 智能手环主机仿真 - 虚拟器件
+ */
+#ifndef __SIM_DEVICES_H__
+#define __SIM_DEVICES_H__
+
+#include "sim.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void sim_max30102_init(const char *bus, rt_base_t int_pin);
+void sim_ssd1306_init(const char *bus);
+void sim_adxl345_init(const char *bus, rt_base_t int1_pin);
+void sim_ds18b20_init(rt_base_t pin);
+void sim_ds1302_init(rt_base_t clk, rt_base_t dat, rt_base_t rst);
+void sim_key_init(void);
+
+/* 通用CSV读取: 每行最多cols个整数, 返回行数 */
+int sim_csv_load(const char *path, int cols, int32_t **data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SIM_DEVICES_H__ */
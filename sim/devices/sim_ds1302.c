@@ -0,0 +1,387 @@
+/*
+ * 智能手环主机仿真 - 虚拟DS1302 (3线接口)
+ *
+ * CE上升沿开始一次传输, SCLK上升沿采样命令/写数据(低位在前),
+ * 读命令第8个上升沿后的每个下降沿输出一位. 计时由虚拟时间推算,
+ * 可设置晶振误差(ppm). 地址31为突发模式: 时钟突发 (0xBE/0xBF) 连续传送
+ * 秒~写保护8个寄存器, 读时在命令字节处锁存; 写须8个字节全部到齐才生效.
+ * RAM突发 (0xFE/0xFF) 连续传送31个字节.
+ *
+ * 脚本命令:
+ *   ds1302 set <YYYY-MM-DD> <hh:mm:ss> [星期1-7]
+ *   ds1302 drift <ppm>
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim_devices.h"
+
+#define BCD(x)      ((uint8_t)((((x) / 10) << 4) | ((x) % 10)))
+#define DEC(x)      ((((x) >> 4) & 0x0F) * 10 + ((x) & 0x0F))
+
+enum { PIN_CE, PIN_SCLK, PIN_IO, PIN_NUM };
+
+struct rtc_fields
+{
+    int sec, min, hour, day, mon, year, week;
+};
+
+static struct
+{
+    struct sim_pin_dev pin_dev[PIN_NUM];
+    rt_base_t   pins[PIN_NUM];
+    int         level[PIN_NUM];
+
+    /* 传输状态 */
+    uint8_t     active;
+    uint8_t     cmd;
+    uint8_t     shift;
+    uint16_t    bits;
+    uint8_t     out_enable;
+    uint8_t     out_bit;
+    uint8_t     out_byte;
+    uint8_t     burst[31];          /* 突发传输缓冲 */
+    uint8_t     burst_len;          /* 0表示单寄存器命令 */
+
+    /* 计时 */
+    int64_t     base_sec;           /* 自2000-01-01 00:00:00起的秒数 */
+    int         base_week;
+    uint64_t    base_ns;
+    double      drift_ppm;
+    uint8_t     halted;
+    uint8_t     wp;
+    uint8_t     ram[31];
+
+    /* 统计 */
+    uint32_t    transactions;
+    uint32_t    burst_reads;
+    uint32_t    burst_writes;
+    uint64_t    sclk_edges;
+} rtc;
+
+static int64_t days_from_civil(int y, int m, int d)
+{
+    int64_t era, yoe, doy, doe;
+
+    y -= m <= 2;
+    era = y / 400;
+    yoe = y - era * 400;
+    doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 730485;     /* 相对2000-03-01修正到2000-01-01 */
+}
+
+static void civil_from_days(int64_t z, int *y, int *m, int *d)
+{
+    int64_t era, doe, yoe, doy, mp;
+
+    z += 730485;
+    era = z / 146097;
+    doe = z - era * 146097;
+    yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    mp = (5 * doy + 2) / 153;
+    *d = (int)(doy - (153 * mp + 2) / 5 + 1);
+    *m = (int)(mp < 10 ? mp + 3 : mp - 9);
+    *y = (int)(yoe + era * 400 + (*m <= 2));
+}
+
+static int64_t now_sec(void)
+{
+    double elapsed;
+
+    if (rtc.halted)
+        return rtc.base_sec;
+    elapsed = (double)(sim_now_ns() - rtc.base_ns) / 1e9 * (1.0 + rtc.drift_ppm * 1e-6);
+    return rtc.base_sec + (int64_t)elapsed;
+}
+
+static void get_fields(struct rtc_fields *f)
+{
+    int64_t s = now_sec();
+    int64_t days = s / 86400;
+    int64_t base_days = rtc.base_sec / 86400;
+    int rem = (int)(s % 86400);
+
+    civil_from_days(days, &f->year, &f->mon, &f->day);
+    f->hour = rem / 3600;
+    f->min = rem / 60 % 60;
+    f->sec = rem % 60;
+    f->week = (int)((rtc.base_week - 1 + (days - base_days)) % 7) + 1;
+}
+
+static void set_fields(const struct rtc_fields *f)
+{
+    int64_t days = days_from_civil(f->year, f->mon, f->day);
+
+    rtc.base_sec = days * 86400 + f->hour * 3600 + f->min * 60 + f->sec;
+    rtc.base_week = f->week;
+    rtc.base_ns = sim_now_ns();
+}
+
+static uint8_t read_reg(uint8_t addr)
+{
+    struct rtc_fields f;
+
+    get_fields(&f);
+    switch (addr)
+    {
+    case 0: return (uint8_t)(BCD(f.sec) | (rtc.halted ? 0x80 : 0));
+    case 1: return BCD(f.min);
+    case 2: return BCD(f.hour);
+    case 3: return BCD(f.day);
+    case 4: return BCD(f.mon);
+    case 5: return BCD(f.week);
+    case 6: return BCD(f.year % 100);
+    case 7: return rtc.wp ? 0x80 : 0x00;
+    default: return 0;
+    }
+}
+
+static void write_reg(uint8_t addr, uint8_t v)
+{
+    struct rtc_fields f;
+
+    if (addr == 7)
+    {
+        rtc.wp = (v & 0x80) != 0;
+        return;
+    }
+    if (rtc.wp)
+        return;
+
+    get_fields(&f);
+    switch (addr)
+    {
+    case 0:
+        f.sec = DEC(v & 0x7F);
+        rtc.halted = (v & 0x80) != 0;
+        break;
+    case 1: f.min = DEC(v & 0x7F); break;
+    case 2: f.hour = DEC(v & 0x3F); break;
+    case 3: f.day = DEC(v & 0x3F); break;
+    case 4: f.mon = DEC(v & 0x1F); break;
+    case 5: f.week = DEC(v & 0x07); break;
+    case 6: f.year = 2000 + DEC(v); break;
+    default: return;
+    }
+    if (f.mon < 1) f.mon = 1;
+    if (f.day < 1) f.day = 1;
+    if (f.week < 1) f.week = 1;
+    set_fields(&f);
+}
+
+static uint8_t cmd_read_byte(void)
+{
+    uint8_t addr = (rtc.cmd >> 1) & 0x1F;
+
+    if (rtc.cmd & 0x40)
+        return addr < 31 ? rtc.ram[addr] : 0;
+    return read_reg(addr);
+}
+
+static void cmd_write_byte(uint8_t v)
+{
+    uint8_t addr = (rtc.cmd >> 1) & 0x1F;
+
+    if (rtc.cmd & 0x40)
+    {
+        if (addr < 31 && !rtc.wp)
+            rtc.ram[addr] = v;
+        return;
+    }
+    write_reg(addr, v);
+}
+
+/* 时钟突发写: 写保护未打开时整组忽略 */
+static void clock_burst_write(void)
+{
+    int i;
+
+    rtc.burst_writes++;
+    if (rtc.wp)
+        return;
+    for (i = 0; i < 8; i++)
+        write_reg((uint8_t)i, rtc.burst[i]);
+}
+
+static void on_cmd(void)
+{
+    uint8_t addr = (rtc.cmd >> 1) & 0x1F;
+    int i;
+
+    rtc.burst_len = 0;
+    if (addr == 31)
+        rtc.burst_len = (rtc.cmd & 0x40) ? 31 : 8;
+    if (!(rtc.cmd & 0x01))
+        return;
+
+    if (rtc.burst_len == 0)
+    {
+        rtc.out_byte = cmd_read_byte();
+        return;
+    }
+    /* 突发读: 在命令字节处锁存 */
+    for (i = 0; i < rtc.burst_len; i++)
+        rtc.burst[i] = (rtc.cmd & 0x40) ? rtc.ram[i] : read_reg((uint8_t)i);
+    if (!(rtc.cmd & 0x40))
+        rtc.burst_reads++;
+}
+
+static void on_sclk_rise(void)
+{
+    int io = rtc.level[PIN_IO];
+    uint16_t n;
+
+    if (rtc.bits < 8)
+    {
+        rtc.shift = (uint8_t)((rtc.shift >> 1) | (io ? 0x80 : 0));
+        if (++rtc.bits == 8)
+        {
+            rtc.cmd = rtc.shift;
+            on_cmd();
+        }
+        return;
+    }
+
+    if (rtc.cmd & 0x01)
+        return;
+
+    n = rtc.bits - 8;
+    if (n >= (rtc.burst_len ? rtc.burst_len : 1) * 8)
+        return;
+    rtc.shift = (uint8_t)((rtc.shift >> 1) | (io ? 0x80 : 0));
+    rtc.bits++;
+    if ((n & 7) != 7)
+        return;
+    if (rtc.burst_len == 0)
+        cmd_write_byte(rtc.shift);
+    else if (rtc.cmd & 0x40)
+    {
+        if (!rtc.wp)
+            rtc.ram[n / 8] = rtc.shift;
+    }
+    else
+    {
+        rtc.burst[n / 8] = rtc.shift;
+        if (n / 8 == 7)
+            clock_burst_write();
+    }
+}
+
+static void on_sclk_fall(void)
+{
+    uint16_t n;
+
+    if (rtc.bits < 8 || !(rtc.cmd & 0x01))
+        return;
+
+    n = rtc.bits - 8;
+    if (n < (rtc.burst_len ? rtc.burst_len : 1) * 8)
+    {
+        rtc.out_enable = 1;
+        rtc.out_bit = ((rtc.burst_len ? rtc.burst[n / 8] : rtc.out_byte) >> (n & 7)) & 1;
+        rtc.bits++;
+    }
+    else
+    {
+        rtc.out_enable = 0;
+    }
+    sim_pin_update(rtc.pins[PIN_IO]);
+}
+
+static int ds1302_level(struct sim_pin_dev *pd, rt_base_t pin)
+{
+    if (pin == rtc.pins[PIN_IO] && rtc.active && rtc.out_enable)
+        return rtc.out_bit;
+    return 1;
+}
+
+static void ds1302_on_master(struct sim_pin_dev *pd, rt_base_t pin, int level)
+{
+    int which = (int)(pd - rtc.pin_dev);
+    int old = rtc.level[which];
+
+    rtc.level[which] = level;
+    if (old == level)
+        return;
+
+    if (which == PIN_CE)
+    {
+        rtc.active = (uint8_t)level;
+        rtc.bits = 0;
+        rtc.shift = 0;
+        rtc.out_enable = 0;
+        if (level)
+            rtc.transactions++;
+        sim_pin_update(rtc.pins[PIN_IO]);
+    }
+    else if (which == PIN_SCLK && rtc.active)
+    {
+        rtc.sclk_edges++;
+        if (level)
+            on_sclk_rise();
+        else
+            on_sclk_fall();
+    }
+}
+
+static int ds1302_cmd(int argc, char **argv)
+{
+    struct rtc_fields f;
+
+    if (argc >= 4 && strcmp(argv[1], "set") == 0)
+    {
+        if (sscanf(argv[2], "%d-%d-%d", &f.year, &f.mon, &f.day) != 3 ||
+            sscanf(argv[3], "%d:%d:%d", &f.hour, &f.min, &f.sec) != 3)
+            return -RT_EINVAL;
+        f.week = argc >= 5 ? atoi(argv[4]) : 1;
+        set_fields(&f);
+        return 0;
+    }
+    if (argc == 3 && strcmp(argv[1], "drift") == 0)
+    {
+        struct rtc_fields cur;
+        get_fields(&cur);
+        set_fields(&cur);
+        rtc.drift_ppm = atof(argv[2]);
+        return 0;
+    }
+    return -RT_EINVAL;
+}
+
+static void ds1302_report(FILE *out)
+{
+    struct rtc_fields f;
+
+    get_fields(&f);
+    fprintf(out, "ds1302: %u transactions (%u clock burst reads, %u burst writes), %llu sclk edges, "
+            "time %04d-%02d-%02d %02d:%02d:%02d\n",
+            rtc.transactions, rtc.burst_reads, rtc.burst_writes, (unsigned long long)rtc.sclk_edges,
+            f.year, f.mon, f.day, f.hour, f.min, f.sec);
+}
+
+void sim_ds1302_init(rt_base_t clk, rt_base_t dat, rt_base_t rst)
+{
+    static const char *names[PIN_NUM] = {"ds1302.ce", "ds1302.sclk", "ds1302.io"};
+    struct rtc_fields f = {0, 0, 12, 1, 1, 2024, 1};
+    int i;
+
+    rtc.pins[PIN_CE] = rst;
+    rtc.pins[PIN_SCLK] = clk;
+    rtc.pins[PIN_IO] = dat;
+    set_fields(&f);
+    rtc.wp = 1;
+
+    for (i = 0; i < PIN_NUM; i++)
+    {
+        rtc.level[i] = 1;
+        rtc.pin_dev[i].name = names[i];
+        rtc.pin_dev[i].level = ds1302_level;
+        rtc.pin_dev[i].on_master = ds1302_on_master;
+        sim_pin_attach(rtc.pins[i], &rtc.pin_dev[i]);
+    }
+
+    sim_cmd_register("ds1302", ds1302_cmd, "ds1302 set <YYYY-MM-DD> <hh:mm:ss> [week] | drift <ppm>");
+    sim_report_register("ds1302", ds1302_report);
+}
@@ -0,0 +1,460 @@
+/*
+ * 智能手环主机仿真 - 虚拟DS18B20 (1-Wire, 可多个器件挂在同一总线)
+ *
+ * 每个器件独立按主机拉低/释放的虚拟时间戳解码复位脉冲与读写时隙,
+ * 线电平为各器件与主机的线与:
+ *   低电平 >= 480us        复位, 释放后30us起应答120us
+ *   低电平 <  15us         写1 / 读时隙
+ *   低电平 >= 15us         写0
+ * 发送0时从下降沿起拉低30us. 转换时间按分辨率 93.75~750ms,
+ * 上电后未完成转换前暂存器温度为85.0°C.
+ * ROM命令支持 Skip ROM (0xCC)、Match ROM (0x55)、Read ROM (0x33) 与
+ * Search ROM (0xF0): 搜索时每位先发ROM位与反码, 再按主机写入的方向位决定是否继续参与.
+ *
+ * 脚本命令:
+ *   ds18b20 temp <°C>               第0个器件的温度
+ *   ds18b20 temp <序号> <°C>
+ *   ds18b20 add [<°C>]              在总线上增加一个器件 (最多8个)
+ *   ds18b20 warm [<序号>] <°C> <τ秒>  从当前温度按时间常数τ指数趋近 (佩戴后探头升温)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "sim_devices.h"
+
+#define T_RESET_MIN_NS      (480 * SIM_NS_PER_US)
+#define T_SLOT_1_MAX_NS     (15 * SIM_NS_PER_US)
+#define T_PDHIGH_NS         (30 * SIM_NS_PER_US)
+#define T_PDLOW_NS          (120 * SIM_NS_PER_US)
+#define T_TX0_LOW_NS        (30 * SIM_NS_PER_US)
+
+#define OW_MAX_CHIPS        8
+
+enum ow_state
+{
+    OW_IDLE,
+    OW_ROM_CMD,
+    OW_MATCH_ROM,
+    OW_SEARCH,
+    OW_FUNC_CMD,
+    OW_TX,
+    OW_RX_SCRATCH,
+    OW_CONVERT,
+};
+
+struct ds18b20_chip
+{
+    struct sim_pin_dev pin_dev;
+    int         master_level;
+    uint64_t    fall_ns;
+
+    uint8_t     rom[8];
+    uint8_t     scratch[9];
+    double      temp_c;
+    double      warm_from_c;        /* 指数趋近: 起点, 终点为temp_c */
+    double      warm_tau_s;         /* 0表示温度恒定 */
+    uint64_t    warm_start_ns;
+    uint64_t    conv_done_ns;
+    uint8_t     converting;
+
+    enum ow_state state;
+    uint8_t     rx_byte;
+    uint8_t     rx_bits;
+    uint8_t     rx_count;
+    uint8_t     tx_buf[9];
+    uint8_t     tx_len;
+    uint16_t    tx_bit;
+    uint8_t     search_bit;         /* Search ROM: 当前ROM位 */
+    uint8_t     search_phase;       /* 0发ROM位 1发反码 2收方向位 */
+
+    /* 从机驱动的低电平窗口 */
+    uint64_t    pull_start_ns;
+    uint64_t    pull_end_ns;
+
+    uint32_t    conversions;
+    uint32_t    early_reads;
+};
+
+static struct
+{
+    rt_base_t   pin;
+    struct ds18b20_chip chips[OW_MAX_CHIPS];
+    int         nchips;
+
+    /* 统计 (按第0个器件解码的总线事务) */
+    uint32_t    resets;
+    uint64_t    slots;
+    uint32_t    searches;
+    uint32_t    matches;
+    uint32_t    skips;
+} ow;
+
+static uint8_t crc8(const uint8_t *data, int len)
+{
+    uint8_t crc = 0;
+    int i, b;
+
+    for (i = 0; i < len; i++)
+    {
+        uint8_t in = data[i];
+        for (b = 0; b < 8; b++)
+        {
+            uint8_t mix = (crc ^ in) & 0x01;
+            crc >>= 1;
+            if (mix)
+                crc ^= 0x8C;
+            in >>= 1;
+        }
+    }
+    return crc;
+}
+
+static uint64_t conv_time_ns(const struct ds18b20_chip *c)
+{
+    /* 9位93.75ms, 每增加一位翻倍 */
+    return 93750ULL * SIM_NS_PER_US << ((c->scratch[4] >> 5) & 0x03);
+}
+
+static double chip_temp(const struct ds18b20_chip *c)
+{
+    double t;
+
+    if (c->warm_tau_s <= 0)
+        return c->temp_c;
+    t = (double)(sim_now_ns() - c->warm_start_ns) / SIM_NS_PER_SEC;
+    return c->temp_c - (c->temp_c - c->warm_from_c) * exp(-t / c->warm_tau_s);
+}
+
+static void chip_set_temp(struct ds18b20_chip *c, double temp_c, double tau_s)
+{
+    c->warm_from_c = chip_temp(c);
+    c->warm_start_ns = sim_now_ns();
+    c->warm_tau_s = tau_s;
+    c->temp_c = temp_c;
+}
+
+static void chip_latch_temp(struct ds18b20_chip *c)
+{
+    int res = 9 + ((c->scratch[4] >> 5) & 0x03);
+    double temp_c = chip_temp(c);
+    int16_t raw = (int16_t)(temp_c * 16.0 + (temp_c >= 0 ? 0.5 : -0.5));
+
+    /* 低分辨率时未定义位清零 */
+    raw &= (int16_t)~((1 << (12 - res)) - 1);
+    c->scratch[0] = (uint8_t)raw;
+    c->scratch[1] = (uint8_t)((uint16_t)raw >> 8);
+    c->scratch[8] = crc8(c->scratch, 8);
+}
+
+static void chip_poll(struct ds18b20_chip *c)
+{
+    if (c->converting && sim_now_ns() >= c->conv_done_ns)
+    {
+        c->converting = 0;
+        chip_latch_temp(c);
+    }
+}
+
+static void chip_reset(struct ds18b20_chip *c, const uint8_t serial[6])
+{
+    c->rom[0] = 0x28;
+    memcpy(&c->rom[1], serial, 6);
+    c->rom[7] = crc8(c->rom, 7);
+
+    c->scratch[0] = 0x50;       /* 85.0°C */
+    c->scratch[1] = 0x05;
+    c->scratch[2] = 0x4B;
+    c->scratch[3] = 0x46;
+    c->scratch[4] = 0x7F;       /* 12位 */
+    c->scratch[5] = 0xFF;
+    c->scratch[6] = 0x0C;
+    c->scratch[7] = 0x10;
+    c->scratch[8] = crc8(c->scratch, 8);
+    c->temp_c = 25.0;
+    c->converting = 0;
+    c->master_level = 1;
+    c->state = OW_IDLE;
+}
+
+static void start_tx(struct ds18b20_chip *c, const uint8_t *buf, int len)
+{
+    memcpy(c->tx_buf, buf, len);
+    c->tx_len = (uint8_t)len;
+    c->tx_bit = 0;
+    c->state = OW_TX;
+}
+
+static int rom_bit(const struct ds18b20_chip *c, int n)
+{
+    return (c->rom[n / 8] >> (n % 8)) & 1;
+}
+
+/* 本时隙器件要发送的位 (1为释放) */
+static int tx_next_bit(struct ds18b20_chip *c)
+{
+    switch (c->state)
+    {
+    case OW_CONVERT:
+        chip_poll(c);
+        return c->converting ? 0 : 1;
+    case OW_SEARCH:
+        if (c->search_phase == 0)
+            return rom_bit(c, c->search_bit);
+        if (c->search_phase == 1)
+            return !rom_bit(c, c->search_bit);
+        return 1;
+    case OW_TX:
+        if (c->tx_bit >= c->tx_len * 8)
+            return 1;
+        return (c->tx_buf[c->tx_bit / 8] >> (c->tx_bit % 8)) & 1;
+    default:
+        return 1;
+    }
+}
+
+static void handle_byte(struct ds18b20_chip *c, uint8_t b)
+{
+    int primary = (c == &ow.chips[0]);
+
+    switch (c->state)
+    {
+    case OW_ROM_CMD:
+        if (b == 0xCC)
+        {
+            ow.skips += primary;
+            c->state = OW_FUNC_CMD;
+        }
+        else if (b == 0x55)
+        {
+            ow.matches += primary;
+            c->rx_count = 0;
+            c->state = OW_MATCH_ROM;
+        }
+        else if (b == 0xF0)
+        {
+            ow.searches += primary;
+            c->search_bit = 0;
+            c->search_phase = 0;
+            c->state = OW_SEARCH;
+        }
+        else if (b == 0x33)
+            start_tx(c, c->rom, 8);
+        else
+            c->state = OW_IDLE;
+        break;
+
+    case OW_MATCH_ROM:
+        if (b != c->rom[c->rx_count])
+            c->state = OW_IDLE;
+        else if (++c->rx_count == 8)
+            c->state = OW_FUNC_CMD;
+        break;
+
+    case OW_FUNC_CMD:
+        chip_poll(c);
+        if (b == 0x44)
+        {
+            c->converting = 1;
+            c->conv_done_ns = sim_now_ns() + conv_time_ns(c);
+            c->conversions++;
+            c->state = OW_CONVERT;
+        }
+        else if (b == 0xBE)
+        {
+            if (c->converting)
+                c->early_reads++;
+            start_tx(c, c->scratch, 9);
+        }
+        else if (b == 0x4E)
+        {
+            c->rx_count = 0;
+            c->state = OW_RX_SCRATCH;
+        }
+        else
+        {
+            c->state = OW_IDLE;
+        }
+        break;
+
+    case OW_RX_SCRATCH:
+        c->scratch[2 + c->rx_count] = (c->rx_count == 2) ? (uint8_t)((b & 0x60) | 0x1F) : b;
+        c->scratch[8] = crc8(c->scratch, 8);
+        if (++c->rx_count == 3)
+            c->state = OW_IDLE;
+        break;
+
+    default:
+        break;
+    }
+}
+
+static int ds18b20_level(struct sim_pin_dev *pd, rt_base_t pin)
+{
+    struct ds18b20_chip *c = pd->user;
+    uint64_t now = sim_now_ns();
+
+    return !(now >= c->pull_start_ns && now < c->pull_end_ns);
+}
+
+static void ds18b20_on_master(struct sim_pin_dev *pd, rt_base_t pin, int level)
+{
+    struct ds18b20_chip *c = pd->user;
+    int primary = (c == &ow.chips[0]);
+    uint64_t now = sim_now_ns();
+    uint64_t low_ns;
+    int bit;
+
+    if (level == c->master_level)
+        return;
+    c->master_level = level;
+
+    if (!level)
+    {
+        /* 下降沿: 时隙开始, 需要发送0时保持拉低 */
+        c->fall_ns = now;
+        if ((c->state == OW_TX || c->state == OW_CONVERT ||
+             (c->state == OW_SEARCH && c->search_phase < 2)) && !tx_next_bit(c))
+        {
+            c->pull_start_ns = now;
+            c->pull_end_ns = now + T_TX0_LOW_NS;
+        }
+        return;
+    }
+
+    /* 上升沿: 按低电平持续时间分类 */
+    low_ns = now - c->fall_ns;
+    if (low_ns >= T_RESET_MIN_NS)
+    {
+        ow.resets += primary;
+        c->state = OW_ROM_CMD;
+        c->rx_bits = 0;
+        c->rx_byte = 0;
+        c->pull_start_ns = now + T_PDHIGH_NS;
+        c->pull_end_ns = now + T_PDHIGH_NS + T_PDLOW_NS;
+        return;
+    }
+
+    ow.slots += primary;
+    bit = low_ns < T_SLOT_1_MAX_NS;
+    if (c->state == OW_TX)
+    {
+        c->tx_bit++;
+        return;
+    }
+    if (c->state == OW_SEARCH)
+    {
+        if (c->search_phase < 2)
+        {
+            c->search_phase++;
+            return;
+        }
+        /* 方向位与本器件ROM位不同则退出, 搜完64位的器件被选中 */
+        c->search_phase = 0;
+        if (bit != rom_bit(c, c->search_bit))
+            c->state = OW_IDLE;
+        else if (++c->search_bit == 64)
+            c->state = OW_FUNC_CMD;
+        return;
+    }
+    if (c->state == OW_CONVERT || c->state == OW_IDLE)
+        return;
+
+    c->rx_byte >>= 1;
+    if (bit)
+        c->rx_byte |= 0x80;
+    if (++c->rx_bits == 8)
+    {
+        c->rx_bits = 0;
+        handle_byte(c, c->rx_byte);
+    }
+}
+
+static struct ds18b20_chip *chip_add(double temp_c)
+{
+    struct ds18b20_chip *c;
+    uint8_t serial[6] = {0x11, 0x22, 0x33, 0x44, 0x55, 0x01};
+
+    if (ow.nchips >= OW_MAX_CHIPS)
+        return RT_NULL;
+    c = &ow.chips[ow.nchips];
+    /* 序列号各不相同且在多个位上有差别, 搜索要走过多个分叉 */
+    serial[0] ^= (uint8_t)(ow.nchips * 0x5A);
+    serial[5] += (uint8_t)ow.nchips;
+    chip_reset(c, serial);
+    c->temp_c = temp_c;
+    ow.nchips++;
+
+    c->pin_dev.name = "ds18b20";
+    c->pin_dev.level = ds18b20_level;
+    c->pin_dev.on_master = ds18b20_on_master;
+    c->pin_dev.user = c;
+    sim_pin_attach(ow.pin, &c->pin_dev);
+    return c;
+}
+
+static int ds18b20_cmd(int argc, char **argv)
+{
+    if (argc == 3 && strcmp(argv[1], "temp") == 0)
+    {
+        chip_set_temp(&ow.chips[0], atof(argv[2]), 0);
+        return 0;
+    }
+    if (argc == 4 && strcmp(argv[1], "temp") == 0)
+    {
+        int idx = atoi(argv[2]);
+
+        if (idx < 0 || idx >= ow.nchips)
+            return -RT_EINVAL;
+        chip_set_temp(&ow.chips[idx], atof(argv[3]), 0);
+        return 0;
+    }
+    if ((argc == 4 || argc == 5) && strcmp(argv[1], "warm") == 0)
+    {
+        int idx = argc == 5 ? atoi(argv[2]) : 0;
+        double tau = atof(argv[argc - 1]);
+
+        if (idx < 0 || idx >= ow.nchips || tau <= 0)
+            return -RT_EINVAL;
+        chip_set_temp(&ow.chips[idx], atof(argv[argc - 2]), tau);
+        return 0;
+    }
+    if ((argc == 2 || argc == 3) && strcmp(argv[1], "add") == 0)
+        return chip_add(argc == 3 ? atof(argv[2]) : 25.0) != RT_NULL ? 0 : -RT_EFULL;
+    return -RT_EINVAL;
+}
+
+static void ds18b20_report(FILE *out)
+{
+    uint32_t conversions = 0, early = 0;
+    int i;
+
+    for (i = 0; i < ow.nchips; i++)
+    {
+        conversions += ow.chips[i].conversions;
+        early += ow.chips[i].early_reads;
+    }
+    fprintf(out, "ds18b20: %u resets, %llu slots, %u conversions, %u scratchpad reads during conversion\n",
+            ow.resets, (unsigned long long)ow.slots, conversions, early);
+    if (ow.nchips > 1 || ow.searches > 0)
+    {
+        fprintf(out, "ds18b20: %d devices, %u search / %u match / %u skip rom\n",
+                ow.nchips, ow.searches, ow.matches, ow.skips);
+        for (i = 0; i < ow.nchips; i++)
+        {
+            const uint8_t *r = ow.chips[i].rom;
+
+            fprintf(out, "  %d %02X%02X%02X%02X%02X%02X%02X%02X %6.2f C %6u conversions\n", i,
+                    r[0], r[1], r[2], r[3], r[4], r[5], r[6], r[7], chip_temp(&ow.chips[i]), ow.chips[i].conversions);
+        }
+    }
+}
+
+void sim_ds18b20_init(rt_base_t pin)
+{
+    ow.pin = pin;
+    chip_add(25.0);
+
+    sim_cmd_register("ds18b20", ds18b20_cmd, "ds18b20 temp [<idx>] <celsius> | add [<celsius>] | warm [<idx>] <celsius> <tau_s>");
+    sim_report_register("ds18b20", ds18b20_report);
+}
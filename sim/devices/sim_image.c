@@ -0,0 +1,213 @@
+/*
+ * 智能手环主机仿真 - 灰度图像读写 (PGM/PNG)
+ * PNG使用不压缩的deflate块, 不依赖zlib
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim_image.h"
+
+/* ==================== PNG ==================== */
+
+static uint32_t crc_table[256];
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t *p, size_t n)
+{
+    size_t i;
+
+    if (crc_table[1] == 0)
+    {
+        uint32_t c, k;
+
+        for (i = 0; i < 256; i++)
+        {
+            c = (uint32_t)i;
+            for (k = 0; k < 8; k++)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            crc_table[i] = c;
+        }
+    }
+    for (i = 0; i < n; i++)
+        crc = crc_table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+static void put_be32(uint8_t *p, uint32_t v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+static void png_chunk(FILE *fp, const char *type, const uint8_t *data, uint32_t len)
+{
+    uint8_t b[4];
+    uint32_t crc;
+
+    put_be32(b, len);
+    fwrite(b, 1, 4, fp);
+    fwrite(type, 1, 4, fp);
+    if (len)
+        fwrite(data, 1, len, fp);
+    crc = crc32_update(0xFFFFFFFFu, (const uint8_t *)type, 4);
+    crc = crc32_update(crc, data, len) ^ 0xFFFFFFFFu;
+    put_be32(b, crc);
+    fwrite(b, 1, 4, fp);
+}
+
+static int save_png(FILE *fp, const uint8_t *raw, size_t raw_len, int w, int h)
+{
+    static const uint8_t sig[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    size_t blocks = (raw_len + 65534) / 65535, zlen = 2 + blocks * 5 + raw_len + 4, pos = 0, off;
+    uint8_t ihdr[13], *z = malloc(zlen);
+    uint32_t a = 1, b = 0;
+
+    if (z == NULL)
+        return -1;
+
+    /* zlib头 + 存储块 + adler32 */
+    z[pos++] = 0x78;
+    z[pos++] = 0x01;
+    for (off = 0; off < raw_len; off += 65535)
+    {
+        size_t n = raw_len - off > 65535 ? 65535 : raw_len - off;
+
+        z[pos++] = off + n == raw_len;
+        z[pos++] = n & 0xFF;
+        z[pos++] = n >> 8;
+        z[pos++] = ~n & 0xFF;
+        z[pos++] = (~n >> 8) & 0xFF;
+        memcpy(z + pos, raw + off, n);
+        pos += n;
+    }
+    for (off = 0; off < raw_len; off++)
+    {
+        a = (a + raw[off]) % 65521;
+        b = (b + a) % 65521;
+    }
+    put_be32(z + pos, (b << 16) | a);
+    pos += 4;
+
+    put_be32(ihdr, (uint32_t)w);
+    put_be32(ihdr + 4, (uint32_t)h);
+    ihdr[8] = 8;        /* 位深 */
+    ihdr[9] = 0;        /* 灰度 */
+    ihdr[10] = 0;
+    ihdr[11] = 0;
+    ihdr[12] = 0;
+
+    fwrite(sig, 1, sizeof(sig), fp);
+    png_chunk(fp, "IHDR", ihdr, sizeof(ihdr));
+    png_chunk(fp, "IDAT", z, (uint32_t)pos);
+    png_chunk(fp, "IEND", NULL, 0);
+    free(z);
+    return 0;
+}
+
+int sim_image_save(const char *path, const uint8_t *pix, int w, int h, int scale)
+{
+    const char *ext = strrchr(path, '.');
+    int png = ext != NULL && strcmp(ext, ".png") == 0;
+    int sw = w * scale, sh = h * scale, stride = sw + png, x, y, ret = 0;
+    uint8_t *raw;
+    FILE *fp;
+
+    if (scale < 1)
+        return -1;
+    raw = malloc((size_t)stride * sh);
+    if (raw == NULL)
+        return -1;
+    for (y = 0; y < sh; y++)
+    {
+        uint8_t *row = raw + (size_t)y * stride;
+
+        if (png)
+            *row++ = 0;     /* 行滤波: 无 */
+        for (x = 0; x < sw; x++)
+            row[x] = pix[(y / scale) * w + x / scale];
+    }
+
+    fp = fopen(path, "wb");
+    if (fp == NULL)
+    {
+        free(raw);
+        return -1;
+    }
+    if (png)
+    {
+        ret = save_png(fp, raw, (size_t)stride * sh, sw, sh);
+    }
+    else
+    {
+        fprintf(fp, "P5\n%d %d\n255\n", sw, sh);
+        fwrite(raw, 1, (size_t)sw * sh, fp);
+    }
+    if (fclose(fp) != 0)
+        ret = -1;
+    free(raw);
+    return ret;
+}
+
+/* ==================== PGM读取 ==================== */
+
+static int pgm_token(FILE *fp)
+{
+    int c, v = 0, got = 0;
+
+    while ((c = fgetc(fp)) != EOF)
+    {
+        if (c == '#')
+        {
+            while ((c = fgetc(fp)) != EOF && c != '\n')
+                ;
+            continue;
+        }
+        if (c >= '0' && c <= '9')
+        {
+            v = v * 10 + (c - '0');
+            got = 1;
+        }
+        else if (got)
+        {
+            break;
+        }
+    }
+    return got ? v : -1;
+}
+
+int sim_image_load_pgm(const char *path, uint8_t *pix, int w, int h)
+{
+    FILE *fp = fopen(path, "rb");
+    char magic[2];
+    int fw, fh, maxv, i, ret = -1;
+
+    if (fp == NULL)
+        return -1;
+    if (fread(magic, 1, 2, fp) == 2 && magic[0] == 'P' && (magic[1] == '5' || magic[1] == '2'))
+    {
+        fw = pgm_token(fp);
+        fh = pgm_token(fp);
+        maxv = pgm_token(fp);
+        if (fw == w && fh == h && maxv == 255)
+        {
+            if (magic[1] == '5')
+            {
+                ret = fread(pix, 1, (size_t)w * h, fp) == (size_t)w * h ? 0 : -1;
+            }
+            else
+            {
+                for (i = 0, ret = 0; i < w * h && ret == 0; i++)
+                {
+                    int v = pgm_token(fp);
+
+                    if (v < 0)
+                        ret = -1;
+                    pix[i] = (uint8_t)v;
+                }
+            }
+        }
+    }
+    fclose(fp);
+    return ret;
+}
@@ -0,0 +1,24 @@
+/*
+ * 智能手环主机仿真 - 灰度图像读写 (PGM/PNG)
+ * PNG使用不压缩的deflate块, 不依赖zlib
+ */
+#ifndef __SIM_IMAGE_H__
+#define __SIM_IMAGE_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 按扩展名 (.png 或其他为.pgm) 保存8位灰度图, 每像素放大scale倍 */
+int sim_image_save(const char *path, const uint8_t *pix, int w, int h, int scale);
+
+/* 读取8位灰度PGM (P5/P2), 尺寸须与w*h一致, 返回0成功 */
+int sim_image_load_pgm(const char *path, uint8_t *pix, int w, int h);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SIM_IMAGE_H__ */
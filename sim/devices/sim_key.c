@@ -0,0 +1,126 @@
+/*
+ * 智能手环主机仿真 - 按键与蜂鸣器
+ *
+ * 按键按下时拉低对应引脚, 到时自动释放; 蜂鸣器统计鸣响次数与时长.
+ *
+ * 脚本命令:
+ *   key <0-4> press [持续时间, 默认100ms]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "board.h"
+#include "sim_devices.h"
+
+#define KEY_NUM     5
+
+struct sim_key
+{
+    struct sim_pin_dev pin_dev;
+    struct sim_event release;
+    rt_base_t   pin;
+    uint8_t     pressed;
+    uint32_t    presses;
+};
+
+static struct sim_key keys[KEY_NUM];
+
+static struct
+{
+    struct sim_pin_dev pin_dev;
+    int         level;
+    uint64_t    on_since_ns;
+    uint64_t    on_ns;
+    uint32_t    beeps;
+} beep;
+
+static int key_level(struct sim_pin_dev *pd, rt_base_t pin)
+{
+    struct sim_key *k = (struct sim_key *)pd->user;
+    return !k->pressed;
+}
+
+static void key_release(void *arg)
+{
+    struct sim_key *k = (struct sim_key *)arg;
+
+    k->pressed = 0;
+    sim_pin_update(k->pin);
+}
+
+static int key_cmd(int argc, char **argv)
+{
+    struct sim_key *k;
+    int n;
+
+    if (argc < 3 || strcmp(argv[2], "press") != 0)
+        return -RT_EINVAL;
+    n = atoi(argv[1]);
+    if (n < 0 || n >= KEY_NUM)
+        return -RT_EINVAL;
+
+    k = &keys[n];
+    k->pressed = 1;
+    k->presses++;
+    sim_pin_update(k->pin);
+    sim_event_schedule(&k->release,
+                       sim_now_ns() + (argc >= 4 ? sim_parse_time_ns(argv[3]) : 100 * SIM_NS_PER_MS));
+    return 0;
+}
+
+static void beep_on_master(struct sim_pin_dev *pd, rt_base_t pin, int level)
+{
+    if (!sim_pin_is_output(pin) || level == beep.level)
+        return;
+
+    beep.level = level;
+    if (level)
+    {
+        beep.beeps++;
+        beep.on_since_ns = sim_now_ns();
+    }
+    else
+    {
+        beep.on_ns += sim_now_ns() - beep.on_since_ns;
+    }
+}
+
+static void key_report(FILE *out)
+{
+    uint64_t on_ns = beep.on_ns;
+    int i;
+
+    if (beep.level)
+        on_ns += sim_now_ns() - beep.on_since_ns;
+
+    fprintf(out, "key: presses");
+    for (i = 0; i < KEY_NUM; i++)
+        fprintf(out, " %u", keys[i].presses);
+    fprintf(out, "; beep: %u times, %.3f s on\n", beep.beeps, (double)on_ns / SIM_NS_PER_SEC);
+}
+
+void sim_key_init(void)
+{
+    static const rt_base_t pins[KEY_NUM] = {
+        BSP_KEY0_PIN, BSP_KEY1_PIN, BSP_KEY2_PIN, BSP_KEY3_PIN, BSP_KEY4_PIN
+    };
+    static const char *names[KEY_NUM] = {"key0", "key1", "key2", "key3", "key4"};
+    int i;
+
+    for (i = 0; i < KEY_NUM; i++)
+    {
+        keys[i].pin = pins[i];
+        keys[i].pin_dev.name = names[i];
+        keys[i].pin_dev.level = key_level;
+        keys[i].pin_dev.user = &keys[i];
+        sim_event_init(&keys[i].release, key_release, &keys[i]);
+        sim_pin_attach(pins[i], &keys[i].pin_dev);
+    }
+
+    beep.pin_dev.name = "beep";
+    beep.pin_dev.on_master = beep_on_master;
+    sim_pin_attach(BSP_BEEP_PIN, &beep.pin_dev);
+
+    sim_cmd_register("key", key_cmd, "key <0-4> press [duration]");
+    sim_report_register("key", key_report);
+}
@@ -0,0 +1,413 @@
+/*
+ * 智能手环主机仿真 - 虚拟MAX30102
+ *
+ * 32级FIFO按 SPO2_CONFIG采样率 / FIFO_CONFIG平均数 的有效速率产生样本,
+ * 支持写/读指针, 溢出计数, FIFO_DATA连续读, A_FULL/PPG_RDY中断标志.
+ *
+ * 脚本命令:
+ *   max30102 hr <bpm> | spo2 <pct> | finger on|off | noise <lsb>
+ *   max30102 wander <lsb> | perfusion <ratio> | hrv <ratio>
+ *   max30102 trace <csv: red,ir> | trace off
+ *
+ * INT引脚(开漏, 低有效)在已使能的中断标志置位时拉低; 报告中统计从INT拉低到
+ * 主机开始读取指针/FIFO的响应延迟及其抖动.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "drv_max30102.h"
+#include "ppg_synth.h"
+#include "sim_devices.h"
+
+#define FIFO_DEPTH          32
+#define PART_ID             0x15
+#define INTR_A_FULL         0x80
+#define INTR_PPG_RDY        0x40
+#define INTR_PWR_RDY        0x01
+
+static const uint16_t sample_rates[8] = {50, 100, 200, 400, 800, 1000, 1600, 3200};
+static const uint8_t sample_avgs[8] = {1, 2, 4, 8, 16, 32, 32, 32};
+
+static struct
+{
+    struct sim_i2c_dev i2c;
+    uint8_t     regs[256];
+    uint8_t     reg_ptr;
+
+    uint32_t    fifo_red[FIFO_DEPTH];
+    uint32_t    fifo_ir[FIFO_DEPTH];
+    uint8_t     count;
+    uint8_t     byte_idx;           /* 当前样本已读出的字节数 */
+    struct sim_event sample_ev;
+    uint64_t    period_ns;
+
+    struct ppg_synth synth;
+    int32_t     *trace;
+    int         trace_len;
+    int         trace_pos;
+
+    /* INT引脚 */
+    struct sim_pin_dev int_dev;
+    rt_base_t   int_pin;
+    int         int_level;
+    uint64_t    int_since_ns;
+    uint8_t     int_pending;        /* INT已拉低, 主机尚未开始读取 */
+
+    /* 统计 */
+    uint64_t    generated;
+    uint64_t    popped;
+    uint64_t    lost;
+    uint32_t    irqs;
+    uint32_t    serviced;
+    uint64_t    lat_min_ns;
+    uint64_t    lat_max_ns;
+    double      lat_sum_ns;
+    double      lat_sq_sum_ns;
+} dev;
+
+static int active(void)
+{
+    uint8_t mode = dev.regs[REG_MODE_CONFIG];
+    return !(mode & 0x80) && ((mode & 0x07) == 0x02 || (mode & 0x07) == 0x03 || (mode & 0x07) == 0x07);
+}
+
+static int bytes_per_sample(void)
+{
+    return (dev.regs[REG_MODE_CONFIG] & 0x07) == 0x02 ? 3 : 6;
+}
+
+static void update_period(void)
+{
+    uint32_t sr = sample_rates[(dev.regs[REG_SPO2_CONFIG] >> 2) & 0x07];
+    uint32_t avg = sample_avgs[(dev.regs[REG_FIFO_CONFIG] >> 5) & 0x07];
+
+    dev.period_ns = SIM_NS_PER_SEC * avg / sr;
+    dev.synth.fs = (double)sr / avg;
+}
+
+static void set_ptrs_from_count(void)
+{
+    dev.regs[REG_FIFO_WR_PTR] = (dev.regs[REG_FIFO_RD_PTR] + dev.count) & 0x1F;
+}
+
+static void check_a_full(void)
+{
+    uint8_t a_full = dev.regs[REG_FIFO_CONFIG] & 0x0F;
+
+    if (dev.count >= FIFO_DEPTH - a_full)
+        dev.regs[REG_INTR_STATUS_1] |= INTR_A_FULL;
+}
+
+static int int_level(struct sim_pin_dev *pd, rt_base_t pin)
+{
+    return dev.int_level;
+}
+
+/* 中断标志变化后重新计算INT电平, PWR_RDY不可屏蔽 */
+static void int_update(void)
+{
+    int level = !((dev.regs[REG_INTR_STATUS_1] & (dev.regs[REG_INTR_ENABLE_1] | INTR_PWR_RDY)) ||
+                  (dev.regs[REG_INTR_STATUS_2] & dev.regs[REG_INTR_ENABLE_2]));
+
+    if (level == dev.int_level)
+        return;
+    dev.int_level = level;
+    if (!level)
+    {
+        dev.irqs++;
+        dev.int_since_ns = sim_now_ns();
+        dev.int_pending = 1;
+    }
+    if (dev.int_pin >= 0)
+        sim_pin_update(dev.int_pin);
+}
+
+/* 主机开始读取FIFO: 记录INT响应延迟 */
+static void int_serviced(void)
+{
+    uint64_t lat;
+
+    if (!dev.int_pending)
+        return;
+    dev.int_pending = 0;
+    lat = sim_now_ns() - dev.int_since_ns;
+    if (dev.serviced == 0 || lat < dev.lat_min_ns)
+        dev.lat_min_ns = lat;
+    if (lat > dev.lat_max_ns)
+        dev.lat_max_ns = lat;
+    dev.lat_sum_ns += (double)lat;
+    dev.lat_sq_sum_ns += (double)lat * lat;
+    dev.serviced++;
+}
+
+static void next_sample(uint32_t *red, uint32_t *ir)
+{
+    if (dev.trace != RT_NULL && dev.trace_len > 0)
+    {
+        *red = (uint32_t)dev.trace[dev.trace_pos * 2] & 0x3FFFF;
+        *ir = (uint32_t)dev.trace[dev.trace_pos * 2 + 1] & 0x3FFFF;
+        dev.trace_pos = (dev.trace_pos + 1) % dev.trace_len;
+    }
+    else
+    {
+        ppg_synth_next(&dev.synth, red, ir);
+    }
+}
+
+static void sample_tick(void *arg)
+{
+    uint32_t red, ir;
+    uint8_t slot;
+
+    if (!active())
+        return;
+
+    next_sample(&red, &ir);
+    dev.generated++;
+
+    if (dev.count == FIFO_DEPTH)
+    {
+        if (dev.regs[REG_OVF_COUNTER] < 0x1F)
+            dev.regs[REG_OVF_COUNTER]++;
+        if (!(dev.regs[REG_FIFO_CONFIG] & 0x10))
+        {
+            /* 未开启回卷: 新样本丢弃 */
+            dev.lost++;
+            goto next;
+        }
+        /* 回卷: 覆盖最旧样本 */
+        dev.regs[REG_FIFO_RD_PTR] = (dev.regs[REG_FIFO_RD_PTR] + 1) & 0x1F;
+        dev.count--;
+        dev.lost++;
+    }
+
+    slot = dev.regs[REG_FIFO_WR_PTR] & 0x1F;
+    dev.fifo_red[slot] = red;
+    dev.fifo_ir[slot] = ir;
+    dev.count++;
+    set_ptrs_from_count();
+
+    dev.regs[REG_INTR_STATUS_1] |= INTR_PPG_RDY;
+    check_a_full();
+    int_update();
+
+next:
+    sim_event_schedule(&dev.sample_ev, dev.sample_ev.when_ns + dev.period_ns);
+}
+
+static void restart_sampling(void)
+{
+    update_period();
+    sim_event_cancel(&dev.sample_ev);
+    if (active())
+        sim_event_schedule(&dev.sample_ev, sim_now_ns() + dev.period_ns);
+}
+
+static void reset_regs(void)
+{
+    memset(dev.regs, 0, sizeof(dev.regs));
+    dev.regs[REG_INTR_STATUS_1] = INTR_PWR_RDY;
+    dev.regs[REG_REV_ID] = 0x03;
+    dev.regs[REG_PART_ID] = PART_ID;
+    dev.count = 0;
+    dev.byte_idx = 0;
+    restart_sampling();
+    int_update();
+}
+
+static uint8_t fifo_read_byte(void)
+{
+    uint8_t slot = dev.regs[REG_FIFO_RD_PTR] & 0x1F;
+    uint32_t v;
+    uint8_t b;
+    int n = bytes_per_sample();
+
+    /* FIFO为空时重复返回当前读指针处的旧数据, 指针不前进 */
+    v = dev.byte_idx < 3 ? dev.fifo_red[slot] : dev.fifo_ir[slot];
+    b = (uint8_t)(v >> (8 * (2 - dev.byte_idx % 3)));
+
+    if (++dev.byte_idx >= n)
+    {
+        dev.byte_idx = 0;
+        if (dev.count > 0)
+        {
+            dev.regs[REG_FIFO_RD_PTR] = (dev.regs[REG_FIFO_RD_PTR] + 1) & 0x1F;
+            dev.regs[REG_OVF_COUNTER] = 0;     /* 读指针前进时清零 */
+            dev.count--;
+            dev.popped++;
+        }
+    }
+    dev.regs[REG_INTR_STATUS_1] &= ~(INTR_A_FULL | INTR_PPG_RDY);
+    int_update();
+    return b;
+}
+
+static uint8_t read_reg(uint8_t reg)
+{
+    uint8_t v;
+
+    if (reg >= REG_FIFO_WR_PTR && reg <= REG_FIFO_DATA)
+        int_serviced();
+    if (reg == REG_FIFO_DATA)
+        return fifo_read_byte();
+
+    v = dev.regs[reg];
+    if (reg == REG_INTR_STATUS_1 || reg == REG_INTR_STATUS_2)
+    {
+        dev.regs[reg] = 0;
+        int_update();
+    }
+    return v;
+}
+
+static void write_reg(uint8_t reg, uint8_t v)
+{
+    switch (reg)
+    {
+    case REG_MODE_CONFIG:
+        if (v & 0x40)
+        {
+            reset_regs();
+            return;
+        }
+        dev.regs[reg] = v;
+        restart_sampling();
+        break;
+    case REG_SPO2_CONFIG:
+    case REG_FIFO_CONFIG:
+        dev.regs[reg] = v;
+        restart_sampling();
+        break;
+    case REG_FIFO_WR_PTR:
+    case REG_FIFO_RD_PTR:
+        dev.regs[reg] = v & 0x1F;
+        dev.count = (dev.regs[REG_FIFO_WR_PTR] - dev.regs[REG_FIFO_RD_PTR]) & 0x1F;
+        dev.byte_idx = 0;
+        break;
+    case REG_OVF_COUNTER:
+        dev.regs[reg] = v & 0x1F;
+        break;
+    case REG_INTR_ENABLE_1:
+    case REG_INTR_ENABLE_2:
+        dev.regs[reg] = v;
+        int_update();
+        break;
+    case REG_INTR_STATUS_1:
+    case REG_INTR_STATUS_2:
+    case REG_REV_ID:
+    case REG_PART_ID:
+        break;
+    default:
+        dev.regs[reg] = v;
+        break;
+    }
+}
+
+static int max30102_xfer(struct sim_i2c_dev *i2c, struct rt_i2c_msg *msgs, int num)
+{
+    int i, k;
+
+    for (i = 0; i < num; i++)
+    {
+        struct rt_i2c_msg *m = &msgs[i];
+
+        if (m->flags & RT_I2C_RD)
+        {
+            for (k = 0; k < m->len; k++)
+            {
+                m->buf[k] = read_reg(dev.reg_ptr);
+                if (dev.reg_ptr != REG_FIFO_DATA)
+                    dev.reg_ptr++;
+            }
+        }
+        else if (m->len > 0)
+        {
+            dev.reg_ptr = m->buf[0];
+            for (k = 1; k < m->len; k++)
+            {
+                write_reg(dev.reg_ptr, m->buf[k]);
+                if (dev.reg_ptr != REG_FIFO_DATA)
+                    dev.reg_ptr++;
+            }
+        }
+    }
+    return num;
+}
+
+static int max30102_cmd(int argc, char **argv)
+{
+    if (argc < 3)
+        return -RT_EINVAL;
+
+    if (strcmp(argv[1], "hr") == 0)
+        dev.synth.hr_bpm = atof(argv[2]);
+    else if (strcmp(argv[1], "spo2") == 0)
+        dev.synth.spo2 = atof(argv[2]);
+    else if (strcmp(argv[1], "finger") == 0)
+        dev.synth.finger = strcmp(argv[2], "on") == 0;
+    else if (strcmp(argv[1], "noise") == 0)
+        dev.synth.noise = atoi(argv[2]);
+    else if (strcmp(argv[1], "wander") == 0)
+        dev.synth.wander = atoi(argv[2]);
+    else if (strcmp(argv[1], "perfusion") == 0)
+        dev.synth.perfusion = atof(argv[2]);
+    else if (strcmp(argv[1], "hrv") == 0)
+        dev.synth.hrv = atof(argv[2]);
+    else if (strcmp(argv[1], "trace") == 0)
+    {
+        free(dev.trace);
+        dev.trace = RT_NULL;
+        dev.trace_len = 0;
+        dev.trace_pos = 0;
+        if (strcmp(argv[2], "off") != 0)
+        {
+            dev.trace_len = sim_csv_load(argv[2], 2, &dev.trace);
+            if (dev.trace_len <= 0)
+                return -RT_EIO;
+        }
+    }
+    else
+        return -RT_EINVAL;
+    return 0;
+}
+
+static void max30102_report(FILE *out)
+{
+    fprintf(out, "max30102: %llu samples generated, %llu read, %llu lost to overflow\n",
+            (unsigned long long)dev.generated, (unsigned long long)dev.popped,
+            (unsigned long long)dev.lost);
+    if (dev.serviced > 0)
+    {
+        double avg = dev.lat_sum_ns / dev.serviced;
+        double var = dev.lat_sq_sum_ns / dev.serviced - avg * avg;
+
+        fprintf(out, "max30102: int %u asserted, %u serviced, latency avg %.3f ms "
+                "min %.3f max %.3f jitter %.3f ms\n",
+                dev.irqs, dev.serviced, avg / SIM_NS_PER_MS,
+                (double)dev.lat_min_ns / SIM_NS_PER_MS, (double)dev.lat_max_ns / SIM_NS_PER_MS,
+                sqrt(var > 0 ? var : 0) / SIM_NS_PER_MS);
+    }
+}
+
+void sim_max30102_init(const char *bus, rt_base_t int_pin)
+{
+    dev.i2c.name = "max30102";
+    dev.i2c.addr = MAX30102_I2C_ADDR;
+    dev.i2c.xfer = max30102_xfer;
+    sim_event_init(&dev.sample_ev, sample_tick, RT_NULL);
+    ppg_synth_init(&dev.synth, 50);
+    dev.int_pin = -1;
+    dev.int_level = 1;
+    reset_regs();
+
+    dev.int_pin = int_pin;
+    dev.int_dev.name = "max30102.int";
+    dev.int_dev.level = int_level;
+    sim_pin_attach(int_pin, &dev.int_dev);
+
+    sim_i2c_attach(bus, &dev.i2c);
+    sim_cmd_register("max30102", max30102_cmd,
+                     "max30102 hr|spo2|finger|noise|wander|perfusion|hrv|trace <value>");
+    sim_report_register("max30102", max30102_report);
+}
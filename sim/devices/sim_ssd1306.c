@@ -0,0 +1,601 @@
+/*
+ * 智能手环主机仿真 - 虚拟SSD1306 (128x64, I2C)
+ *
+ * 解析控制字节(Co/D#C)后的命令流与数据流, 命令解析状态跨传输保持,
+ * 与真实芯片一致. 支持页/水平/垂直三种地址模式及列/页地址窗口,
+ * 段重映射(0xA0/0xA1)在写入时生效, COM扫描方向(0xC0/0xC8)、起始行、
+ * 显示偏移、复用比、对比度、反显与全亮在输出时生效.
+ * 模组按 0xA1 + 0xC8 正向安装, 即此配置下GDDRAM第0列第0行在左上角.
+ *
+ * 水平滚动 (0x26/0x27, 及0x29/0x2A的水平部分) 按列地址方向循环移动GDDRAM,
+ * 启动 (0x2F) 后每 间隔帧数 x 帧周期 移动一列, 帧周期由0xD5/0xD9/0xA8推算;
+ * 帧时钟自上电起自由运行, 步进落在帧计数的整数倍上, 与启动时刻无关, 所以
+ * 启停之间移动的列数随相位变化, 与真实芯片一样. 垂直滚动偏移不模拟.
+ * 滚动中写GDDRAM计为违例.
+ *
+ * 帧统计: 距上一次传输结束超过 FRAME_GAP_NS 的传输开始新的一帧,
+ * 统计每帧的传输数、总线字节数 (含地址字节) 及100/400kHz下的总线时间.
+ *
+ * 脚本命令:
+ *   oled dump                          以字符画打印当前GDDRAM
+ *   oled save <文件.pgm|.png> [倍数]   保存当前屏幕画面
+ *   oled capture <前缀> [pgm|png] [倍数]  每帧结束时保存画面为 <前缀>_NNNN.<扩展名>
+ *   oled capture off
+ *   oled log <文件.csv>                每帧一行写入统计
+ *   oled expect <文件.pgm>             与参考画面比较, 不一致计为仿真失败
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "drv_oled.h"
+#include "sim_devices.h"
+#include "sim_image.h"
+
+#define FRAME_GAP_NS    (5 * 1000000ULL)
+
+struct frame_stat
+{
+    uint32_t    xfers;
+    uint32_t    bytes;
+    uint64_t    ns_100k;
+    uint64_t    ns_400k;
+};
+
+static struct
+{
+    struct sim_i2c_dev i2c;
+    uint8_t     gddram[OLED_PAGES][OLED_WIDTH];   /* 按段(SEG)存放 */
+    uint8_t     page;
+    uint8_t     col;
+
+    /* 地址模式: 0水平, 1垂直, 2页 */
+    uint8_t     addr_mode;
+    uint8_t     col_start, col_end;
+    uint8_t     page_start, page_end;
+
+    /* 显示配置 */
+    uint8_t     display_on;
+    uint8_t     seg_remap;
+    uint8_t     com_remap;
+    uint8_t     start_line;
+    uint8_t     offset;
+    uint8_t     mux;
+    uint8_t     contrast;
+    uint8_t     inverse;
+    uint8_t     entire_on;
+    uint8_t     charge_pump;
+    uint8_t     clock;          /* 0xD5: 高4位振荡频率, 低4位分频-1 */
+    uint8_t     precharge;      /* 0xD9: 低4位阶段1, 高4位阶段2 */
+
+    /* 水平滚动 */
+    uint8_t     scroll_left;
+    uint8_t     scroll_page0, scroll_page1;
+    uint16_t    scroll_frames;  /* 每步帧数 */
+    uint8_t     scroll_active;
+    uint64_t    scroll_start_ns;
+    uint64_t    scroll_done;    /* 本次启动后已移动的列数 */
+    uint64_t    scroll_steps;
+    uint32_t    scroll_starts;
+    uint32_t    scroll_writes;  /* 滚动中写入GDDRAM的字节数 */
+
+    /* 多字节命令解析 */
+    uint8_t     cmd;
+    uint8_t     args_left;
+    uint8_t     args[6];
+    uint8_t     nargs;
+
+    /* 统计 */
+    uint64_t    cmd_bytes;
+    uint64_t    data_bytes;
+
+    /* 帧统计 */
+    uint64_t    last_xfer_ns;
+    uint64_t    last_busy_ns;       /* 上一次传输开始时总线占用累计, 用于求其结束时刻 */
+    uint64_t    frame_start_ns;
+    struct frame_stat cur, sum, max;
+    uint32_t    frames;
+
+    /* 画面输出 */
+    char        capture_prefix[200];
+    char        capture_ext[4];
+    int         capture_scale;
+    FILE       *log;
+} dev;
+
+/* ==================== 滚动 ==================== */
+
+/**
+ * @brief 帧周期 = 分频 x (阶段1 + 阶段2 + 50) x 复用比 / 振荡频率
+ * 振荡频率按复位值8约370kHz、每档约24kHz近似
+ */
+static uint64_t frame_ns(void)
+{
+    double fosc = 175e3 + 24.3e3 * (dev.clock >> 4);
+    int div = (dev.clock & 0x0F) + 1;
+    int clocks = (dev.precharge & 0x0F) + (dev.precharge >> 4) + 50;
+
+    return (uint64_t)(1e9 * div * clocks * (dev.mux + 1) / fosc);
+}
+
+static void scroll_step(void)
+{
+    uint8_t row[OLED_WIDTH];
+    int page, c;
+
+    for (page = dev.scroll_page0; page <= dev.scroll_page1; page++)
+    {
+        /* 按列地址顺序取出, 移动后放回 */
+        for (c = 0; c < OLED_WIDTH; c++)
+            row[c] = dev.gddram[page][dev.seg_remap ? OLED_WIDTH - 1 - c : c];
+        for (c = 0; c < OLED_WIDTH; c++)
+        {
+            int from = dev.scroll_left ? (c + 1) % OLED_WIDTH : (c + OLED_WIDTH - 1) % OLED_WIDTH;
+
+            dev.gddram[page][dev.seg_remap ? OLED_WIDTH - 1 - c : c] = row[from];
+        }
+    }
+    dev.scroll_done++;
+    dev.scroll_steps++;
+}
+
+/**
+ * @brief 执行到当前时刻为止应发生的滚动步进
+ */
+static void scroll_advance(void)
+{
+    uint64_t step_ns, due;
+
+    if (!dev.scroll_active)
+        return;
+    step_ns = frame_ns() * dev.scroll_frames;
+    due = sim_now_ns() / step_ns - dev.scroll_start_ns / step_ns;
+    while (dev.scroll_done < due)
+        scroll_step();
+}
+
+static void scroll_setup(int left, uint8_t page0, uint8_t interval, uint8_t page1)
+{
+    static const uint16_t frames[8] = {5, 64, 128, 256, 3, 4, 25, 2};
+
+    dev.scroll_left = left;
+    dev.scroll_page0 = page0 & 0x07;
+    dev.scroll_page1 = page1 & 0x07;
+    dev.scroll_frames = frames[interval & 0x07];
+    if (dev.scroll_page1 < dev.scroll_page0)
+        dev.scroll_page1 = dev.scroll_page0;
+}
+
+/* ==================== 画面 ==================== */
+
+/**
+ * @brief 按当前显示配置生成面板画面, 每像素一字节灰度
+ */
+static void render(uint8_t pix[OLED_HEIGHT][OLED_WIDTH])
+{
+    uint8_t on = (uint8_t)(64 + dev.contrast * 191 / 255);
+    int x, y;
+
+    scroll_advance();
+    for (y = 0; y < OLED_HEIGHT; y++)
+    {
+        /* 模组在0xC8下正向安装: 第y行由COM(63-y)驱动 */
+        int com = OLED_HEIGHT - 1 - y;
+        int row = dev.com_remap ? OLED_HEIGHT - 1 - com : com;
+        int ram = (row + dev.start_line + dev.offset) & (OLED_HEIGHT - 1);
+
+        for (x = 0; x < OLED_WIDTH; x++)
+        {
+            /* 模组在0xA1下正向安装: 第x列为SEG(127-x) */
+            int seg = OLED_WIDTH - 1 - x;
+            int lit = (dev.gddram[ram / 8][seg] >> (ram % 8)) & 1;
+
+            if (dev.entire_on)
+                lit = 1;
+            else if (dev.inverse)
+                lit = !lit;
+            if (!dev.display_on || row > dev.mux)
+                lit = 0;
+            pix[y][x] = lit ? on : 0;
+        }
+    }
+}
+
+static int save_frame(const char *path, int scale)
+{
+    uint8_t pix[OLED_HEIGHT][OLED_WIDTH];
+
+    render(pix);
+    return sim_image_save(path, &pix[0][0], OLED_WIDTH, OLED_HEIGHT, scale);
+}
+
+/* ==================== 帧统计 ==================== */
+
+static void frame_close(void)
+{
+    if (dev.cur.xfers == 0)
+        return;
+    dev.frames++;
+    dev.sum.xfers += dev.cur.xfers;
+    dev.sum.bytes += dev.cur.bytes;
+    dev.sum.ns_100k += dev.cur.ns_100k;
+    dev.sum.ns_400k += dev.cur.ns_400k;
+    if (dev.cur.xfers > dev.max.xfers) dev.max.xfers = dev.cur.xfers;
+    if (dev.cur.bytes > dev.max.bytes) dev.max.bytes = dev.cur.bytes;
+    if (dev.cur.ns_100k > dev.max.ns_100k) dev.max.ns_100k = dev.cur.ns_100k;
+    if (dev.cur.ns_400k > dev.max.ns_400k) dev.max.ns_400k = dev.cur.ns_400k;
+
+    if (dev.log != NULL)
+        fprintf(dev.log, "%u,%.3f,%u,%u,%.3f,%.3f\n", dev.frames, dev.frame_start_ns / 1e6,
+                dev.cur.xfers, dev.cur.bytes, dev.cur.ns_100k / 1e6, dev.cur.ns_400k / 1e6);
+    if (dev.capture_prefix[0] != '\0')
+    {
+        char path[256];
+
+        snprintf(path, sizeof(path), "%s_%04u.%s", dev.capture_prefix, dev.frames, dev.capture_ext);
+        if (save_frame(path, dev.capture_scale) != 0)
+            fprintf(stderr, "ssd1306: cannot write %s\n", path);
+    }
+    memset(&dev.cur, 0, sizeof(dev.cur));
+}
+
+/* ==================== 命令与数据 ==================== */
+
+static uint8_t cmd_arg_count(uint8_t cmd)
+{
+    switch (cmd)
+    {
+    case 0x20: case 0x81: case 0x8D: case 0xA8: case 0xD3:
+    case 0xD5: case 0xD9: case 0xDA: case 0xDB:
+        return 1;
+    case 0x21: case 0x22: case 0xA3:
+        return 2;
+    case 0x29: case 0x2A:
+        return 5;
+    case 0x26: case 0x27:
+        return 6;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * @brief 执行带参数的命令, 参数已收齐
+ */
+static void exec_args(void)
+{
+    switch (dev.cmd)
+    {
+    case 0x20:
+        dev.addr_mode = dev.args[0] & 0x03;
+        if (dev.addr_mode == 3)
+            dev.addr_mode = 2;      /* 无效值, 芯片保持页模式处理 */
+        break;
+    case 0x21:
+        dev.col_start = dev.args[0] & 0x7F;
+        dev.col_end = dev.args[1] & 0x7F;
+        dev.col = dev.col_start;
+        break;
+    case 0x22:
+        dev.page_start = dev.args[0] & 0x07;
+        dev.page_end = dev.args[1] & 0x07;
+        dev.page = dev.page_start;
+        break;
+    case 0x81:
+        dev.contrast = dev.args[0];
+        break;
+    case 0x8D:
+        dev.charge_pump = (dev.args[0] & 0x04) != 0;
+        break;
+    case 0xA8:
+        dev.mux = dev.args[0] & 0x3F;
+        break;
+    case 0xD3:
+        dev.offset = dev.args[0] & 0x3F;
+        break;
+    case 0xD5:
+        dev.clock = dev.args[0];
+        break;
+    case 0xD9:
+        dev.precharge = dev.args[0];
+        break;
+    case 0x26: case 0x27: case 0x29: case 0x2A:
+        scroll_setup(dev.cmd == 0x27 || dev.cmd == 0x2A, dev.args[1], dev.args[2], dev.args[3]);
+        break;
+    default:
+        /* COM引脚配置、VCOMH、垂直滚动区域: 不影响画面 */
+        break;
+    }
+}
+
+static void exec_cmd(uint8_t c)
+{
+    if (dev.args_left > 0)
+    {
+        dev.args[dev.nargs++] = c;
+        if (--dev.args_left == 0)
+            exec_args();
+        return;
+    }
+
+    dev.cmd = c;
+    dev.nargs = 0;
+    dev.args_left = cmd_arg_count(c);
+    if (dev.args_left > 0)
+        return;
+
+    if (c <= 0x0F)
+        dev.col = (dev.col & 0xF0) | c;
+    else if (c <= 0x1F)
+        dev.col = (uint8_t)(((c & 0x07) << 4) | (dev.col & 0x0F));
+    else if (c >= 0x40 && c <= 0x7F)
+        dev.start_line = c & 0x3F;
+    else if (c == 0xA0 || c == 0xA1)
+        dev.seg_remap = c & 1;
+    else if (c == 0xA4 || c == 0xA5)
+        dev.entire_on = c & 1;
+    else if (c == 0xA6 || c == 0xA7)
+        dev.inverse = c & 1;
+    else if (c == 0xAE || c == 0xAF)
+        dev.display_on = c & 1;
+    else if (c >= 0xB0 && c <= 0xB7)
+        dev.page = c & 0x07;
+    else if (c == 0xC0 || c == 0xC8)
+        dev.com_remap = (c & 0x08) != 0;
+    else if (c == 0x2E)
+    {
+        scroll_advance();
+        dev.scroll_active = 0;
+    }
+    else if (c == 0x2F && !dev.scroll_active)
+    {
+        dev.scroll_active = 1;
+        dev.scroll_start_ns = sim_now_ns();
+        dev.scroll_done = 0;
+        dev.scroll_starts++;
+    }
+}
+
+static void write_data(uint8_t d)
+{
+    /* 段重映射只影响之后写入的数据 */
+    uint8_t seg = dev.seg_remap ? OLED_WIDTH - 1 - dev.col : dev.col;
+
+    if (dev.scroll_active)
+    {
+        /* 手册要求滚动中不得写RAM */
+        scroll_advance();
+        dev.scroll_writes++;
+    }
+    dev.gddram[dev.page][seg] = d;
+
+    switch (dev.addr_mode)
+    {
+    case 0:     /* 水平: 列到窗口末尾换页 */
+        if (dev.col >= dev.col_end)
+        {
+            dev.col = dev.col_start;
+            dev.page = dev.page >= dev.page_end ? dev.page_start : dev.page + 1;
+        }
+        else
+        {
+            dev.col++;
+        }
+        break;
+    case 1:     /* 垂直: 页到窗口末尾换列 */
+        if (dev.page >= dev.page_end)
+        {
+            dev.page = dev.page_start;
+            dev.col = dev.col >= dev.col_end ? dev.col_start : dev.col + 1;
+        }
+        else
+        {
+            dev.page++;
+        }
+        break;
+    default:    /* 页: 列到末尾后回到0, 页不变 */
+        dev.col = (dev.col + 1) & (OLED_WIDTH - 1);
+        break;
+    }
+}
+
+static int ssd1306_xfer(struct sim_i2c_dev *i2c, struct rt_i2c_msg *msgs, int num)
+{
+    uint64_t now = sim_now_ns();
+    int i, k;
+
+    if (now - (dev.last_xfer_ns + dev.i2c.busy_ns - dev.last_busy_ns) > FRAME_GAP_NS)
+    {
+        frame_close();
+        dev.frame_start_ns = now;
+    }
+    dev.last_xfer_ns = now;
+    dev.last_busy_ns = dev.i2c.busy_ns;
+    dev.cur.xfers++;
+    dev.cur.ns_100k += sim_i2c_xfer_ns(100000, msgs, num);
+    dev.cur.ns_400k += sim_i2c_xfer_ns(400000, msgs, num);
+
+    for (i = 0; i < num; i++)
+    {
+        struct rt_i2c_msg *m = &msgs[i];
+        uint8_t ctrl = 0x00;
+        int expect_ctrl = 1;
+
+        dev.cur.bytes += m->len + ((m->flags & RT_I2C_NO_START) ? 0 : 1);
+        if (m->flags & RT_I2C_RD)
+            continue;
+
+        for (k = 0; k < m->len; k++)
+        {
+            if (expect_ctrl)
+            {
+                /* 控制字节: Co=1时每个字节前都有控制字节 */
+                ctrl = m->buf[k];
+                expect_ctrl = 0;
+                continue;
+            }
+            if (ctrl & 0x40)
+            {
+                write_data(m->buf[k]);
+                dev.data_bytes++;
+            }
+            else
+            {
+                exec_cmd(m->buf[k]);
+                dev.cmd_bytes++;
+            }
+            if (ctrl & 0x80)
+                expect_ctrl = 1;
+        }
+    }
+    return num;
+}
+
+/* ==================== 脚本命令与报告 ==================== */
+
+static void dump(FILE *out)
+{
+    int y, x;
+
+    fprintf(out, "+");
+    for (x = 0; x < OLED_WIDTH; x++)
+        fputc('-', out);
+    fprintf(out, "+\n");
+    for (y = 0; y < OLED_HEIGHT; y += 2)
+    {
+        fputc('|', out);
+        for (x = 0; x < OLED_WIDTH; x++)
+        {
+            int top = (dev.gddram[y / 8][x] >> (y % 8)) & 1;
+            int bot = (dev.gddram[(y + 1) / 8][x] >> ((y + 1) % 8)) & 1;
+            fputc(top && bot ? '#' : top ? '"' : bot ? '.' : ' ', out);
+        }
+        fprintf(out, "|\n");
+    }
+    fprintf(out, "+");
+    for (x = 0; x < OLED_WIDTH; x++)
+        fputc('-', out);
+    fprintf(out, "+\n");
+}
+
+static int expect(const char *path)
+{
+    uint8_t pix[OLED_HEIGHT][OLED_WIDTH], ref[OLED_HEIGHT][OLED_WIDTH];
+    char actual[256];
+    int i, diff = 0;
+
+    render(pix);
+    snprintf(actual, sizeof(actual), "%s.actual.pgm", path);
+    if (sim_image_load_pgm(path, &ref[0][0], OLED_WIDTH, OLED_HEIGHT) != 0)
+    {
+        /* 参考画面缺失时同样保存实际画面, 便于生成参考 */
+        sim_image_save(actual, &pix[0][0], OLED_WIDTH, OLED_HEIGHT, 1);
+        printf("ssd1306: expect %s: cannot read 128x64 PGM, actual frame saved to %s\n", path, actual);
+        sim_failures++;
+        return 0;
+    }
+    for (i = 0; i < OLED_WIDTH * OLED_HEIGHT; i++)
+        diff += (&pix[0][0])[i] != (&ref[0][0])[i];
+    if (diff == 0)
+    {
+        printf("ssd1306: expect %s: match\n", path);
+        return 0;
+    }
+    sim_image_save(actual, &pix[0][0], OLED_WIDTH, OLED_HEIGHT, 1);
+    printf("ssd1306: expect %s: %d pixels differ, actual frame saved to %s\n", path, diff, actual);
+    sim_failures++;
+    return 0;
+}
+
+static int oled_cmd(int argc, char **argv)
+{
+    if (argc == 2 && strcmp(argv[1], "dump") == 0)
+    {
+        dump(stdout);
+        return 0;
+    }
+    if (argc >= 3 && strcmp(argv[1], "save") == 0)
+    {
+        if (save_frame(argv[2], argc > 3 ? atoi(argv[3]) : 1) != 0)
+        {
+            fprintf(stderr, "ssd1306: cannot write %s\n", argv[2]);
+            return -RT_ERROR;
+        }
+        return 0;
+    }
+    if (argc >= 3 && strcmp(argv[1], "capture") == 0)
+    {
+        if (strcmp(argv[2], "off") == 0)
+        {
+            dev.capture_prefix[0] = '\0';
+            return 0;
+        }
+        snprintf(dev.capture_prefix, sizeof(dev.capture_prefix), "%s", argv[2]);
+        snprintf(dev.capture_ext, sizeof(dev.capture_ext), "%s",
+                 argc > 3 && strcmp(argv[3], "png") == 0 ? "png" : "pgm");
+        dev.capture_scale = argc > 4 ? atoi(argv[4]) : 1;
+        if (dev.capture_scale < 1)
+            dev.capture_scale = 1;
+        return 0;
+    }
+    if (argc == 3 && strcmp(argv[1], "log") == 0)
+    {
+        if (dev.log != NULL)
+            fclose(dev.log);
+        dev.log = fopen(argv[2], "w");
+        if (dev.log == NULL)
+            return -RT_ERROR;
+        fprintf(dev.log, "frame,start_ms,xfers,bytes,bus_ms_100k,bus_ms_400k\n");
+        return 0;
+    }
+    if (argc == 3 && strcmp(argv[1], "expect") == 0)
+        return expect(argv[2]);
+    return -RT_EINVAL;
+}
+
+static void ssd1306_report(FILE *out)
+{
+    static const char *mode_name[] = {"horizontal", "vertical", "page"};
+
+    fprintf(out, "ssd1306: %llu command bytes, %llu data bytes, display %s, %s addressing, "
+            "remap seg %d com %d, contrast %u\n",
+            (unsigned long long)dev.cmd_bytes, (unsigned long long)dev.data_bytes,
+            dev.display_on ? "on" : "off", mode_name[dev.addr_mode],
+            dev.seg_remap, dev.com_remap, dev.contrast);
+    if (dev.scroll_starts)
+        fprintf(out, "ssd1306: scroll started %u times, %llu columns moved, %u bytes written while scrolling\n",
+                dev.scroll_starts, (unsigned long long)dev.scroll_steps, dev.scroll_writes);
+    frame_close();
+    if (dev.frames)
+    {
+        fprintf(out, "ssd1306: %u frames, avg %.1f xfers / %.1f bytes per frame, max %u xfers / %u bytes\n",
+                dev.frames, (double)dev.sum.xfers / dev.frames, (double)dev.sum.bytes / dev.frames,
+                dev.max.xfers, dev.max.bytes);
+        fprintf(out, "ssd1306: bus time per frame avg %.3f ms @100kHz / %.3f ms @400kHz, "
+                "max %.3f / %.3f ms\n",
+                dev.sum.ns_100k / 1e6 / dev.frames, dev.sum.ns_400k / 1e6 / dev.frames,
+                dev.max.ns_100k / 1e6, dev.max.ns_400k / 1e6);
+    }
+    if (dev.log != NULL)
+        fflush(dev.log);
+}
+
+void sim_ssd1306_init(const char *bus)
+{
+    dev.i2c.name = "ssd1306";
+    dev.i2c.addr = OLED_I2C_ADDR;
+    dev.i2c.xfer = ssd1306_xfer;
+
+    /* 复位状态 */
+    dev.addr_mode = 2;
+    dev.col_end = OLED_WIDTH - 1;
+    dev.page_end = OLED_PAGES - 1;
+    dev.mux = OLED_HEIGHT - 1;
+    dev.contrast = 0x7F;
+    dev.clock = 0x80;
+    dev.precharge = 0x22;
+
+    sim_i2c_attach(bus, &dev.i2c);
+    sim_cmd_register("oled", oled_cmd, "oled dump | save <f.pgm|f.png> [scale] | "
+                     "capture <prefix> [pgm|png] [scale] | capture off | log <f.csv> | expect <f.pgm>");
+    sim_report_register("ssd1306", ssd1306_report);
+}
@@ -0,0 +1,208 @@
+/*
+ * 主机仿真 - RT-Thread基础类型与对象定义
+ * 仅保留本工程用到的子集, 语义与RT-Thread 4.x保持一致
+ */
+#ifndef __RT_DEF_H__
+#define __RT_DEF_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 基础类型 */
+typedef int8_t                          rt_int8_t;
+typedef int16_t                         rt_int16_t;
+typedef int32_t                         rt_int32_t;
+typedef int64_t                         rt_int64_t;
+typedef uint8_t                         rt_uint8_t;
+typedef uint16_t                        rt_uint16_t;
+typedef uint32_t                        rt_uint32_t;
+typedef uint64_t                        rt_uint64_t;
+typedef int                             rt_bool_t;
+typedef long                            rt_base_t;
+typedef unsigned long                   rt_ubase_t;
+typedef rt_base_t                       rt_err_t;
+typedef rt_uint32_t                     rt_time_t;
+typedef rt_uint32_t                     rt_tick_t;
+typedef rt_base_t                       rt_flag_t;
+typedef rt_ubase_t                      rt_size_t;
+typedef rt_base_t                       rt_ssize_t;
+typedef rt_base_t                       rt_off_t;
+
+#define RT_TRUE                         1
+#define RT_FALSE                        0
+#define RT_NULL                         ((void *)0)
+
+#define RT_UINT8_MAX                    0xff
+#define RT_UINT16_MAX                   0xffff
+#define RT_UINT32_MAX                   0xffffffff
+#define RT_TICK_MAX                     RT_UINT32_MAX
+
+/* 错误码 */
+#define RT_EOK                          0
+#define RT_ERROR                        1
+#define RT_ETIMEOUT                     2
+#define RT_EFULL                        3
+#define RT_EEMPTY                       4
+#define RT_ENOMEM                       5
+#define RT_ENOSYS                       6
+#define RT_EBUSY                        7
+#define RT_EIO                          8
+#define RT_EINTR                        9
+#define RT_EINVAL                       10
+
+#define RT_ALIGN(size, align)           (((size) + (align) - 1) & ~((align) - 1))
+#define RT_ALIGN_DOWN(size, align)      ((size) & ~((align) - 1))
+#define RT_ARRAY_SIZE(arr)              (sizeof(arr) / sizeof(arr[0]))
+
+#define rt_inline                       static __inline
+#define RT_UNUSED(x)                    ((void)(x))
+
+/* 等待方式 */
+#define RT_WAITING_FOREVER              -1
+#define RT_WAITING_NO                   0
+
+/* IPC标志 */
+#define RT_IPC_FLAG_FIFO                0x00
+#define RT_IPC_FLAG_PRIO                0x01
+
+/* 定时器标志 */
+#define RT_TIMER_FLAG_DEACTIVATED       0x0
+#define RT_TIMER_FLAG_ACTIVATED         0x1
+#define RT_TIMER_FLAG_ONE_SHOT          0x0
+#define RT_TIMER_FLAG_PERIODIC          0x2
+#define RT_TIMER_FLAG_HARD_TIMER        0x0
+#define RT_TIMER_FLAG_SOFT_TIMER        0x4
+
+#define RT_TIMER_CTRL_SET_TIME          0x0
+#define RT_TIMER_CTRL_GET_TIME          0x1
+#define RT_TIMER_CTRL_SET_ONESHOT       0x2
+#define RT_TIMER_CTRL_SET_PERIODIC      0x3
+
+/* 线程状态 */
+#define RT_THREAD_INIT                  0x00
+#define RT_THREAD_READY                 0x01
+#define RT_THREAD_SUSPEND               0x02
+#define RT_THREAD_RUNNING               0x03
+#define RT_THREAD_CLOSE                 0x04
+
+#define RT_THREAD_CTRL_CHANGE_PRIORITY  0x02
+
+/* 双向链表 */
+struct rt_list_node
+{
+    struct rt_list_node *next;
+    struct rt_list_node *prev;
+};
+typedef struct rt_list_node rt_list_t;
+
+/* 仿真事件 (虚拟时间轴上的回调), 由定时器和线程超时复用 */
+struct sim_event
+{
+    rt_uint64_t when_ns;
+    void (*fn)(void *arg);
+    void *arg;
+    struct sim_event *next;
+    rt_uint8_t pending;
+};
+
+/* 线程控制块 */
+struct rt_thread
+{
+    char        name[RT_NAME_MAX];
+    void        (*entry)(void *parameter);
+    void        *parameter;
+    void        *stack_addr;
+    rt_uint32_t stack_size;
+
+    rt_uint8_t  init_priority;
+    rt_uint8_t  current_priority;
+    rt_uint8_t  stat;
+    rt_err_t    error;
+
+    rt_list_t   tlist;                  /* IPC等待队列节点 */
+    struct sim_event wake;              /* 延时/超时唤醒 */
+
+    /* 仿真统计 */
+    void        *sim_ctx;
+    rt_uint64_t ready_seq;
+    rt_uint64_t cpu_ns;
+    rt_uint32_t switches;
+    rt_uint32_t preempted;
+    struct rt_thread *sim_next;
+};
+typedef struct rt_thread *rt_thread_t;
+
+/* 定时器 */
+struct rt_timer
+{
+    char        name[RT_NAME_MAX];
+    void        (*timeout_func)(void *parameter);
+    void        *parameter;
+    rt_tick_t   init_tick;
+    rt_uint8_t  flag;
+    struct sim_event ev;
+};
+typedef struct rt_timer *rt_timer_t;
+
+/* IPC公共部分 */
+struct rt_ipc_object
+{
+    char        name[RT_NAME_MAX];
+    rt_uint8_t  flag;
+    rt_list_t   suspend_thread;
+};
+
+struct rt_semaphore
+{
+    struct rt_ipc_object parent;
+    rt_uint16_t value;
+};
+typedef struct rt_semaphore *rt_sem_t;
+
+struct rt_mutex
+{
+    struct rt_ipc_object parent;
+    rt_uint16_t value;
+    rt_uint8_t  original_priority;
+    rt_uint8_t  hold;
+    struct rt_thread *owner;
+};
+typedef struct rt_mutex *rt_mutex_t;
+
+struct rt_messagequeue
+{
+    struct rt_ipc_object parent;
+    void        *msg_pool;
+    rt_uint16_t msg_size;
+    rt_uint16_t max_msgs;
+    rt_uint16_t entry;
+    rt_uint16_t head;
+    rt_uint16_t tail;
+    rt_list_t   suspend_sender_thread;
+    rt_uint8_t  dynamic;
+};
+typedef struct rt_messagequeue *rt_mq_t;
+
+/* 设备对象 */
+struct rt_device
+{
+    char        name[RT_NAME_MAX];
+    rt_uint8_t  type;
+    void        *user_data;
+    struct rt_device *next;
+};
+typedef struct rt_device *rt_device_t;
+
+#define RT_Device_Class_Char            0
+#define RT_Device_Class_I2CBUS          1
+#define RT_Device_Class_Pin             2
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __RT_DEF_H__ */
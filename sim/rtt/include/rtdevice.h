@@ -0,0 +1,86 @@
+/*
+ * 主机仿真 - RT-Thread设备驱动框架 (I2C / PIN)
+ */
+#ifndef __RT_DEVICE_H__
+#define __RT_DEVICE_H__
+
+#include <rtthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 设备 */
+rt_device_t rt_device_find(const char *name);
+rt_err_t rt_device_register(rt_device_t dev, const char *name, rt_uint16_t flags);
+
+/* ==================== I2C ==================== */
+#define RT_I2C_WR                0x0000
+#define RT_I2C_RD               (1u << 0)
+#define RT_I2C_ADDR_10BIT       (1u << 2)
+#define RT_I2C_NO_START         (1u << 4)
+#define RT_I2C_IGNORE_NACK      (1u << 5)
+#define RT_I2C_NO_READ_ACK      (1u << 6)
+#define RT_I2C_NO_STOP          (1u << 7)
+
+struct rt_i2c_msg
+{
+    rt_uint16_t addr;
+    rt_uint16_t flags;
+    rt_uint16_t len;
+    rt_uint8_t  *buf;
+};
+
+struct rt_i2c_bus_device
+{
+    struct rt_device parent;
+    struct rt_mutex lock;
+};
+
+rt_size_t rt_i2c_transfer(struct rt_i2c_bus_device *bus,
+                          struct rt_i2c_msg msgs[],
+                          rt_uint32_t num);
+
+/* ==================== PIN ==================== */
+#define PIN_LOW                 0x00
+#define PIN_HIGH                0x01
+
+#define PIN_MODE_OUTPUT         0x00
+#define PIN_MODE_INPUT          0x01
+#define PIN_MODE_INPUT_PULLUP   0x02
+#define PIN_MODE_INPUT_PULLDOWN 0x03
+#define PIN_MODE_OUTPUT_OD      0x04
+
+#define PIN_IRQ_MODE_RISING             0x00
+#define PIN_IRQ_MODE_FALLING            0x01
+#define PIN_IRQ_MODE_RISING_FALLING     0x02
+#define PIN_IRQ_MODE_HIGH_LEVEL         0x03
+#define PIN_IRQ_MODE_LOW_LEVEL          0x04
+
+#define PIN_IRQ_DISABLE         0x00
+#define PIN_IRQ_ENABLE          0x01
+
+#define PIN_IRQ_PIN_NONE        -1
+
+/* STM32引脚编号: 每个端口16个引脚 */
+enum
+{
+    SIM_PORT_A = 0, SIM_PORT_B, SIM_PORT_C, SIM_PORT_D, SIM_PORT_E, SIM_PORT_F,
+    SIM_PORT_G, SIM_PORT_H, SIM_PORT_I, SIM_PORT_J, SIM_PORT_K,
+};
+#define GET_PIN(PORTx, PIN)     ((rt_base_t)(16 * SIM_PORT_##PORTx + (PIN)))
+#define SIM_PIN_MAX             (16 * 11)
+
+void rt_pin_mode(rt_base_t pin, rt_base_t mode);
+void rt_pin_write(rt_base_t pin, rt_base_t value);
+int  rt_pin_read(rt_base_t pin);
+rt_err_t rt_pin_attach_irq(rt_int32_t pin, rt_uint32_t mode,
+                           void (*hdr)(void *args), void *args);
+rt_err_t rt_pin_detach_irq(rt_int32_t pin);
+rt_err_t rt_pin_irq_enable(rt_base_t pin, rt_uint32_t enabled);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __RT_DEVICE_H__ */
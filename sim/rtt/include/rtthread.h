@@ -0,0 +1,178 @@
+/*
+ * 主机仿真 - RT-Thread内核接口
+ * 线程运行在虚拟时间轴上, 详见 sim/rtt/src/kernel.c
+ */
+#ifndef __RT_THREAD_H__
+#define __RT_THREAD_H__
+
+#include <rtconfig.h>
+#include <rtdef.h>
+#include <stdarg.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 链表操作 */
+rt_inline void rt_list_init(rt_list_t *l)
+{
+    l->next = l->prev = l;
+}
+
+rt_inline void rt_list_insert_before(rt_list_t *l, rt_list_t *n)
+{
+    l->prev->next = n;
+    n->prev = l->prev;
+    l->prev = n;
+    n->next = l;
+}
+
+rt_inline void rt_list_remove(rt_list_t *n)
+{
+    n->next->prev = n->prev;
+    n->prev->next = n->next;
+    n->next = n->prev = n;
+}
+
+rt_inline int rt_list_isempty(const rt_list_t *l)
+{
+    return l->next == l;
+}
+
+#define rt_container_of(node, type, member) \
+    ((type *)((char *)(node) - (unsigned long)(&((type *)0)->member)))
+#define rt_list_entry(node, type, member) \
+    rt_container_of(node, type, member)
+
+/* 自动初始化 (仿真中由构造函数登记, 在main线程中按级别调用) */
+typedef int (*init_fn_t)(void);
+void rt_components_register(init_fn_t fn, int level, const char *name);
+
+#define INIT_EXPORT(fn, level)                                          \
+    static void __attribute__((constructor)) __rt_init_reg_##fn(void)   \
+    {                                                                   \
+        rt_components_register(fn, level, #fn);                         \
+    }
+#define INIT_BOARD_EXPORT(fn)           INIT_EXPORT(fn, 1)
+#define INIT_PREV_EXPORT(fn)            INIT_EXPORT(fn, 2)
+#define INIT_DEVICE_EXPORT(fn)          INIT_EXPORT(fn, 3)
+#define INIT_COMPONENT_EXPORT(fn)       INIT_EXPORT(fn, 4)
+#define INIT_ENV_EXPORT(fn)             INIT_EXPORT(fn, 5)
+#define INIT_APP_EXPORT(fn)             INIT_EXPORT(fn, 6)
+
+void rt_components_init(void);
+
+/* MSH命令 (仿真中可由脚本 "msh <cmd> ..." 调用) */
+typedef int (*msh_cmd_t)(int argc, char **argv);
+void rt_msh_register(msh_cmd_t fn, const char *name, const char *desc);
+int  rt_msh_exec(int argc, char **argv);
+
+#define MSH_CMD_EXPORT(command, desc)                                   \
+    static void __attribute__((constructor)) __rt_msh_reg_##command(void) \
+    {                                                                   \
+        rt_msh_register((msh_cmd_t)command, #command, #desc);           \
+    }
+#define MSH_CMD_EXPORT_ALIAS(command, alias, desc)                      \
+    static void __attribute__((constructor)) __rt_msh_reg_##alias(void) \
+    {                                                                   \
+        rt_msh_register((msh_cmd_t)command, #alias, #desc);             \
+    }
+
+/* 时钟 */
+rt_tick_t rt_tick_get(void);
+rt_tick_t rt_tick_from_millisecond(rt_int32_t ms);
+
+/* 线程 */
+rt_thread_t rt_thread_create(const char *name,
+                             void (*entry)(void *parameter),
+                             void *parameter,
+                             rt_uint32_t stack_size,
+                             rt_uint8_t priority,
+                             rt_uint32_t tick);
+rt_err_t rt_thread_init(struct rt_thread *thread,
+                        const char *name,
+                        void (*entry)(void *parameter),
+                        void *parameter,
+                        void *stack_start,
+                        rt_uint32_t stack_size,
+                        rt_uint8_t priority,
+                        rt_uint32_t tick);
+rt_err_t rt_thread_startup(rt_thread_t thread);
+rt_thread_t rt_thread_self(void);
+rt_err_t rt_thread_yield(void);
+rt_err_t rt_thread_delay(rt_tick_t tick);
+rt_err_t rt_thread_mdelay(rt_int32_t ms);
+rt_err_t rt_thread_control(rt_thread_t thread, int cmd, void *arg);
+
+void rt_enter_critical(void);
+void rt_exit_critical(void);
+
+/* 定时器 */
+void rt_timer_init(rt_timer_t timer, const char *name,
+                   void (*timeout)(void *parameter), void *parameter,
+                   rt_tick_t time, rt_uint8_t flag);
+rt_timer_t rt_timer_create(const char *name,
+                           void (*timeout)(void *parameter), void *parameter,
+                           rt_tick_t time, rt_uint8_t flag);
+rt_err_t rt_timer_start(rt_timer_t timer);
+rt_err_t rt_timer_stop(rt_timer_t timer);
+rt_err_t rt_timer_control(rt_timer_t timer, int cmd, void *arg);
+
+/* 信号量 */
+rt_err_t rt_sem_init(rt_sem_t sem, const char *name, rt_uint32_t value, rt_uint8_t flag);
+rt_sem_t rt_sem_create(const char *name, rt_uint32_t value, rt_uint8_t flag);
+rt_err_t rt_sem_detach(rt_sem_t sem);
+rt_err_t rt_sem_take(rt_sem_t sem, rt_int32_t timeout);
+rt_err_t rt_sem_trytake(rt_sem_t sem);
+rt_err_t rt_sem_release(rt_sem_t sem);
+
+/* 互斥量 */
+rt_err_t rt_mutex_init(rt_mutex_t mutex, const char *name, rt_uint8_t flag);
+rt_mutex_t rt_mutex_create(const char *name, rt_uint8_t flag);
+rt_err_t rt_mutex_take(rt_mutex_t mutex, rt_int32_t timeout);
+rt_err_t rt_mutex_release(rt_mutex_t mutex);
+
+/* 消息队列 */
+rt_err_t rt_mq_init(rt_mq_t mq, const char *name, void *msgpool,
+                    rt_size_t msg_size, rt_size_t pool_size, rt_uint8_t flag);
+rt_mq_t rt_mq_create(const char *name, rt_size_t msg_size,
+                     rt_size_t max_msgs, rt_uint8_t flag);
+rt_err_t rt_mq_send(rt_mq_t mq, const void *buffer, rt_size_t size);
+rt_err_t rt_mq_send_wait(rt_mq_t mq, const void *buffer, rt_size_t size, rt_int32_t timeout);
+rt_err_t rt_mq_recv(rt_mq_t mq, void *buffer, rt_size_t size, rt_int32_t timeout);
+
+/* 中断 */
+rt_base_t rt_hw_interrupt_disable(void);
+void rt_hw_interrupt_enable(rt_base_t level);
+void rt_interrupt_enter(void);
+void rt_interrupt_leave(void);
+rt_uint8_t rt_interrupt_get_nest(void);
+
+/* 内存 */
+void *rt_malloc(rt_size_t size);
+void *rt_calloc(rt_size_t count, rt_size_t size);
+void rt_free(void *ptr);
+
+/* 库函数 */
+void *rt_memset(void *s, int c, rt_ubase_t count);
+void *rt_memcpy(void *dst, const void *src, rt_ubase_t count);
+void *rt_memmove(void *dest, const void *src, rt_ubase_t n);
+rt_int32_t rt_memcmp(const void *cs, const void *ct, rt_ubase_t count);
+rt_size_t rt_strlen(const char *s);
+char *rt_strncpy(char *dst, const char *src, rt_ubase_t n);
+rt_int32_t rt_strcmp(const char *cs, const char *ct);
+rt_int32_t rt_strncmp(const char *cs, const char *ct, rt_ubase_t count);
+int rt_snprintf(char *buf, rt_size_t size, const char *format, ...);
+int rt_vsnprintf(char *buf, rt_size_t size, const char *fmt, va_list args);
+int rt_sprintf(char *buf, const char *format, ...);
+void rt_kprintf(const char *fmt, ...);
+
+#define RT_ASSERT(EX)                                                   \
+    do { if (!(EX)) rt_assert_handler(#EX, __FUNCTION__, __LINE__); } while (0)
+void rt_assert_handler(const char *ex, const char *func, rt_size_t line);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __RT_THREAD_H__ */
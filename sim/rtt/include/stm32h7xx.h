@@ -0,0 +1,16 @@
+/*
+ * 主机仿真 - STM32H7 HAL头文件占位
+ * board/board.h 需要包含此文件, 仿真中不提供任何寄存器定义
+ */
+#ifndef __STM32H7xx_H
+#define __STM32H7xx_H
+
+#include <stdint.h>
+
+extern uint32_t SystemCoreClock;
+
+/* rtconfig.h 中的串口引脚是给Kconfig看的字符串, board.h 随后以GET_PIN重新定义 */
+#undef BSP_UART1_TX_PIN
+#undef BSP_UART1_RX_PIN
+
+#endif /* __STM32H7xx_H */
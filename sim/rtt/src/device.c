@@ -0,0 +1,416 @@
+/*
+ * 主机仿真 - 设备注册/I2C总线/PIN
+ *
+ * I2C按位时间计费: 每个消息 START + 地址(9位) + 数据(每字节9位),
+ * 整个传输结束时一个STOP. 软件I2C(RT_USING_I2C_BITOPS)期间CPU忙等,
+ * 因此耗时记入调用线程.
+ */
+#include <rtthread.h>
+#include <rtdevice.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+
+static rt_device_t device_list = RT_NULL;
+
+rt_err_t rt_device_register(rt_device_t dev, const char *name, rt_uint16_t flags)
+{
+    RT_UNUSED(flags);
+    strncpy(dev->name, name, RT_NAME_MAX - 1);
+    dev->next = device_list;
+    device_list = dev;
+    return RT_EOK;
+}
+
+rt_device_t rt_device_find(const char *name)
+{
+    rt_device_t dev;
+
+    for (dev = device_list; dev != RT_NULL; dev = dev->next)
+    {
+        if (strncmp(dev->name, name, RT_NAME_MAX) == 0)
+            return dev;
+    }
+    return RT_NULL;
+}
+
+/* ==================== I2C ==================== */
+
+struct sim_i2c_bus
+{
+    struct rt_i2c_bus_device parent;
+    uint32_t    freq_hz;
+    struct sim_i2c_dev *devs;
+
+    uint32_t    xfers;
+    uint32_t    nacks;
+    uint64_t    bytes;
+    uint64_t    busy_ns;
+    struct sim_i2c_bus *next;
+};
+
+static struct sim_i2c_bus *bus_list = RT_NULL;
+
+static struct sim_i2c_bus *i2c_bus_get(const char *name)
+{
+    struct sim_i2c_bus *bus;
+
+    for (bus = bus_list; bus != RT_NULL; bus = bus->next)
+    {
+        if (strcmp(bus->parent.parent.name, name) == 0)
+            return bus;
+    }
+    return RT_NULL;
+}
+
+static void i2c_report(FILE *out)
+{
+    struct sim_i2c_bus *bus;
+    struct sim_i2c_dev *dev;
+    double total = (double)sim_now_ns();
+
+    for (bus = bus_list; bus != RT_NULL; bus = bus->next)
+    {
+        fprintf(out, "%s: %u kHz, %u xfers, %llu bytes, %u nacks, busy %.3f ms (%.2f%%)\n",
+                bus->parent.parent.name, bus->freq_hz / 1000, bus->xfers,
+                (unsigned long long)bus->bytes, bus->nacks, bus->busy_ns / 1e6,
+                total > 0 ? 100.0 * bus->busy_ns / total : 0.0);
+        for (dev = bus->devs; dev != RT_NULL; dev = dev->next)
+        {
+            fprintf(out, "  %-10s 0x%02X %9u xfers %10llu bytes %10.3f ms\n",
+                    dev->name, dev->addr, dev->xfers,
+                    (unsigned long long)dev->bytes, dev->busy_ns / 1e6);
+        }
+    }
+}
+
+static int i2c_cmd(int argc, char **argv)
+{
+    /* i2c <bus> freq <kHz> */
+    if (argc == 4 && strcmp(argv[2], "freq") == 0)
+        return sim_i2c_set_freq(argv[1], (uint32_t)atoi(argv[3]) * 1000);
+    return -RT_EINVAL;
+}
+
+int sim_i2c_bus_create(const char *name, uint32_t freq_hz)
+{
+    struct sim_i2c_bus *bus = calloc(1, sizeof(struct sim_i2c_bus));
+
+    if (bus == RT_NULL)
+        return -RT_ENOMEM;
+    if (bus_list == RT_NULL)
+    {
+        sim_report_register("i2c", i2c_report);
+        sim_cmd_register("i2c", i2c_cmd, "i2c <bus> freq <kHz>");
+    }
+
+    bus->freq_hz = freq_hz;
+    bus->parent.parent.type = RT_Device_Class_I2CBUS;
+    rt_mutex_init(&bus->parent.lock, name, RT_IPC_FLAG_PRIO);
+    rt_device_register(&bus->parent.parent, name, 0);
+    bus->next = bus_list;
+    bus_list = bus;
+    return RT_EOK;
+}
+
+int sim_i2c_attach(const char *bus_name, struct sim_i2c_dev *dev)
+{
+    struct sim_i2c_bus *bus = i2c_bus_get(bus_name);
+    struct sim_i2c_dev **pp;
+
+    if (bus == RT_NULL)
+        return -RT_ERROR;
+    for (pp = &bus->devs; *pp != RT_NULL; pp = &(*pp)->next);
+    dev->next = RT_NULL;
+    *pp = dev;
+    return RT_EOK;
+}
+
+int sim_i2c_set_freq(const char *bus_name, uint32_t freq_hz)
+{
+    struct sim_i2c_bus *bus = i2c_bus_get(bus_name);
+
+    if (bus == RT_NULL || freq_hz == 0)
+        return -RT_ERROR;
+    bus->freq_hz = freq_hz;
+    return RT_EOK;
+}
+
+static uint32_t i2c_xfer_bits(const struct rt_i2c_msg *msgs, int num)
+{
+    uint32_t bits = 1;      /* STOP */
+    int i;
+
+    for (i = 0; i < num; i++)
+    {
+        if (!(msgs[i].flags & RT_I2C_NO_START))
+            bits += 1 + 9;
+        bits += 9u * msgs[i].len;
+    }
+    return bits;
+}
+
+uint64_t sim_i2c_xfer_ns(uint32_t freq_hz, const struct rt_i2c_msg *msgs, int num)
+{
+    return (uint64_t)i2c_xfer_bits(msgs, num) * SIM_NS_PER_SEC / freq_hz;
+}
+
+rt_size_t rt_i2c_transfer(struct rt_i2c_bus_device *bus_dev,
+                          struct rt_i2c_msg msgs[],
+                          rt_uint32_t num)
+{
+    struct sim_i2c_bus *bus = (struct sim_i2c_bus *)bus_dev;
+    struct sim_i2c_dev *dev;
+    uint64_t ns;
+    uint32_t bytes = 0;
+    int acked = 0;
+    rt_uint32_t i;
+
+    if (bus == RT_NULL || num == 0)
+        return 0;
+
+    rt_mutex_take(&bus->parent.lock, RT_WAITING_FOREVER);
+
+    for (dev = bus->devs; dev != RT_NULL; dev = dev->next)
+    {
+        if (dev->addr == msgs[0].addr)
+            break;
+    }
+
+    for (i = 0; i < num; i++)
+        bytes += msgs[i].len + ((msgs[i].flags & RT_I2C_NO_START) ? 0 : 1);
+
+    if (dev != RT_NULL)
+        acked = dev->xfer(dev, msgs, (int)num);
+
+    if (acked == 0)
+    {
+        /* 地址无应答: 只有地址字节上了总线 */
+        struct rt_i2c_msg probe = msgs[0];
+        probe.len = 0;
+        ns = sim_i2c_xfer_ns(bus->freq_hz, &probe, 1);
+        bytes = 1;
+        bus->nacks++;
+    }
+    else
+    {
+        ns = sim_i2c_xfer_ns(bus->freq_hz, msgs, (int)num);
+    }
+
+    bus->xfers++;
+    bus->bytes += bytes;
+    bus->busy_ns += ns;
+    if (dev != RT_NULL)
+    {
+        dev->xfers++;
+        dev->bytes += bytes;
+        dev->busy_ns += ns;
+    }
+
+    sim_busy_ns(ns);
+
+    rt_mutex_release(&bus->parent.lock);
+
+    return (rt_size_t)acked;
+}
+
+/* ==================== PIN ==================== */
+
+struct sim_pin
+{
+    rt_uint8_t  mode;
+    rt_uint8_t  latch;
+    rt_uint8_t  level;
+    rt_uint8_t  irq_mode;
+    rt_uint8_t  irq_enabled;
+    void        (*irq_hdr)(void *args);
+    void        *irq_args;
+    struct sim_pin_dev *devs;
+};
+
+static struct sim_pin pins[SIM_PIN_MAX];
+static int pins_ready = 0;
+
+static int pin_valid(rt_base_t pin)
+{
+    int i;
+
+    /* 复位后所有引脚为浮空输入 */
+    if (!pins_ready)
+    {
+        for (i = 0; i < SIM_PIN_MAX; i++)
+        {
+            pins[i].mode = PIN_MODE_INPUT;
+            pins[i].level = 1;
+        }
+        pins_ready = 1;
+    }
+    return pin >= 0 && pin < SIM_PIN_MAX;
+}
+
+int sim_pin_is_output(rt_base_t pin)
+{
+    return pins[pin].mode == PIN_MODE_OUTPUT || pins[pin].mode == PIN_MODE_OUTPUT_OD;
+}
+
+/**
+ * @brief 主机侧驱动电平: 推挽输出为锁存值, 开漏/输入视为释放(上拉)
+ */
+int sim_pin_master_level(rt_base_t pin)
+{
+    struct sim_pin *p = &pins[pin];
+
+    switch (p->mode)
+    {
+    case PIN_MODE_OUTPUT:
+        return p->latch;
+    case PIN_MODE_OUTPUT_OD:
+        return p->latch ? 1 : 0;
+    case PIN_MODE_INPUT_PULLDOWN:
+        return p->devs == RT_NULL ? 0 : 1;
+    default:
+        return 1;
+    }
+}
+
+static int pin_resolve(rt_base_t pin)
+{
+    struct sim_pin_dev *dev;
+    int level = sim_pin_master_level(pin);
+
+    for (dev = pins[pin].devs; dev != RT_NULL; dev = dev->next)
+    {
+        if (dev->level != RT_NULL && !dev->level(dev, pin))
+            level = 0;
+    }
+    return level;
+}
+
+static void pin_irq_check(rt_base_t pin, int old_level, int new_level)
+{
+    struct sim_pin *p = &pins[pin];
+    int fire = 0;
+
+    if (!p->irq_enabled || p->irq_hdr == RT_NULL)
+        return;
+
+    switch (p->irq_mode)
+    {
+    case PIN_IRQ_MODE_RISING:         fire = !old_level && new_level; break;
+    case PIN_IRQ_MODE_FALLING:        fire = old_level && !new_level; break;
+    case PIN_IRQ_MODE_RISING_FALLING: fire = old_level != new_level; break;
+    case PIN_IRQ_MODE_HIGH_LEVEL:     fire = !old_level && new_level; break;
+    case PIN_IRQ_MODE_LOW_LEVEL:      fire = old_level && !new_level; break;
+    }
+
+    if (fire)
+    {
+        rt_interrupt_enter();
+        p->irq_hdr(p->irq_args);
+        rt_interrupt_leave();
+    }
+}
+
+/**
+ * @brief 器件驱动变化后重新计算线电平并检查中断
+ */
+void sim_pin_update(rt_base_t pin)
+{
+    int old_level, new_level;
+
+    if (!pin_valid(pin))
+        return;
+    old_level = pins[pin].level;
+    new_level = pin_resolve(pin);
+    pins[pin].level = (rt_uint8_t)new_level;
+    if (old_level != new_level)
+        pin_irq_check(pin, old_level, new_level);
+}
+
+static void pin_master_changed(rt_base_t pin)
+{
+    struct sim_pin_dev *dev;
+    int level = sim_pin_master_level(pin);
+
+    for (dev = pins[pin].devs; dev != RT_NULL; dev = dev->next)
+    {
+        if (dev->on_master != RT_NULL)
+            dev->on_master(dev, pin, level);
+    }
+    sim_pin_update(pin);
+    if (!sim_in_isr())
+        rt_schedule();
+}
+
+int sim_pin_attach(rt_base_t pin, struct sim_pin_dev *dev)
+{
+    if (!pin_valid(pin))
+        return -RT_EINVAL;
+    dev->next = pins[pin].devs;
+    pins[pin].devs = dev;
+    pins[pin].level = (rt_uint8_t)pin_resolve(pin);
+    return RT_EOK;
+}
+
+void rt_pin_mode(rt_base_t pin, rt_base_t mode)
+{
+    if (!pin_valid(pin))
+        return;
+    pins[pin].mode = (rt_uint8_t)mode;
+    pin_master_changed(pin);
+}
+
+void rt_pin_write(rt_base_t pin, rt_base_t value)
+{
+    if (!pin_valid(pin))
+        return;
+    pins[pin].latch = value ? PIN_HIGH : PIN_LOW;
+    if (sim_pin_is_output(pin))
+        pin_master_changed(pin);
+}
+
+int rt_pin_read(rt_base_t pin)
+{
+    if (!pin_valid(pin))
+        return PIN_LOW;
+    sim_pin_update(pin);
+    return pins[pin].level;
+}
+
+rt_err_t rt_pin_attach_irq(rt_int32_t pin, rt_uint32_t mode,
+                           void (*hdr)(void *args), void *args)
+{
+    if (!pin_valid(pin))
+        return -RT_EINVAL;
+    pins[pin].irq_mode = (rt_uint8_t)mode;
+    pins[pin].irq_hdr = hdr;
+    pins[pin].irq_args = args;
+    return RT_EOK;
+}
+
+rt_err_t rt_pin_detach_irq(rt_int32_t pin)
+{
+    if (!pin_valid(pin))
+        return -RT_EINVAL;
+    pins[pin].irq_hdr = RT_NULL;
+    pins[pin].irq_enabled = 0;
+    return RT_EOK;
+}
+
+rt_err_t rt_pin_irq_enable(rt_base_t pin, rt_uint32_t enabled)
+{
+    if (!pin_valid(pin))
+        return -RT_EINVAL;
+    pins[pin].irq_enabled = (rt_uint8_t)enabled;
+    pins[pin].level = (rt_uint8_t)pin_resolve(pin);
+    /* 电平触发: 使能时已处于有效电平则立即触发一次 */
+    if (enabled && pins[pin].irq_hdr != RT_NULL &&
+        ((pins[pin].irq_mode == PIN_IRQ_MODE_LOW_LEVEL && pins[pin].level == 0) ||
+         (pins[pin].irq_mode == PIN_IRQ_MODE_HIGH_LEVEL && pins[pin].level == 1)))
+    {
+        rt_interrupt_enter();
+        pins[pin].irq_hdr(pins[pin].irq_args);
+        rt_interrupt_leave();
+    }
+    return RT_EOK;
+}
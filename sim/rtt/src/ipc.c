@@ -0,0 +1,275 @@
+/*
+ * 主机仿真 - 信号量/互斥量/消息队列
+ */
+#include <rtthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+
+static void ipc_init(struct rt_ipc_object *ipc, const char *name, rt_uint8_t flag)
+{
+    memset(ipc->name, 0, sizeof(ipc->name));
+    strncpy(ipc->name, name, RT_NAME_MAX - 1);
+    ipc->flag = flag;
+    rt_list_init(&ipc->suspend_thread);
+}
+
+static rt_thread_t ipc_first_waiter(rt_list_t *waitq)
+{
+    if (rt_list_isempty(waitq))
+        return RT_NULL;
+    return rt_list_entry(waitq->next, struct rt_thread, tlist);
+}
+
+/* ==================== 信号量 ==================== */
+
+rt_err_t rt_sem_init(rt_sem_t sem, const char *name, rt_uint32_t value, rt_uint8_t flag)
+{
+    ipc_init(&sem->parent, name, flag);
+    sem->value = (rt_uint16_t)value;
+    return RT_EOK;
+}
+
+rt_sem_t rt_sem_create(const char *name, rt_uint32_t value, rt_uint8_t flag)
+{
+    rt_sem_t sem = calloc(1, sizeof(struct rt_semaphore));
+
+    if (sem != RT_NULL)
+        rt_sem_init(sem, name, value, flag);
+    return sem;
+}
+
+rt_err_t rt_sem_detach(rt_sem_t sem)
+{
+    RT_ASSERT(rt_list_isempty(&sem->parent.suspend_thread));
+    return RT_EOK;
+}
+
+rt_err_t rt_sem_take(rt_sem_t sem, rt_int32_t timeout)
+{
+    if (sem->value > 0)
+    {
+        sem->value--;
+        return RT_EOK;
+    }
+    if (timeout == 0)
+        return -RT_ETIMEOUT;
+
+    /* 释放方直接把信号量交给被唤醒的线程 */
+    return sim_thread_suspend(&sem->parent.suspend_thread, sem->parent.flag, timeout);
+}
+
+rt_err_t rt_sem_trytake(rt_sem_t sem)
+{
+    return rt_sem_take(sem, RT_WAITING_NO);
+}
+
+rt_err_t rt_sem_release(rt_sem_t sem)
+{
+    rt_thread_t waiter = ipc_first_waiter(&sem->parent.suspend_thread);
+
+    if (waiter != RT_NULL)
+    {
+        sim_thread_resume(waiter);
+        rt_schedule();
+    }
+    else
+    {
+        if (sem->value == RT_UINT16_MAX)
+            return -RT_EFULL;
+        sem->value++;
+    }
+    return RT_EOK;
+}
+
+/* ==================== 互斥量 (带优先级继承) ==================== */
+
+rt_err_t rt_mutex_init(rt_mutex_t mutex, const char *name, rt_uint8_t flag)
+{
+    ipc_init(&mutex->parent, name, RT_IPC_FLAG_PRIO);
+    RT_UNUSED(flag);
+    mutex->value = 1;
+    mutex->owner = RT_NULL;
+    mutex->original_priority = 0xFF;
+    mutex->hold = 0;
+    return RT_EOK;
+}
+
+rt_mutex_t rt_mutex_create(const char *name, rt_uint8_t flag)
+{
+    rt_mutex_t mutex = calloc(1, sizeof(struct rt_mutex));
+
+    if (mutex != RT_NULL)
+        rt_mutex_init(mutex, name, flag);
+    return mutex;
+}
+
+rt_err_t rt_mutex_take(rt_mutex_t mutex, rt_int32_t timeout)
+{
+    rt_thread_t self = rt_thread_self();
+    rt_err_t ret;
+
+    if (mutex->owner == self)
+    {
+        mutex->hold++;
+        return RT_EOK;
+    }
+
+    if (mutex->value > 0)
+    {
+        mutex->value = 0;
+        mutex->owner = self;
+        mutex->original_priority = self->current_priority;
+        mutex->hold = 1;
+        return RT_EOK;
+    }
+    if (timeout == 0)
+        return -RT_ETIMEOUT;
+
+    if (self->current_priority < mutex->owner->current_priority)
+        mutex->owner->current_priority = self->current_priority;
+
+    ret = sim_thread_suspend(&mutex->parent.suspend_thread, RT_IPC_FLAG_PRIO, timeout);
+    if (ret == RT_EOK)
+        RT_ASSERT(mutex->owner == self);
+    return ret;
+}
+
+rt_err_t rt_mutex_release(rt_mutex_t mutex)
+{
+    rt_thread_t self = rt_thread_self();
+    rt_thread_t waiter;
+
+    if (mutex->owner != self)
+        return -RT_ERROR;
+    if (--mutex->hold > 0)
+        return RT_EOK;
+
+    self->current_priority = mutex->original_priority;
+
+    waiter = ipc_first_waiter(&mutex->parent.suspend_thread);
+    if (waiter != RT_NULL)
+    {
+        mutex->owner = waiter;
+        mutex->original_priority = waiter->current_priority;
+        mutex->hold = 1;
+        sim_thread_resume(waiter);
+        rt_schedule();
+    }
+    else
+    {
+        mutex->owner = RT_NULL;
+        mutex->value = 1;
+    }
+    return RT_EOK;
+}
+
+/* ==================== 消息队列 ==================== */
+
+struct mq_slot
+{
+    rt_size_t size;
+    rt_uint8_t data[];
+};
+
+static struct mq_slot *mq_slot(rt_mq_t mq, rt_uint16_t index)
+{
+    rt_size_t stride = RT_ALIGN(sizeof(struct mq_slot) + mq->msg_size, RT_ALIGN_SIZE);
+    return (struct mq_slot *)((rt_uint8_t *)mq->msg_pool + stride * index);
+}
+
+rt_err_t rt_mq_init(rt_mq_t mq, const char *name, void *msgpool,
+                    rt_size_t msg_size, rt_size_t pool_size, rt_uint8_t flag)
+{
+    rt_size_t stride = RT_ALIGN(sizeof(struct mq_slot) + msg_size, RT_ALIGN_SIZE);
+
+    ipc_init(&mq->parent, name, flag);
+    rt_list_init(&mq->suspend_sender_thread);
+    mq->msg_pool = msgpool;
+    mq->msg_size = (rt_uint16_t)msg_size;
+    mq->max_msgs = (rt_uint16_t)(pool_size / stride);
+    mq->entry = 0;
+    mq->head = 0;
+    mq->tail = 0;
+    return RT_EOK;
+}
+
+rt_mq_t rt_mq_create(const char *name, rt_size_t msg_size,
+                     rt_size_t max_msgs, rt_uint8_t flag)
+{
+    rt_size_t stride = RT_ALIGN(sizeof(struct mq_slot) + msg_size, RT_ALIGN_SIZE);
+    rt_mq_t mq = calloc(1, sizeof(struct rt_messagequeue));
+
+    if (mq == RT_NULL)
+        return RT_NULL;
+    mq->dynamic = 1;
+    rt_mq_init(mq, name, calloc(max_msgs, stride), msg_size, stride * max_msgs, flag);
+    return mq;
+}
+
+rt_err_t rt_mq_send_wait(rt_mq_t mq, const void *buffer, rt_size_t size, rt_int32_t timeout)
+{
+    struct mq_slot *slot;
+    rt_thread_t waiter;
+    rt_err_t ret;
+
+    if (size > mq->msg_size)
+        return -RT_ERROR;
+
+    while (mq->entry >= mq->max_msgs)
+    {
+        if (timeout == 0)
+            return -RT_EFULL;
+        ret = sim_thread_suspend(&mq->suspend_sender_thread, mq->parent.flag, timeout);
+        if (ret != RT_EOK)
+            return -RT_EFULL;
+    }
+
+    slot = mq_slot(mq, mq->tail);
+    slot->size = size;
+    memcpy(slot->data, buffer, size);
+    mq->tail = (mq->tail + 1) % mq->max_msgs;
+    mq->entry++;
+
+    waiter = ipc_first_waiter(&mq->parent.suspend_thread);
+    if (waiter != RT_NULL)
+    {
+        sim_thread_resume(waiter);
+        rt_schedule();
+    }
+    return RT_EOK;
+}
+
+rt_err_t rt_mq_send(rt_mq_t mq, const void *buffer, rt_size_t size)
+{
+    return rt_mq_send_wait(mq, buffer, size, RT_WAITING_NO);
+}
+
+rt_err_t rt_mq_recv(rt_mq_t mq, void *buffer, rt_size_t size, rt_int32_t timeout)
+{
+    struct mq_slot *slot;
+    rt_thread_t waiter;
+    rt_err_t ret;
+
+    while (mq->entry == 0)
+    {
+        if (timeout == 0)
+            return -RT_ETIMEOUT;
+        ret = sim_thread_suspend(&mq->parent.suspend_thread, mq->parent.flag, timeout);
+        if (ret != RT_EOK)
+            return ret;
+    }
+
+    slot = mq_slot(mq, mq->head);
+    memcpy(buffer, slot->data, slot->size < size ? slot->size : size);
+    mq->head = (mq->head + 1) % mq->max_msgs;
+    mq->entry--;
+
+    waiter = ipc_first_waiter(&mq->suspend_sender_thread);
+    if (waiter != RT_NULL)
+    {
+        sim_thread_resume(waiter);
+        rt_schedule();
+    }
+    return RT_EOK;
+}
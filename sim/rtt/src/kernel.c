@@ -0,0 +1,522 @@
+/*
+ * 主机仿真 - RT-Thread调度器/线程/定时器
+ *
+ * 每个rt_thread是一个ucontext协程, 只在阻塞调用(延时/IPC)和忙等
+ * (sim_busy_ns, 即delay_us与I2C传输)的事件边界处切换. 所有时间
+ * 都是虚拟时间, 同一脚本的两次运行结果完全一致.
+ */
+#include <rtthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ucontext.h>
+#include "sim.h"
+
+#define SIM_STACK_SIZE          (256 * 1024)
+#define SIM_TICK_NS             (SIM_NS_PER_SEC / RT_TICK_PER_SECOND)
+
+static ucontext_t sched_ctx;
+static rt_thread_t thread_list = RT_NULL;
+static rt_thread_t current = RT_NULL;
+static rt_uint64_t ready_seq = 0;
+static int isr_nest = 0;
+static int irq_disable_nest = 0;
+static int critical_nest = 0;
+static uint64_t run_end_ns = SIM_TIME_NEVER;
+static uint64_t idle_ns = 0;
+static uint64_t isr_ns = 0;
+
+static void make_ready(rt_thread_t thread)
+{
+    thread->stat = RT_THREAD_READY;
+    thread->ready_seq = ++ready_seq;
+}
+
+static rt_thread_t pick_ready(void)
+{
+    rt_thread_t t, best = RT_NULL;
+
+    for (t = thread_list; t != RT_NULL; t = t->sim_next)
+    {
+        if (t->stat != RT_THREAD_READY)
+            continue;
+        if (best == RT_NULL ||
+            t->current_priority < best->current_priority ||
+            (t->current_priority == best->current_priority && t->ready_seq < best->ready_seq))
+            best = t;
+    }
+    return best;
+}
+
+/**
+ * @brief 当前线程让出CPU, 回到调度循环
+ */
+static void switch_out(void)
+{
+    rt_thread_t self = current;
+
+    self->switches++;
+    swapcontext((ucontext_t *)self->sim_ctx, &sched_ctx);
+}
+
+static int need_preempt(void)
+{
+    rt_thread_t t;
+
+    if (current == RT_NULL || isr_nest || irq_disable_nest || critical_nest)
+        return 0;
+    for (t = thread_list; t != RT_NULL; t = t->sim_next)
+    {
+        if (t->stat == RT_THREAD_READY && t->current_priority < current->current_priority)
+            return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 在线程上下文中检查是否需要切换到更高优先级线程
+ */
+void rt_schedule(void)
+{
+    if (need_preempt())
+    {
+        current->preempted++;
+        make_ready(current);
+        switch_out();
+    }
+}
+
+int sim_in_isr(void)
+{
+    return isr_nest > 0;
+}
+
+static void run_events(void)
+{
+    isr_nest++;
+    sim_run_due_events();
+    isr_nest--;
+}
+
+/**
+ * @brief 忙等: 推进虚拟时间并计入当前线程CPU时间
+ * 中断中的忙等计入中断时间; 线程忙等期间插入的中断忙等不重复计入线程.
+ */
+void sim_busy_ns(uint64_t ns)
+{
+    uint64_t target, next, step;
+
+    target = sim_now_ns() + ns;
+    while (sim_now_ns() < target)
+    {
+        next = sim_next_event_ns();
+        step = next < target ? next : target;
+        if (isr_nest)
+            isr_ns += step - sim_now_ns();
+        else if (current != RT_NULL)
+            current->cpu_ns += step - sim_now_ns();
+        sim_set_now_ns(step);
+        run_events();
+
+        if (current == RT_NULL || isr_nest)
+            continue;
+
+        if (sim_now_ns() >= run_end_ns)
+        {
+            /* 仿真结束, 线程不再恢复 */
+            make_ready(current);
+            switch_out();
+        }
+        else if (need_preempt())
+        {
+            uint64_t remain = target > sim_now_ns() ? target - sim_now_ns() : 0;
+
+            current->preempted++;
+            make_ready(current);
+            switch_out();
+            target = sim_now_ns() + remain;
+        }
+    }
+}
+
+static void thread_timeout(void *parameter)
+{
+    rt_thread_t thread = (rt_thread_t)parameter;
+
+    if (thread->stat != RT_THREAD_SUSPEND)
+        return;
+    rt_list_remove(&thread->tlist);
+    thread->error = -RT_ETIMEOUT;
+    make_ready(thread);
+}
+
+/**
+ * @brief 挂起当前线程到等待队列 (waitq可为空, 即纯延时)
+ */
+rt_err_t sim_thread_suspend(rt_list_t *waitq, rt_uint8_t flag, rt_int32_t timeout)
+{
+    rt_thread_t self = current;
+
+    RT_ASSERT(self != RT_NULL);
+    RT_ASSERT(isr_nest == 0);
+
+    self->stat = RT_THREAD_SUSPEND;
+    self->error = RT_EOK;
+
+    if (waitq != RT_NULL)
+    {
+        rt_list_t *n = waitq->next;
+
+        if (flag == RT_IPC_FLAG_PRIO)
+        {
+            for (; n != waitq; n = n->next)
+            {
+                rt_thread_t t = rt_list_entry(n, struct rt_thread, tlist);
+                if (self->current_priority < t->current_priority)
+                    break;
+            }
+            rt_list_insert_before(n, &self->tlist);
+        }
+        else
+        {
+            rt_list_insert_before(waitq, &self->tlist);
+        }
+    }
+
+    if (timeout > 0)
+        sim_event_schedule(&self->wake, sim_now_ns() + (uint64_t)timeout * SIM_TICK_NS);
+
+    switch_out();
+    sim_event_cancel(&self->wake);
+
+    return self->error;
+}
+
+void sim_thread_resume(rt_thread_t thread)
+{
+    rt_list_remove(&thread->tlist);
+    sim_event_cancel(&thread->wake);
+    thread->error = RT_EOK;
+    make_ready(thread);
+}
+
+static void thread_trampoline(void)
+{
+    rt_thread_t self = current;
+
+    self->entry(self->parameter);
+    self->stat = RT_THREAD_CLOSE;
+    setcontext(&sched_ctx);
+}
+
+rt_err_t rt_thread_init(struct rt_thread *thread,
+                        const char *name,
+                        void (*entry)(void *parameter),
+                        void *parameter,
+                        void *stack_start,
+                        rt_uint32_t stack_size,
+                        rt_uint8_t priority,
+                        rt_uint32_t tick)
+{
+    ucontext_t *ctx;
+
+    RT_UNUSED(stack_start);
+    RT_UNUSED(tick);
+
+    memset(thread, 0, sizeof(*thread));
+    strncpy(thread->name, name, RT_NAME_MAX - 1);
+    thread->entry = entry;
+    thread->parameter = parameter;
+    thread->stack_size = stack_size;
+    thread->init_priority = priority;
+    thread->current_priority = priority;
+    thread->stat = RT_THREAD_INIT;
+    rt_list_init(&thread->tlist);
+    sim_event_init(&thread->wake, thread_timeout, thread);
+
+    /* 主机上printf等库函数的栈开销远大于MCU, 统一使用大栈 */
+    ctx = calloc(1, sizeof(ucontext_t));
+    thread->stack_addr = malloc(SIM_STACK_SIZE);
+    if (ctx == RT_NULL || thread->stack_addr == RT_NULL)
+        return -RT_ENOMEM;
+
+    getcontext(ctx);
+    ctx->uc_stack.ss_sp = thread->stack_addr;
+    ctx->uc_stack.ss_size = SIM_STACK_SIZE;
+    ctx->uc_link = &sched_ctx;
+    makecontext(ctx, thread_trampoline, 0);
+    thread->sim_ctx = ctx;
+
+    thread->sim_next = thread_list;
+    thread_list = thread;
+
+    return RT_EOK;
+}
+
+rt_thread_t rt_thread_create(const char *name,
+                             void (*entry)(void *parameter),
+                             void *parameter,
+                             rt_uint32_t stack_size,
+                             rt_uint8_t priority,
+                             rt_uint32_t tick)
+{
+    rt_thread_t thread = calloc(1, sizeof(struct rt_thread));
+
+    if (thread == RT_NULL)
+        return RT_NULL;
+    if (rt_thread_init(thread, name, entry, parameter, RT_NULL,
+                       stack_size, priority, tick) != RT_EOK)
+    {
+        free(thread);
+        return RT_NULL;
+    }
+    return thread;
+}
+
+rt_err_t rt_thread_startup(rt_thread_t thread)
+{
+    RT_ASSERT(thread != RT_NULL);
+    make_ready(thread);
+    if (current != RT_NULL)
+        rt_schedule();
+    return RT_EOK;
+}
+
+rt_thread_t rt_thread_self(void)
+{
+    return current;
+}
+
+rt_err_t rt_thread_yield(void)
+{
+    if (current == RT_NULL)
+        return RT_EOK;
+    make_ready(current);
+    switch_out();
+    return RT_EOK;
+}
+
+rt_err_t rt_thread_delay(rt_tick_t tick)
+{
+    if (tick == 0)
+        return rt_thread_yield();
+    sim_thread_suspend(RT_NULL, RT_IPC_FLAG_FIFO, (rt_int32_t)tick);
+    return RT_EOK;
+}
+
+rt_err_t rt_thread_mdelay(rt_int32_t ms)
+{
+    return rt_thread_delay(rt_tick_from_millisecond(ms));
+}
+
+/**
+ * @brief 只支持修改当前优先级; 与RT-Thread相同, 已在IPC队列中的位置不调整
+ */
+rt_err_t rt_thread_control(rt_thread_t thread, int cmd, void *arg)
+{
+    RT_ASSERT(thread != RT_NULL);
+    switch (cmd)
+    {
+    case RT_THREAD_CTRL_CHANGE_PRIORITY:
+        thread->current_priority = *(rt_uint8_t *)arg;
+        if (thread->stat == RT_THREAD_READY)
+            make_ready(thread);
+        break;
+    default:
+        return -RT_EINVAL;
+    }
+    return RT_EOK;
+}
+
+rt_tick_t rt_tick_get(void)
+{
+    return (rt_tick_t)(sim_now_ns() / SIM_TICK_NS);
+}
+
+rt_tick_t rt_tick_from_millisecond(rt_int32_t ms)
+{
+    if (ms < 0)
+        return (rt_tick_t)RT_WAITING_FOREVER;
+    return (rt_tick_t)(((uint64_t)ms * RT_TICK_PER_SECOND + 999) / 1000);
+}
+
+void rt_enter_critical(void)
+{
+    critical_nest++;
+}
+
+void rt_exit_critical(void)
+{
+    if (critical_nest > 0 && --critical_nest == 0)
+        rt_schedule();
+}
+
+rt_base_t rt_hw_interrupt_disable(void)
+{
+    return irq_disable_nest++;
+}
+
+void rt_hw_interrupt_enable(rt_base_t level)
+{
+    irq_disable_nest = (int)level;
+    if (irq_disable_nest == 0 && isr_nest == 0)
+        rt_schedule();
+}
+
+void rt_interrupt_enter(void)
+{
+    isr_nest++;
+}
+
+void rt_interrupt_leave(void)
+{
+    isr_nest--;
+}
+
+rt_uint8_t rt_interrupt_get_nest(void)
+{
+    return (rt_uint8_t)isr_nest;
+}
+
+/* ==================== 定时器 ==================== */
+
+static void timer_expire(void *parameter)
+{
+    rt_timer_t timer = (rt_timer_t)parameter;
+
+    if (timer->flag & RT_TIMER_FLAG_PERIODIC)
+        sim_event_schedule(&timer->ev, timer->ev.when_ns + (uint64_t)timer->init_tick * SIM_TICK_NS);
+    else
+        timer->flag &= ~RT_TIMER_FLAG_ACTIVATED;
+
+    timer->timeout_func(timer->parameter);
+}
+
+void rt_timer_init(rt_timer_t timer, const char *name,
+                   void (*timeout)(void *parameter), void *parameter,
+                   rt_tick_t time, rt_uint8_t flag)
+{
+    memset(timer, 0, sizeof(*timer));
+    strncpy(timer->name, name, RT_NAME_MAX - 1);
+    timer->timeout_func = timeout;
+    timer->parameter = parameter;
+    timer->init_tick = time;
+    timer->flag = flag & ~RT_TIMER_FLAG_ACTIVATED;
+    sim_event_init(&timer->ev, timer_expire, timer);
+}
+
+rt_timer_t rt_timer_create(const char *name,
+                           void (*timeout)(void *parameter), void *parameter,
+                           rt_tick_t time, rt_uint8_t flag)
+{
+    rt_timer_t timer = calloc(1, sizeof(struct rt_timer));
+
+    if (timer != RT_NULL)
+        rt_timer_init(timer, name, timeout, parameter, time, flag);
+    return timer;
+}
+
+rt_err_t rt_timer_start(rt_timer_t timer)
+{
+    timer->flag |= RT_TIMER_FLAG_ACTIVATED;
+    sim_event_schedule(&timer->ev, sim_now_ns() + (uint64_t)timer->init_tick * SIM_TICK_NS);
+    return RT_EOK;
+}
+
+rt_err_t rt_timer_stop(rt_timer_t timer)
+{
+    if (!(timer->flag & RT_TIMER_FLAG_ACTIVATED))
+        return -RT_ERROR;
+    timer->flag &= ~RT_TIMER_FLAG_ACTIVATED;
+    sim_event_cancel(&timer->ev);
+    return RT_EOK;
+}
+
+rt_err_t rt_timer_control(rt_timer_t timer, int cmd, void *arg)
+{
+    switch (cmd)
+    {
+    case RT_TIMER_CTRL_SET_TIME:
+        timer->init_tick = *(rt_tick_t *)arg;
+        break;
+    case RT_TIMER_CTRL_GET_TIME:
+        *(rt_tick_t *)arg = timer->init_tick;
+        break;
+    case RT_TIMER_CTRL_SET_ONESHOT:
+        timer->flag &= ~RT_TIMER_FLAG_PERIODIC;
+        break;
+    case RT_TIMER_CTRL_SET_PERIODIC:
+        timer->flag |= RT_TIMER_FLAG_PERIODIC;
+        break;
+    default:
+        return -RT_EINVAL;
+    }
+    return RT_EOK;
+}
+
+/* ==================== 启动与运行 ==================== */
+
+void sim_kernel_start(void (*entry)(void *parameter))
+{
+    rt_thread_t tid;
+
+    tid = rt_thread_create("main", entry, RT_NULL,
+                           RT_MAIN_THREAD_STACK_SIZE, RT_MAIN_THREAD_PRIORITY, 20);
+    RT_ASSERT(tid != RT_NULL);
+    rt_thread_startup(tid);
+}
+
+/**
+ * @brief 运行调度循环直到虚拟时间end_ns
+ */
+void sim_kernel_run(uint64_t end_ns)
+{
+    rt_thread_t t;
+    uint64_t next;
+
+    run_end_ns = end_ns;
+    for (;;)
+    {
+        run_events();
+        if (sim_now_ns() >= end_ns)
+            break;
+
+        t = pick_ready();
+        if (t != RT_NULL)
+        {
+            current = t;
+            t->stat = RT_THREAD_RUNNING;
+            swapcontext(&sched_ctx, (ucontext_t *)t->sim_ctx);
+            current = RT_NULL;
+            continue;
+        }
+
+        next = sim_next_event_ns();
+        if (next == SIM_TIME_NEVER)
+            break;
+        if (next > end_ns)
+            next = end_ns;
+        idle_ns += next - sim_now_ns();
+        sim_set_now_ns(next);
+    }
+}
+
+void sim_kernel_report(FILE *out)
+{
+    rt_thread_t t;
+    double total = (double)sim_now_ns();
+
+    fprintf(out, "threads:\n");
+    fprintf(out, "  %-8s %4s %12s %7s %9s %9s\n", "name", "prio", "cpu_ms", "cpu%", "switches", "preempt");
+    for (t = thread_list; t != RT_NULL; t = t->sim_next)
+    {
+        fprintf(out, "  %-8s %4d %12.3f %6.2f%% %9u %9u\n",
+                t->name, t->init_priority, t->cpu_ns / 1e6,
+                total > 0 ? 100.0 * t->cpu_ns / total : 0.0,
+                t->switches, t->preempted);
+    }
+    fprintf(out, "  %-8s %4s %12.3f %6.2f%%\n", "isr", "-", isr_ns / 1e6,
+            total > 0 ? 100.0 * isr_ns / total : 0.0);
+    fprintf(out, "  %-8s %4s %12.3f %6.2f%%\n", "idle", "-", idle_ns / 1e6,
+            total > 0 ? 100.0 * idle_ns / total : 0.0);
+}
@@ -0,0 +1,161 @@
+/*
+ * 主机仿真 - 内核服务: 内存/字符串/打印/自动初始化/MSH命令表
+ */
+#include <rtthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+
+int sim_quiet = 0;
+
+void *rt_malloc(rt_size_t size)               { return malloc(size); }
+void *rt_calloc(rt_size_t count, rt_size_t size) { return calloc(count, size); }
+void rt_free(void *ptr)                       { free(ptr); }
+
+void *rt_memset(void *s, int c, rt_ubase_t count)              { return memset(s, c, count); }
+void *rt_memcpy(void *dst, const void *src, rt_ubase_t count)  { return memcpy(dst, src, count); }
+void *rt_memmove(void *dest, const void *src, rt_ubase_t n)    { return memmove(dest, src, n); }
+rt_int32_t rt_memcmp(const void *cs, const void *ct, rt_ubase_t count) { return memcmp(cs, ct, count); }
+rt_size_t rt_strlen(const char *s)                             { return strlen(s); }
+char *rt_strncpy(char *dst, const char *src, rt_ubase_t n)     { return strncpy(dst, src, n); }
+rt_int32_t rt_strcmp(const char *cs, const char *ct)           { return strcmp(cs, ct); }
+rt_int32_t rt_strncmp(const char *cs, const char *ct, rt_ubase_t count) { return strncmp(cs, ct, count); }
+
+int rt_vsnprintf(char *buf, rt_size_t size, const char *fmt, va_list args)
+{
+    return vsnprintf(buf, size, fmt, args);
+}
+
+int rt_snprintf(char *buf, rt_size_t size, const char *format, ...)
+{
+    va_list args;
+    int n;
+
+    va_start(args, format);
+    n = vsnprintf(buf, size, format, args);
+    va_end(args);
+    return n;
+}
+
+int rt_sprintf(char *buf, const char *format, ...)
+{
+    va_list args;
+    int n;
+
+    va_start(args, format);
+    n = vsprintf(buf, format, args);
+    va_end(args);
+    return n;
+}
+
+/**
+ * @brief 控制台输出, 每行前缀虚拟时间
+ */
+void rt_kprintf(const char *fmt, ...)
+{
+    static int line_start = 1;
+    char buf[RT_CONSOLEBUF_SIZE];
+    va_list args;
+    char *p;
+
+    if (sim_quiet)
+        return;
+
+    va_start(args, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+
+    for (p = buf; *p != '\0'; p++)
+    {
+        if (line_start && *p != '\n' && *p != '\r')
+        {
+            uint64_t now = sim_now_ns();
+            printf("[%5llu.%06llu] ", (unsigned long long)(now / SIM_NS_PER_SEC),
+                   (unsigned long long)(now % SIM_NS_PER_SEC / SIM_NS_PER_US));
+            line_start = 0;
+        }
+        if (*p != '\r')
+            putchar(*p);
+        if (*p == '\n')
+            line_start = 1;
+    }
+}
+
+void rt_assert_handler(const char *ex, const char *func, rt_size_t line)
+{
+    fprintf(stderr, "(%s) assertion failed at function:%s, line number:%lu\n",
+            ex, func, (unsigned long)line);
+    abort();
+}
+
+/* ==================== 自动初始化 ==================== */
+
+#define INIT_TABLE_MAX      64
+
+static struct
+{
+    init_fn_t   fn;
+    int         level;
+    const char  *name;
+} init_table[INIT_TABLE_MAX];
+static int init_count = 0;
+
+void rt_components_register(init_fn_t fn, int level, const char *name)
+{
+    RT_ASSERT(init_count < INIT_TABLE_MAX);
+    init_table[init_count].fn = fn;
+    init_table[init_count].level = level;
+    init_table[init_count].name = name;
+    init_count++;
+}
+
+void rt_components_init(void)
+{
+    int level, i;
+
+    for (level = 1; level <= 6; level++)
+    {
+        for (i = 0; i < init_count; i++)
+        {
+            if (init_table[i].level == level)
+                init_table[i].fn();
+        }
+    }
+}
+
+/* ==================== MSH命令 ==================== */
+
+#define MSH_TABLE_MAX       64
+
+static struct
+{
+    msh_cmd_t   fn;
+    const char  *name;
+    const char  *desc;
+} msh_table[MSH_TABLE_MAX];
+static int msh_count = 0;
+
+void rt_msh_register(msh_cmd_t fn, const char *name, const char *desc)
+{
+    RT_ASSERT(msh_count < MSH_TABLE_MAX);
+    msh_table[msh_count].fn = fn;
+    msh_table[msh_count].name = name;
+    msh_table[msh_count].desc = desc;
+    msh_count++;
+}
+
+int rt_msh_exec(int argc, char **argv)
+{
+    int i;
+
+    if (argc < 1)
+        return -RT_EINVAL;
+    for (i = 0; i < msh_count; i++)
+    {
+        if (strcmp(msh_table[i].name, argv[0]) == 0)
+            return msh_table[i].fn(argc, argv);
+    }
+    rt_kprintf("%s: command not found.\n", argv[0]);
+    return -RT_ENOSYS;
+}
@@ -0,0 +1,112 @@
+/*
+ * 智能手环主机仿真 - 核心接口
+ * 虚拟时间轴, 事件, 脚本命令, 统计报告, 以及虚拟I2C/PIN总线
+ */
+#ifndef __SIM_H__
+#define __SIM_H__
+
+#include <rtthread.h>
+#include <rtdevice.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SIM_NS_PER_US           1000ULL
+#define SIM_NS_PER_MS           1000000ULL
+#define SIM_NS_PER_SEC          1000000000ULL
+#define SIM_TIME_NEVER          UINT64_MAX
+
+/* ==================== 虚拟时间与事件 ==================== */
+uint64_t sim_now_ns(void);
+void sim_set_now_ns(uint64_t ns);
+
+void sim_event_init(struct sim_event *ev, void (*fn)(void *arg), void *arg);
+void sim_event_schedule(struct sim_event *ev, uint64_t when_ns);
+void sim_event_cancel(struct sim_event *ev);
+uint64_t sim_next_event_ns(void);
+void sim_run_due_events(void);
+
+/* 当前线程忙等ns纳秒 (计入CPU时间, 期间可被更高优先级线程抢占); 中断中调用时计入中断时间 */
+void sim_busy_ns(uint64_t ns);
+
+/* ==================== 内核 ==================== */
+void sim_kernel_start(void (*entry)(void *parameter));
+void sim_kernel_run(uint64_t end_ns);
+void sim_kernel_report(FILE *out);
+
+/* 内核内部接口, 供IPC实现使用 */
+rt_err_t sim_thread_suspend(rt_list_t *waitq, rt_uint8_t flag, rt_int32_t timeout);
+void sim_thread_resume(rt_thread_t thread);
+void rt_schedule(void);
+int sim_in_isr(void);
+
+/* ==================== 脚本命令与报告 ==================== */
+typedef int (*sim_cmd_fn)(int argc, char **argv);
+typedef void (*sim_report_fn)(FILE *out);
+
+void sim_cmd_register(const char *name, sim_cmd_fn fn, const char *help);
+int  sim_cmd_exec_line(const char *line);
+void sim_cmd_help(FILE *out);
+int  sim_script_load(const char *path);
+int  sim_script_add(const char *line);
+uint64_t sim_parse_time_ns(const char *s);
+
+void sim_report_register(const char *name, sim_report_fn fn);
+void sim_report(FILE *out);
+
+extern int sim_quiet;
+extern int sim_failures;     /* 脚本检查失败次数, 非0时仿真以状态1退出 */
+
+/* 确定性随机数 */
+uint32_t sim_rand(void);
+int32_t  sim_rand_noise(int32_t amplitude);
+
+/* ==================== 虚拟I2C ==================== */
+struct sim_i2c_dev
+{
+    const char  *name;
+    rt_uint16_t addr;
+    /* 返回被应答的消息数, 0表示NACK */
+    int (*xfer)(struct sim_i2c_dev *dev, struct rt_i2c_msg *msgs, int num);
+    void *user;
+
+    /* 统计 */
+    uint32_t    xfers;
+    uint64_t    bytes;
+    uint64_t    busy_ns;
+    struct sim_i2c_dev *next;
+};
+
+int  sim_i2c_bus_create(const char *name, uint32_t freq_hz);
+int  sim_i2c_attach(const char *bus_name, struct sim_i2c_dev *dev);
+int  sim_i2c_set_freq(const char *bus_name, uint32_t freq_hz);
+uint64_t sim_i2c_xfer_ns(uint32_t freq_hz, const struct rt_i2c_msg *msgs, int num);
+
+/* ==================== 虚拟PIN ==================== */
+struct sim_pin_dev
+{
+    const char  *name;
+    /* 器件对该引脚的驱动: 1释放(上拉), 0拉低 */
+    int  (*level)(struct sim_pin_dev *dev, rt_base_t pin);
+    /* 主机侧电平/模式变化通知, level为主机释放后的线电平 */
+    void (*on_master)(struct sim_pin_dev *dev, rt_base_t pin, int level);
+    void *user;
+    struct sim_pin_dev *next;
+};
+
+int  sim_pin_attach(rt_base_t pin, struct sim_pin_dev *dev);
+void sim_pin_update(rt_base_t pin);
+int  sim_pin_master_level(rt_base_t pin);
+int  sim_pin_is_output(rt_base_t pin);
+
+/* ==================== 虚拟器件 ==================== */
+void sim_devices_init(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SIM_H__ */
@@ -0,0 +1,104 @@
+/*
+ * 智能手环主机仿真 - 板级支持 (对应 board/board.c)
+ */
+#include <rtthread.h>
+#include "board.h"
+#include "sim.h"
+
+/* 定时器中断进出与分发的开销 (480MHz下约240周期) */
+#define US_TIMER_ISR_NS     500
+
+uint32_t SystemCoreClock = BSP_CLOCK_SYSTEM_FREQ_MHZ * 1000000UL;
+
+static struct {
+    struct sim_event ev;
+    void (*callback)(void);
+    uint8_t  registered;
+    uint32_t starts;
+    uint32_t irqs;
+    uint64_t wait_ns;           /* 交给定时器的等待总时长 */
+    uint64_t isr_ns;            /* 定时器中断中的执行时间 */
+    uint64_t delay_thread_ns;   /* delay_us忙等: 线程中 */
+    uint64_t delay_isr_ns;      /* delay_us忙等: 中断中 */
+} us_timer;
+
+static void board_report(FILE *out)
+{
+    double sec = (double)sim_now_ns() / SIM_NS_PER_SEC;
+
+    fprintf(out, "bitbang: %u us-timer waits, %.3f ms yielded (%.3f ms/s thread CPU reclaimed), "
+            "%u interrupts, %.3f ms in ISR\n",
+            us_timer.starts, us_timer.wait_ns / 1e6,
+            sec > 0 ? us_timer.wait_ns / 1e6 / sec : 0.0,
+            us_timer.irqs, us_timer.isr_ns / 1e6);
+    fprintf(out, "  delay_us busy-wait: %.3f ms in threads (%.3f ms/s), %.3f ms in ISRs\n",
+            us_timer.delay_thread_ns / 1e6,
+            sec > 0 ? us_timer.delay_thread_ns / 1e6 / sec : 0.0,
+            us_timer.delay_isr_ns / 1e6);
+}
+
+static void board_report_register(void)
+{
+    if (!us_timer.registered)
+    {
+        us_timer.registered = 1;
+        sim_report_register("bitbang", board_report);
+    }
+}
+
+/**
+ * @brief 延时函数 (微秒), 与SysTick忙等一样占用CPU
+ */
+void delay_us(uint32_t us)
+{
+    board_report_register();
+    if (sim_in_isr())
+        us_timer.delay_isr_ns += (uint64_t)us * SIM_NS_PER_US;
+    else
+        us_timer.delay_thread_ns += (uint64_t)us * SIM_NS_PER_US;
+    sim_busy_ns((uint64_t)us * SIM_NS_PER_US);
+}
+
+static void us_timer_fire(void *parameter)
+{
+    uint64_t t0 = sim_now_ns();
+
+    us_timer.irqs++;
+    sim_busy_ns(US_TIMER_ISR_NS);
+    us_timer.callback();
+    us_timer.isr_ns += sim_now_ns() - t0;
+}
+
+/**
+ * @brief us微秒后在中断中调用一次callback (对应TIM7单脉冲), 重新启动会取消未到期的一次
+ */
+void us_timer_start(uint32_t us, void (*callback)(void))
+{
+    if (us_timer.starts == 0)
+    {
+        board_report_register();
+        sim_event_init(&us_timer.ev, us_timer_fire, RT_NULL);
+    }
+    if (us == 0)
+        us = 1;
+    us_timer.starts++;
+    us_timer.wait_ns += (uint64_t)us * SIM_NS_PER_US;
+    us_timer.callback = callback;
+    sim_event_schedule(&us_timer.ev, sim_now_ns() + (uint64_t)us * SIM_NS_PER_US);
+}
+
+/**
+ * @brief 微秒时间戳, 取虚拟时间
+ */
+uint32_t get_time_us(void)
+{
+    return (uint32_t)(sim_now_ns() / SIM_NS_PER_US);
+}
+
+/**
+ * @brief 延时函数 (毫秒)
+ */
+void delay_ms(uint32_t ms)
+{
+    rt_thread_mdelay(ms);
+}
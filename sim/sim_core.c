@@ -0,0 +1,300 @@
+/*
+ * 智能手环主机仿真 - 虚拟时间/事件队列/脚本命令/报告
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "sim.h"
+
+static uint64_t now_ns = 0;
+static struct sim_event *event_head = RT_NULL;
+
+uint64_t sim_now_ns(void)
+{
+    return now_ns;
+}
+
+void sim_set_now_ns(uint64_t ns)
+{
+    if (ns > now_ns)
+        now_ns = ns;
+}
+
+/* ==================== 事件队列 (按时间排序, 同一时刻先进先出) ==================== */
+
+void sim_event_init(struct sim_event *ev, void (*fn)(void *arg), void *arg)
+{
+    memset(ev, 0, sizeof(*ev));
+    ev->fn = fn;
+    ev->arg = arg;
+}
+
+void sim_event_cancel(struct sim_event *ev)
+{
+    struct sim_event **pp;
+
+    if (!ev->pending)
+        return;
+    for (pp = &event_head; *pp != RT_NULL; pp = &(*pp)->next)
+    {
+        if (*pp == ev)
+        {
+            *pp = ev->next;
+            break;
+        }
+    }
+    ev->pending = 0;
+    ev->next = RT_NULL;
+}
+
+void sim_event_schedule(struct sim_event *ev, uint64_t when_ns)
+{
+    struct sim_event **pp;
+
+    sim_event_cancel(ev);
+    if (when_ns < now_ns)
+        when_ns = now_ns;
+    ev->when_ns = when_ns;
+    for (pp = &event_head; *pp != RT_NULL && (*pp)->when_ns <= when_ns; pp = &(*pp)->next);
+    ev->next = *pp;
+    *pp = ev;
+    ev->pending = 1;
+}
+
+uint64_t sim_next_event_ns(void)
+{
+    return event_head != RT_NULL ? event_head->when_ns : SIM_TIME_NEVER;
+}
+
+void sim_run_due_events(void)
+{
+    struct sim_event *ev;
+
+    while (event_head != RT_NULL && event_head->when_ns <= now_ns)
+    {
+        ev = event_head;
+        event_head = ev->next;
+        ev->next = RT_NULL;
+        ev->pending = 0;
+        ev->fn(ev->arg);
+    }
+}
+
+/* ==================== 随机数 ==================== */
+
+static uint32_t rand_state = 0x12345678;
+
+uint32_t sim_rand(void)
+{
+    /* xorshift32, 保证各平台结果一致 */
+    rand_state ^= rand_state << 13;
+    rand_state ^= rand_state >> 17;
+    rand_state ^= rand_state << 5;
+    return rand_state;
+}
+
+/**
+ * @brief 近似高斯噪声 (4个均匀分布求和), 标准差约为amplitude
+ */
+int32_t sim_rand_noise(int32_t amplitude)
+{
+    int64_t sum = 0;
+    int i;
+
+    if (amplitude <= 0)
+        return 0;
+    for (i = 0; i < 4; i++)
+        sum += (int64_t)(sim_rand() % 2001) - 1000;
+    /* 4个U(-1000,1000)之和的标准差约1155 */
+    return (int32_t)(sum * amplitude / 1155);
+}
+
+/* ==================== 命令 ==================== */
+
+#define CMD_MAX         32
+#define ARG_MAX         16
+
+static struct
+{
+    const char  *name;
+    sim_cmd_fn  fn;
+    const char  *help;
+} cmd_table[CMD_MAX];
+static int cmd_count = 0;
+
+void sim_cmd_register(const char *name, sim_cmd_fn fn, const char *help)
+{
+    RT_ASSERT(cmd_count < CMD_MAX);
+    cmd_table[cmd_count].name = name;
+    cmd_table[cmd_count].fn = fn;
+    cmd_table[cmd_count].help = help;
+    cmd_count++;
+}
+
+void sim_cmd_help(FILE *out)
+{
+    int i;
+
+    for (i = 0; i < cmd_count; i++)
+        fprintf(out, "  %s\n", cmd_table[i].help);
+}
+
+static int split_args(char *line, char **argv)
+{
+    int argc = 0;
+    char *p = line;
+
+    while (*p != '\0' && argc < ARG_MAX)
+    {
+        while (isspace((unsigned char)*p))
+            p++;
+        if (*p == '\0' || *p == '#')
+            break;
+        argv[argc++] = p;
+        while (*p != '\0' && !isspace((unsigned char)*p))
+            p++;
+        if (*p != '\0')
+            *p++ = '\0';
+    }
+    return argc;
+}
+
+int sim_cmd_exec_line(const char *line)
+{
+    char buf[256];
+    char *argv[ARG_MAX];
+    int argc, i, ret;
+
+    strncpy(buf, line, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+    argc = split_args(buf, argv);
+    if (argc == 0)
+        return 0;
+
+    for (i = 0; i < cmd_count; i++)
+    {
+        if (strcmp(cmd_table[i].name, argv[0]) == 0)
+        {
+            ret = cmd_table[i].fn(argc, argv);
+            if (ret != 0)
+                fprintf(stderr, "sim: command failed (%d): %s\n", ret, line);
+            return ret;
+        }
+    }
+    fprintf(stderr, "sim: unknown command: %s\n", argv[0]);
+    return -RT_ENOSYS;
+}
+
+/* ==================== 脚本 ==================== */
+
+struct script_event
+{
+    struct sim_event ev;
+    char line[240];
+};
+
+static void script_fire(void *arg)
+{
+    struct script_event *se = (struct script_event *)arg;
+
+    sim_cmd_exec_line(se->line);
+    free(se);
+}
+
+/**
+ * @brief 解析时间: "1500" / "1500ms" 为毫秒, "1.5s" 为秒, "200us" 为微秒
+ */
+uint64_t sim_parse_time_ns(const char *s)
+{
+    char *end;
+    double v = strtod(s, &end);
+
+    if (strcmp(end, "s") == 0)
+        return (uint64_t)(v * SIM_NS_PER_SEC);
+    if (strcmp(end, "us") == 0)
+        return (uint64_t)(v * SIM_NS_PER_US);
+    if (strcmp(end, "min") == 0)
+        return (uint64_t)(v * 60 * SIM_NS_PER_SEC);
+    if (strcmp(end, "h") == 0)
+        return (uint64_t)(v * 3600 * SIM_NS_PER_SEC);
+    return (uint64_t)(v * SIM_NS_PER_MS);
+}
+
+/**
+ * @brief 添加一条脚本: "<时间> <命令> [参数...]"
+ */
+int sim_script_add(const char *line)
+{
+    struct script_event *se;
+    char tbuf[32];
+    const char *p = line;
+    int n = 0;
+
+    while (isspace((unsigned char)*p))
+        p++;
+    if (*p == '\0' || *p == '#')
+        return 0;
+    while (*p != '\0' && !isspace((unsigned char)*p) && n < (int)sizeof(tbuf) - 1)
+        tbuf[n++] = *p++;
+    tbuf[n] = '\0';
+    while (isspace((unsigned char)*p))
+        p++;
+
+    se = calloc(1, sizeof(struct script_event));
+    if (se == RT_NULL)
+        return -RT_ENOMEM;
+    strncpy(se->line, p, sizeof(se->line) - 1);
+    se->line[strcspn(se->line, "\r\n")] = '\0';
+    sim_event_init(&se->ev, script_fire, se);
+    sim_event_schedule(&se->ev, sim_parse_time_ns(tbuf));
+    return 0;
+}
+
+int sim_script_load(const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    char line[256];
+    int ret = 0;
+
+    if (fp == RT_NULL)
+    {
+        fprintf(stderr, "sim: cannot open script %s\n", path);
+        return -RT_EIO;
+    }
+    while (ret == 0 && fgets(line, sizeof(line), fp) != RT_NULL)
+        ret = sim_script_add(line);
+    fclose(fp);
+    return ret;
+}
+
+/* ==================== 报告 ==================== */
+
+#define REPORT_MAX      16
+
+int sim_failures = 0;
+
+static struct
+{
+    const char      *name;
+    sim_report_fn   fn;
+} report_table[REPORT_MAX];
+static int report_count = 0;
+
+void sim_report_register(const char *name, sim_report_fn fn)
+{
+    RT_ASSERT(report_count < REPORT_MAX);
+    report_table[report_count].name = name;
+    report_table[report_count].fn = fn;
+    report_count++;
+}
+
+void sim_report(FILE *out)
+{
+    int i;
+
+    fprintf(out, "=== sim report @ %.3f s ===\n", sim_now_ns() / 1e9);
+    sim_kernel_report(out);
+    for (i = 0; i < report_count; i++)
+        report_table[i].fn(out);
+}
@@ -0,0 +1,130 @@
+/*
+ * 智能手环主机仿真 - 入口
+ *
+ * 用法: smartband_sim [-t 秒] [-s 脚本] [-c "时间 命令"] [-q]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "sim.h"
+
+/* applications/main.c 的main()在仿真中更名为rt_application_main */
+extern int rt_application_main(void);
+
+#define SHELL_LINE_MAX      128
+
+static rt_mq_t shell_mq = RT_NULL;
+
+/**
+ * @brief main线程: 组件初始化后进入应用main()
+ */
+static void main_thread_entry(void *parameter)
+{
+    rt_components_init();
+    rt_application_main();
+}
+
+/**
+ * @brief 仿真shell线程: 执行脚本中的 "msh <cmd>" 命令
+ */
+static void shell_thread_entry(void *parameter)
+{
+    char line[SHELL_LINE_MAX];
+    char *argv[16];
+    int argc;
+    char *p;
+
+    while (1)
+    {
+        if (rt_mq_recv(shell_mq, line, sizeof(line), RT_WAITING_FOREVER) != RT_EOK)
+            continue;
+
+        argc = 0;
+        for (p = strtok(line, " \t"); p != RT_NULL && argc < 16; p = strtok(RT_NULL, " \t"))
+            argv[argc++] = p;
+        rt_msh_exec(argc, argv);
+    }
+}
+
+static int msh_cmd(int argc, char **argv)
+{
+    char line[SHELL_LINE_MAX] = "";
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        strncat(line, argv[i], sizeof(line) - strlen(line) - 2);
+        strcat(line, " ");
+    }
+    return rt_mq_send(shell_mq, line, sizeof(line));
+}
+
+static int report_cmd(int argc, char **argv)
+{
+    sim_report(stdout);
+    if (sim_failures)
+    {
+        printf("sim: %d check(s) failed\n", sim_failures);
+        return 1;
+    }
+    return 0;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [-t seconds] [-s script] [-c \"<time> <cmd>\"] [-q]\n", prog);
+    fprintf(stderr, "script commands (\"<time> <cmd> ...\", time in ms or with s/us/min suffix):\n");
+    sim_cmd_help(stderr);
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = 10.0;
+    rt_thread_t tid;
+    int opt;
+
+    sim_cmd_register("msh", msh_cmd, "msh <command> [args]");
+    sim_cmd_register("report", report_cmd, "report");
+    sim_devices_init();
+
+    while ((opt = getopt(argc, argv, "t:s:c:qh")) != -1)
+    {
+        switch (opt)
+        {
+        case 't':
+            seconds = atof(optarg);
+            break;
+        case 's':
+            if (sim_script_load(optarg) != 0)
+                return 1;
+            break;
+        case 'c':
+            sim_script_add(optarg);
+            break;
+        case 'q':
+            sim_quiet = 1;
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    shell_mq = rt_mq_create("shell", SHELL_LINE_MAX, 8, RT_IPC_FLAG_FIFO);
+    tid = rt_thread_create("tshell", shell_thread_entry, RT_NULL,
+                           FINSH_THREAD_STACK_SIZE, FINSH_THREAD_PRIORITY, 10);
+    rt_thread_startup(tid);
+
+    sim_kernel_start(main_thread_entry);
+    sim_kernel_run((uint64_t)(seconds * SIM_NS_PER_SEC));
+
+    fflush(stdout);
+    sim_report(stdout);
+    if (sim_failures)
+    {
+        printf("sim: %d check(s) failed\n", sim_failures);
+        return 1;
+    }
+    return 0;
+}
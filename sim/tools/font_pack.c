@@ -0,0 +1,218 @@
+/*
+ * 字库压缩工具: 读取 font_src.h 中的未压缩字库, 生成固件使用的 drivers/oled_font.h
+ *
+ *   make -C sim fonts
+ *
+ * 每个字形的 宽x页 个字节逐个编为2位操作码 (低位在前, 每字节4个):
+ *   0 - 0x00
+ *   1 - 与同页左侧一列相同
+ *   2 - 字面字节, 按出现顺序跟在操作码之后
+ *   3 - 0xFF
+ * 字形变长, 每8个字形记录一次起始偏移; 组内其余字形按操作码中字面字节个数跳过.
+ *
+ * 大号数字 16x32 由 8x16 的 '-' ~ ':' 放大2倍得到.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "font_src.h"
+
+#define GLYPH_MAX   64
+
+struct font
+{
+    const char  *name;
+    const char  *desc;
+    int         width;
+    int         pages;
+    int         first;
+    int         count;
+    uint8_t     (*glyphs)[GLYPH_MAX];
+};
+
+static size_t total_raw, total_packed;
+
+/**
+ * @brief 编码一个字形
+ * @return 编码后字节数
+ */
+static int encode(const uint8_t *g, int width, int n, uint8_t *out)
+{
+    int ops = (n + 3) / 4, lit = ops, i;
+
+    memset(out, 0, ops);
+    for (i = 0; i < n; i++)
+    {
+        int op;
+
+        if (g[i] == 0x00)
+            op = 0;
+        else if (g[i] == 0xFF)
+            op = 3;
+        else if (i % width != 0 && g[i] == g[i - 1])
+            op = 1;
+        else
+        {
+            op = 2;
+            out[lit++] = g[i];
+        }
+        out[i / 4] |= op << ((i % 4) * 2);
+    }
+    return lit;
+}
+
+/* 与 drv_oled.c 中的解码相同, 用于校验 */
+static void decode(const uint8_t *in, int width, int n, uint8_t *g)
+{
+    const uint8_t *lit = in + (n + 3) / 4;
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        switch ((in[i / 4] >> ((i % 4) * 2)) & 3)
+        {
+        case 0: g[i] = 0x00; break;
+        case 1: g[i] = g[i - 1]; break;
+        case 2: g[i] = *lit++; break;
+        default: g[i] = 0xFF; break;
+        }
+    }
+    (void)width;
+}
+
+static void emit_bytes(const uint8_t *p, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        printf("%s0x%02X,%s", i % 16 == 0 ? "    " : "", p[i], i % 16 == 15 || i == n - 1 ? "\n" : "");
+}
+
+static int emit_font(const struct font *f)
+{
+    int n = f->width * f->pages, k, groups = (f->count + 7) / 8;
+    uint8_t *data = malloc((size_t)f->count * (GLYPH_MAX + GLYPH_MAX / 4));
+    uint16_t *index = malloc(sizeof(uint16_t) * groups);
+    size_t len = 0;
+
+    if (data == NULL || index == NULL)
+        return -1;
+
+    for (k = 0; k < f->count; k++)
+    {
+        uint8_t check[GLYPH_MAX];
+        int glen;
+
+        if (k % 8 == 0)
+        {
+            if (len > 0xFFFF)
+            {
+                fprintf(stderr, "font_pack: %s too large for 16-bit index\n", f->name);
+                return -1;
+            }
+            index[k / 8] = (uint16_t)len;
+        }
+        glen = encode(f->glyphs[k], f->width, n, data + len);
+        decode(data + len, f->width, n, check);
+        if (memcmp(check, f->glyphs[k], n) != 0)
+        {
+            fprintf(stderr, "font_pack: %s glyph %d does not round-trip\n", f->name, k);
+            return -1;
+        }
+        len += glen;
+    }
+
+    printf("/* %dx%d %s: %d个字形, 原始%d字节, 压缩后%zu字节 (含索引) */\n",
+           f->width, f->pages * 8, f->desc, f->count, f->count * n, len + groups * 2);
+    printf("static const uint16_t %s_index[] = {\n    ", f->name);
+    for (k = 0; k < groups; k++)
+        printf("%u,%s", index[k], k == groups - 1 ? "\n" : k % 12 == 11 ? "\n    " : " ");
+    printf("};\n");
+    printf("static const uint8_t %s_data[] = {\n", f->name);
+    emit_bytes(data, len);
+    printf("};\n");
+    printf("static const oled_font_t %s = {%d, %d, %d, %d, %s_index, %s_data};\n\n",
+           f->name, f->width, f->pages, f->first, f->count, f->name, f->name);
+
+    total_raw += (size_t)f->count * n;
+    total_packed += len + groups * 2;
+    free(data);
+    free(index);
+    return 0;
+}
+
+/**
+ * @brief 从按页排列的字库数组取字形
+ */
+static uint8_t (*load(const unsigned char *src, int width, int pages, int count))[GLYPH_MAX]
+{
+    uint8_t (*g)[GLYPH_MAX] = calloc(count, GLYPH_MAX);
+    int k;
+
+    for (k = 0; g != NULL && k < count; k++)
+        memcpy(g[k], src + (size_t)k * width * pages, width * pages);
+    return g;
+}
+
+/**
+ * @brief 8x16字形放大2倍为16x32
+ */
+static void upscale(const uint8_t *src, uint8_t *dst)
+{
+    int x, y;
+
+    memset(dst, 0, 64);
+    for (y = 0; y < 32; y++)
+        for (x = 0; x < 16; x++)
+            if ((src[(y / 16) * 8 + x / 2] >> ((y / 2) % 8)) & 1)
+                dst[(y / 8) * 16 + x] |= 1 << (y % 8);
+}
+
+int main(void)
+{
+    struct font fonts[4] = {
+        {"font6x8",   "ASCII",  6,  1, ' ', sizeof(F6x8) / 6},
+        {"font8x16",  "ASCII",  8,  2, ' ', sizeof(F8X16) / 16},
+        {"font16x32", "数字",   16, 4, '-', ':' - '-' + 1},
+        {"font16x16", "汉字",   16, 2, 0,   sizeof(F16x16) / 32},
+    };
+    int k;
+
+    fonts[0].glyphs = load(F6x8, 6, 1, fonts[0].count);
+    fonts[1].glyphs = load(F8X16, 8, 2, fonts[1].count);
+    fonts[2].glyphs = calloc(fonts[2].count, GLYPH_MAX);
+    fonts[3].glyphs = load(F16x16, 16, 2, fonts[3].count);
+    for (k = 0; k < 4; k++)
+    {
+        if (fonts[k].glyphs == NULL)
+            return 1;
+    }
+    for (k = 0; k < fonts[2].count; k++)
+        upscale(F8X16 + (size_t)(fonts[2].first + k - ' ') * 16, fonts[2].glyphs[k]);
+
+    printf("/*\n"
+           " * OLED字库 - 由 sim/tools/font_pack 从 sim/tools/font_src.h 生成, 请勿手工修改\n"
+           " * 压缩格式见 sim/tools/font_pack.c, 解码见 drv_oled.c\n"
+           " */\n"
+           "#ifndef __OLED_FONT_H__\n"
+           "#define __OLED_FONT_H__\n\n"
+           "#include <rtthread.h>\n\n"
+           "typedef struct {\n"
+           "    uint8_t  width;                 /* 字宽 (列) */\n"
+           "    uint8_t  pages;                 /* 字高 (页) */\n"
+           "    uint8_t  first;                 /* 首个字形的编码 */\n"
+           "    uint8_t  count;                 /* 字形数 */\n"
+           "    const uint16_t *index;          /* 每8个字形的起始偏移 */\n"
+           "    const uint8_t  *data;\n"
+           "} oled_font_t;\n\n");
+    for (k = 0; k < 4; k++)
+    {
+        if (emit_font(&fonts[k]) != 0)
+            return 1;
+    }
+    printf("#endif /* __OLED_FONT_H__ */\n");
+
+    fprintf(stderr, "font_pack: %zu bytes raw, %zu bytes packed\n", total_raw, total_packed);
+    return 0;
+}
@@ -0,0 +1,630 @@
+/*
+ * 记录会话批量分析: 多线程对大量PPG记录逐窗口计算心率血氧, 结果写入一个列式文件
+ *
+ *   ppg_batch [-j 线程数] [-w 窗口] [-s 步长] [-m bpf|ma4] [-o 输出.col] [-l 列表文件] [会话文件...]
+ *   ppg_batch -d 输出.col                         列式文件转为CSV打印
+ *   ppg_batch -G 数量 [-t 秒] 目录                 生成合成会话 (FIFO原始字节) 用于测试
+ *
+ * 会话文件格式与 bench_ppg_replay 相同: .csv 每行 "red,ir[,...]", 其他按MAX30102 FIFO
+ * 原始字节 (每样本6字节, 高位在前). 列表文件每行一个路径.
+ *
+ * 线程数默认为在线CPU数. 会话按文件大小从大到小排序后由各线程原子地领取,
+ * 每个线程有自己的 maxim_ctx_t 和解码缓冲区, 输入文件只读映射, 线程间
+ * 除领取序号和追加输出外不共享状态.
+ *
+ * 列式文件 (主机字节序):
+ *   文件头  "PPGCOL1\0"
+ *   行组    每会话一个, 按完成顺序追加:
+ *           uint32 会话序号, uint32 行数, 然后各列连续存放:
+ *           int32 end[] / int16 hr[] / int16 spo2[] / int8 hr_valid[] / int8 spo2_valid[]
+ *   索引    uint32 会话数, 按会话序号每项: uint64 行组偏移, uint32 行数, uint32 样本数,
+ *           uint16 名称长度, 名称
+ *   文件尾  uint64 索引偏移, "PPGCOL1\0"
+ * 行组偏移为0表示该会话无法读取.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "algorithm.h"
+#include "ppg_synth.h"
+#include "bench/bench.h"
+
+#define COL_MAGIC       "PPGCOL1"   /* 含结尾'\0'共8字节 */
+
+struct session
+{
+    const char *path;
+    off_t       size;               /* -1为stat失败 */
+    int         err;
+    uint64_t    offset;             /* 行组在输出文件中的偏移, 0为失败 */
+    uint32_t    rows;
+    uint32_t    samples;
+};
+
+struct worker
+{
+    pthread_t   tid;
+    int         id;
+    maxim_ctx_t ctx;
+    int32_t    *pn_work;            /* 窗口超过BUFFER_SIZE时的工作缓冲区 */
+
+    /* 解码缓冲区与行组缓冲区, 跨会话复用 */
+    uint32_t   *pun_ir, *pun_red;
+    uint32_t    un_cap;
+    uint8_t    *pch_group;
+    size_t      group_cap;
+
+    /* 统计 */
+    uint64_t    samples;
+    uint64_t    windows;
+    uint32_t    sessions;
+    uint32_t    errors;
+    uint64_t    cpu_ns;             /* 线程CPU时间 */
+    uint64_t    io_ns;              /* 等待输出锁与写出的时间 */
+};
+
+static struct session *sessions;
+static int      n_sessions;
+static int      next_session;
+static int      window = BUFFER_SIZE, step = FS;
+static const char *frontend = "bpf";
+static maxim_bpf_t bpf;
+
+static FILE    *out_fp;
+static uint64_t out_pos;
+static pthread_mutex_t out_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t thread_cpu_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* ==================== 输入 ==================== */
+
+static int reserve(struct worker *pw, uint32_t n)
+{
+    uint32_t *ir, *red;
+
+    if (n <= pw->un_cap)
+        return 0;
+    ir = realloc(pw->pun_ir, sizeof(uint32_t) * n);
+    if (ir == NULL)
+        return -1;
+    pw->pun_ir = ir;
+    red = realloc(pw->pun_red, sizeof(uint32_t) * n);
+    if (red == NULL)
+        return -1;
+    pw->pun_red = red;
+    pw->un_cap = n;
+    return 0;
+}
+
+/**
+ * @brief 解析一个十进制无符号数, 跳过前导空白
+ * @return 下一字符位置, 无数字返回NULL
+ */
+static const char *parse_ulong(const char *p, const char *end, unsigned long *val)
+{
+    unsigned long v = 0;
+    const char *s;
+
+    while (p < end && (*p == ' ' || *p == '\t'))
+        p++;
+    for (s = p; p < end && *p >= '0' && *p <= '9'; p++)
+        v = v * 10 + (unsigned long)(*p - '0');
+    if (p == s)
+        return NULL;
+    *val = v;
+    return p;
+}
+
+static int decode_csv(struct worker *pw, const char *p, const char *end)
+{
+    uint32_t n = 0;
+
+    /* 每行至少4字节 ("r,i\n"), 按此预留上限避免逐行扩容 */
+    if (reserve(pw, (uint32_t)((end - p) / 4 + 1)) < 0)
+        return -1;
+    while (p < end)
+    {
+        const char *eol = memchr(p, '\n', end - p);
+        const char *q;
+        unsigned long red, ir;
+
+        if (eol == NULL)
+            eol = end;
+        q = parse_ulong(p, eol, &red);
+        if (q != NULL && q < eol && *q == ',' && parse_ulong(q + 1, eol, &ir) != NULL)
+        {
+            pw->pun_red[n] = (uint32_t)red & 0x3FFFF;
+            pw->pun_ir[n] = (uint32_t)ir & 0x3FFFF;
+            n++;
+        }
+        p = eol + 1;
+    }
+    return (int)n;
+}
+
+static int decode_fifo_bin(struct worker *pw, const uint8_t *b, size_t len)
+{
+    uint32_t n = (uint32_t)(len / 6), i;
+
+    if (reserve(pw, n) < 0)
+        return -1;
+    for (i = 0; i < n; i++, b += 6)
+    {
+        pw->pun_red[i] = (((uint32_t)b[0] << 16) | ((uint32_t)b[1] << 8) | b[2]) & 0x3FFFF;
+        pw->pun_ir[i] = (((uint32_t)b[3] << 16) | ((uint32_t)b[4] << 8) | b[5]) & 0x3FFFF;
+    }
+    return (int)n;
+}
+
+/**
+ * @brief 映射并解码一个会话文件
+ * @return 样本数, 失败返回-1
+ */
+static int load_session(struct worker *pw, const struct session *ps)
+{
+    const char *ext = strrchr(ps->path, '.');
+    void *map;
+    int fd, n;
+
+    if (ps->size < 0)
+    {
+        errno = ps->err;
+        return -1;
+    }
+    if (ps->size == 0)
+        return 0;
+    fd = open(ps->path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    map = mmap(NULL, ps->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return -1;
+    madvise(map, ps->size, MADV_SEQUENTIAL);
+    if (ext != NULL && strcmp(ext, ".csv") == 0)
+        n = decode_csv(pw, map, (const char *)map + ps->size);
+    else
+        n = decode_fifo_bin(pw, map, ps->size);
+    munmap(map, ps->size);
+    return n;
+}
+
+/* ==================== 计算与输出 ==================== */
+
+static size_t group_size(uint32_t rows)
+{
+    return 8 + (size_t)rows * (4 + 2 + 2 + 1 + 1);
+}
+
+/**
+ * @brief 逐窗口计算一个会话, 结果按列填入行组缓冲区
+ * @return 行数, 内存不足返回-1
+ */
+static int analyze(struct worker *pw, int idx, int n)
+{
+    uint32_t rows = n >= window ? (uint32_t)((n - window) / step + 1) : 0, r;
+    size_t size = group_size(rows);
+    uint8_t *pch;
+    int32_t *pn_end;
+    int16_t *ps_hr, *ps_spo2;
+    int8_t *pch_hr_valid, *pch_spo2_valid;
+    uint32_t hdr[2];
+
+    if (size > pw->group_cap)
+    {
+        pch = realloc(pw->pch_group, size);
+        if (pch == NULL)
+            return -1;
+        pw->pch_group = pch;
+        pw->group_cap = size;
+    }
+    hdr[0] = (uint32_t)idx;
+    hdr[1] = rows;
+    memcpy(pw->pch_group, hdr, sizeof(hdr));
+    pn_end = (int32_t *)(pw->pch_group + 8);
+    ps_hr = (int16_t *)(pn_end + rows);
+    ps_spo2 = ps_hr + rows;
+    pch_hr_valid = (int8_t *)(ps_spo2 + rows);
+    pch_spo2_valid = pch_hr_valid + rows;
+
+    for (r = 0; r < rows; r++)
+    {
+        uint32_t start = r * (uint32_t)step;
+        maxim_view_t v_ir = {pw->pun_ir, 0xFFFFFFFF, start};
+        maxim_view_t v_red = {pw->pun_red, 0xFFFFFFFF, start};
+        int32_t hr, spo2;
+
+        maxim_ctx_calc(&pw->ctx, &v_ir, &v_red, window, &spo2, &pch_spo2_valid[r], &hr, &pch_hr_valid[r]);
+        pn_end[r] = (int32_t)(start + window - 1);
+        ps_hr[r] = (int16_t)hr;
+        ps_spo2[r] = (int16_t)spo2;
+    }
+    return (int)rows;
+}
+
+/**
+ * @brief 追加行组到输出文件, 返回其偏移, 失败返回0
+ */
+static uint64_t emit(struct worker *pw, uint32_t rows)
+{
+    size_t size = group_size(rows);
+    uint64_t t0 = bench_ns(), pos = 0;
+
+    pthread_mutex_lock(&out_lock);
+    if (fwrite(pw->pch_group, 1, size, out_fp) == size)
+    {
+        pos = out_pos;
+        out_pos += size;
+    }
+    pthread_mutex_unlock(&out_lock);
+    pw->io_ns += bench_ns() - t0;
+    return pos;
+}
+
+static void *worker_entry(void *parameter)
+{
+    struct worker *pw = parameter;
+    uint64_t cpu0 = thread_cpu_ns();
+    int idx;
+
+    maxim_ctx_init(&pw->ctx);
+    if (strcmp(frontend, "bpf") == 0)
+        maxim_ctx_set_bpf(&pw->ctx, &bpf);
+    if (pw->pn_work != NULL)
+        maxim_ctx_set_buffer(&pw->ctx, pw->pn_work, window);
+
+    while ((idx = __atomic_fetch_add(&next_session, 1, __ATOMIC_RELAXED)) < n_sessions)
+    {
+        struct session *ps = &sessions[idx];
+        int n = load_session(pw, ps), rows = 0;
+
+        if (n < 0 || (rows = analyze(pw, idx, n)) < 0)
+        {
+            fprintf(stderr, "%s: %s\n", ps->path, strerror(errno));
+            pw->errors++;
+            continue;
+        }
+        ps->samples = (uint32_t)n;
+        ps->rows = (uint32_t)rows;
+        ps->offset = emit(pw, (uint32_t)rows);
+        if (ps->offset == 0)
+        {
+            fprintf(stderr, "%s: write failed\n", ps->path);
+            pw->errors++;
+            continue;
+        }
+        pw->samples += (uint64_t)n;
+        pw->windows += rows;
+        pw->sessions++;
+    }
+    pw->cpu_ns = thread_cpu_ns() - cpu0;
+    return NULL;
+}
+
+static int write_index(void)
+{
+    uint64_t index_pos = out_pos;
+    uint32_t count = (uint32_t)n_sessions;
+    int i;
+
+    fwrite(&count, sizeof(count), 1, out_fp);
+    for (i = 0; i < n_sessions; i++)
+    {
+        const struct session *ps = &sessions[i];
+        const char *name = strrchr(ps->path, '/') ? strrchr(ps->path, '/') + 1 : ps->path;
+        uint16_t len = (uint16_t)strlen(name);
+
+        fwrite(&ps->offset, sizeof(ps->offset), 1, out_fp);
+        fwrite(&ps->rows, sizeof(ps->rows), 1, out_fp);
+        fwrite(&ps->samples, sizeof(ps->samples), 1, out_fp);
+        fwrite(&len, sizeof(len), 1, out_fp);
+        fwrite(name, 1, len, out_fp);
+    }
+    fwrite(&index_pos, sizeof(index_pos), 1, out_fp);
+    fwrite(COL_MAGIC, 1, 8, out_fp);
+    return ferror(out_fp) ? -1 : 0;
+}
+
+/* ==================== 会话列表 ==================== */
+
+static int add_session(const char *path)
+{
+    static int cap;
+    struct stat st;
+
+    if (n_sessions == cap)
+    {
+        cap = cap ? cap * 2 : 1024;
+        sessions = realloc(sessions, sizeof(*sessions) * cap);
+    }
+    memset(&sessions[n_sessions], 0, sizeof(*sessions));
+    sessions[n_sessions].path = path;
+    if (stat(path, &st) == 0)
+        sessions[n_sessions].size = st.st_size;
+    else
+    {
+        sessions[n_sessions].size = -1;
+        sessions[n_sessions].err = errno;
+    }
+    n_sessions++;
+    return 0;
+}
+
+static int add_list(const char *list)
+{
+    FILE *fp = fopen(list, "r");
+    char line[4096];
+
+    if (fp == NULL)
+        return -1;
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] != '\0' && line[0] != '#')
+            add_session(strdup(line));
+    }
+    fclose(fp);
+    return 0;
+}
+
+/* 大文件优先, 尾部只剩小会话, 各线程结束时间接近 */
+static int cmp_size_desc(const void *a, const void *b)
+{
+    off_t x = ((const struct session *)a)->size, y = ((const struct session *)b)->size;
+    return x > y ? -1 : x < y;
+}
+
+/* ==================== 辅助模式 ==================== */
+
+static int dump(const char *path)
+{
+    FILE *fp = fopen(path, "rb");
+    char magic[8];
+    uint64_t index_pos;
+    uint32_t count, i, r;
+
+    if (fp == NULL)
+        return -1;
+    if (fseek(fp, -16, SEEK_END) != 0 || fread(&index_pos, sizeof(index_pos), 1, fp) != 1 ||
+        fread(magic, 1, 8, fp) != 8 || memcmp(magic, COL_MAGIC, 8) != 0 ||
+        fseek(fp, (long)index_pos, SEEK_SET) != 0 || fread(&count, sizeof(count), 1, fp) != 1)
+    {
+        fprintf(stderr, "%s: not a ppg_batch column file\n", path);
+        fclose(fp);
+        return -1;
+    }
+
+    printf("session,end,hr,hr_valid,spo2,spo2_valid\n");
+    for (i = 0; i < count; i++)
+    {
+        uint64_t offset;
+        uint32_t rows, samples, hdr[2];
+        uint16_t len;
+        char name[65536];
+        long next;
+        int32_t *pn_end;
+        int16_t *ps_hr, *ps_spo2;
+        int8_t *pch_hr_valid, *pch_spo2_valid;
+        uint8_t *pch;
+
+        if (fread(&offset, 8, 1, fp) != 1 || fread(&rows, 4, 1, fp) != 1 ||
+            fread(&samples, 4, 1, fp) != 1 || fread(&len, 2, 1, fp) != 1 || fread(name, 1, len, fp) != len)
+            break;
+        name[len] = '\0';
+        next = ftell(fp);
+        if (offset == 0 || rows == 0)
+            continue;
+
+        pch = malloc(group_size(rows));
+        fseek(fp, (long)offset, SEEK_SET);
+        if (fread(pch, 1, group_size(rows), fp) == group_size(rows))
+        {
+            memcpy(hdr, pch, sizeof(hdr));
+            pn_end = (int32_t *)(pch + 8);
+            ps_hr = (int16_t *)(pn_end + rows);
+            ps_spo2 = ps_hr + rows;
+            pch_hr_valid = (int8_t *)(ps_spo2 + rows);
+            pch_spo2_valid = pch_hr_valid + rows;
+            for (r = 0; r < rows; r++)
+                printf("%s,%d,%d,%d,%d,%d\n", name, pn_end[r], ps_hr[r], pch_hr_valid[r],
+                       ps_spo2[r], pch_spo2_valid[r]);
+        }
+        free(pch);
+        fseek(fp, next, SEEK_SET);
+    }
+    fclose(fp);
+    return 0;
+}
+
+static int generate(const char *dir, int count, int seconds)
+{
+    uint8_t *buf = malloc((size_t)seconds * FS * 6);
+    char path[4096];
+    int k, i;
+
+    for (k = 0; k < count; k++)
+    {
+        struct ppg_synth s;
+        FILE *fp;
+
+        ppg_synth_init(&s, FS);
+        s.rng = 0x9E3779B9u * (uint32_t)(k + 1);
+        s.noise = 60;
+        s.wander = 600;
+        s.hrv = 0.03;
+        s.hr_bpm = 55 + k % 70;
+        s.spo2 = 94 + k % 6;
+        for (i = 0; i < seconds * FS; i++)
+        {
+            uint32_t red, ir;
+            uint8_t *b = buf + i * 6;
+
+            ppg_synth_next(&s, &red, &ir);
+            b[0] = red >> 16; b[1] = red >> 8; b[2] = red;
+            b[3] = ir >> 16; b[4] = ir >> 8; b[5] = ir;
+        }
+        snprintf(path, sizeof(path), "%s/sess_%05d.bin", dir, k);
+        fp = fopen(path, "wb");
+        if (fp == NULL || fwrite(buf, 6, (size_t)seconds * FS, fp) != (size_t)seconds * FS)
+        {
+            perror(path);
+            if (fp != NULL)
+                fclose(fp);
+            free(buf);
+            return -1;
+        }
+        fclose(fp);
+    }
+    free(buf);
+    printf("%d sessions of %d s written to %s\n", count, seconds, dir);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *output = "ppg_batch.col", *list = NULL, *dump_path = NULL;
+    int cores = (int)sysconf(_SC_NPROCESSORS_ONLN), threads = cores, gen = 0, gen_seconds = 600, opt, i;
+    struct worker *workers;
+    uint64_t t0, wall_ns, samples = 0, windows = 0, cpu_ns = 0, io_ns = 0;
+    double min_rate = 0, max_rate = 0;
+    unsigned errors = 0;
+
+    while ((opt = getopt(argc, argv, "j:w:s:m:o:l:d:G:t:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 'j': threads = atoi(optarg); break;
+        case 'w': window = atoi(optarg); break;
+        case 's': step = atoi(optarg); break;
+        case 'm': frontend = optarg; break;
+        case 'o': output = optarg; break;
+        case 'l': list = optarg; break;
+        case 'd': dump_path = optarg; break;
+        case 'G': gen = atoi(optarg); break;
+        case 't': gen_seconds = atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-j threads] [-w window] [-s step] [-m bpf|ma4] [-o out.col] [-l list] [session...]\n"
+                    "       %s -d out.col\n"
+                    "       %s -G count [-t seconds] dir\n", argv[0], argv[0], argv[0]);
+            return 2;
+        }
+    }
+
+    if (dump_path != NULL)
+        return dump(dump_path) < 0 ? 2 : 0;
+    if (gen > 0)
+    {
+        if (optind >= argc || gen_seconds < 1)
+        {
+            fprintf(stderr, "-G needs a directory and -t >= 1\n");
+            return 2;
+        }
+        return generate(argv[optind], gen, gen_seconds) < 0 ? 2 : 0;
+    }
+
+    if (window < MA4_SIZE || step < 1 || threads < 1)
+    {
+        fprintf(stderr, "window must be >= %d, step and threads >= 1\n", MA4_SIZE);
+        return 2;
+    }
+    if (strcmp(frontend, "bpf") == 0)
+        maxim_bpf_design(&bpf, FS, MAXIM_BPF_LO_HZ, MAXIM_BPF_HI_HZ);
+    else if (strcmp(frontend, "ma4") != 0)
+    {
+        fprintf(stderr, "front-end must be bpf or ma4\n");
+        return 2;
+    }
+
+    if (list != NULL && add_list(list) < 0)
+    {
+        perror(list);
+        return 2;
+    }
+    for (i = optind; i < argc; i++)
+        add_session(argv[i]);
+    if (n_sessions == 0)
+    {
+        fprintf(stderr, "no sessions given\n");
+        return 2;
+    }
+    qsort(sessions, n_sessions, sizeof(*sessions), cmp_size_desc);
+    if (threads > n_sessions)
+        threads = n_sessions;
+
+    out_fp = fopen(output, "wb");
+    if (out_fp == NULL)
+    {
+        perror(output);
+        return 2;
+    }
+    setvbuf(out_fp, NULL, _IOFBF, 1 << 20);
+    fwrite(COL_MAGIC, 1, 8, out_fp);
+    out_pos = 8;
+
+    workers = calloc(threads, sizeof(*workers));
+    t0 = bench_ns();
+    for (i = 0; i < threads; i++)
+    {
+        workers[i].id = i;
+        if (window > BUFFER_SIZE)
+            workers[i].pn_work = malloc(sizeof(int32_t) * window);
+        if (pthread_create(&workers[i].tid, NULL, worker_entry, &workers[i]) != 0)
+        {
+            fprintf(stderr, "cannot start worker %d\n", i);
+            return 2;
+        }
+    }
+    for (i = 0; i < threads; i++)
+        pthread_join(workers[i].tid, NULL);
+    wall_ns = bench_ns() - t0;
+
+    if (write_index() < 0 || fclose(out_fp) != 0)
+    {
+        perror(output);
+        return 2;
+    }
+
+    for (i = 0; i < threads; i++)
+    {
+        const struct worker *pw = &workers[i];
+        double rate = pw->cpu_ns ? pw->samples * 1e9 / pw->cpu_ns : 0;
+
+        samples += pw->samples;
+        windows += pw->windows;
+        cpu_ns += pw->cpu_ns;
+        io_ns += pw->io_ns;
+        errors += pw->errors;
+        if (i == 0 || rate < min_rate) min_rate = rate;
+        if (i == 0 || rate > max_rate) max_rate = rate;
+        free(pw->pun_ir);
+        free(pw->pun_red);
+        free(pw->pch_group);
+        free(pw->pn_work);
+    }
+
+    printf("%d sessions (%u failed), %llu samples (%.1f h @ %d Hz), %llu windows -> %s\n",
+           n_sessions, errors, (unsigned long long)samples, (double)samples / FS / 3600, FS,
+           (unsigned long long)windows, output);
+    printf("%s front-end, window %d, step %d, %d threads on %d cores\n",
+           frontend, window, step, threads, cores);
+    printf("wall %.3f s, cpu %.3f s, output lock+write %.3f s\n",
+           wall_ns / 1e9, cpu_ns / 1e9, io_ns / 1e9);
+    /* 每核吞吐按实际可并行的核数折算 */
+    printf("throughput: %.0f samples/s total, %.0f samples/s per core (wall), "
+           "per-thread cpu %.0f..%.0f samples/s\n",
+           samples * 1e9 / wall_ns, samples * 1e9 / wall_ns / min(threads, cores), min_rate, max_rate);
+
+    free(workers);
+    return errors ? 1 : 0;
+}